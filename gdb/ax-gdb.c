@@ -503,6 +503,19 @@ gen_extend (struct agent_expr *ax, struct type *type)
 }
 
 
+/* CUDA - memory segments */
+/* Remember the CUDA memory segment of a value of type TYPE, fetched by
+   the `ref' opcode about to be generated.  */
+static void
+gen_cuda_ref (struct agent_expr *ax, struct type *type)
+{
+  ax_cuda_ref_s ref;
+
+  ref.offset = ax->len;
+  ref.segment = TYPE_CUDA_ALL (type);
+  VEC_safe_push (ax_cuda_ref_s, ax->cuda_refs, &ref);
+}
+
 /* Assume that the top of the stack contains a value of type "pointer
    to TYPE"; generate code to fetch its value.  Note that TYPE is the
    target type, not the pointer type.  */
@@ -528,6 +541,7 @@ gen_fetch (struct agent_expr *ax, struct type *type)
     case TYPE_CODE_BOOL:
       /* It's a scalar value, so we know how to dereference it.  How
          many bytes long is it?  */
+      gen_cuda_ref (ax, type);
       switch (TYPE_LENGTH (type))
 	{
 	case 8 / TARGET_CHAR_BIT:
@@ -1368,6 +1382,7 @@ gen_bitfield_ref (struct expression *exp, struct agent_expr *ax,
 	    }
 
 	  /* Perform the fetch.  */
+	  gen_cuda_ref (ax, value->type);
 	  ax_simple (ax, ops[op]);
 
 	  /* Shift the bits we have to their proper position.
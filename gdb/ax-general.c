@@ -58,6 +58,9 @@ new_agent_expr (struct gdbarch *gdbarch, CORE_ADDR scope)
   x->reg_mask = xmalloc (x->reg_mask_len * sizeof (x->reg_mask[0]));
   memset (x->reg_mask, 0, x->reg_mask_len * sizeof (x->reg_mask[0]));
 
+  /* CUDA - memory segments */
+  x->cuda_refs = NULL;
+
   return x;
 }
 
@@ -67,6 +70,7 @@ free_agent_expr (struct agent_expr *x)
 {
   xfree (x->buf);
   xfree (x->reg_mask);
+  VEC_free (ax_cuda_ref_s, x->cuda_refs);
   xfree (x);
 }
 
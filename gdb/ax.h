@@ -91,6 +91,20 @@ union agent_val
     DOUBLEST d;
   };
 
+/* CUDA - memory segments */
+/* A `ref' opcode of an agent expression that fetches a value from a CUDA
+   memory segment.  */
+typedef struct ax_cuda_ref
+  {
+    /* The offset of the `ref' opcode in the bytecode.  */
+    int offset;
+
+    /* The TYPE_INSTANCE_FLAG_CUDA_* flags of the fetched value, zero if
+       the type is not qualified with a CUDA memory segment.  */
+    int segment;
+  } ax_cuda_ref_s;
+DEF_VEC_O (ax_cuda_ref_s);
+
 /* A buffer containing a agent expression.  */
 struct agent_expr
   {
@@ -143,6 +157,12 @@ struct agent_expr
     */
     int reg_mask_len;
     unsigned char *reg_mask;
+
+    /* CUDA - memory segments */
+    /* The bytecode has no notion of the CUDA memory segments.  For each
+       `ref' opcode generated to fetch a value, remember the CUDA type
+       instance flags of the value.  */
+    VEC (ax_cuda_ref_s) *cuda_refs;
   };
 
 /* Pointer to an agent_expr structure.  */
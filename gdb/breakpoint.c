@@ -106,6 +106,7 @@
 #include "cuda-modules.h"
 #include "cuda-context.h"
 #include "cuda-autostep.h"
+#include "cuda-bpcond.h"
 #include "cuda-elf-image.h"
 #include "cuda-options.h"
 #include "cuda-convvars.h"
@@ -993,6 +994,10 @@ set_breakpoint_condition (struct breakpoint *b, char *exp,
 	  xfree (loc->cond);
 	  loc->cond = NULL;
 
+	  /* CUDA - conditional breakpoints */
+	  cuda_bpcond_free (loc->cuda_cond);
+	  loc->cuda_cond = NULL;
+
 	  /* No need to free the condition agent expression
 	     bytecode (if we have one).  We will handle this
 	     when we go through update_global_location_list.  */
@@ -4734,21 +4739,37 @@ breakpoint_cond_eval (void *exp)
 }
 
 /* CUDA - conditional breakpoints */
+/* Return the mask of the LANES of warp WP that are stopped at PC. */
+
+static uint32_t
+cuda_warp_lanes_at_pc (uint32_t dev, uint32_t sm, uint32_t wp,
+                       uint32_t lanes, uint64_t pc)
+{
+  uint32_t ln;
+
+  for (ln = 0; ln < device_get_num_lanes (dev); ++ln)
+    if ((lanes & (1U << ln)) &&
+        lane_get_virtual_pc (dev, sm, wp, ln) != pc)
+      lanes &= ~(1U << ln);
+
+  return lanes;
+}
+
 /* Same as breakpoint_cond_eval, but iterate over all the lanes that have hit
-   a breakpoint in hardware as the frame is different every time. */
+   the breakpoint location in hardware as the frame is different every time.
+   The condition is evaluated for a whole warp at a time, see
+   cuda-bpcond.c. */
 
 static int
 cuda_breakpoint_cond_eval (void *data)
 {
   cuda_iterator iter;
-  struct expression *exp = (struct expression *) data;
-  struct value *mark = value_mark ();
+  struct bp_location *bl = (struct bp_location *) data;
   cuda_coords_t coords = CUDA_INVALID_COORDS, current = CUDA_INVALID_COORDS;
   cuda_coords_t filter = CUDA_WILDCARD_COORDS;
-  cuda_focus_t focus;
+  uint32_t dev = ~0U, sm = ~0U, wp = ~0U;
+  uint32_t lanes, hit_lanes = 0;
 
-  cuda_focus_init (&focus);
-  cuda_focus_save (&focus);
   iter = cuda_iterator_create (CUDA_ITERATOR_TYPE_THREADS, &filter,
                                CUDA_SELECT_VALID | CUDA_SELECT_BKPT);
 
@@ -4757,17 +4778,25 @@ cuda_breakpoint_cond_eval (void *data)
        cuda_iterator_next (iter))
     {
       current = cuda_iterator_get_current (iter);
-      switch_to_cuda_thread (&current);
 
-      if (!value_true (evaluate_expression (exp)))
+      if (current.dev != dev || current.sm != sm || current.wp != wp)
+        {
+          dev = current.dev;
+          sm  = current.sm;
+          wp  = current.wp;
+          lanes = warp_get_active_lanes_mask (dev, sm, wp);
+          lanes = cuda_warp_lanes_at_pc (dev, sm, wp, lanes, bl->address);
+          hit_lanes = cuda_bpcond_eval_warp (bl, dev, sm, wp, lanes, false);
+        }
+
+      if (!(hit_lanes & (1U << current.ln)))
         continue;
 
-      coords = cuda_iterator_get_current (iter);
+      coords = current;
       break;
     }
 
   cuda_iterator_destroy (iter);
-  cuda_focus_restore (&focus);
 
   if (coords.valid)
     {
@@ -4779,25 +4808,28 @@ cuda_breakpoint_cond_eval (void *data)
       switch_to_cuda_thread (&coords);
     }
 
-  value_free_to_mark (mark);
   return !coords.valid;
 }
 
 /* CUDA - breakpoints */
-/* For a valid thread, check if it hits a cuda breakpoint B_NUMBER.
-   It checks all cuda breakpoints when B_NUMBER == 0  */
-bool
-cuda_eval_thread_at_breakpoint (uint64_t pc, cuda_coords_t *c, int b_number)
-{
-  struct bp_location *bl, **bl_tmp;
+/* Return the mask of the valid lanes of warp WP, stopped at PC, that hit
+   cuda breakpoint B_NUMBER.  It checks all cuda breakpoints when
+   B_NUMBER == 0  */
+uint32_t
+cuda_eval_warp_at_breakpoint (uint64_t pc, uint32_t dev, uint32_t sm,
+                              uint32_t wp, int b_number)
+{
+  struct bp_location **locp = NULL, **loc2p, *bl;
   struct address_space *aspace = target_thread_address_space (inferior_ptid);
-  cuda_coords_t prev_coords;
-  bool cond_eval_result = false;
+  uint32_t lanes, hit_lanes = 0;
 
-  gdb_assert (lane_is_valid (c->dev, c->sm, c->wp, c->ln));
+  lanes = warp_get_valid_lanes_mask (dev, sm, wp);
+  lanes = cuda_warp_lanes_at_pc (dev, sm, wp, lanes, pc);
 
-  ALL_BP_LOCATIONS (bl, bl_tmp)
+  ALL_BP_LOCATIONS_AT_ADDR (loc2p, locp, pc)
     {
+      bl = *loc2p;
+
       if (!breakpoint_enabled (bl->owner) ||
           !bl->cuda_breakpoint ||
           bl->owner->number < 0 ||
@@ -4808,20 +4840,15 @@ cuda_eval_thread_at_breakpoint (uint64_t pc, cuda_coords_t *c, int b_number)
       if (b_number > 0 && b_number != bl->owner->number)
         continue;
 
-      /* Hit a non-conditional breakpoint. */
-      if (!bl->cond)
-        return true;
-
-      /* Hit a conditional breakpoint. Evaluate the condition for this thread. */
-      cuda_coords_get_current (&prev_coords);
-      switch_to_cuda_thread (c);
-      cond_eval_result = value_true (evaluate_expression (bl->cond));
-      switch_to_cuda_thread (&prev_coords);
-      if (cond_eval_result)
-        return true;
+      /* Evaluate the condition, if any, for the lanes that did not hit
+         another location yet. */
+      hit_lanes |= cuda_bpcond_eval_warp (bl, dev, sm, wp,
+                                          lanes & ~hit_lanes, true);
+      if (hit_lanes == lanes)
+        break;
     }
 
-  return false;
+  return hit_lanes;
 }
 
 /* Allocate a new bpstat.  Link it to the FIFO list by BS_LINK_POINTER.  */
@@ -5358,7 +5385,7 @@ bpstat_check_breakpoint_conditions (bpstat bs, ptid_t ptid)
               if (bl->cuda_breakpoint)
                 {
                   value_is_zero
-                    = catch_errors (cuda_breakpoint_cond_eval, (cond),
+                    = catch_errors (cuda_breakpoint_cond_eval, (void *) bl,
                                     "Error in testing CUDA breakpoint condition:\n",
                                     RETURN_MASK_ALL);
                 }
@@ -13894,6 +13921,7 @@ bp_location_dtor (struct bp_location *self)
   xfree (self->cond);
   if (self->cond_bytecode)
     free_agent_expr (self->cond_bytecode);
+  cuda_bpcond_free (self->cuda_cond);
   xfree (self->function_name);
 }
 
@@ -537,6 +537,11 @@ struct bp_location
      of the device kernel/function is not available upon re-setting the
      breakpoint. */
   bool cuda_breakpoint;
+
+  /* CUDA - conditional breakpoints */
+  /* The condition compiled for device lanes, see cuda-bpcond.c.  NULL
+     until the condition is first evaluated on the device.  */
+  struct cuda_bpcond *cuda_cond;
 };
 
 /* Return values for bpstat_explains_signal.  Note that the order of
@@ -1635,7 +1640,8 @@ extern void check_tracepoint_command (char *line, void *closure);
 struct breakpoint *cuda_find_autostep_by_addr (CORE_ADDR address);
 
 /* CUDA - breakpoint */
-bool cuda_eval_thread_at_breakpoint (uint64_t pc, cuda_coords_t *c, int b_number);
+uint32_t cuda_eval_warp_at_breakpoint (uint64_t pc, uint32_t dev, uint32_t sm,
+                                       uint32_t wp, int b_number);
 
 /* CUDA - auto breakpoints */
 void cuda_auto_breakpoints_add_locations (void);
@@ -0,0 +1,185 @@
+#! /bin/sh
+#
+# NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2015 NVIDIA Corporation
+# Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 3 as
+# published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+# Performance regression suite for the CUDA state code, run on the
+# simulated GPU of libcudacore ("target cudacore mock:PARAMETERS"), so
+# that it needs no GPU.
+#
+# For every grid size, opens the simulated GPU, lists the kernels, blocks,
+# warps and threads, switches the focus between threads, reads registers
+# and local, shared and global memory, and filters the threads at a
+# conditional device breakpoint.  Reports the wall time, the number of
+# debugger API calls and the number of lanes in the register cache after
+# every step.
+#
+# The registers steps read a register of FOCUS new threads each, so that
+# the register cache grows from one step to the next while the number of
+# lookups stays the same: their wall time should not grow with it.
+#
+# The breakpoint step sets a breakpoint at the entry of the first kernel,
+# where the simulated GPU stops a quarter of the warps, on a condition on a
+# register: the kernels have no debug information.  The condition is
+# evaluated for every lane at the breakpoint.
+#
+# Usage:
+#   cuda-mock-bench.sh [GDB]
+#
+# Environment:
+#   SIZES    threads per grid
+#            (default: 1000 10000 100000 1000000 10000000)
+#   DEVICE   parameters of the simulated GPU
+#            (default: warps=64,block=256,pcs=4,exceptions=1)
+#   LATENCY  delay of every API call in microseconds (default: 0)
+#   FOCUS    number of focus switches (default: 32)
+#   ROUNDS   number of registers steps (default: 4)
+#   KEEP     directory to keep the command files and logs in
+#
+# Blocks are 256 threads and the first 64 blocks must be resident on the
+# simulated GPU.  Unless DEVICE sets "sms", the simulated GPU has enough SMs
+# for the whole grid to be resident, so that every size measures its own
+# state.
+
+GDB=${1:-./gdb}
+SIZES=${SIZES:-"1000 10000 100000 1000000 10000000"}
+DEVICE=${DEVICE:-"warps=64,block=256,pcs=4,exceptions=1"}
+LATENCY=${LATENCY:-0}
+FOCUS=${FOCUS:-32}
+ROUNDS=${ROUNDS:-4}
+
+if test -n "$KEEP"; then
+  TMP=$KEEP
+  mkdir -p "$TMP" || exit 2
+else
+  TMP=`mktemp -d /tmp/cuda-mock-bench.XXXXXX` || exit 2
+  trap 'rm -rf "$TMP"' 0
+fi
+
+# Print "@@ STEP" before the commands of a step, and the statistics after
+step ()
+{
+  printf 'echo @@ %s\\n\n' "$1"
+}
+
+stats ()
+{
+  printf 'echo @@ -\\n\n'
+  echo "maint print cuda_stats"
+}
+
+commands ()
+{
+  threads=$1
+  blocks=`expr \( $threads + 255 \) / 256 - 1`
+  test $blocks -gt 64 && blocks=64
+  test $blocks -lt 1 && blocks=1
+
+  echo "set pagination off"
+  echo "set confirm off"
+  echo "set width 0"
+  echo "maint time 1"
+
+  step open
+  echo "target cudacore mock:$DEVICE,latency=$LATENCY,threads=$threads"
+  stats
+
+  for info in kernels blocks warps threads; do
+    step "info-$info"
+    echo "info cuda $info"
+    stats
+  done
+
+  step focus
+  i=0
+  while test $i -lt $FOCUS; do
+    echo "cuda block (`expr $i \* 7 % $blocks`,0,0) thread (`expr $i \* 37 % 200`,0,0)"
+    i=`expr $i + 1`
+  done
+  stats
+
+  r=0
+  while test $r -lt $ROUNDS; do
+    step "registers-$r"
+    i=0
+    while test $i -lt $FOCUS; do
+      n=`expr $r \* $FOCUS + $i`
+      echo "cuda block (`expr $n % $blocks`,0,0) thread (`expr $n / $blocks % 256`,0,0)"
+      echo "output \$R1"
+      i=`expr $i + 1`
+    done
+    stats
+    r=`expr $r + 1`
+  done
+
+  step memory
+  echo "cuda block (0,0,0) thread (0,0,0)"
+  echo "x/1024xw (@local int *) 0"
+  echo "x/1024xw (@shared int *) 0"
+  echo "x/512xg (@global long *) 0x200000000"
+  stats
+
+  step breakpoint
+  echo "cuda block (0,0,0) thread (0,0,0)"
+  echo "break mock_kernel_0 if \$R1 == 0"
+  echo "info cuda threads breakpoint all"
+  stats
+}
+
+printf "%-10s %-12s %12s %12s %12s\n" threads step "wall (s)" "API calls" \
+       "reg lanes"
+
+for threads in $SIZES; do
+  commands $threads > "$TMP/bench-$threads.gdb"
+  "$GDB" -nx -batch -x "$TMP/bench-$threads.gdb" < /dev/null \
+    > "$TMP/bench-$threads.log" 2>&1
+
+  awk -v threads=$threads '
+    /^@@ / {
+      skip = 1            # the time of the echo command itself
+      timing = ($2 != "-")
+      if (timing)
+        order[++n] = step = $2
+      next
+    }
+    /^Command execution time:/ {
+      if (skip)
+        skip = 0
+      else if (timing) {
+        wall = $0
+        sub(/.*\(cpu\), */, "", wall)
+        sub(/ *\(wall\).*/, "", wall)
+        time[step] += wall
+      }
+      next
+    }
+    /^Simulated GPU: [0-9]+ API calls/ {
+      calls[step] = $3 - total
+      total = $3
+    }
+    /^Register cache: .* lanes cached/ {
+      lanes[step] = $(NF - 2)
+    }
+    END {
+      for (i = 1; i <= n; i++)
+        printf "%-10s %-12s %12.6f %12d %12d\n", threads, order[i],
+               time[order[i]], calls[order[i]], lanes[order[i]]
+    }' "$TMP/bench-$threads.log"
+
+  if grep -q "^Could not open CUDA core file" "$TMP/bench-$threads.log"; then
+    echo "$threads: failed to open the simulated GPU, see $TMP/bench-$threads.log" >&2
+    test -n "$KEEP" || trap - 0
+  fi
+done
@@ -27,10 +27,12 @@
 #include "gdb_string.h"
 #include "gdbcore.h"
 
+#include "cuda-memcache.h"
 #include "cuda-options.h"
 #include "cuda-tdep.h"
 #include "cuda-packet-manager.h"
 #include "cuda-utils.h"
+#include "libcudbg.h"
 
 
 static void
@@ -88,12 +90,22 @@ static CUDBGAPI cudbgAPI = NULL;
 
 static bool api_initialized = false;
 
+/* True when cudbgAPI is the libcudbg client, which can pipeline reads */
+static bool api_batching = false;
+
 static cuda_attach_state_t attach_state = CUDA_ATTACH_STATE_NOT_STARTED;
 
 void
 cuda_api_set_api (CUDBGAPI api)
 {
   cudbgAPI = api;
+  api_batching = false;
+}
+
+void
+cuda_api_set_batching (bool batching)
+{
+  api_batching = batching;
 }
 
 void
@@ -819,6 +831,9 @@ cuda_api_write_generic_memory (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t
   if (!api_initialized)
     return;
 
+  /* Any write may alias cached device memory, whatever its segment */
+  cuda_memcache_invalidate ();
+
   res = cudbgAPI->writeGenericMemory (dev, sm, wp, ln, addr, buf, sz);
   cuda_api_print_api_call_result (res);
   if (res != CUDBG_SUCCESS && res != CUDBG_ERROR_ADDRESS_NOT_IN_DEVICE_MEM)
@@ -844,6 +859,8 @@ cuda_api_write_pinned_memory (uint64_t addr, const void *buf, uint32_t sz)
   if (!api_initialized)
     return false;
 
+  cuda_memcache_invalidate ();
+
   res = cudbgAPI->writePinnedMemory (addr, buf, sz);
   cuda_api_print_api_call_result (res);
   if (res != CUDBG_SUCCESS && res != CUDBG_ERROR_MEMORY_MAPPING_FAILED)
@@ -859,6 +876,8 @@ cuda_api_write_param_memory (uint32_t dev, uint32_t sm, uint32_t wp, uint64_t ad
   if (!api_initialized)
     return;
 
+  cuda_memcache_invalidate ();
+
   res = cudbgAPI->writeParamMemory (dev, sm, wp, addr, buf, sz);
   cuda_api_print_api_call_result (res);
   if (res != CUDBG_SUCCESS)
@@ -875,6 +894,8 @@ cuda_api_write_shared_memory (uint32_t dev, uint32_t sm, uint32_t wp, uint64_t a
   if (!api_initialized)
     return;
 
+  cuda_memcache_invalidate ();
+
   res = cudbgAPI->writeSharedMemory (dev, sm, wp, addr, buf, sz);
   cuda_api_print_api_call_result (res);
   if (res != CUDBG_SUCCESS)
@@ -891,6 +912,8 @@ cuda_api_write_local_memory (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln
   if (!api_initialized)
     return;
 
+  cuda_memcache_invalidate ();
+
   res = cudbgAPI->writeLocalMemory (dev, sm, wp, ln, addr, buf, sz);
   cuda_api_print_api_call_result (res);
   if (res != CUDBG_SUCCESS)
@@ -1437,6 +1460,8 @@ cuda_api_write_global_memory (uint64_t addr, const void *buf, uint32_t buf_size)
   if (!api_initialized)
     return;
 
+  cuda_memcache_invalidate ();
+
   res = cudbgAPI->writeGlobalMemory (addr, (void *)buf, buf_size);
   cuda_api_print_api_call_result (res);
 
@@ -1464,3 +1489,259 @@ cuda_api_get_managed_memory_region_info (uint64_t start_addr, CUDBGMemoryInfo *m
                     entries_count, (unsigned long long)start_addr);
 }
 
+
+/******************************************************************************
+ *
+ *                                Batched reads
+ *
+ ******************************************************************************/
+
+/* Reads issued between cuda_api_batch_begin and cuda_api_batch_flush are sent
+   to the debugger backend together. The destination buffers are only filled
+   in, and errors only reported, once the batch is flushed. The result of a
+   "try" read is stored for the caller instead of being reported. */
+
+#define CUDA_API_BATCH_MAX  128
+#define CUDA_API_BATCH_NONE (~0U)
+
+typedef struct {
+  CUDBGResult res;
+  CUDBGResult *result;
+  const char *what;
+  uint32_t    dev;
+  uint32_t    sm;
+  uint32_t    wp;
+  uint32_t    ln;
+} cuda_api_batch_entry_t;
+
+static cuda_api_batch_entry_t batch_entries[CUDA_API_BATCH_MAX];
+static uint32_t batch_count = 0;
+static bool     batch_open = false;
+
+/* True when the reads of a batch are pipelined: the API is the libcudbg
+   client and "set cuda batched_reads" is on. */
+static bool
+cuda_api_batching (void)
+{
+  return api_batching && cuda_options_batched_reads_enabled ();
+}
+
+/* True when the reads of a batch cost a single round trip.  Otherwise every
+   read is performed as soon as it is queued. */
+bool
+cuda_api_batch_supported (void)
+{
+  return api_initialized && cuda_api_batching () && cudbgBatchSupported ();
+}
+
+void
+cuda_api_batch_begin (void)
+{
+  gdb_assert (!batch_open);
+
+  batch_open = true;
+  batch_count = 0;
+
+  if (api_initialized && cuda_api_batching ())
+    cudbgBatchBegin ();
+}
+
+void
+cuda_api_batch_flush (void)
+{
+  cuda_api_batch_entry_t *entry;
+  uint32_t count = batch_count;
+  uint32_t i;
+
+  gdb_assert (batch_open);
+
+  batch_open = false;
+  batch_count = 0;
+
+  if (api_initialized && cuda_api_batching ())
+    cudbgBatchFlush ();
+
+  for (i = 0; i < count; ++i)
+    {
+      entry = &batch_entries[i];
+      if (entry->result)
+        {
+          *entry->result = entry->res;
+          continue;
+        }
+
+      cuda_api_print_api_call_result (entry->res);
+      if (entry->res == CUDBG_SUCCESS)
+        continue;
+
+      if (entry->wp == CUDA_API_BATCH_NONE)
+        cuda_api_error (entry->res, _("Failed to %s (dev=%u, sm=%u)"),
+                        entry->what, entry->dev, entry->sm);
+      else if (entry->ln == CUDA_API_BATCH_NONE)
+        cuda_devsmwp_api_error (entry->what, entry->dev, entry->sm, entry->wp,
+                                entry->res);
+      else
+        cuda_devsmwpln_api_error (entry->what, entry->dev, entry->sm,
+                                  entry->wp, entry->ln, entry->res);
+    }
+}
+
+static cuda_api_batch_entry_t *
+cuda_api_batch_entry (const char *what, uint32_t dev, uint32_t sm,
+                      uint32_t wp, uint32_t ln)
+{
+  cuda_api_batch_entry_t *entry;
+
+  gdb_assert (batch_open);
+
+  /* The reads queued so far stay valid, only the errors come in early */
+  if (batch_count == CUDA_API_BATCH_MAX)
+    {
+      cuda_api_batch_flush ();
+      cuda_api_batch_begin ();
+    }
+
+  entry = &batch_entries[batch_count++];
+  entry->res  = CUDBG_SUCCESS;
+  entry->result = NULL;
+  entry->what = what;
+  entry->dev  = dev;
+  entry->sm   = sm;
+  entry->wp   = wp;
+  entry->ln   = ln;
+
+  return entry;
+}
+
+/* A read that could not even be queued fails on its own */
+static void
+cuda_api_batch_queued (cuda_api_batch_entry_t *entry, CUDBGResult res)
+{
+  if (res != CUDBG_SUCCESS)
+    entry->res = res;
+}
+
+void
+cuda_api_batch_read_valid_warps (uint32_t dev, uint32_t sm, uint64_t *valid_warps)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read the valid warps mask"), dev, sm,
+                                CUDA_API_BATCH_NONE, CUDA_API_BATCH_NONE);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadValidWarps (dev, sm, valid_warps, &entry->res));
+  else
+    entry->res = cudbgAPI->readValidWarps (dev, sm, valid_warps);
+}
+
+void
+cuda_api_batch_read_broken_warps (uint32_t dev, uint32_t sm, uint64_t *broken_warps)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read the broken warps mask"), dev, sm,
+                                CUDA_API_BATCH_NONE, CUDA_API_BATCH_NONE);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadBrokenWarps (dev, sm, broken_warps, &entry->res));
+  else
+    entry->res = cudbgAPI->readBrokenWarps (dev, sm, broken_warps);
+}
+
+void
+cuda_api_batch_read_warp_state (uint32_t dev, uint32_t sm, uint32_t wp, CUDBGWarpState *state)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("get warp state"), dev, sm, wp,
+                                CUDA_API_BATCH_NONE);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadWarpState (dev, sm, wp, state, &entry->res));
+  else
+    entry->res = cudbgAPI->readWarpState (dev, sm, wp, state);
+}
+
+void
+cuda_api_batch_read_thread_idx (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, CuDim3 *threadIdx)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read thread index"), dev, sm, wp, ln);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadThreadIdx (dev, sm, wp, ln, threadIdx, &entry->res));
+  else
+    entry->res = cudbgAPI->readThreadIdx (dev, sm, wp, ln, threadIdx);
+}
+
+void
+cuda_api_batch_read_pc (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *pc)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read the program counter"), dev, sm, wp, ln);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadPC (dev, sm, wp, ln, pc, &entry->res));
+  else
+    entry->res = cudbgAPI->readPC (dev, sm, wp, ln, pc);
+}
+
+void
+cuda_api_batch_try_read_pc (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *pc, CUDBGResult *res)
+{
+  cuda_api_batch_entry_t *entry;
+
+  *res = CUDBG_ERROR_UNINITIALIZED;
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read the program counter"), dev, sm, wp, ln);
+  entry->result = res;
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadPC (dev, sm, wp, ln, pc, &entry->res));
+  else
+    entry->res = cudbgAPI->readPC (dev, sm, wp, ln, pc);
+}
+
+void
+cuda_api_batch_read_register_range (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint32_t idx, uint32_t count, uint32_t *regs)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read register range"), dev, sm, wp, ln);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadRegisterRange (dev, sm, wp, ln, idx, count, regs, &entry->res));
+  else
+    entry->res = cudbgAPI->readRegisterRange (dev, sm, wp, ln, idx, count, regs);
+}
+
+void
+cuda_api_batch_read_generic_memory (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t addr, void *buf, uint32_t sz)
+{
+  cuda_api_batch_entry_t *entry;
+
+  if (!api_initialized)
+    return;
+
+  entry = cuda_api_batch_entry (_("read generic memory"), dev, sm, wp, ln);
+  if (cuda_api_batching ())
+    cuda_api_batch_queued (entry, cudbgBatchReadGenericMemory (dev, sm, wp, ln, addr, buf, sz, &entry->res));
+  else
+    entry->res = cudbgAPI->readGenericMemory (dev, sm, wp, ln, addr, buf, sz);
+}
@@ -39,6 +39,7 @@ void cuda_api_handle_initialization_error (CUDBGResult res);
 void cuda_api_handle_get_api_error (CUDBGResult res);
 void cuda_api_handle_finalize_api_error (CUDBGResult res);
 void cuda_api_set_api (CUDBGAPI api);
+void cuda_api_set_batching (bool batching);
 int  cuda_api_initialize (void);
 void cuda_api_initialize_attach_stub (void);
 void cuda_api_finalize (void);
@@ -141,5 +142,18 @@ void cuda_api_set_kernel_launch_notification_mode (CUDBGKernelLaunchNotifyMode m
 
 /* Memcheck related */
 void cuda_api_memcheck_read_error_address(uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *address, ptxStorageKind *storage);
+
+/* Batched reads */
+bool cuda_api_batch_supported (void);
+void cuda_api_batch_begin (void);
+void cuda_api_batch_flush (void);
+void cuda_api_batch_read_valid_warps (uint32_t dev, uint32_t sm, uint64_t *valid_warps);
+void cuda_api_batch_read_broken_warps (uint32_t dev, uint32_t sm, uint64_t *broken_warps);
+void cuda_api_batch_read_warp_state (uint32_t dev, uint32_t sm, uint32_t wp, CUDBGWarpState *state);
+void cuda_api_batch_read_thread_idx (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, CuDim3 *threadIdx);
+void cuda_api_batch_read_pc (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *pc);
+void cuda_api_batch_try_read_pc (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *pc, CUDBGResult *res);
+void cuda_api_batch_read_register_range (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint32_t idx, uint32_t count, uint32_t *regs);
+void cuda_api_batch_read_generic_memory (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t addr, void *buf, uint32_t sz);
 #endif
 
@@ -46,34 +46,200 @@ struct inst_st {
   uint64_t      pc;      /* the PC of the disassembled instruction */
   char         *text;    /* the dissassembled instruction */
   uint32_t      size;    /* size of the instruction in bytes */
-  inst_t next;           /* the next element in the list */
+  uint32_t      cf;      /* control-flow class, see CUDA_CF_* */
+  uint64_t      target;  /* target PC if CUDA_CF_DIRECT */
+  uint64_t      stop_pc; /* first control-flow instruction from here on */
+  uint64_t      stop_pc_no_calls; /* same, when stepping over calls */
 };
 
-static inst_t
-inst_create (uint64_t pc, const char *text, uint32_t size, inst_t next)
+/* Instructions a warp cannot be resumed past while single-stepping,
+   matched against the disassembled text. */
+static const struct {
+  const char *pattern;
+  uint32_t    cf;
+} inst_cf_table[] = {
+  { "SSY",      CUDA_CF_SYNC },
+  { "BAR.SYNC", CUDA_CF_BARRIER },
+  { "BAR.RED",  CUDA_CF_BARRIER },
+  { "BRA",      CUDA_CF_BRANCH },
+  { "BRK",      CUDA_CF_BRANCH },
+  { "NOP.S",    CUDA_CF_SYNC },
+  { "SYNC",     CUDA_CF_SYNC },
+  { "EXIT",     CUDA_CF_EXIT },
+  { "RET",      CUDA_CF_EXIT },
+  { "JMP",      CUDA_CF_BRANCH },
+  { "CAL",      CUDA_CF_CALL },     /* CAL and JCAL */
+};
+
+/* Return the control-flow class of the instruction TEXT.  For a plain
+   "BRA 0x<offset>", with no predicate nor condition code, CUDA_CF_DIRECT
+   is set and the function-relative target is stored in TARGET_OFFSET. */
+uint32_t
+disasm_classify_instruction (const char *text, uint64_t *target_offset)
 {
-  inst_t inst;
-  int len;
+  unsigned long long offset;
+  uint32_t cf = 0;
+  uint32_t i;
+  int n = 0;
 
-  gdb_assert (text);
+  if (!text)
+    return 0;
+
+  for (i = 0; i < sizeof inst_cf_table / sizeof inst_cf_table[0]; ++i)
+    if (strstr (text, inst_cf_table[i].pattern))
+      cf |= inst_cf_table[i].cf;
+
+  if (cf == CUDA_CF_BRANCH &&
+      sscanf (text, " BRA 0x%llx %n", &offset, &n) == 1 && n > 0 && text[n] == 0)
+    {
+      cf |= CUDA_CF_DIRECT;
+      if (target_offset)
+        *target_offset = offset;
+    }
 
-  len = strlen (text);
-  inst = xmalloc (sizeof *inst);
-  inst->text= xmalloc (len + 1);
+  return cf;
+}
 
-  inst->pc   = pc;
-  inst->text= strncpy (inst->text, text, len + 1);
-  inst->next = next;
-  inst->size = size;
+static int
+inst_compare (const void *a, const void *b)
+{
+  const struct inst_st *inst_a = a;
+  const struct inst_st *inst_b = b;
 
-  return inst;
+  if (inst_a->pc != inst_b->pc)
+    return inst_a->pc < inst_b->pc ? -1 : 1;
+  return 0;
+}
+
+
+/******************************************************************************
+ *
+ *                        One Disassembled Function
+ *
+ *****************************************************************************/
+
+typedef struct disasm_function_st *disasm_function_t;
+
+struct disasm_function_st {
+  uint64_t         entry_pc;    /* entry PC of the function */
+  uint64_t         end_pc;      /* PC right after the last instruction */
+  uint32_t         num_insts;   /* number of disassembled instructions */
+  uint32_t         max_insts;   /* allocated size of the insts array */
+  struct inst_st  *insts;       /* the instructions, sorted by PC */
+  uint64_t         last_use;    /* LRU timestamp */
+};
+
+static disasm_function_t
+disasm_function_create (uint64_t entry_pc)
+{
+  disasm_function_t function;
+
+  function = xmalloc (sizeof *function);
+
+  function->entry_pc  = entry_pc;
+  function->end_pc    = entry_pc;
+  function->num_insts = 0;
+  function->max_insts = 0;
+  function->insts     = NULL;
+  function->last_use  = 0;
+
+  return function;
 }
 
 static void
-inst_destroy (inst_t inst)
+disasm_function_destroy (disasm_function_t function)
 {
-  xfree (inst->text);
-  xfree (inst);
+  uint32_t i;
+
+  for (i = 0; i < function->num_insts; ++i)
+    xfree (function->insts[i].text);
+  xfree (function->insts);
+  xfree (function);
+}
+
+static void
+disasm_function_add_instruction (disasm_function_t function, uint64_t pc,
+                                 const char *text, uint32_t size)
+{
+  struct inst_st *inst;
+
+  gdb_assert (text);
+
+  if (function->num_insts == function->max_insts)
+    {
+      function->max_insts = function->max_insts ? function->max_insts * 2 : 64;
+      function->insts = xrealloc (function->insts,
+                                  function->max_insts * sizeof *function->insts);
+    }
+
+  inst = &function->insts[function->num_insts++];
+  inst->pc     = pc;
+  inst->text   = xstrdup (text);
+  inst->size   = size;
+  inst->target = 0;
+  inst->cf     = disasm_classify_instruction (text, &inst->target);
+  if (inst->cf & CUDA_CF_DIRECT)
+    inst->target += function->entry_pc;
+
+  if (pc + size > function->end_pc)
+    function->end_pc = pc + size;
+}
+
+/* cuobjdump lists the instructions in address order, so sorting is only
+   needed when it does not.  Once sorted, the control-flow map is built:
+   every instruction records the PC of the next instruction a warp cannot
+   be resumed past, which is a control-flow instruction or a hole in the
+   disassembly. */
+static void
+disasm_function_finalize (disasm_function_t function)
+{
+  struct inst_st *inst, *next;
+  uint32_t i;
+
+  for (i = 1; i < function->num_insts; ++i)
+    if (function->insts[i - 1].pc > function->insts[i].pc)
+      {
+        qsort (function->insts, function->num_insts,
+               sizeof *function->insts, inst_compare);
+        break;
+      }
+
+  for (i = function->num_insts; i-- > 0; )
+    {
+      inst = &function->insts[i];
+      next = i + 1 < function->num_insts &&
+             function->insts[i + 1].pc == inst->pc + inst->size
+             ? &function->insts[i + 1] : NULL;
+
+      if (inst->cf)
+        inst->stop_pc = inst->pc;
+      else
+        inst->stop_pc = next ? next->stop_pc : inst->pc + inst->size;
+
+      if (inst->cf & ~CUDA_CF_CALL)
+        inst->stop_pc_no_calls = inst->pc;
+      else
+        inst->stop_pc_no_calls = next ? next->stop_pc_no_calls : inst->pc + inst->size;
+    }
+}
+
+static struct inst_st *
+disasm_function_find_instruction (disasm_function_t function, uint64_t pc)
+{
+  uint32_t low = 0, high = function->num_insts, mid;
+
+  while (low < high)
+    {
+      mid = low + (high - low) / 2;
+      if (function->insts[mid].pc < pc)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  if (low < function->num_insts && function->insts[low].pc == pc)
+    return &function->insts[low];
+  return NULL;
 }
 
 
@@ -83,22 +249,44 @@ inst_destroy (inst_t inst)
  *
  *****************************************************************************/
 
+/* Upper bound on the number of instructions kept per ELF image. Least
+   recently used functions are evicted first once the bound is reached. */
+#define DISASM_CACHE_MAX_INSTS (1 << 16)
+
 struct disasm_cache_st {
-  bool       cached;            /* have we already tried to populate this disasm_cache */
-  uint64_t   entry_pc;          /* entry PC of the function being cached */
-  inst_t     head;              /* head of the list of instructions */
+  elf_image_t        elf_image;     /* the ELF image being disassembled */
+  uint32_t           num_functions; /* number of cached functions */
+  uint32_t           max_functions; /* allocated size of the functions array */
+  disasm_function_t *functions;     /* cached functions, sorted by entry PC */
+  uint64_t           num_insts;     /* instructions cached over all functions */
 };
 
+static struct {
+  uint64_t clock;
+  uint64_t lookups;
+  uint64_t hits;
+  uint64_t spawns;
+  uint64_t evictions;
+  uint64_t stop_pc_lookups;
+  uint64_t branches_followed;
+} disasm_cache_stats;
+
+/* The device memory path does not cache anything. The last instruction read
+   is kept here so that the returned text outlives the call. */
+static char disasm_cache_device_inst[512];
+
 disasm_cache_t
-disasm_cache_create (void)
+disasm_cache_create (elf_image_t elf_image)
 {
   disasm_cache_t disasm_cache;
 
   disasm_cache = xmalloc (sizeof *disasm_cache);
 
-  disasm_cache->cached     = false;
-  disasm_cache->entry_pc   = 0ULL;
-  disasm_cache->head       = NULL;
+  disasm_cache->elf_image     = elf_image;
+  disasm_cache->num_functions = 0;
+  disasm_cache->max_functions = 0;
+  disasm_cache->functions     = NULL;
+  disasm_cache->num_insts     = 0;
 
   return disasm_cache;
 }
@@ -106,19 +294,17 @@ disasm_cache_create (void)
 void
 disasm_cache_flush (disasm_cache_t disasm_cache)
 {
-  inst_t inst = disasm_cache->head;
-  inst_t next_inst;
+  uint32_t i;
 
-  while (inst)
-    {
-      next_inst = inst->next;
-      inst_destroy (inst);
-      inst = next_inst;
-    }
+  for (i = 0; i < disasm_cache->num_functions; ++i)
+    disasm_function_destroy (disasm_cache->functions[i]);
 
-  disasm_cache->cached     = false;
-  disasm_cache->entry_pc   = 0ULL;
-  disasm_cache->head       = NULL;
+  xfree (disasm_cache->functions);
+
+  disasm_cache->num_functions = 0;
+  disasm_cache->max_functions = 0;
+  disasm_cache->functions     = NULL;
+  disasm_cache->num_insts     = 0;
 }
 
 void
@@ -129,6 +315,104 @@ disasm_cache_destroy (disasm_cache_t disasm_cache)
   xfree (disasm_cache);
 }
 
+/* Index of the first cached function whose entry PC is not below PC */
+static uint32_t
+disasm_cache_lower_bound (disasm_cache_t disasm_cache, uint64_t pc)
+{
+  uint32_t low = 0, high = disasm_cache->num_functions, mid;
+
+  while (low < high)
+    {
+      mid = low + (high - low) / 2;
+      if (disasm_cache->functions[mid]->entry_pc < pc)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+/* Return the cached function that either starts at PC or whose
+   disassembled instructions cover PC. */
+static disasm_function_t
+disasm_cache_lookup (disasm_cache_t disasm_cache, uint64_t pc)
+{
+  disasm_function_t function;
+  uint32_t idx;
+
+  idx = disasm_cache_lower_bound (disasm_cache, pc);
+  if (idx < disasm_cache->num_functions &&
+      disasm_cache->functions[idx]->entry_pc == pc)
+    return disasm_cache->functions[idx];
+
+  if (idx == 0)
+    return NULL;
+
+  function = disasm_cache->functions[idx - 1];
+  return pc < function->end_pc ? function : NULL;
+}
+
+static void
+disasm_cache_remove (disasm_cache_t disasm_cache, uint32_t idx)
+{
+  disasm_function_t function = disasm_cache->functions[idx];
+
+  disasm_cache->num_insts -= function->num_insts;
+  disasm_cache->num_functions--;
+  memmove (&disasm_cache->functions[idx], &disasm_cache->functions[idx + 1],
+           (disasm_cache->num_functions - idx) * sizeof *disasm_cache->functions);
+  disasm_function_destroy (function);
+}
+
+/* Evict the least recently used functions, but never KEEP, until the cache
+   fits within DISASM_CACHE_MAX_INSTS. */
+static void
+disasm_cache_evict (disasm_cache_t disasm_cache, disasm_function_t keep)
+{
+  uint32_t i, victim;
+
+  while (disasm_cache->num_insts > DISASM_CACHE_MAX_INSTS &&
+         disasm_cache->num_functions > 1)
+    {
+      victim = disasm_cache->num_functions;
+      for (i = 0; i < disasm_cache->num_functions; ++i)
+        if (disasm_cache->functions[i] != keep &&
+            (victim == disasm_cache->num_functions ||
+             disasm_cache->functions[i]->last_use <
+             disasm_cache->functions[victim]->last_use))
+          victim = i;
+
+      cuda_trace ("disasm cache: evicting function at 0x%llx",
+                  (unsigned long long) disasm_cache->functions[victim]->entry_pc);
+      disasm_cache_remove (disasm_cache, victim);
+      disasm_cache_stats.evictions++;
+    }
+}
+
+/* Insert a newly created function. The function is inserted before it is
+   populated so that a failed cuobjdump run is not retried on every lookup. */
+static void
+disasm_cache_insert (disasm_cache_t disasm_cache, disasm_function_t function)
+{
+  uint32_t idx;
+
+  if (disasm_cache->num_functions == disasm_cache->max_functions)
+    {
+      disasm_cache->max_functions = disasm_cache->max_functions
+                                    ? disasm_cache->max_functions * 2 : 16;
+      disasm_cache->functions = xrealloc (disasm_cache->functions,
+                                          disasm_cache->max_functions
+                                          * sizeof *disasm_cache->functions);
+    }
+
+  idx = disasm_cache_lower_bound (disasm_cache, function->entry_pc);
+  memmove (&disasm_cache->functions[idx + 1], &disasm_cache->functions[idx],
+           (disasm_cache->num_functions - idx) * sizeof *disasm_cache->functions);
+  disasm_cache->functions[idx] = function;
+  disasm_cache->num_functions++;
+}
+
 extern char *gdb_program_name;
 
 static int
@@ -254,50 +538,34 @@ disasm_cache_parse_line(const char *line, char *insn, uint64_t *offs, uint32_t *
 }
 
 static void
-disasm_cache_populate_from_elf_image (disasm_cache_t disasm_cache, uint64_t pc)
+disasm_cache_populate_from_elf_image (disasm_cache_t disasm_cache,
+                                      disasm_function_t function, uint64_t pc)
 {
-  kernel_t kernel;
-  module_t module;
-  elf_image_t elf_img;
-  struct objfile *objfile;
-  uint32_t devId, size;
-  uint64_t ofst = 0, entry_pc = 0;
+  uint32_t size;
+  uint64_t ofst = 0, prev_end;
   FILE *sass;
   char command[1024], line[1024], header[1024];
-  char *filename;
+  const char *filename;
   const char *function_name;
   char *function_base_name;
   char text[INSN_MAX_LENGTH];
   bool header_found = false;
 
-  entry_pc = get_pc_function_start (pc);
-  /* Exit early if PC does not belong to the code segment */
-  if (entry_pc == 0)
-    return;
-  /* early exit if already cached */
-  if (disasm_cache->cached && disasm_cache->entry_pc == entry_pc)
-    return;
-
-  disasm_cache_flush (disasm_cache);
-  disasm_cache->cached = true;
-  disasm_cache->entry_pc = entry_pc;
-
   /* collect all the necessary data */
-  kernel      = cuda_current_kernel ();
-  module      = kernel_get_module (kernel);
-  elf_img     = module_get_elf_image (module);
-  objfile     = cuda_elf_image_get_objfile (elf_img);
-  filename    = objfile->name;
   function_name = cuda_find_function_name_from_pc (pc, false);
 
   /* Could not disasemble outside of the symbol boundaries */
   if (!function_name)
     return;
 
+  /* cuobjdump needs the image on disk */
+  filename = cuda_elf_image_get_path (disasm_cache->elf_image);
+
   /* generate the dissassembled code using cuobjdump if available */
   snprintf (command, sizeof (command), "%s --function %s --dump-sass %s",
             find_cuobjdump(), function_name, filename);
   sass = popen (command, "r");
+  disasm_cache_stats.spawns++;
 
   if (!sass)
     throw_error (GENERIC_ERROR, "Cannot disassemble from the ELF image.");
@@ -321,6 +589,7 @@ disasm_cache_populate_from_elf_image (disasm_cache_t disasm_cache, uint64_t pc)
     }
 
   /* parse the sass output and insert each instruction individually */
+  prev_end = function->entry_pc;
   while (fgets (line, sizeof (line), sass) != NULL)
     {
       /* stop reading at the first white line */
@@ -330,71 +599,192 @@ disasm_cache_populate_from_elf_image (disasm_cache_t disasm_cache, uint64_t pc)
        if (!disasm_cache_parse_line (line, text, &ofst, &size))
          continue;
        if (ofst == (uint64_t)-1LL)
-           ofst = disasm_cache->head ? disasm_cache->head->pc + disasm_cache->head->size : entry_pc;
+           ofst = prev_end;
        else
-           ofst += entry_pc;
+           ofst += function->entry_pc;
 
       /* add the instruction to the cache at the found offset */
-      disasm_cache->head = inst_create (ofst, text, size, disasm_cache->head);
+      disasm_function_add_instruction (function, ofst, text, size);
+      prev_end = ofst + size;
     }
 
   /* close the sass file */
   pclose (sass);
 
+  disasm_function_finalize (function);
+  disasm_cache->num_insts += function->num_insts;
+
   /* we expect to always being able to diassemble at least one instruction */
-  if (cuda_options_debug_strict () && !disasm_cache->head)
+  if (cuda_options_debug_strict () && function->num_insts == 0)
     throw_error (GENERIC_ERROR, "Unable to disassemble a single device instruction.");
 }
 
-static void
-disasm_cache_read_from_device_memory (disasm_cache_t disasm_cache, uint64_t pc, uint32_t *inst_size)
+/* Return the disassembled function containing PC, disassembling it first
+   if needed. */
+static disasm_function_t
+disasm_cache_get_function (disasm_cache_t disasm_cache, uint64_t pc)
 {
-  char buf[512];
-  uint32_t devId;
+  disasm_function_t function;
+  uint64_t entry_pc = 0;
 
-  /* no caching */
-  disasm_cache_flush (disasm_cache);
+  if (!disasm_cache || !cuda_elf_image_is_loaded (disasm_cache->elf_image))
+    return NULL;
+
+  disasm_cache_stats.lookups++;
+
+  /* Only resolve the function symbol when PC is not inside the
+     instructions of an already disassembled function. */
+  function = disasm_cache_lookup (disasm_cache, pc);
+  if (!function)
+    {
+      entry_pc = get_pc_function_start (pc);
+      /* Exit early if PC does not belong to the code segment */
+      if (entry_pc == 0)
+        return NULL;
+      function = disasm_cache_lookup (disasm_cache, entry_pc);
+    }
+
+  if (function)
+    disasm_cache_stats.hits++;
+  else
+    {
+      function = disasm_function_create (entry_pc);
+      disasm_cache_insert (disasm_cache, function);
+      disasm_cache_populate_from_elf_image (disasm_cache, function, pc);
+      disasm_cache_evict (disasm_cache, function);
+    }
+
+  function->last_use = ++disasm_cache_stats.clock;
+
+  return function;
+}
+
+static const char *
+disasm_cache_find_in_elf_image (disasm_cache_t disasm_cache,
+                                uint64_t pc, uint32_t *inst_size)
+{
+  disasm_function_t function;
+  struct inst_st *inst;
+
+  function = disasm_cache_get_function (disasm_cache, pc);
+  if (!function)
+    return NULL;
+
+  inst = disasm_function_find_instruction (function, pc);
+  if (!inst)
+    return NULL;
+
+  *inst_size = inst->size;
+  return inst->text;
+}
+
+static const char *
+disasm_cache_read_from_device_memory (uint64_t pc, uint32_t *inst_size)
+{
+  uint32_t devId;
 
   if (!cuda_initialized)
-    return;
+    return NULL;
 
-  buf[0] = 0;
+  disasm_cache_device_inst[0] = 0;
   devId = cuda_current_device ();
-  cuda_api_disassemble (devId, pc, inst_size, buf, sizeof (buf));
+  cuda_api_disassemble (devId, pc, inst_size, disasm_cache_device_inst,
+                        sizeof (disasm_cache_device_inst));
 
-  disasm_cache->head = inst_create (pc, buf, *inst_size, disasm_cache->head);
+  return disasm_cache_device_inst;
 }
 
 const char *
 disasm_cache_find_instruction (disasm_cache_t disasm_cache,
                                uint64_t pc, uint32_t *inst_size)
 {
-  inst_t inst = NULL;
+  const char *text;
 
   if (!cuda_focus_is_device ())
     return NULL;
 
   /* compute the disassembled instruction */
   if (cuda_options_disassemble_from_elf_image ())
-    disasm_cache_populate_from_elf_image (disasm_cache, pc);
+    text = disasm_cache_find_in_elf_image (disasm_cache, pc, inst_size);
   else
-    disasm_cache_read_from_device_memory (disasm_cache, pc, inst_size);
+    text = disasm_cache_read_from_device_memory (pc, inst_size);
 
+  /* return the instruction or NULL if not found */
+  if (!text)
+    *inst_size = 4;
 
-  /* find the cached disassembled instruction. */
-  for (inst = disasm_cache->head; inst; inst = inst->next)
-    if (inst->pc == pc)
-      break;
+  return text;
+}
 
-  /* return the instruction or NULL if not found */
-  if (inst && inst->text)
+/* Find how far a warp at PC can be resumed while stepping through
+   [RANGE_START, RANGE_END): up to the next control-flow instruction, or
+   the end of the range.  Unconditional forward branches whose target is
+   in the range are followed, the warp takes them without diverging.
+   Returns false if the control-flow map of the function is not
+   available, i.e. when disassembling from device memory. */
+bool
+disasm_cache_find_stop_pc (disasm_cache_t disasm_cache, uint64_t pc,
+                           uint64_t range_start, uint64_t range_end,
+                           bool skip_subroutines, uint64_t *stop_pc,
+                           uint32_t *inst_size, uint32_t *branches)
+{
+  disasm_function_t function;
+  struct inst_st *inst, *branch;
+  uint64_t stop;
+
+  if (!cuda_focus_is_device () || !cuda_options_disassemble_from_elf_image ())
+    return false;
+
+  function = disasm_cache_get_function (disasm_cache, pc);
+  if (!function)
+    return false;
+
+  disasm_cache_stats.stop_pc_lookups++;
+  *branches = 0;
+
+  inst = disasm_function_find_instruction (function, pc);
+  if (!inst)
     {
-      *inst_size = inst->size;
-      return inst->text;
+      *stop_pc = pc;
+      *inst_size = 4;
+      return true;
     }
-  else
+  *inst_size = inst->size;
+
+  for (;;)
     {
-      *inst_size = 4;
-      return NULL;
+      stop = skip_subroutines ? inst->stop_pc_no_calls : inst->stop_pc;
+      if (stop >= range_end)
+        break;
+
+      branch = disasm_function_find_instruction (function, stop);
+      if (!branch || branch->cf != (CUDA_CF_BRANCH | CUDA_CF_DIRECT) ||
+          branch->target <= branch->pc ||
+          branch->target < range_start || branch->target >= range_end)
+        break;
+
+      inst = disasm_function_find_instruction (function, branch->target);
+      if (!inst)
+        break;
+
+      ++*branches;
+      disasm_cache_stats.branches_followed++;
     }
+
+  *stop_pc = min (stop, range_end);
+  return true;
+}
+
+void
+disasm_cache_print_statistics (void)
+{
+  printf_unfiltered (_("Disassembly cache: %llu lookups, %llu hits, "
+                       "%llu cuobjdump runs, %llu evictions, "
+                       "%llu stop PC lookups, %llu branches followed\n"),
+                     (unsigned long long) disasm_cache_stats.lookups,
+                     (unsigned long long) disasm_cache_stats.hits,
+                     (unsigned long long) disasm_cache_stats.spawns,
+                     (unsigned long long) disasm_cache_stats.evictions,
+                     (unsigned long long) disasm_cache_stats.stop_pc_lookups,
+                     (unsigned long long) disasm_cache_stats.branches_followed);
 }
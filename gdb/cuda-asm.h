@@ -21,11 +21,30 @@
 
 #include "cuda-defs.h"
 
-disasm_cache_t disasm_cache_create           (void);
+/* Control-flow classes of a device instruction */
+#define CUDA_CF_BRANCH  0x01   /* branch, jump or loop break */
+#define CUDA_CF_SYNC    0x02   /* divergence/convergence point */
+#define CUDA_CF_BARRIER 0x04   /* block-wide barrier */
+#define CUDA_CF_CALL    0x08   /* subroutine call */
+#define CUDA_CF_EXIT    0x10   /* thread exit or subroutine return */
+#define CUDA_CF_DIRECT  0x20   /* unconditional branch to a known offset */
+
+uint32_t       disasm_classify_instruction   (const char *text,
+                                              uint64_t *target_offset);
+
+disasm_cache_t disasm_cache_create           (elf_image_t elf_image);
 void           disasm_cache_destroy          (disasm_cache_t disasm_cache);
 void           disasm_cache_flush            (disasm_cache_t disasm_cache);
 const char *   disasm_cache_find_instruction (disasm_cache_t disasm_cache,
                                               uint64_t pc, uint32_t
                                               *inst_size);
+bool           disasm_cache_find_stop_pc     (disasm_cache_t disasm_cache,
+                                              uint64_t pc, uint64_t range_start,
+                                              uint64_t range_end,
+                                              bool skip_subroutines,
+                                              uint64_t *stop_pc,
+                                              uint32_t *inst_size,
+                                              uint32_t *branches);
+void           disasm_cache_print_statistics (void);
 
 #endif
@@ -20,13 +20,17 @@
 #include "gdbthread.h"
 #include "arch-utils.h"
 #include "regcache.h"
+#include "vec.h"
 
 #include <block.h>
+#include <sys/time.h>
 
 #include "cuda-autostep.h"
 #include "cuda-state.h"
 #include "cuda-iterator.h"
 #include "cuda-frame.h"
+#include "cuda-linecache.h"
+#include "cuda-options.h"
 
 /* When inside an autostep range, we go into single-step mode */
 static bool autostep_stepping = false;
@@ -81,7 +85,7 @@ autostep_report_exception_host (uint64_t before_pc)
   struct type *type_uint32   = builtin_type (gdbarch)->builtin_uint32;
   struct type *type_data_ptr = builtin_type (gdbarch)->builtin_data_ptr;
 
-  struct symtab_and_line before_sal = find_pc_line (before_pc, 0);
+  struct symtab_and_line before_sal = cuda_linecache_find_pc_line (before_pc);
 
   printf_filtered (_("Autostep precisely caught exception at %s:%d (0x%llx)\n"),
     before_sal.symtab->filename, before_sal.line, (unsigned long long)before_pc);
@@ -111,7 +115,7 @@ autostep_report_exception_device (int before_ln, uint64_t before_pc,
       /* Exception in active lane. We know the exception must have been at the
          previous pc */
 
-      struct symtab_and_line before_sal = find_pc_line (before_pc, 0);
+      struct symtab_and_line before_sal = cuda_linecache_find_pc_line (before_pc);
 
       if (before_sal.symtab && before_sal.line)
         printf_filtered (_("Autostep precisely caught exception at %s:%d (0x%llx)\n"),
@@ -136,7 +140,7 @@ autostep_report_exception_device (int before_ln, uint64_t before_pc,
 
       cuda_api_get_adjusted_code_address (c.dev, after_pc, &guess_pc, CUDBG_ADJ_PREVIOUS_ADDRESS);
 
-      guess_sal = find_pc_line (guess_pc, 0);
+      guess_sal = cuda_linecache_find_pc_line (guess_pc);
 
       printf_filtered (_("Autostep caught exception at instruction before 0x%llx\n"),
         (unsigned long long)after_pc);
@@ -243,22 +247,95 @@ find_end_pc(uint64_t pc)
   return (uint64_t)-1LL;
 }
 
-/* Single steps all the warps that are at an autostep */
+/* Warps of one SM, stopped at the same PC of the same grid and autostep,
+   that are single-stepped together.  C holds the coordinates of the warp
+   the group was started from. */
+typedef struct {
+  cuda_coords_t      c;
+  uint64_t           warp_mask;
+  uint64_t           pc;
+  struct breakpoint *astep;
+  int                remaining;
+} autostep_group_t;
+
+DEF_VEC_O (autostep_group_t);
+
+static struct {
+  uint64_t groups;
+  uint64_t warps;
+  uint64_t steps;
+  uint64_t warp_steps;
+  double   time;
+} cuda_autostep_stats;
+
 static void
-handle_autostep_device ()
+autostep_reset_lockstep_mask (void *unused)
+{
+  cuda_sstep_set_lockstep_mask (0ULL);
+}
+
+/* Queue the warps of WARP_MASK, on the SM of C, as new groups continuing
+   ASTEP with REMAINING steps left, one group per PC. */
+static void
+autostep_split_group (VEC (autostep_group_t) **groups, const cuda_coords_t *c,
+                      uint64_t warp_mask, struct breakpoint *astep,
+                      int remaining)
+{
+  autostep_group_t g;
+  uint32_t wp, other;
+
+  if (remaining <= 0)
+    return;
+
+  for (wp = 0; warp_mask && wp < device_get_num_warps (c->dev); ++wp)
+    {
+      if (!(warp_mask & (1ULL << wp)))
+        continue;
+
+      g.c         = *c;
+      g.c.wp      = wp;
+      g.pc        = warp_get_active_virtual_pc (c->dev, c->sm, wp);
+      g.astep     = astep;
+      g.remaining = remaining;
+      g.warp_mask = 1ULL << wp;
+      warp_mask  &= ~g.warp_mask;
+
+      /* Warps with a higher id that stopped at the same PC.  Only
+         instruction autosteps are taken in lock-step, see
+         autostep_collect_groups. */
+      for (other = wp + 1;
+           astep->cuda_autostep_length_type == cuda_autostep_insts &&
+           other < device_get_num_warps (c->dev); ++other)
+        if (warp_mask & (1ULL << other) &&
+            warp_get_active_virtual_pc (c->dev, c->sm, other) == g.pc)
+          g.warp_mask |= 1ULL << other;
+      warp_mask &= ~g.warp_mask;
+
+      VEC_safe_push (autostep_group_t, *groups, &g);
+      cuda_autostep_stats.groups++;
+    }
+}
+
+/* Group the warps of the current grid that are at an enabled autostep.
+   Warps of the same SM at the same PC and instruction autostep share a
+   group.  Each warp is stepped on its own for line autosteps, which have
+   to stop at the end of the line of every warp, and when software
+   preemption is enabled, where warps can move between SMs after every
+   step. */
+static void
+autostep_collect_groups (VEC (autostep_group_t) **groups)
 {
   cuda_iterator iter;
-  cuda_coords_t after_coords;
-  struct breakpoint *astep, *overlap;
-  uint64_t before_pc, after_pc, end_pc;
-  int remaining;
+  struct breakpoint *astep;
   struct cleanup *old_cleanups;
-  bool single_inst;
   cuda_coords_t filter;
+  autostep_group_t *g, new_group;
+  uint64_t pc;
   const char *sm_type;
+  bool lockstep;
+  int i;
 
-  /* This suppresses printing of the line after each step */
-  cuda_set_autostep_stepping (true);
+  lockstep = !cuda_options_software_preemption ();
 
   /* Iterate through all warps in current grid that are at a breakpoint */
 
@@ -273,27 +350,15 @@ handle_autostep_device ()
     (void*)iter);
 
   cuda_iterator_start (iter);
-  while (cuda_focus_is_device () && !cuda_iterator_end (iter))
+  while (!cuda_iterator_end (iter))
     {
-      cuda_coords_t curc, nextc, c;
-      int before_ln;
-
-      /* We look only at logical coordinates from iterator.
-         Physical coordinates can change with Software Preemption enabled
-         after each step (on all warps, not just currently stepped). */
-      curc = cuda_iterator_get_current (iter);
-      c = curc; /* This will be used as an up to date physical coordinate holder. */
+      cuda_coords_t c, nextc;
 
-      /* Update physical coordinates */
-      cuda_coords_complete_physical (&c);
-
-      /* Make sure the warp didn't become invalid */
-      if (!warp_is_valid (c.dev, c.sm, c.wp))
-        goto next_warp;
+      c = cuda_iterator_get_current (iter);
 
       /* Check we're at the autostep bp */
-      before_pc = warp_get_active_virtual_pc (c.dev, c.sm, c.wp);
-      astep = cuda_find_autostep_by_addr (before_pc);
+      pc = warp_get_active_virtual_pc (c.dev, c.sm, c.wp);
+      astep = cuda_find_autostep_by_addr (pc);
       if (astep == NULL || astep->enable_state != bp_enabled)
         goto next_warp;
 
@@ -308,15 +373,121 @@ handle_autostep_device ()
           goto next_warp;
         }
 
+      cuda_autostep_stats.warps++;
+
+      for (i = 0;
+           lockstep && astep->cuda_autostep_length_type == cuda_autostep_insts &&
+           VEC_iterate (autostep_group_t, *groups, i, g); ++i)
+        if (g->c.dev == c.dev && g->c.sm == c.sm && g->c.gridId == c.gridId &&
+            g->pc == pc && g->astep == astep)
+          {
+            g->warp_mask |= 1ULL << c.wp;
+            goto next_warp;
+          }
+
+      new_group.c         = c;
+      new_group.warp_mask = 1ULL << c.wp;
+      new_group.pc        = pc;
+      new_group.astep     = astep;
+      new_group.remaining = astep->cuda_autostep_length;
+      VEC_safe_push (autostep_group_t, *groups, &new_group);
+      cuda_autostep_stats.groups++;
+
+next_warp:
+      /* Skip to next warp */
+      do {
+        cuda_iterator_next (iter);
+        nextc = cuda_iterator_get_current (iter);
+      } while (!cuda_iterator_end (iter) &&
+               c.dev == nextc.dev && c.sm == nextc.sm && c.wp == nextc.wp);
+    }
+
+  do_cleanups (old_cleanups);
+}
+
+/* Single steps all the warps that are at an autostep.  The warps sharing
+   an autostep PC are stepped together, as a group, as long as they keep
+   the same PC.  Warps that diverge from the warp in focus, or finish, are
+   split off the group and stepped through the rest of the range after it. */
+static void
+handle_autostep_device ()
+{
+  VEC (autostep_group_t) *groups = NULL;
+  autostep_group_t g;
+  cuda_coords_t c, cur;
+  struct breakpoint *astep, *overlap;
+  uint64_t before_pc, after_pc, end_pc, members, split;
+  uint32_t dev, sm, wp, leader, before_ln;
+  uint32_t before_lns[CUDBG_MAX_WARPS];
+  struct timeval start, end;
+  int remaining;
+  struct cleanup *old_cleanups;
+  bool single_inst, preemption;
+  int i;
+
+  /* This suppresses printing of the line after each step */
+  cuda_set_autostep_stepping (true);
+
+  old_cleanups = make_cleanup (VEC_cleanup (autostep_group_t), &groups);
+  make_cleanup (autostep_reset_lockstep_mask, NULL);
+
+  preemption = cuda_options_software_preemption ();
+  autostep_collect_groups (&groups);
+
+  /* Groups split off while stepping are queued behind the others */
+  for (i = 0; cuda_focus_is_device () && i < VEC_length (autostep_group_t, groups); ++i)
+    {
+      /* The vector may be reallocated when a group is split */
+      g = *VEC_index (autostep_group_t, groups, i);
+      c = g.c;
+
+      if (preemption)
+        {
+          /* We look only at logical coordinates from the iterator.
+             Physical coordinates can change with Software Preemption
+             enabled after each step (on all warps, not just currently
+             stepped). */
+          if (cuda_coords_complete_physical (&c) ||
+              !warp_is_valid (c.dev, c.sm, c.wp) ||
+              warp_get_active_virtual_pc (c.dev, c.sm, c.wp) != g.pc)
+            continue;
+          members = 1ULL << c.wp;
+        }
+      else
+        {
+          /* Keep the warps that are still at the PC of the group */
+          members = 0ULL;
+          for (wp = 0; wp < device_get_num_warps (c.dev); ++wp)
+            if (g.warp_mask & (1ULL << wp) &&
+                warp_is_valid (c.dev, c.sm, wp) &&
+                warp_get_grid_id (c.dev, c.sm, wp) == c.gridId &&
+                warp_get_active_virtual_pc (c.dev, c.sm, wp) == g.pc)
+              members |= 1ULL << wp;
+          if (!members)
+            continue;
+
+          /* Step the lowest warp left if the warp of the group is gone */
+          if (!(members & (1ULL << c.wp)))
+            for (c.wp = 0; !(members & (1ULL << c.wp)); ++c.wp)
+              ;
+        }
+
       /* Check if we single step or step by lines */
+      astep = g.astep;
       single_inst = astep->cuda_autostep_length_type == cuda_autostep_insts;
 
+      /* Remember the lanes in focus of the warps before stepping */
+      for (wp = 0; wp < device_get_num_warps (c.dev); ++wp)
+        if (members & (1ULL << wp))
+          before_lns[wp] = warp_get_lowest_active_lane (c.dev, c.sm, wp);
+
       /* Set focus to current warp */
-      before_ln = warp_get_lowest_active_lane (c.dev, c.sm, c.wp);
+      before_ln = before_lns[c.wp];
       cuda_coords_set_current_physical (c.dev, c.sm, c.wp, before_ln);
+      cuda_coords_get_current (&c);
 
       /* Step until we are out of the autostep range */
-      remaining = astep->cuda_autostep_length;
+      remaining = g.remaining;
 
       while (remaining > 0)
         {
@@ -330,21 +501,52 @@ handle_autostep_device ()
                 break;
             }
 
+          /* A line step is not taken in lock-step: the group of an
+             overlapping line autostep is split into its warps. */
+          single_inst = astep->cuda_autostep_length_type == cuda_autostep_insts;
+          if (!single_inst && members != (1ULL << c.wp))
+            {
+              autostep_split_group (&groups, &c, members & ~(1ULL << c.wp),
+                                    astep, remaining);
+              members = 1ULL << c.wp;
+            }
+
           /* Clear pending flag to test if we encounter another autostep */
           cuda_set_autostep_pending (false);
 
-          /* Basically does a next/nexti */
+          /* Basically does a next/nexti, on all the warps of the group */
+          dev = c.dev;
+          sm = c.sm;
+          leader = c.wp;
+          cuda_sstep_set_lockstep_mask (members);
+
+          gettimeofday (&start, NULL);
           step_1 (false, single_inst, NULL);
+          gettimeofday (&end, NULL);
+
+          cuda_sstep_set_lockstep_mask (0ULL);
+          cuda_autostep_stats.steps++;
+          cuda_autostep_stats.warp_steps += __builtin_popcountll (members);
+          cuda_autostep_stats.time += (end.tv_sec - start.tv_sec) +
+                                      (end.tv_usec - start.tv_usec) * 1e-6;
 
           /* Check if logical coordinates are still valid and update physical
              coordinates. If logical coordinates are not valid, warp ran to
-             completion. */
-          if (cuda_coords_complete_physical (&c))
-            break;
-
-          /* Make sure we can continue stepping this warp */
-          if (!cuda_focus_is_device () || !warp_is_valid (c.dev, c.sm, c.wp))
-            break;
+             completion. Make sure we can continue stepping this warp. */
+          if (cuda_coords_complete_physical (&c) ||
+              !cuda_focus_is_device () || !warp_is_valid (c.dev, c.sm, c.wp))
+            {
+              /* The other warps of the group carry on without it */
+              c = g.c;
+              c.dev = dev;
+              c.sm = sm;
+              members &= ~(1ULL << leader);
+              for (wp = 0; wp < device_get_num_warps (dev); ++wp)
+                if (members & (1ULL << wp) && !warp_is_valid (dev, sm, wp))
+                  members &= ~(1ULL << wp);
+              autostep_split_group (&groups, &c, members, astep, remaining - 1);
+              break;
+            }
 
           after_pc = warp_get_active_virtual_pc (c.dev, c.sm, c.wp);
 
@@ -357,7 +559,15 @@ handle_autostep_device ()
 
               if (tp && signal_pass_state (tp->suspend.stop_signal))
                 {
-                  /* This is an exception */
+                  /* This is an exception, in the warp in focus, which can
+                     be any warp of the group */
+                  cuda_coords_get_current (&cur);
+                  if (cur.dev == dev && cur.sm == sm && cur.wp != c.wp &&
+                      members & (1ULL << cur.wp))
+                    {
+                      before_ln = before_lns[cur.wp];
+                      after_pc = warp_get_active_virtual_pc (cur.dev, cur.sm, cur.wp);
+                    }
                   autostep_report_exception_device (before_ln, before_pc, after_pc);
                   cuda_set_autostep_pending (false);
                 }
@@ -378,6 +588,24 @@ handle_autostep_device ()
 
           remaining--;
 
+          /* Split off the warps that finished or diverged from the warp in
+             focus */
+          if (preemption)
+            members = 1ULL << c.wp;
+          split = 0ULL;
+          for (wp = 0; wp < device_get_num_warps (c.dev); ++wp)
+            if (wp != c.wp && members & (1ULL << wp))
+              {
+                if (!warp_is_valid (c.dev, c.sm, wp))
+                  members &= ~(1ULL << wp);
+                else if (warp_get_active_virtual_pc (c.dev, c.sm, wp) != after_pc)
+                  {
+                    members &= ~(1ULL << wp);
+                    split |= 1ULL << wp;
+                  }
+              }
+          autostep_split_group (&groups, &c, split, astep, remaining);
+
           /* Handle overlapping autosteps */
           if (cuda_get_autostep_pending ())
             {
@@ -394,15 +622,6 @@ handle_autostep_device ()
                 }
             }
         }
-
-next_warp:
-      /* Skip to next warp (by using possibly outdated physical coordinates,
-         but sorted correctly by logical coordinates) */
-      do {
-        cuda_iterator_next (iter);
-        nextc = cuda_iterator_get_current (iter);
-      } while (cuda_focus_is_device () && !cuda_iterator_end (iter) &&
-               curc.dev == nextc.dev && curc.sm == nextc.sm && curc.wp == nextc.wp);
     }
 
   /* Mark that autostepping has been handled */
@@ -412,6 +631,20 @@ next_warp:
   do_cleanups (old_cleanups);
 }
 
+void
+cuda_autostep_print_statistics (void)
+{
+  printf_unfiltered (_("Autostep: %llu groups, %llu warps, %llu steps, "
+                       "%llu warp steps, %.0f warp steps/sec\n"),
+                     (unsigned long long) cuda_autostep_stats.groups,
+                     (unsigned long long) cuda_autostep_stats.warps,
+                     (unsigned long long) cuda_autostep_stats.steps,
+                     (unsigned long long) cuda_autostep_stats.warp_steps,
+                     cuda_autostep_stats.time > 0
+                     ? cuda_autostep_stats.warp_steps / cuda_autostep_stats.time
+                     : 0.0);
+}
+
 void
 cuda_handle_autostep ()
 {
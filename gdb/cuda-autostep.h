@@ -29,4 +29,6 @@ void cuda_set_autostep_stepping (bool stepping);
 
 bool cuda_autostep_stop (void);
 
+void cuda_autostep_print_statistics (void);
+
 #endif
@@ -0,0 +1,504 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Conditions of device breakpoints.
+
+   A condition is evaluated for each lane stopped at the breakpoint.
+   Interpreting the expression requires switching the focus to the lane,
+   which flushes the frame and register caches, and evaluating the whole
+   expression tree.  Instead, the condition of a location is compiled once
+   into an agent expression (see ax-gdb.c), with the focus on a lane at the
+   location so that the PTX registers are mapped for its PC.  The bytecode
+   is then run for every lane of a warp straight from the device state
+   cache, without touching the focus.
+
+   The bytecode does not know about the CUDA memory segments: ax-gdb.c
+   records the type instance flags of every value it fetches, and a fetch
+   from an unqualified type is only accepted for the CUDA built-in
+   variables.  Conditions that cannot be compiled, and lanes for which the
+   bytecode fails, e.g. on a division by zero or a memory error, are
+   evaluated the old way so that the user sees the same results and
+   errors as before. */
+
+#include "defs.h"
+#include "symtab.h"
+#include "expression.h"
+#include "ax.h"
+#include "ax-gdb.h"
+#include "block.h"
+#include "breakpoint.h"
+#include "exceptions.h"
+#include "gdb_assert.h"
+#include "language.h"
+#include "value.h"
+
+#include "cuda-bpcond.h"
+#include "cuda-coords.h"
+#include "cuda-memcache.h"
+#include "cuda-state.h"
+#include "cuda-tdep.h"
+
+/* Maximum stack depth of a compiled condition */
+#define CUDA_BPCOND_MAX_STACK 64
+
+/* Segment of a fetch from a type that is not CUDA-qualified */
+#define CUDA_BPCOND_UNQUALIFIED  CUDA_MEMCACHE_SEGMENT_MAX
+/* Not a fetch */
+#define CUDA_BPCOND_NO_REF       (-1)
+
+struct cuda_bpcond
+{
+  /* The compiled condition, NULL if it could not be compiled */
+  struct agent_expr *aexpr;
+
+  /* For each bytecode offset, the segment fetched from by the `ref'
+     opcode at that offset, CUDA_BPCOND_NO_REF elsewhere. */
+  int *segments;
+};
+
+static struct {
+  uint64_t compiled;
+  uint64_t not_compiled;
+  uint64_t lanes_compiled;
+  uint64_t lanes_interpreted;
+} cuda_bpcond_stats;
+
+void
+cuda_bpcond_free (struct cuda_bpcond *cond)
+{
+  if (!cond)
+    return;
+
+  if (cond->aexpr)
+    free_agent_expr (cond->aexpr);
+  xfree (cond->segments);
+  xfree (cond);
+}
+
+/* Map the CUDA type instance flags of a fetched value to a segment of
+   the device memory cache.  Returns false for the segments the bytecode
+   cannot read from. */
+static bool
+cuda_bpcond_segment (int flags, int *segment)
+{
+  switch (flags)
+    {
+    case 0:
+      *segment = CUDA_BPCOND_UNQUALIFIED;
+      return true;
+    case TYPE_INSTANCE_FLAG_CUDA_CODE:
+      *segment = CUDA_MEMCACHE_CODE;
+      return true;
+    case TYPE_INSTANCE_FLAG_CUDA_CONST:
+      *segment = CUDA_MEMCACHE_CONST;
+      return true;
+    case TYPE_INSTANCE_FLAG_CUDA_GENERIC:
+    case TYPE_INSTANCE_FLAG_CUDA_GLOBAL:
+    case TYPE_INSTANCE_FLAG_CUDA_MANAGED:
+      *segment = CUDA_MEMCACHE_GENERIC;
+      return true;
+    case TYPE_INSTANCE_FLAG_CUDA_PARAM:
+      *segment = CUDA_MEMCACHE_PARAM;
+      return true;
+    case TYPE_INSTANCE_FLAG_CUDA_SHARED:
+      *segment = CUDA_MEMCACHE_SHARED;
+      return true;
+    case TYPE_INSTANCE_FLAG_CUDA_LOCAL:
+      *segment = CUDA_MEMCACHE_LOCAL;
+      return true;
+    default:
+      return false;
+    }
+}
+
+/* Check that every opcode of the compiled condition is understood by
+   cuda_bpcond_run and that every fetch has a known segment.  Fills in
+   the segments of COND. */
+static bool
+cuda_bpcond_validate (struct cuda_bpcond *cond)
+{
+  struct agent_expr *aexpr = cond->aexpr;
+  struct gdbarch *gdbarch = cuda_get_gdbarch ();
+  ax_cuda_ref_s *ref;
+  int i, pc, op, regnum;
+
+  ax_reqs (aexpr);
+  if (aexpr->flaw != agent_flaw_none ||
+      aexpr->min_height < 0 ||
+      aexpr->max_height > CUDA_BPCOND_MAX_STACK)
+    return false;
+
+  cond->segments = xmalloc (aexpr->len * sizeof (*cond->segments));
+  for (pc = 0; pc < aexpr->len; ++pc)
+    cond->segments[pc] = CUDA_BPCOND_NO_REF;
+
+  for (i = 0; VEC_iterate (ax_cuda_ref_s, aexpr->cuda_refs, i, ref); ++i)
+    {
+      gdb_assert (ref->offset < aexpr->len);
+      if (!cuda_bpcond_segment (ref->segment, &cond->segments[ref->offset]))
+        return false;
+    }
+
+  for (pc = 0; pc < aexpr->len; pc += 1 + aop_map[op].op_size)
+    {
+      op = aexpr->buf[pc];
+      switch (op)
+        {
+        case aop_add: case aop_sub: case aop_mul:
+        case aop_div_signed: case aop_div_unsigned:
+        case aop_rem_signed: case aop_rem_unsigned:
+        case aop_lsh: case aop_rsh_signed: case aop_rsh_unsigned:
+        case aop_log_not: case aop_bit_and: case aop_bit_or:
+        case aop_bit_xor: case aop_bit_not:
+        case aop_equal: case aop_less_signed: case aop_less_unsigned:
+        case aop_ext: case aop_zero_ext:
+        case aop_if_goto: case aop_goto:
+        case aop_const8: case aop_const16: case aop_const32: case aop_const64:
+        case aop_end: case aop_dup: case aop_pop: case aop_swap:
+        case aop_pick: case aop_rot:
+          break;
+
+        case aop_ref8: case aop_ref16: case aop_ref32: case aop_ref64:
+          /* A fetch generated outside of ax-gdb.c, e.g. by a DWARF
+             location expression */
+          if (cond->segments[pc] == CUDA_BPCOND_NO_REF)
+            return false;
+          break;
+
+        case aop_reg:
+          regnum = (aexpr->buf[pc + 1] << 8) + aexpr->buf[pc + 2];
+          if (regnum >= gdbarch_num_regs (gdbarch))
+            return false;
+          break;
+
+        default:
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/* Compile the condition of BL.  The focus must be on a lane stopped at
+   BL, the PTX registers of the condition are mapped for its PC. */
+static struct cuda_bpcond *
+cuda_bpcond_compile (struct bp_location *bl)
+{
+  volatile struct gdb_exception e;
+  struct cuda_bpcond *cond;
+  struct expression *expr = NULL;
+  struct cleanup *cleanups;
+  const char *s;
+
+  cond = xcalloc (1, sizeof *cond);
+  if (!bl->owner->cond_string)
+    return cond;
+
+  /* Parse the condition again, with the device architecture */
+  TRY_CATCH (e, RETURN_MASK_ERROR)
+    {
+      s = bl->owner->cond_string;
+      expr = parse_exp_1 (&s, bl->address, block_for_pc (bl->address), 0);
+      cleanups = make_cleanup (xfree, expr);
+      cond->aexpr = gen_eval_for_expr (bl->address, expr);
+      do_cleanups (cleanups);
+    }
+
+  if (e.reason < 0 || !cond->aexpr || !cuda_bpcond_validate (cond))
+    {
+      if (cond->aexpr)
+        free_agent_expr (cond->aexpr);
+      cond->aexpr = NULL;
+      xfree (cond->segments);
+      cond->segments = NULL;
+      ++cuda_bpcond_stats.not_compiled;
+      return cond;
+    }
+
+  ++cuda_bpcond_stats.compiled;
+  return cond;
+}
+
+/* Read LEN bytes fetched by the `ref' opcode at PC, for the given lane */
+static bool
+cuda_bpcond_read (struct cuda_bpcond *cond, int pc,
+                  uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln,
+                  CORE_ADDR addr, int len, ULONGEST *value)
+{
+  enum bfd_endian byte_order = gdbarch_byte_order (cuda_get_gdbarch ());
+  int segment = cond->segments[pc];
+  gdb_byte buf[8];
+
+  if (segment != CUDA_BPCOND_UNQUALIFIED)
+    cuda_memcache_read (segment, dev, sm, wp, ln, addr, buf, len);
+  else if (cuda_read_builtin_variable (dev, sm, wp, ln, addr, buf, len))
+    return false;
+
+  *value = extract_unsigned_integer (buf, len, byte_order);
+  return true;
+}
+
+/* Run the compiled condition for the given lane.  Returns false if the
+   condition must be evaluated by the expression evaluator instead. */
+static bool
+cuda_bpcond_run (struct cuda_bpcond *cond,
+                 uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln,
+                 ULONGEST *result)
+{
+  struct agent_expr *aexpr = cond->aexpr;
+  struct gdbarch *gdbarch = cuda_get_gdbarch ();
+  ULONGEST stack[CUDA_BPCOND_MAX_STACK + 1];
+  ULONGEST tmp;
+  unsigned char *buf = aexpr->buf;
+  int sp = 0, pc = 0, op, arg, i;
+
+#define POP()  (stack[--sp])
+#define TOP    (stack[sp - 1])
+
+  for (;;)
+    {
+      op = buf[pc];
+      switch (op)
+        {
+        case aop_add:         tmp = POP (); TOP += tmp; break;
+        case aop_sub:         tmp = POP (); TOP -= tmp; break;
+        case aop_mul:         tmp = POP (); TOP *= tmp; break;
+        case aop_lsh:         tmp = POP (); TOP <<= tmp; break;
+        case aop_rsh_signed:  tmp = POP (); TOP = (LONGEST) TOP >> tmp; break;
+        case aop_rsh_unsigned:tmp = POP (); TOP >>= tmp; break;
+        case aop_bit_and:     tmp = POP (); TOP &= tmp; break;
+        case aop_bit_or:      tmp = POP (); TOP |= tmp; break;
+        case aop_bit_xor:     tmp = POP (); TOP ^= tmp; break;
+        case aop_equal:       tmp = POP (); TOP = TOP == tmp; break;
+        case aop_less_signed: tmp = POP (); TOP = (LONGEST) TOP < (LONGEST) tmp; break;
+        case aop_less_unsigned: tmp = POP (); TOP = TOP < tmp; break;
+        case aop_log_not:     TOP = !TOP; break;
+        case aop_bit_not:     TOP = ~TOP; break;
+
+        case aop_div_signed:
+        case aop_div_unsigned:
+        case aop_rem_signed:
+        case aop_rem_unsigned:
+          tmp = POP ();
+          /* Let the expression evaluator report the error */
+          if (tmp == 0)
+            return false;
+          if (op == aop_div_signed)
+            TOP = (LONGEST) TOP / (LONGEST) tmp;
+          else if (op == aop_div_unsigned)
+            TOP = TOP / tmp;
+          else if (op == aop_rem_signed)
+            TOP = (LONGEST) TOP % (LONGEST) tmp;
+          else
+            TOP = TOP % tmp;
+          break;
+
+        case aop_ext:
+          arg = buf[pc + 1];
+          if (arg > 0 && arg < sizeof (LONGEST) * 8)
+            {
+              tmp = (ULONGEST) 1 << (arg - 1);
+              TOP &= ((ULONGEST) 1 << arg) - 1;
+              TOP = (TOP ^ tmp) - tmp;
+            }
+          break;
+
+        case aop_zero_ext:
+          arg = buf[pc + 1];
+          if (arg < sizeof (LONGEST) * 8)
+            TOP &= ((ULONGEST) 1 << arg) - 1;
+          break;
+
+        case aop_ref8:
+        case aop_ref16:
+        case aop_ref32:
+        case aop_ref64:
+          if (!cuda_bpcond_read (cond, pc, dev, sm, wp, ln, TOP,
+                                 aop_map[op].data_size / 8, &TOP))
+            return false;
+          break;
+
+        case aop_if_goto:
+          if (POP ())
+            {
+              pc = (buf[pc + 1] << 8) + buf[pc + 2];
+              continue;
+            }
+          break;
+
+        case aop_goto:
+          pc = (buf[pc + 1] << 8) + buf[pc + 2];
+          continue;
+
+        case aop_const8:
+        case aop_const16:
+        case aop_const32:
+        case aop_const64:
+          for (tmp = 0, i = 0; i < aop_map[op].op_size; ++i)
+            tmp = (tmp << 8) + buf[pc + 1 + i];
+          stack[sp++] = tmp;
+          break;
+
+        case aop_reg:
+          arg = (buf[pc + 1] << 8) + buf[pc + 2];
+          if (arg == cuda_pc_regnum (gdbarch))
+            stack[sp++] = lane_get_virtual_pc (dev, sm, wp, ln);
+          else
+            stack[sp++] = lane_get_register (dev, sm, wp, ln, arg);
+          break;
+
+        case aop_end:
+          if (sp == 0)
+            return false;
+          *result = TOP;
+          return true;
+
+        case aop_dup:
+          tmp = TOP;
+          stack[sp++] = tmp;
+          break;
+
+        case aop_pop:
+          --sp;
+          break;
+
+        case aop_swap:
+          tmp = TOP;
+          TOP = stack[sp - 2];
+          stack[sp - 2] = tmp;
+          break;
+
+        case aop_pick:
+          arg = buf[pc + 1];
+          tmp = stack[sp - 1 - arg];
+          stack[sp++] = tmp;
+          break;
+
+        case aop_rot:
+          tmp = stack[sp - 3];
+          stack[sp - 3] = TOP;
+          TOP = stack[sp - 2];
+          stack[sp - 2] = tmp;
+          break;
+
+        default:
+          return false;
+        }
+
+      pc += 1 + aop_map[op].op_size;
+    }
+
+#undef POP
+#undef TOP
+}
+
+static void
+cuda_bpcond_restore_focus (void *arg)
+{
+  cuda_focus_t *focus = arg;
+
+  if (focus->valid)
+    cuda_focus_restore (focus);
+}
+
+/* Switch the focus to the given lane, saving the focus first */
+static void
+cuda_bpcond_switch_focus (cuda_focus_t *focus,
+                          uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln)
+{
+  if (!focus->valid)
+    cuda_focus_save (focus);
+  cuda_coords_set_current_physical (dev, sm, wp, ln);
+  switch_to_cuda_thread (NULL);
+}
+
+/* Evaluate the condition of location BL for the LANES of warp WP, all
+   stopped at BL.  Returns the mask of the lanes for which the condition
+   holds.  Unless ALL_LANES, stop at the first of them. */
+uint32_t
+cuda_bpcond_eval_warp (struct bp_location *bl, uint32_t dev, uint32_t sm,
+                       uint32_t wp, uint32_t lanes, bool all_lanes)
+{
+  volatile struct gdb_exception e;
+  struct cuda_bpcond *cond;
+  struct cleanup *cleanups;
+  struct value *mark;
+  cuda_focus_t focus;
+  uint32_t ln, result = 0;
+  ULONGEST value = 0;
+  bool compiled;
+
+  if (!bl->cond || !lanes)
+    return lanes;
+
+  cuda_focus_init (&focus);
+  cleanups = make_cleanup (cuda_bpcond_restore_focus, &focus);
+
+  if (!bl->cuda_cond)
+    {
+      cuda_bpcond_switch_focus (&focus, dev, sm, wp, __builtin_ctz (lanes));
+      bl->cuda_cond = cuda_bpcond_compile (bl);
+    }
+  cond = bl->cuda_cond;
+
+  for (ln = 0; ln < device_get_num_lanes (dev); ++ln)
+    {
+      if (!(lanes & (1U << ln)))
+        continue;
+
+      compiled = false;
+      if (cond->aexpr)
+        {
+          TRY_CATCH (e, RETURN_MASK_ERROR)
+            {
+              compiled = cuda_bpcond_run (cond, dev, sm, wp, ln, &value);
+            }
+        }
+
+      if (compiled)
+        ++cuda_bpcond_stats.lanes_compiled;
+      else
+        {
+          ++cuda_bpcond_stats.lanes_interpreted;
+          cuda_bpcond_switch_focus (&focus, dev, sm, wp, ln);
+          mark = value_mark ();
+          value = value_true (evaluate_expression (bl->cond));
+          value_free_to_mark (mark);
+        }
+
+      if (!value)
+        continue;
+
+      result |= 1U << ln;
+      if (!all_lanes)
+        break;
+    }
+
+  do_cleanups (cleanups);
+  return result;
+}
+
+void
+cuda_bpcond_print_statistics (void)
+{
+  printf_unfiltered (_("Breakpoint conditions: %llu compiled, %llu interpreted, "
+                       "%llu lanes evaluated compiled, %llu lanes interpreted\n"),
+                     (unsigned long long) cuda_bpcond_stats.compiled,
+                     (unsigned long long) cuda_bpcond_stats.not_compiled,
+                     (unsigned long long) cuda_bpcond_stats.lanes_compiled,
+                     (unsigned long long) cuda_bpcond_stats.lanes_interpreted);
+}
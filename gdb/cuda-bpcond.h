@@ -0,0 +1,34 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CUDA_BPCOND_H
+#define _CUDA_BPCOND_H 1
+
+#include "cuda-defs.h"
+
+struct bp_location;
+struct cuda_bpcond;
+
+uint32_t cuda_bpcond_eval_warp (struct bp_location *bl, uint32_t dev,
+                                uint32_t sm, uint32_t wp, uint32_t lanes,
+                                bool all_lanes);
+
+void cuda_bpcond_free (struct cuda_bpcond *cond);
+
+void cuda_bpcond_print_statistics (void);
+
+#endif
@@ -36,6 +36,7 @@
 #include "cuda-context.h"
 #include "cuda-iterator.h"
 #include "cuda-kernel.h"
+#include "cuda-linecache.h"
 #include "cuda-state.h"
 #include "cuda-convvars.h"
 #include "cuda-exceptions.h"
@@ -851,7 +852,8 @@ cuda_info_kernels_build (char *filter_string, cuda_info_kernel_t **kernels, uint
 
   /* compile the needed info for each kernel */
   k = *kernels;
-  for (kernel = kernels_get_first_kernel (); kernel; kernel = kernels_get_next_kernel (kernel))
+  for (kernel = kernels_get_first_present_kernel (); kernel;
+       kernel = kernels_get_next_present_kernel (kernel))
     {
       if (!kernel_is_present (kernel))
         continue;
@@ -1315,6 +1317,8 @@ cuda_info_threads_build (char *filter_string, cuda_info_thread_t **threads, uint
   struct symtab_and_line sal, prev_sal;
   bool first_entry, break_of_contiguity;
   struct value_print_options opts;
+  uint32_t bp_dev = ~0U, bp_sm = ~0U, bp_wp = ~0U, bp_lanes = 0;
+  uint64_t bp_pc = 0;
 
   /* sanity checks */
   gdb_assert (threads);
@@ -1334,8 +1338,12 @@ cuda_info_threads_build (char *filter_string, cuda_info_thread_t **threads, uint
   default_filter.coords.kernelId = CUDA_CURRENT;
   filter = cuda_build_filter (filter_string, &default_filter, CMD_FILTER);
 
-  /* get the list of threads */
-  iter = cuda_iterator_create (CUDA_ITERATOR_TYPE_THREADS, &filter.coords, CUDA_SELECT_VALID);
+  /* get the list of threads, only the warps of the stop report at a
+     breakpoint if filtering on breakpoints */
+  iter = cuda_iterator_create (CUDA_ITERATOR_TYPE_THREADS, &filter.coords,
+                               filter.bp_number_p
+                               ? CUDA_SELECT_VALID | CUDA_SELECT_BKPT
+                               : CUDA_SELECT_VALID);
   num_elements = cuda_iterator_get_size (iter);
   *threads = xmalloc (num_elements * sizeof (**threads));
 
@@ -1348,11 +1356,24 @@ cuda_info_threads_build (char *filter_string, cuda_info_thread_t **threads, uint
       kernel = kernels_find_kernel_by_grid_id (c.dev, c.gridId);
       pc = lane_get_virtual_pc (c.dev, c.sm, c.wp, c.ln);
 
-      if (filter.bp_number_p  && !cuda_eval_thread_at_breakpoint (pc, &c, filter.bp_number))
-        continue;
+      /* the breakpoint is checked for all the lanes of a warp at a PC at once */
+      if (filter.bp_number_p)
+        {
+          if (c.dev != bp_dev || c.sm != bp_sm || c.wp != bp_wp || pc != bp_pc)
+            {
+              bp_dev = c.dev;
+              bp_sm  = c.sm;
+              bp_wp  = c.wp;
+              bp_pc  = pc;
+              bp_lanes = cuda_eval_warp_at_breakpoint (pc, c.dev, c.sm, c.wp,
+                                                       filter.bp_number);
+            }
+          if (!(bp_lanes & (1U << c.ln)))
+            continue;
+        }
 
       if (pc != prev_pc) /* optimization */
-        sal = find_pc_line (pc, 0);
+        sal = cuda_linecache_find_pc_line (pc);
 
       /* data for the current iteration */
       break_of_contiguity =
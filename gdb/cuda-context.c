@@ -18,6 +18,7 @@
 #include "gdb_assert.h"
 
 #include "cuda-context.h"
+#include "cuda-elf-image.h"
 #include "cuda-options.h"
 #include "cuda-tdep.h"
 #include "cuda-state.h"
@@ -364,20 +365,29 @@ contexts_get_active_context (contexts_t this, uint32_t tid)
   return (*stack)->context;
 }
 
-/* expensive: traverse all the objfiles to see if addr corresponds to
-   any of them. Return the context if found, 0 otherwise. */
+static bool
+contexts_owns_elf_image (elf_image_t elf_image, void *data)
+{
+  context_t context = module_get_context (cuda_elf_image_get_module (elf_image));
+
+  return device_get_contexts (context_get_device_id (context)) == data;
+}
+
+/* Return the context of THIS with code at addr if found, 0 otherwise. */
 context_t
 contexts_find_context_by_address (contexts_t this, CORE_ADDR addr)
 {
-  list_elt_t elt;
+  elf_image_t elf_image;
 
   gdb_assert (this);
 
-  for (elt = this->list; elt; elt = elt->next)
-    if (modules_find_module_by_address (elt->context->modules, addr))
-      return elt->context;
+  elf_image = cuda_elf_image_find_by_address_matching (addr,
+                                                       contexts_owns_elf_image,
+                                                       this);
+  if (!elf_image)
+    return NULL;
 
-  return NULL;
+  return module_get_context (cuda_elf_image_get_module (elf_image));
 }
 
 bool
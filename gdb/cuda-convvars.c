@@ -28,6 +28,7 @@
 #include "command.h"
 
 #include "cuda-iterator.h"
+#include "cuda-linecache.h"
 #include "cuda-state.h"
 #include "cuda-tdep.h"
 #include "cuda-utils.h"
@@ -371,7 +372,7 @@ cv_update_lineno_var(void)
   if (valid)
     {
       pc      = lane_get_virtual_pc (cur.dev, cur.sm, cur.wp, cur.ln);
-      lineno  = find_pc_line (pc, 0).line;
+      lineno  = cuda_linecache_find_pc_line (pc).line;
     }
 
   cv_set_uint32_var ("cuda_thread_lineno", lineno);
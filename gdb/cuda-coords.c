@@ -749,8 +749,8 @@ cuda_coords_find_valid_exact (cuda_coords_t wished, cuda_coords_t *found, cuda_s
     return;
 
   if (at_breakpoint &&
-      /* CUDA - no address space management */
-      !breakpoint_here_p (NULL, lane_get_virtual_pc (dev, sm, wp, ln)))
+      (!((sm_get_breakpoint_warps_mask (dev, sm) >> wp) & 1ULL) ||
+       !lane_is_active (dev, sm, wp, ln)))
     return;
 
   if (at_exception &&
@@ -23,6 +23,7 @@
 #include "completer.h"
 #include "readline/readline.h"
 #include "gdb_assert.h"
+#include "gdb_string.h"
 
 #include "cuda-api.h"
 #include "cuda-tdep.h"
@@ -40,6 +41,11 @@ void _initialize_cuda_corelow (void);
 struct target_ops cuda_core_ops;
 static CudaCore *cuda_core = NULL;
 
+/* A simulated device is opened instead of a core file when the file name
+   starts with this prefix; the rest are the parameters of the device. */
+#define CUDA_MOCK_PREFIX "mock:"
+static CudaMock *cuda_mock = NULL;
+
 static void cuda_core_close (int quitting);
 
 static void cuda_core_close_cleanup (void *ignore);
@@ -125,12 +131,25 @@ cuda_core_load_api (char *filename)
 {
   CUDBGAPI api;
 
-  printf_unfiltered (_("Opening GPU coredump: %s\n"), filename);
+  if (strncmp (filename, CUDA_MOCK_PREFIX, strlen (CUDA_MOCK_PREFIX)) == 0)
+    {
+      filename += strlen (CUDA_MOCK_PREFIX);
+      printf_unfiltered (_("Opening simulated GPU: %s\n"), filename);
 
-  cuda_core = cuCoreOpenByName (filename);
-  if (cuda_core == NULL)
-    error ("Failed to read core file: %s", cuCoreErrorMsg());
-  api = cuCoreGetApi (cuda_core);
+      cuda_mock = cuMockOpen (filename);
+      if (cuda_mock == NULL)
+        error ("Failed to create simulated GPU: %s", cuCoreErrorMsg());
+      api = cuMockGetApi (cuda_mock);
+    }
+  else
+    {
+      printf_unfiltered (_("Opening GPU coredump: %s\n"), filename);
+
+      cuda_core = cuCoreOpenByName (filename);
+      if (cuda_core == NULL)
+        error ("Failed to read core file: %s", cuCoreErrorMsg());
+      api = cuCoreGetApi (cuda_core);
+    }
   if (api == NULL)
     error ("Failed to get debugger APIs: %s", cuCoreErrorMsg());
 
@@ -148,13 +167,39 @@ cuda_core_load_api (char *filename)
 void
 cuda_core_free (void)
 {
-  if (cuda_core == NULL)
+  if (cuda_core == NULL && cuda_mock == NULL)
     return;
 
   cuda_cleanup ();
   cuda_gdb_session_destroy ();
-  cuCoreFree(cuda_core);
+  if (cuda_core)
+    cuCoreFree(cuda_core);
+  if (cuda_mock)
+    cuMockFree(cuda_mock);
   cuda_core = NULL;
+  cuda_mock = NULL;
+}
+
+void
+cuda_core_print_statistics (void)
+{
+  const CudaMockCallStats *stats;
+  size_t num_stats, i;
+  uint64_t calls = 0;
+
+  if (cuda_mock == NULL)
+    return;
+
+  num_stats = cuMockGetCallStats (cuda_mock, &stats);
+  for (i = 0; i < num_stats; ++i)
+    calls += stats[i].calls;
+
+  printf_unfiltered (_("Simulated GPU: %llu API calls\n"),
+                     (unsigned long long) calls);
+  for (i = 0; i < num_stats; ++i)
+    if (stats[i].calls)
+      printf_unfiltered (_("  %-28s %12llu\n"), stats[i].name,
+                         (unsigned long long) stats[i].calls);
 }
 
 void
@@ -335,7 +380,8 @@ init_cuda_core_ops (void)
   cuda_core_ops.to_shortname = "cudacore";
   cuda_core_ops.to_longname = "CUDA core dump file";
   cuda_core_ops.to_doc =
-    "Use CUDA core file as a target. Specify the filename to the core file.";
+    "Use CUDA core file as a target. Specify the filename to the core file,\n\
+or mock:PARAMETERS to debug a simulated GPU instead.";
   cuda_core_ops.to_open = cuda_core_open;
   cuda_core_ops.to_detach = cuda_core_detach;
   cuda_core_ops.to_close = cuda_core_close;
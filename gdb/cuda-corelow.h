@@ -25,5 +25,6 @@ extern void cuda_core_register_tid (uint32_t tid);
 extern void cuda_core_load_api (char *filename);
 extern void cuda_core_free (void);
 extern void cuda_core_initialize_events_exceptions (void);
+extern void cuda_core_print_statistics (void);
 
 #endif
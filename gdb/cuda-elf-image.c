@@ -16,14 +16,20 @@
  */
 
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include "defs.h"
 #include "breakpoint.h"
 #include "gdb_assert.h"
+#include "gdb_bfd.h"
+#include "gdbcore.h"
+#include "hashtab.h"
 #include "source.h"
 
+#include "cuda-asm.h"
 #include "cuda-context.h"
 #include "cuda-elf-image.h"
+#include "cuda-linecache.h"
 #include "cuda-modules.h"
 #include "cuda-options.h"
 #include "cuda-state.h"
@@ -32,32 +38,355 @@
 
 elf_image_t elf_image_chain = NULL;
 
+/******************************************************************************
+ *
+ *                             ELF Image Contents
+ *
+ *****************************************************************************/
+
+/* The contents of an ELF image are kept in memory and handed to BFD
+   directly. Identical images, as produced when the same module is loaded by
+   several contexts, share a single copy. A file is only written to disk
+   when an external tool such as cuobjdump needs one. */
+typedef struct elf_image_data_st *elf_image_data_t;
+
+struct elf_image_data_st {
+  hashval_t          hash;        /* hash of the image contents */
+  uint64_t           size;        /* the size of the image */
+  void              *image;       /* the image contents */
+  uint32_t           refcount;    /* ELF images and open BFDs using the data */
+  bool               saved;       /* has the image been written to path? */
+  char               path [CUDA_GDB_TMP_BUF_SIZE];
+                                  /* file path of the image in the tmp folder */
+};
+
+static htab_t elf_image_data_table;
+
+static struct {
+  uint64_t loads;
+  uint64_t shared;
+  uint64_t saved;
+  double   total_time;
+  double   max_time;
+} elf_image_stats;
+
+static hashval_t
+elf_image_data_hash (const void *item)
+{
+  const struct elf_image_data_st *data = item;
+
+  return data->hash;
+}
+
+static int
+elf_image_data_eq (const void *item_a, const void *item_b)
+{
+  const struct elf_image_data_st *data_a = item_a;
+  const struct elf_image_data_st *data_b = item_b;
+
+  return data_a->hash == data_b->hash &&
+         data_a->size == data_b->size &&
+         memcmp (data_a->image, data_b->image, data_a->size) == 0;
+}
+
+/* Return the shared data for IMAGE. Ownership of IMAGE, allocated with
+   xmalloc, is passed to the data object. */
+static elf_image_data_t
+elf_image_data_get (void *image, uint64_t size)
+{
+  struct elf_image_data_st key;
+  elf_image_data_t data;
+  void **slot;
+
+  if (!elf_image_data_table)
+    elf_image_data_table = htab_create_alloc (64, elf_image_data_hash,
+                                              elf_image_data_eq, NULL,
+                                              xcalloc, xfree);
+
+  key.hash  = iterative_hash (image, size, 0);
+  key.size  = size;
+  key.image = image;
+
+  slot = htab_find_slot_with_hash (elf_image_data_table, &key, key.hash, INSERT);
+  if (*slot)
+    {
+      data = *slot;
+      data->refcount++;
+      elf_image_stats.shared++;
+      xfree (image);
+      return data;
+    }
+
+  data = xmalloc (sizeof *data);
+  data->hash     = key.hash;
+  data->size     = size;
+  data->image    = image;
+  data->refcount = 1;
+  data->saved    = false;
+  data->path[0]  = 0;
+  *slot = data;
+
+  return data;
+}
+
+static void
+elf_image_data_put (elf_image_data_t data)
+{
+  gdb_assert (data->refcount > 0);
+
+  if (--data->refcount > 0)
+    return;
+
+  htab_remove_elt_with_hash (elf_image_data_table, data, data->hash);
+  if (data->saved)
+    unlink (data->path);
+  xfree (data->image);
+  xfree (data);
+}
+
+/* Write the image to the session directory, once. */
+static const char *
+elf_image_data_save (elf_image_data_t data)
+{
+  int fd;
+  uint64_t nbytes;
+
+  if (data->saved)
+    return data->path;
+
+  snprintf (data->path, sizeof (data->path), "%s/elf.%08x.o.XXXXXX",
+            cuda_gdb_session_get_dir (), (unsigned) data->hash);
+
+  fd = mkstemp (data->path);
+  if (fd == -1)
+    error (_("Error: Failed to create device ELF symbol file!"));
+
+  nbytes = write (fd, data->image, data->size);
+  close (fd);
+  if (nbytes != data->size)
+    {
+      unlink (data->path);
+      error (_("Error: Failed to write the ELF image file"));
+    }
+
+  data->saved = true;
+  elf_image_stats.saved++;
+
+  return data->path;
+}
+
+/* BFD in-memory I/O callbacks. The open BFD holds a reference on the data
+   so that the contents outlive the ELF image if GDB still reads from it. */
+static void *
+elf_image_data_bfd_open (struct bfd *abfd, void *open_closure)
+{
+  elf_image_data_t data = open_closure;
+
+  data->refcount++;
+  return data;
+}
+
+static file_ptr
+elf_image_data_bfd_pread (struct bfd *abfd, void *stream, void *buf,
+                          file_ptr nbytes, file_ptr offset)
+{
+  elf_image_data_t data = stream;
+
+  if (offset < 0 || (uint64_t) offset >= data->size)
+    return 0;
+  if ((uint64_t) (offset + nbytes) > data->size)
+    nbytes = data->size - offset;
+
+  memcpy (buf, (char *) data->image + offset, nbytes);
+  return nbytes;
+}
+
+static int
+elf_image_data_bfd_close (struct bfd *abfd, void *stream)
+{
+  elf_image_data_put (stream);
+  return 0;
+}
+
+static int
+elf_image_data_bfd_stat (struct bfd *abfd, void *stream, struct stat *sb)
+{
+  elf_image_data_t data = stream;
+
+  memset (sb, 0, sizeof *sb);
+  sb->st_size = data->size;
+  return 0;
+}
+
+
+/******************************************************************************
+ *
+ *                           Device Code Address Index
+ *
+ *****************************************************************************/
+
+/* Code sections of all the loaded ELF images, sorted by start address.
+   Entries are added when an image is loaded and removed when it is
+   unloaded, so that mapping a device code address back to its ELF image is
+   a binary search instead of a walk over every context, module and
+   section. */
+typedef struct {
+  CORE_ADDR    start;     /* first address of the code section */
+  CORE_ADDR    end;       /* first address past the code section */
+  CORE_ADDR    max_end;   /* max end over this entry and all the previous ones */
+  elf_image_t  elf_image; /* the ELF image owning the section */
+} code_range_t;
+
+static struct {
+  uint32_t      num_ranges;
+  uint32_t      max_ranges;
+  code_range_t *ranges;
+} code_range_index;
+
+static void
+code_range_index_update_max_end (uint32_t from)
+{
+  uint32_t i;
+  CORE_ADDR max_end = from ? code_range_index.ranges[from - 1].max_end : 0;
+
+  for (i = from; i < code_range_index.num_ranges; ++i)
+    {
+      max_end = max (max_end, code_range_index.ranges[i].end);
+      code_range_index.ranges[i].max_end = max_end;
+    }
+}
+
+/* Number of ranges whose start address is lower or equal to ADDR */
+static uint32_t
+code_range_index_upper_bound (CORE_ADDR addr)
+{
+  uint32_t low = 0, high = code_range_index.num_ranges, mid;
+
+  while (low < high)
+    {
+      mid = low + (high - low) / 2;
+      if (code_range_index.ranges[mid].start <= addr)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+static void
+code_range_index_add (elf_image_t elf_image, CORE_ADDR start, CORE_ADDR end)
+{
+  uint32_t idx;
+
+  if (code_range_index.num_ranges == code_range_index.max_ranges)
+    {
+      code_range_index.max_ranges = code_range_index.max_ranges
+                                    ? code_range_index.max_ranges * 2 : 64;
+      code_range_index.ranges = xrealloc (code_range_index.ranges,
+                                          code_range_index.max_ranges
+                                          * sizeof *code_range_index.ranges);
+    }
+
+  idx = code_range_index_upper_bound (start);
+  memmove (&code_range_index.ranges[idx + 1], &code_range_index.ranges[idx],
+           (code_range_index.num_ranges - idx) * sizeof *code_range_index.ranges);
+  code_range_index.ranges[idx].start     = start;
+  code_range_index.ranges[idx].end       = end;
+  code_range_index.ranges[idx].elf_image = elf_image;
+  code_range_index.num_ranges++;
+
+  code_range_index_update_max_end (idx);
+}
+
+static void
+code_range_index_remove (elf_image_t elf_image)
+{
+  uint32_t i, j, first = code_range_index.num_ranges;
+
+  for (i = 0, j = 0; i < code_range_index.num_ranges; ++i)
+    {
+      if (code_range_index.ranges[i].elf_image == elf_image)
+        {
+          first = min (first, i);
+          continue;
+        }
+      code_range_index.ranges[j++] = code_range_index.ranges[i];
+    }
+  code_range_index.num_ranges = j;
+
+  code_range_index_update_max_end (first);
+}
+
+/* Return the first ELF image with a code section containing ADDR that
+   MATCHES accepts, or NULL.  A NULL MATCHES accepts any image. */
+elf_image_t
+cuda_elf_image_find_by_address_matching (CORE_ADDR addr,
+                                         bool (*matches) (elf_image_t, void *),
+                                         void *data)
+{
+  uint32_t idx;
+  code_range_t *range;
+
+  /* Walk back from the last range starting at or before ADDR, through all
+     the ranges containing ADDR. Ranges of different contexts may overlap,
+     but rarely do, so this normally stops after one step. */
+  for (idx = code_range_index_upper_bound (addr); idx > 0; --idx)
+    {
+      range = &code_range_index.ranges[idx - 1];
+      if (range->max_end <= addr)
+        break;
+      if (addr < range->end && (!matches || matches (range->elf_image, data)))
+        return range->elf_image;
+    }
+
+  return NULL;
+}
+
+elf_image_t
+cuda_elf_image_find_by_address (CORE_ADDR addr)
+{
+  return cuda_elf_image_find_by_address_matching (addr, NULL, NULL);
+}
+
+/******************************************************************************
+ *
+ *                                 ELF Images
+ *
+ *****************************************************************************/
+
 struct elf_image_st {
   struct objfile    *objfile;     /* pointer to the ELF image as managed by GDB */
-  char               objfile_path [CUDA_GDB_TMP_BUF_SIZE];
-                                  /* file path of the ELF image in the tmp folder */
-  uint64_t           size;        /* the size of the relocated ELF image */
+  char               objfile_name [CUDA_GDB_TMP_BUF_SIZE];
+                                  /* name given to the in-memory objfile */
+  elf_image_data_t   data;        /* the (shared) contents of the ELF image */
   bool               loaded;      /* is the ELF image in memory? */
   bool               uses_abi;    /* does the ELF image uses the ABI to call functions */
   bool               system;      /* is this the system ELF image? */
   module_t           module;      /* the parent module */
+  disasm_cache_t     disasm_cache; /* the disassembled functions of this image */
 
   elf_image_t        prev;
   elf_image_t        next;
 };
 
 
+/* Create a new ELF image object. IMAGE must have been allocated with xmalloc
+   and is owned by the ELF image from now on. */
 elf_image_t
 cuda_elf_image_new (void *image, uint64_t size, module_t module)
 {
   elf_image_t elf_image;
+  context_t context;
 
   elf_image = xmalloc (sizeof (*elf_image));
-  elf_image->size     = size;
+  elf_image->objfile  = NULL;
+  elf_image->data     = elf_image_data_get (image, size);
   elf_image->loaded   = false;
   elf_image->uses_abi = false;
   elf_image->system   = false;
   elf_image->module   = module;
+  elf_image->disasm_cache = disasm_cache_create (elf_image);
   elf_image->prev     = NULL;
   elf_image->next     = NULL;
 
@@ -68,7 +397,11 @@ cuda_elf_image_new (void *image, uint64_t size, module_t module)
     }
   elf_image_chain = elf_image;
 
-  cuda_elf_image_save (elf_image, image);
+  context = module_get_context (module);
+  snprintf (elf_image->objfile_name, sizeof (elf_image->objfile_name),
+            "%s/elf.%llx.%llx.o", cuda_gdb_session_get_dir (),
+            (unsigned long long) context_get_id (context),
+            (unsigned long long) module_get_id (module));
 
   return elf_image;
 }
@@ -84,6 +417,8 @@ cuda_elf_image_delete (elf_image_t elf_image)
     elf_image_chain = elf_image->next;
 
   gdb_assert (elf_image);
+  disasm_cache_destroy (elf_image->disasm_cache);
+  elf_image_data_put (elf_image->data);
   xfree (elf_image);
 }
 
@@ -98,7 +433,14 @@ uint64_t
 cuda_elf_image_get_size (elf_image_t elf_image)
 {
   gdb_assert (elf_image);
-  return elf_image->size;
+  return elf_image->data->size;
+}
+
+const char *
+cuda_elf_image_get_path (elf_image_t elf_image)
+{
+  gdb_assert (elf_image);
+  return elf_image_data_save (elf_image->data);
 }
 
 module_t
@@ -108,6 +450,13 @@ cuda_elf_image_get_module (elf_image_t elf_image)
   return elf_image->module;
 }
 
+disasm_cache_t
+cuda_elf_image_get_disasm_cache (elf_image_t elf_image)
+{
+  gdb_assert (elf_image);
+  return elf_image->disasm_cache;
+}
+
 elf_image_t
 cuda_elf_image_get_next (elf_image_t elf_image)
 {
@@ -163,64 +512,43 @@ cuda_elf_image_uses_abi (elf_image_t elf_image)
 
 void cuda_decode_line_table (struct objfile *objfile);
 
-/* This function gets the ELF image from a module load and saves it
- * onto the hard drive. */
-void
-cuda_elf_image_save (elf_image_t elf_image, void *image)
-{
-  int object_file_fd;
-  struct stat object_file_stat;
-  context_t context;
-  uint64_t context_id;
-  uint64_t module_id;
-  uint64_t nbytes = 0;
-
-  gdb_assert (elf_image);
-  gdb_assert (!elf_image->loaded);
-
-  context    = module_get_context (elf_image->module);
-  context_id = context_get_id (context);
-  module_id  = module_get_id (elf_image->module);
-  snprintf (elf_image->objfile_path, sizeof (elf_image->objfile_path),
-            "%s/elf.%llx.%llx.o.XXXXXX",
-            cuda_gdb_session_get_dir (),
-            (unsigned long long)context_id,
-            (unsigned long long)module_id);
-
-  object_file_fd = mkstemp (elf_image->objfile_path);
-  if (object_file_fd == -1)
-    error (_("Error: Failed to create device ELF symbol file!"));
-
-  nbytes = write (object_file_fd, image, elf_image->size);
-  close (object_file_fd);
-  if (nbytes != elf_image->size)
-    error (_("Error: Failed to write the ELF image file"));
-
-  if (stat (elf_image->objfile_path, &object_file_stat))
-    error (_("Error: Failed to stat device ELF symbol file!"));
-  else if (object_file_stat.st_size != elf_image->size)
-    error (_("Error: The device ELF file size is incorrect!"));
-}
-
-/* cuda_elf_image_load() reads the ELF image file into symbol table.
- * Native debugging calls cuda_elf_image_save() first. Remote debugging
- * only calls load() since the ELF image file has already fetched from server. */
+/* cuda_elf_image_load() reads the in-memory ELF image into symbol table. */
 void
 cuda_elf_image_load (elf_image_t elf_image, bool is_system)
 {
   bfd *abfd;
   struct objfile *objfile = NULL;
   const struct bfd_arch_info *arch_info;
+  struct cleanup *cleanups;
+  struct obj_section *osect = NULL;
+  asection *section;
+  struct timeval start, end;
+  double elapsed;
 
   gdb_assert (elf_image);
   gdb_assert (!elf_image->loaded);
 
+  gettimeofday (&start, NULL);
+
   /* auto breakpoints */
   cuda_set_current_elf_image (elf_image);
 
-  /* Open the object file and make sure to adjust its arch_info before reading
-     its symbols. */
-  abfd = symfile_bfd_open (elf_image->objfile_path);
+  /* Open the object file straight from memory and make sure to adjust its
+     arch_info before reading its symbols. */
+  abfd = gdb_bfd_openr_iovec (elf_image->objfile_name, gnutarget,
+                              elf_image_data_bfd_open, elf_image->data,
+                              elf_image_data_bfd_pread,
+                              elf_image_data_bfd_close,
+                              elf_image_data_bfd_stat);
+  if (!abfd)
+    error (_("Error: Failed to open device ELF image: %s."),
+           bfd_errmsg (bfd_get_error ()));
+  cleanups = make_cleanup_bfd_unref (abfd);
+
+  if (!bfd_check_format (abfd, bfd_object))
+    error (_("Error: Failed to read device ELF image: %s."),
+           bfd_errmsg (bfd_get_error ()));
+
   arch_info = bfd_lookup_arch (bfd_arch_m68k, 0);
   bfd_set_arch_info (abfd, arch_info);
 
@@ -246,6 +574,15 @@ cuda_elf_image_load (elf_image_t elf_image, bool is_system)
   elf_image->loaded   = true;
   elf_image->system   = is_system;
   elf_image->uses_abi = cuda_is_bfd_version_call_abi (objfile->obfd);
+
+  ALL_OBJFILE_OSECTIONS (objfile, osect)
+    {
+      section = osect->the_bfd_section;
+      if (section && (section->flags & SEC_CODE) && section->size)
+        code_range_index_add (elf_image, section->vma,
+                              section->vma + section->size);
+    }
+
   cuda_trace ("loaded ELF image (name=%s, module=%p, abi=%d, objfile=%p)",
               objfile->name, elf_image->module,
               elf_image->uses_abi, objfile);
@@ -255,6 +592,15 @@ cuda_elf_image_load (elf_image_t elf_image, bool is_system)
       cuda_auto_breakpoints_add_locations ();
 
   cuda_set_current_elf_image (NULL);
+
+  do_cleanups (cleanups);
+
+  gettimeofday (&end, NULL);
+  elapsed = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_usec - start.tv_usec);
+  elf_image_stats.loads++;
+  elf_image_stats.total_time += elapsed;
+  if (elf_image_stats.max_time < elapsed)
+    elf_image_stats.max_time = elapsed;
 }
 
 void
@@ -269,11 +615,15 @@ cuda_elf_image_unload (elf_image_t elf_image)
   cuda_trace ("unloading ELF image (name=%s, module=%p)",
               objfile->name, elf_image->module);
 
+  code_range_index_remove (elf_image);
+
   /* Make sure that all its users will be cleaned up. */
   clear_current_source_symtab_and_line ();
   clear_displays ();
   cuda_reset_invalid_breakpoint_location_section (objfile);
   free_objfile (objfile);
+  disasm_cache_flush (elf_image->disasm_cache);
+  cuda_linecache_invalidate ();
 
   elf_image->objfile = NULL;
   elf_image->loaded = false;
@@ -282,3 +632,16 @@ cuda_elf_image_unload (elf_image_t elf_image)
   cuda_auto_breakpoints_remove_locations (elf_image);
   cuda_unresolve_breakpoints (elf_image);
 }
+
+void
+cuda_elf_image_print_statistics (void)
+{
+  printf_unfiltered (_("ELF images: %llu loads, %llu shared, %llu written "
+                       "to disk, average load time %.0f usec, "
+                       "max load time %.0f usec\n"),
+                     (unsigned long long) elf_image_stats.loads,
+                     (unsigned long long) elf_image_stats.shared,
+                     (unsigned long long) elf_image_stats.saved,
+                     elf_image_stats.total_time / max (elf_image_stats.loads, 1),
+                     elf_image_stats.max_time);
+}
@@ -40,18 +40,24 @@ void        cuda_elf_image_delete (elf_image_t elf_image);
 void *           cuda_elf_image_get_image        (elf_image_t elf_image);
 struct objfile * cuda_elf_image_get_objfile      (elf_image_t elf_image);
 uint64_t         cuda_elf_image_get_size         (elf_image_t elf_image);
+const char *     cuda_elf_image_get_path         (elf_image_t elf_image);
 module_t         cuda_elf_image_get_module       (elf_image_t elf_image);
 elf_image_t      cuda_elf_image_get_next         (elf_image_t elf_image);
+disasm_cache_t   cuda_elf_image_get_disasm_cache (elf_image_t elf_image);
 
 bool             cuda_elf_image_is_loaded        (elf_image_t elf_image);
 bool             cuda_elf_image_uses_abi         (elf_image_t elf_image);
 bool             cuda_elf_image_is_system        (elf_image_t elf_image);
 
-void             cuda_elf_image_save             (elf_image_t elf_image, void *image);
 void             cuda_elf_image_load             (elf_image_t elf_image, bool is_system);
 void             cuda_elf_image_unload           (elf_image_t elf_image);
 
 bool             cuda_elf_image_contains_address (elf_image_t elf_image, CORE_ADDR addr);
+elf_image_t      cuda_elf_image_find_by_address  (CORE_ADDR addr);
+elf_image_t      cuda_elf_image_find_by_address_matching (CORE_ADDR addr,
+                                                          bool (*matches) (elf_image_t, void *),
+                                                          void *data);
 void             cuda_elf_image_resolve_breakpoints (elf_image_t elf_image);
+void             cuda_elf_image_print_statistics (void);
 
 #endif
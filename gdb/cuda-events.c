@@ -170,9 +170,8 @@ cuda_event_pop_context (uint32_t dev_id, uint64_t context_id, uint32_t tid)
                        (unsigned long long)context_id, dev_id);
 }
 
-/* In native debugging, void *elf_image points to memory. In remote debugging, it
-   points to a string which is ELF image file path in the temp folder. Both cases 
-   will be handled by cuda_elf_image_new() differently. */
+/* elf_image_raw points to the ELF image contents, allocated with xmalloc.
+   Ownership is passed to the new module. */
 static void
 cuda_event_load_elf_image (uint32_t dev_id, uint64_t context_id, uint64_t module_id,
                            void *elf_image_raw, uint64_t elf_image_size, uint32_t properties)
@@ -245,7 +244,6 @@ cuda_event_kernel_ready (uint32_t dev_id, uint64_t context_id, uint64_t module_i
 #if defined(__linux__) && defined(GDB_NM_FILE)
   struct lwp_info *lp            = NULL;
 #endif
-  struct gdbarch  *gdbarch       = get_current_arch ();
 
   cuda_trace_event ("CUDBG_EVENT_KERNEL_READY dev_id=%u context=%llx"
                     " module=%llx grid_id=%lld tid=%u type=%u"
@@ -372,11 +370,10 @@ cuda_process_event (CUDBGEvent *event)
             handle         = event->cases.elfImageLoaded.handle;
             properties     = event->cases.elfImageLoaded.properties;
             elf_image_size = event->cases.elfImageLoaded.size;
-            elf_image      = malloc (elf_image_size);
+            elf_image      = xmalloc (elf_image_size);
             cuda_api_get_elf_image (dev_id, handle, true, elf_image, elf_image_size);
             cuda_event_load_elf_image (dev_id, context_id, module_id,
                                        elf_image, elf_image_size, properties);
-            free (elf_image);
             break;
           }
         case CUDBG_EVENT_KERNEL_READY:
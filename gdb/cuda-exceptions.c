@@ -24,6 +24,7 @@
 #include "cuda-coords.h"
 #include "cuda-exceptions.h"
 #include "cuda-iterator.h"
+#include "cuda-linecache.h"
 #include "cuda-options.h"
 #include "cuda-state.h"
 
@@ -103,7 +104,7 @@ print_exception_origin (cuda_exception_t exception)
 
   ui_out_text (uiout, "The exception was triggered at ");
   pc = warp_get_error_pc (c.dev, c.sm, c.wp);
-  sal = find_pc_line ((CORE_ADDR)pc, 0);
+  sal = cuda_linecache_find_pc_line ((CORE_ADDR)pc);
 
   if (sal.symtab && sal.line)
     {
@@ -278,7 +279,9 @@ cuda_exception_hit_p (cuda_exception_t exception)
         }
     }
 
-  if (filter.dev == CUDA_WILDCARD || device_has_exception (filter.dev))
+  if (filter.dev == CUDA_WILDCARD
+      ? cuda_system_has_lane_exception ()
+      : device_has_lane_exception (filter.dev))
     {
       itr = cuda_iterator_create (CUDA_ITERATOR_TYPE_THREADS, &filter,
                                   CUDA_SELECT_VALID | CUDA_SELECT_EXCPT | CUDA_SELECT_SNGL);
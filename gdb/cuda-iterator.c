@@ -29,18 +29,71 @@
 static CuDim3 CUDA_WILDCARD_DIM = {CUDA_WILDCARD, CUDA_WILDCARD, CUDA_WILDCARD};
 static CuDim3 CUDA_INVALID_DIM = {CUDA_INVALID, CUDA_INVALID, CUDA_INVALID};
 
+/* Logical iterators have to return their elements sorted by logical
+   coordinates, which do not follow the physical layout of the device.  They
+   walk the block index of the system (see cuda_system_get_block_index), a
+   group of entries at a time: the entries of a kernel, or of a block.  Only
+   the threads of the block being iterated are collected, to order them by
+   thread index. */
+
+/* A thread of the block being iterated */
+typedef struct {
+  CuDim3   threadIdx;
+  uint32_t dev;
+  uint32_t sm;
+  uint32_t wp;
+  uint32_t ln;
+} cuda_iterator_thread_t;
+
+/* How to walk the lanes of a group of the block index */
+typedef enum {
+  CUDA_ITERATOR_WALK_FIRST,     /* stop at the first lane */
+  CUDA_ITERATOR_WALK_COUNT,     /* count the lanes */
+  CUDA_ITERATOR_WALK_COLLECT,   /* add the lanes to the threads of the block */
+} cuda_iterator_walk_t;
+
+/* Largest block for which threads are ordered by bucketing their rank in
+   the block instead of sorting them. */
+#define CUDA_ITERATOR_MAX_BUCKETS 65536
+#define CUDA_ITERATOR_EMPTY_BUCKET (~0U)
+
+/* The filter and select mask of an iterator, compiled once at creation
+   time into the list of criteria to check and the state to fetch. */
+typedef struct {
+  bool dev;
+  bool sm;
+  bool wp;
+  bool ln;
+  bool kernel;
+  bool grid;
+  bool block;
+  bool thread;
+  bool fetch_logical;        /* kernel, grid and block index of the warps */
+  bool fetch_thread;         /* thread index of the lanes */
+  cuda_iterator_type unit;   /* physical granularity of the elements */
+} cuda_iterator_plan_t;
+
 struct cuda_iterator_t
 {
   cuda_iterator_type type;
   cuda_coords_t filter;
   cuda_select_t mask;
-  bool     completed;
-  uint32_t num_elements;
-  uint32_t num_unique_elements;
-  uint32_t list_size;
-  uint32_t index;
+  cuda_iterator_plan_t plan;
+  bool     has_current;
+  uint32_t num_returned;
+  cuda_coords_t cursor;      /* physical walk position */
   cuda_coords_t current;
-  cuda_coords_t *list;
+
+  /* Logical iterators only */
+  bool     has_group;
+  cuda_block_warps_t group;  /* first entry of the current group */
+  uint32_t num_threads;
+  uint32_t threads_size;
+  uint32_t thread_index;
+  cuda_iterator_thread_t *threads;
+  uint32_t *order;           /* order of the threads, NULL if sorted */
+  uint32_t buckets_size;
+  uint32_t *buckets;
 };
 
 /*
@@ -131,37 +184,136 @@ cuda_iterator_filter_coords(const cuda_coords_t *in, cuda_iterator_type type)
 }
 
 static bool
-cuda_iterator_step (cuda_iterator itr)
+cuda_iterator_physical_p (cuda_iterator itr)
 {
-  uint64_t validWarpsMask;
-  uint64_t validLanesMask;
-  bool validWarp;
-  bool validLane;
-  cuda_coords_t *c = &itr->current;
-  cuda_coords_t *filter = itr->filter.valid ? &itr->filter: NULL;
+  return (itr->type & CUDA_ITERATOR_TYPE_MASK_PHYSICAL) != 0;
+}
+
+static bool
+cuda_iterator_dim3_is_wildcard (CuDim3 *d)
+{
+  return d->x == CUDA_WILDCARD && d->y == CUDA_WILDCARD && d->z == CUDA_WILDCARD;
+}
+
+/* Compile the filter and the select mask of the iterator */
+static void
+cuda_iterator_compile_plan (cuda_iterator itr)
+{
+  cuda_iterator_plan_t *plan = &itr->plan;
+  cuda_coords_t *f = &itr->filter;
+  bool physical = cuda_iterator_physical_p (itr);
+  bool lane_criteria;
+
+  memset (plan, 0, sizeof *plan);
+
+  if (f->valid)
+    {
+      plan->dev    = f->dev != CUDA_WILDCARD;
+      plan->sm     = f->sm  != CUDA_WILDCARD;
+      plan->wp     = f->wp  != CUDA_WILDCARD;
+      plan->ln     = f->ln  != CUDA_WILDCARD;
+      plan->kernel = f->kernelId != CUDA_WILDCARD;
+      plan->grid   = f->gridId   != CUDA_WILDCARD;
+      plan->block  = !cuda_iterator_dim3_is_wildcard (&f->blockIdx);
+      plan->thread = !cuda_iterator_dim3_is_wildcard (&f->threadIdx);
+    }
+
+  plan->fetch_logical = !physical ||
+                        itr->type >= CUDA_ITERATOR_TYPE_SMS ||
+                        plan->kernel || plan->grid || plan->block;
+  plan->fetch_thread  = itr->type == CUDA_ITERATOR_TYPE_LANES ||
+                        itr->type == CUDA_ITERATOR_TYPE_THREADS ||
+                        plan->thread;
+
+  lane_criteria = plan->ln || plan->thread ||
+                  (itr->mask & (CUDA_SELECT_BKPT | CUDA_SELECT_EXCPT));
+
+  if (physical)
+    plan->unit = itr->type;
+  else if (itr->type == CUDA_ITERATOR_TYPE_THREADS || lane_criteria)
+    plan->unit = CUDA_ITERATOR_TYPE_LANES;
+  else
+    plan->unit = CUDA_ITERATOR_TYPE_WARPS;
+}
+
+/* Returns true if lane C->ln of warp C->wp satisfies the lane criteria of
+   the plan.  The thread index of the lane is left in C. */
+static bool
+cuda_iterator_lane_matches (cuda_iterator itr, cuda_coords_t *c,
+                            uint32_t validLanesMask, uint32_t exceptionLanesMask)
+{
+  cuda_coords_t *filter = &itr->filter;
+  cuda_iterator_plan_t *plan = &itr->plan;
   bool valid            = itr->mask & CUDA_SELECT_VALID;
   bool at_breakpoint    = itr->mask & CUDA_SELECT_BKPT;
   bool at_exception     = itr->mask & CUDA_SELECT_EXCPT;
-  bool single           = itr->mask & CUDA_SELECT_SNGL;
-  struct address_space *aspace = NULL;
+  bool validLane        = (validLanesMask>>c->ln)&1;
+
+  if (valid && !validLane)
+    return false;
+  if (plan->ln && filter->ln != c->ln)
+    return false;
+
+  if (plan->fetch_thread)
+    c->threadIdx = validLane ? lane_get_thread_idx (c->dev, c->sm, c->wp, c->ln) : CUDA_INVALID_DIM;
+  else
+    c->threadIdx = CUDA_INVALID_DIM;
+
+  if (plan->thread && !cuda_dim3_matches (&filter->threadIdx, &c->threadIdx))
+    return false;
+
+  /* if looking for breakpoints, skip the lanes that are not at
+     the breakpoint of their warp */
+  if (at_breakpoint &&
+      (!validLane ||
+       !lane_is_active (c->dev, c->sm, c->wp, c->ln)))
+    return false;
 
-  if (single && itr->num_elements)
+  /* if looking for exceptions, skip healthy kernels */
+  if (at_exception &&
+      (!validLane ||
+       !((exceptionLanesMask>>c->ln)&1) ||
+       !lane_is_active (c->dev, c->sm, c->wp, c->ln)))
     return false;
 
-  if (!ptid_equal (inferior_ptid, null_ptid))
-    aspace = target_thread_address_space (inferior_ptid);
+  return true;
+}
 
+/* Advance the physical walk to the next lane satisfying the plan.  The full
+   coordinates of the lane are left in the cursor. */
+static bool
+cuda_iterator_step (cuda_iterator itr)
+{
+  uint64_t validWarpsMask;
+  uint64_t validLanesMask;
+  uint64_t exceptionWarpsMask;
+  uint64_t breakpointWarpsMask;
+  uint32_t exceptionLanesMask;
+  bool validWarp;
+  cuda_coords_t *c = &itr->cursor;
+  cuda_coords_t *filter = &itr->filter;
+  cuda_iterator_plan_t *plan = &itr->plan;
+  bool valid            = itr->mask & CUDA_SELECT_VALID;
+  bool at_breakpoint    = itr->mask & CUDA_SELECT_BKPT;
+  bool at_exception     = itr->mask & CUDA_SELECT_EXCPT;
   for (; c->dev < cuda_system_get_num_devices (); ++c->dev)
     {
-      if (filter && !cuda_val_matches (filter->dev, c->dev))
+      if (plan->dev && filter->dev != c->dev)
         continue;
 
       for (; c->sm < device_get_num_sms (c->dev); ++c->sm)
         {
-          if (at_exception && !sm_has_exception(c->dev, c->sm))
+          /* Only descend into the warps with a lane exception */
+          exceptionWarpsMask = at_exception ? sm_get_exception_warps_mask (c->dev, c->sm) : 0;
+          if (at_exception && exceptionWarpsMask == 0)
             continue;
 
-          if (filter && !cuda_val_matches (filter->sm, c->sm))
+          /* Only descend into the warps of the stop report at a breakpoint */
+          breakpointWarpsMask = at_breakpoint ? sm_get_breakpoint_warps_mask (c->dev, c->sm) : 0;
+          if (at_breakpoint && breakpointWarpsMask == 0)
+            continue;
+
+          if (plan->sm && filter->sm != c->sm)
             continue;
 
           validWarpsMask = sm_get_valid_warps_mask (c->dev, c->sm);
@@ -173,58 +325,36 @@ cuda_iterator_step (cuda_iterator itr)
               validWarp = (validWarpsMask>>c->wp)&1;
               if (valid && !validWarp)
                 continue;
-              if (filter && !cuda_val_matches (filter->wp, c->wp))
+              if (at_exception && !((exceptionWarpsMask>>c->wp)&1))
+                continue;
+              if (at_breakpoint && !((breakpointWarpsMask>>c->wp)&1))
+                continue;
+              if (plan->wp && filter->wp != c->wp)
                 continue;
 
-              c->kernelId = validWarp ? warp_get_kernel_id (c->dev, c->sm, c->wp) : CUDA_INVALID;
-              c->gridId   = validWarp ? warp_get_grid_id (c->dev, c->sm, c->wp) : CUDA_INVALID;
-              c->blockIdx = validWarp ? warp_get_block_idx (c->dev, c->sm, c->wp) : CUDA_INVALID_DIM;
+              if (plan->fetch_logical)
+                {
+                  c->kernelId = validWarp ? warp_get_kernel_id (c->dev, c->sm, c->wp) : CUDA_INVALID;
+                  c->gridId   = validWarp ? warp_get_grid_id (c->dev, c->sm, c->wp) : CUDA_INVALID;
+                  c->blockIdx = validWarp ? warp_get_block_idx (c->dev, c->sm, c->wp) : CUDA_INVALID_DIM;
+                }
+              else
+                {
+                  c->kernelId = CUDA_INVALID;
+                  c->gridId   = CUDA_INVALID;
+                  c->blockIdx = CUDA_INVALID_DIM;
+                }
 
-              if (filter &&
-                  (!cuda_val64_matches (filter->kernelId, c->kernelId) ||
-                   !cuda_val64_matches (filter->gridId, c->gridId)     ||
-                   !cuda_dim3_matches (&filter->blockIdx, &c->blockIdx)))
+              if ((plan->kernel && !cuda_val64_matches (filter->kernelId, c->kernelId)) ||
+                  (plan->grid   && !cuda_val64_matches (filter->gridId, c->gridId))     ||
+                  (plan->block  && !cuda_dim3_matches (&filter->blockIdx, &c->blockIdx)))
                 continue;
 
-              validLanesMask = warp_get_valid_lanes_mask (c->dev, c->sm, c->wp);
+              validLanesMask = validWarp ? warp_get_valid_lanes_mask (c->dev, c->sm, c->wp) : 0;
+              exceptionLanesMask = at_exception ? warp_get_exception_lanes_mask (c->dev, c->sm, c->wp) : 0;
               for (; c->ln < device_get_num_lanes (c->dev); ++c->ln)
-                {
-                  validLane = (validLanesMask>>c->ln)&validWarp;
-                  if (valid && !validLane)
-                    continue;
-                  if (filter && !cuda_val_matches (filter->ln, c->ln))
-                    continue;
-
-                  c->threadIdx = validLane ? lane_get_thread_idx (c->dev, c->sm, c->wp, c->ln) : CUDA_INVALID_DIM;
-
-                  if (filter && !cuda_dim3_matches (&filter->threadIdx, &c->threadIdx))
-                    continue;
-
-                  /* if looking for breakpoints, skip non-broken kernels */
-                  if (at_breakpoint &&
-                      (!validLane ||
-                       !lane_is_active (c->dev, c->sm, c->wp, c->ln) ||
-                       !breakpoint_here_p (aspace, lane_get_virtual_pc (c->dev, c->sm, c->wp, c->ln))))
-                    continue;
-
-                  /* if looking for exceptions, skip healthy kernels */
-                  if (at_exception &&
-                      (!validLane ||
-                       !lane_is_active (c->dev, c->sm, c->wp, c->ln) ||
-                       !lane_get_exception (c->dev, c->sm, c->wp, c->ln)))
-                    continue;
-
-                  /* allocate more memory if needed */
-                  if (itr->num_elements >= itr->list_size)
-                    {
-                      itr->list_size *= 2;
-                      itr->list = xrealloc (itr->list, itr->list_size * sizeof (*itr->list));
-                    }
-
-                  itr->list[itr->num_elements++] = cuda_iterator_filter_coords (c, itr->type);
-                  ++c->ln;
+                if (cuda_iterator_lane_matches (itr, c, validLanesMask, exceptionLanesMask))
                   return true;
-                }
               c->ln = 0;
             }
           c->wp = 0;
@@ -232,107 +362,423 @@ cuda_iterator_step (cuda_iterator itr)
       c->sm = 0;
     }
 
-
   return false;
 }
 
-/* Count the number of unique elements. The duplicates are not eliminated to
-   save time. We can simply hop them when iterating. */
+/* Move the cursor past the physical unit of the element it points to.  All
+   the lanes of that unit would only produce duplicates. */
+static void
+cuda_iterator_skip_unit (cuda_iterator itr)
+{
+  cuda_coords_t *c = &itr->cursor;
+
+  switch (itr->plan.unit)
+    {
+    case CUDA_ITERATOR_TYPE_DEVICES:
+      c->sm = device_get_num_sms (c->dev);
+      c->wp = 0;
+      c->ln = 0;
+      break;
+    case CUDA_ITERATOR_TYPE_SMS:
+      c->wp = device_get_num_warps (c->dev);
+      c->ln = 0;
+      break;
+    case CUDA_ITERATOR_TYPE_WARPS:
+      c->ln = device_get_num_lanes (c->dev);
+      break;
+    default:
+      ++c->ln;
+      break;
+    }
+}
+
+static void
+cuda_iterator_reset_cursor (cuda_iterator itr)
+{
+  itr->cursor = CUDA_INVALID_COORDS;
+  itr->cursor.valid = true;
+  itr->cursor.dev = itr->cursor.sm = itr->cursor.wp = itr->cursor.ln = 0;
+}
+
+/* Index of the first entry of BLOCKS after the group of entry KEY, for
+   an iterator of the given type: the entries of the same kernel and grid,
+   and of the same block unless iterating over kernels. */
 static uint32_t
-cuda_iterator_count_unique_elements (cuda_iterator itr)
+cuda_iterator_group_after (const cuda_block_warps_t *blocks, uint32_t num_blocks,
+                           const cuda_block_warps_t *key, cuda_iterator_type type)
 {
-  uint32_t i, rc;
+  cuda_block_warps_t last = *key;
+  uint32_t lo = 0, hi = num_blocks, mid;
 
-  if (itr->num_elements == 0)
-    return 0;
-  for (rc = i = 1; i < itr->num_elements; ++i)
+  /* The last possible entry of the group */
+  if (type == CUDA_ITERATOR_TYPE_KERNELS)
+    last.block_idx.x = last.block_idx.y = last.block_idx.z = ~0U;
+  last.dev = ~0U;
+  last.sm  = ~0U;
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (cuda_block_warps_compare (&blocks[mid], &last) <= 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/* Returns true if the entry of the block index may hold elements of the
+   iterator, from the criteria shared by all its warps. */
+static bool
+cuda_iterator_block_matches (cuda_iterator itr, const cuda_block_warps_t *b)
+{
+  cuda_coords_t *filter = &itr->filter;
+  cuda_iterator_plan_t *plan = &itr->plan;
+
+  return (!plan->dev    || filter->dev == b->dev) &&
+         (!plan->sm     || filter->sm  == b->sm)  &&
+         (!plan->kernel || cuda_val64_matches (filter->kernelId, b->kernel_id)) &&
+         (!plan->grid   || cuda_val64_matches (filter->gridId, b->grid_id)) &&
+         (!plan->block  || cuda_dim3_matches (&filter->blockIdx, (CuDim3 *) &b->block_idx));
+}
+
+static void
+cuda_iterator_add_thread (cuda_iterator itr, const cuda_coords_t *c)
+{
+  cuda_iterator_thread_t *t;
+
+  if (itr->num_threads >= itr->threads_size)
+    {
+      itr->threads_size = max (2 * itr->threads_size, 64);
+      itr->threads = xrealloc (itr->threads, itr->threads_size * sizeof (*itr->threads));
+    }
+
+  t = &itr->threads[itr->num_threads++];
+  t->threadIdx = c->threadIdx;
+  t->dev       = c->dev;
+  t->sm        = c->sm;
+  t->wp        = c->wp;
+  t->ln        = c->ln;
+}
+
+/* Walk the lanes satisfying the iterator of the warps of the entries
+   BLOCKS[START, END) of the block index, in physical order.  With
+   CUDA_ITERATOR_WALK_FIRST, the walk stops at the first lane, left in *C.
+   With CUDA_ITERATOR_WALK_COLLECT, the lanes are added to the threads of
+   the iterator.  Returns the number of lanes walked. */
+static uint32_t
+cuda_iterator_walk_group (cuda_iterator itr, const cuda_block_warps_t *blocks,
+                          uint32_t start, uint32_t end,
+                          cuda_iterator_walk_t walk, cuda_coords_t *c)
+{
+  const cuda_block_warps_t *b;
+  cuda_coords_t lane;
+  uint64_t warps_mask;
+  uint32_t validLanesMask, exceptionLanesMask;
+  uint32_t i, count = 0;
+  bool at_breakpoint = itr->mask & CUDA_SELECT_BKPT;
+  bool at_exception  = itr->mask & CUDA_SELECT_EXCPT;
+
+  for (i = start; i < end; ++i)
     {
-      if ((itr->type & CUDA_ITERATOR_TYPE_MASK_PHYSICAL) &&
-          !cuda_coords_compare_physical (&itr->list[i], &itr->list[i-1]))
+      b = &blocks[i];
+      if (!cuda_iterator_block_matches (itr, b))
         continue;
-      if ((itr->type & CUDA_ITERATOR_TYPE_MASK_LOGICAL) &&
-          !cuda_coords_compare_logical (&itr->list[i], &itr->list[i-1]))
+
+      warps_mask = b->warps_mask;
+      if (itr->plan.wp)
+        warps_mask &= 1ULL << itr->filter.wp;
+      if (at_exception && warps_mask)
+        warps_mask &= sm_get_exception_warps_mask (b->dev, b->sm);
+      if (at_breakpoint && warps_mask)
+        warps_mask &= sm_get_breakpoint_warps_mask (b->dev, b->sm);
+
+      lane.valid    = true;
+      lane.dev      = b->dev;
+      lane.sm       = b->sm;
+      lane.kernelId = b->kernel_id;
+      lane.gridId   = b->grid_id;
+      lane.blockIdx = b->block_idx;
+
+      for (lane.wp = 0; warps_mask; ++lane.wp)
+        {
+          if (!((warps_mask >> lane.wp) & 1ULL))
+            continue;
+          warps_mask &= ~(1ULL << lane.wp);
+
+          validLanesMask = warp_get_valid_lanes_mask (lane.dev, lane.sm, lane.wp);
+          exceptionLanesMask = at_exception ? warp_get_exception_lanes_mask (lane.dev, lane.sm, lane.wp) : 0;
+          for (lane.ln = 0; lane.ln < device_get_num_lanes (lane.dev); ++lane.ln)
+            {
+              if (!cuda_iterator_lane_matches (itr, &lane, validLanesMask, exceptionLanesMask))
+                continue;
+
+              ++count;
+              if (walk == CUDA_ITERATOR_WALK_FIRST)
+                {
+                  *c = lane;
+                  return count;
+                }
+              if (walk == CUDA_ITERATOR_WALK_COLLECT)
+                cuda_iterator_add_thread (itr, &lane);
+            }
+        }
+    }
+
+  return count;
+}
+
+static int
+cuda_iterator_compare_threads (const void *a, const void *b)
+{
+  const cuda_iterator_thread_t *t1 = a;
+  const cuda_iterator_thread_t *t2 = b;
+
+  if (t1->threadIdx.x != t2->threadIdx.x)
+    return t1->threadIdx.x < t2->threadIdx.x ? -1 : 1;
+  if (t1->threadIdx.y != t2->threadIdx.y)
+    return t1->threadIdx.y < t2->threadIdx.y ? -1 : 1;
+  if (t1->threadIdx.z != t2->threadIdx.z)
+    return t1->threadIdx.z < t2->threadIdx.z ? -1 : 1;
+  return 0;
+}
+
+/* Order the threads of the block being iterated.  The rank of a thread in
+   the block gives its position directly when the block dimensions are
+   known. */
+static void
+cuda_iterator_order_threads (cuda_iterator itr)
+{
+  cuda_iterator_thread_t *t;
+  kernel_t kernel;
+  CuDim3 dim;
+  uint64_t num_buckets;
+  uint32_t i, rank, n;
+  bool bucketed;
+
+  itr->order = NULL;
+  if (!itr->num_threads)
+    return;
+
+  t = &itr->threads[0];
+  kernel = warp_get_kernel (t->dev, t->sm, t->wp);
+  dim = kernel ? kernel_get_block_dim (kernel) : CUDA_INVALID_DIM;
+  num_buckets = (uint64_t)dim.x * dim.y * dim.z;
+
+  bucketed = dim.x != CUDA_INVALID && num_buckets > 0 &&
+             num_buckets <= CUDA_ITERATOR_MAX_BUCKETS;
+
+  if (bucketed)
+    {
+      if (num_buckets > itr->buckets_size)
+        {
+          itr->buckets_size = num_buckets;
+          itr->buckets = xrealloc (itr->buckets, itr->buckets_size * sizeof (*itr->buckets));
+        }
+      memset (itr->buckets, 0xff, num_buckets * sizeof (*itr->buckets));
+
+      for (i = 0; i < itr->num_threads; ++i)
+        {
+          t = &itr->threads[i];
+          if (t->threadIdx.x >= dim.x || t->threadIdx.y >= dim.y ||
+              t->threadIdx.z >= dim.z)
+            {
+              bucketed = false;
+              break;
+            }
+          rank = (t->threadIdx.x * dim.y + t->threadIdx.y) * dim.z + t->threadIdx.z;
+          if (itr->buckets[rank] != CUDA_ITERATOR_EMPTY_BUCKET)
+            {
+              bucketed = false;
+              break;
+            }
+          itr->buckets[rank] = i;
+        }
+    }
+
+  if (bucketed)
+    {
+      /* Compact the buckets into the rank order of the threads */
+      for (rank = 0, n = 0; rank < num_buckets; ++rank)
+        if (itr->buckets[rank] != CUDA_ITERATOR_EMPTY_BUCKET)
+          itr->buckets[n++] = itr->buckets[rank];
+      itr->order = itr->buckets;
+    }
+  else
+    qsort (itr->threads, itr->num_threads, sizeof (*itr->threads),
+           cuda_iterator_compare_threads);
+}
+
+/* Produce the next element of a logical iterator */
+static bool
+cuda_iterator_advance_logical (cuda_iterator itr, cuda_coords_t *c)
+{
+  const cuda_block_warps_t *blocks;
+  cuda_iterator_thread_t *t;
+  cuda_iterator_type group_type;
+  uint32_t num_blocks, start, end;
+
+  if (itr->type == CUDA_ITERATOR_TYPE_THREADS &&
+      itr->thread_index < itr->num_threads)
+    {
+      t = &itr->threads[itr->order ? itr->order[itr->thread_index]
+                                   : itr->thread_index];
+      ++itr->thread_index;
+
+      c->valid     = true;
+      c->dev       = t->dev;
+      c->sm        = t->sm;
+      c->wp        = t->wp;
+      c->ln        = t->ln;
+      c->kernelId  = itr->group.kernel_id;
+      c->gridId    = itr->group.grid_id;
+      c->blockIdx  = itr->group.block_idx;
+      c->threadIdx = t->threadIdx;
+      return true;
+    }
+
+  /* The threads of an iterator are produced one block at a time */
+  group_type = itr->type == CUDA_ITERATOR_TYPE_KERNELS
+             ? CUDA_ITERATOR_TYPE_KERNELS : CUDA_ITERATOR_TYPE_BLOCKS;
+
+  /* The index may have been rebuilt since the last group: look the next
+     group up from the current one instead of keeping a position. */
+  num_blocks = cuda_system_get_block_index (&blocks);
+  start = itr->has_group
+        ? cuda_iterator_group_after (blocks, num_blocks, &itr->group, group_type)
+        : 0;
+
+  for (; start < num_blocks; start = end)
+    {
+      end = cuda_iterator_group_after (blocks, num_blocks, &blocks[start], group_type);
+      itr->group     = blocks[start];
+      itr->has_group = true;
+
+      if (itr->type != CUDA_ITERATOR_TYPE_THREADS)
+        {
+          if (cuda_iterator_walk_group (itr, blocks, start, end,
+                                        CUDA_ITERATOR_WALK_FIRST, c))
+            return true;
+          continue;
+        }
+
+      itr->num_threads  = 0;
+      itr->thread_index = 0;
+      cuda_iterator_walk_group (itr, blocks, start, end,
+                                CUDA_ITERATOR_WALK_COLLECT, NULL);
+      if (!itr->num_threads)
         continue;
-      ++rc;
+
+      cuda_iterator_order_threads (itr);
+      return cuda_iterator_advance_logical (itr, c);
     }
-  return rc;
+
+  return false;
 }
 
-/* Return a threads iterator sorted by coordinates. Entries must satisfy the
-   filter and other arguments.  The iterator does not return any duplicate,
-   although its internal implementation will have them. */
+/* Produce the next element of the iterator, skipping duplicates */
+static void
+cuda_iterator_advance (cuda_iterator itr)
+{
+  bool physical = cuda_iterator_physical_p (itr);
+  cuda_coords_t c;
+  bool found;
+
+  for (;;)
+    {
+      if ((itr->mask & CUDA_SELECT_SNGL) && itr->num_returned)
+        found = false;
+      else if (physical)
+        {
+          found = cuda_iterator_step (itr);
+          if (found)
+            {
+              c = itr->cursor;
+              cuda_iterator_skip_unit (itr);
+            }
+        }
+      else
+        found = cuda_iterator_advance_logical (itr, &c);
+
+      if (!found)
+        {
+          itr->has_current = false;
+          return;
+        }
+
+      c = cuda_iterator_filter_coords (&c, itr->type);
+
+      if (itr->has_current &&
+          (physical ? cuda_coords_compare_physical (&c, &itr->current)
+                    : cuda_coords_compare_logical (&c, &itr->current)) == 0)
+        continue;
+
+      itr->current = c;
+      itr->has_current = true;
+      ++itr->num_returned;
+      return;
+    }
+}
+
+/* Return an iterator over the elements of the given type, sorted by
+   coordinates, that satisfy the filter and the select mask.  Physical
+   iterators walk the device lazily.  Logical iterators walk the block index
+   of the system, in logical order, one kernel or block at a time. */
 cuda_iterator
 cuda_iterator_create (cuda_iterator_type type, cuda_coords_t *filter, cuda_select_t select_mask)
 {
-  uint32_t i;
   cuda_iterator itr;
 
-  itr = (cuda_iterator) xmalloc (sizeof *itr);
+  itr = (cuda_iterator) xcalloc (1, sizeof *itr);
   itr->type         = type;
   itr->filter       = filter ? *filter: CUDA_INVALID_COORDS;
   itr->mask         = select_mask;
-  itr->num_elements = 0;
-  itr->num_unique_elements = 0;
-  itr->list_size    = 1024;
-  itr->index        = 0;
-  itr->completed    = false;
-  itr->list         = (cuda_coords_t*) xmalloc (itr->list_size * sizeof (*itr->list));
 
   if (filter)
     itr->filter.valid = true;
-  itr->current.dev = itr->current.sm = itr->current.wp = itr->current.ln = 0;
 
-  /* Iterators by physical coordinates can be lazy */
-  if ((type & CUDA_ITERATOR_TYPE_MASK_PHYSICAL) != 0)
-    return itr;
-
-  while (cuda_iterator_step (itr));
-  itr->completed = true;
-
-  /* sort the list by coordinates */
-  qsort (itr->list, itr->num_elements, sizeof (*itr->list),
-         (int(*)(const void*, const void*))cuda_coords_compare_logical);
+  cuda_iterator_compile_plan (itr);
 
-  return itr;
+  return cuda_iterator_start (itr);
 }
 
 void
 cuda_iterator_destroy (cuda_iterator itr)
 {
-  xfree (itr->list);
+  xfree (itr->threads);
+  xfree (itr->buckets);
   xfree (itr);
 }
 
 cuda_iterator
 cuda_iterator_start (cuda_iterator itr)
 {
-  itr->index = 0;
+  itr->has_current  = false;
+  itr->num_returned = 0;
+  itr->has_group    = false;
+  itr->num_threads  = 0;
+  itr->thread_index = 0;
+  cuda_iterator_reset_cursor (itr);
+
+  cuda_iterator_advance (itr);
+
   return itr;
 }
 
 bool
 cuda_iterator_end (cuda_iterator itr)
 {
-  if (itr->index == itr->num_elements && !itr->completed)
-    itr->completed = !cuda_iterator_step (itr);
-  return itr->index >= itr->num_elements;
+  return !itr->has_current;
 }
 
 cuda_iterator
 cuda_iterator_next (cuda_iterator itr)
 {
-  if (cuda_iterator_end(itr))
+  if (cuda_iterator_end (itr))
     return itr;
 
-  /* hop over the duplicate elements */
-  do ++itr->index;
-  while ( !cuda_iterator_end (itr) &&
-          ( ((itr->type & CUDA_ITERATOR_TYPE_MASK_LOGICAL) ?
-               cuda_coords_compare_logical (&itr->list[itr->index],
-                                            &itr->list[itr->index-1]) :
-               cuda_coords_compare_physical (&itr->list[itr->index],
-                                             &itr->list[itr->index-1])) == 0)
-         );
+  cuda_iterator_advance (itr);
 
   return itr;
 }
@@ -340,20 +786,49 @@ cuda_iterator_next (cuda_iterator itr)
 cuda_coords_t
 cuda_iterator_get_current (cuda_iterator itr)
 {
-  return !cuda_iterator_end (itr) ? itr->list[itr->index] : CUDA_INVALID_COORDS;
+  return !cuda_iterator_end (itr) ? itr->current : CUDA_INVALID_COORDS;
 }
 
+/* Count the elements of the iterator without disturbing its position */
 uint32_t
 cuda_iterator_get_size (cuda_iterator itr)
 {
-  if (!itr->completed)
+  struct cuda_iterator_t copy;
+  const cuda_block_warps_t *blocks;
+  cuda_coords_t c;
+  uint32_t num_blocks, start, end, size = 0;
+
+  if (cuda_iterator_physical_p (itr))
     {
-      while (cuda_iterator_step(itr));
-      itr->completed = true;
+      /* Physical iterators only carry a cursor: walk a copy of it */
+      copy = *itr;
+      for (cuda_iterator_start (&copy); !cuda_iterator_end (&copy);
+           cuda_iterator_next (&copy))
+        ++size;
+      return size;
     }
 
-  if (itr->num_unique_elements == 0 && itr->num_elements >0)
-    itr->num_unique_elements = cuda_iterator_count_unique_elements (itr);
-
-  return itr->num_unique_elements;
+  /* Logical iterators count their elements group by group, in any order */
+  num_blocks = cuda_system_get_block_index (&blocks);
+  for (start = 0; start < num_blocks; start = end)
+    if (itr->type == CUDA_ITERATOR_TYPE_THREADS)
+      {
+        end = cuda_iterator_group_after (blocks, num_blocks, &blocks[start],
+                                         CUDA_ITERATOR_TYPE_BLOCKS);
+        size += cuda_iterator_walk_group (itr, blocks, start, end,
+                                          CUDA_ITERATOR_WALK_COUNT, NULL);
+      }
+    else
+      {
+        end = cuda_iterator_group_after (blocks, num_blocks, &blocks[start],
+                                         itr->type);
+        if (cuda_iterator_walk_group (itr, blocks, start, end,
+                                      CUDA_ITERATOR_WALK_FIRST, &c))
+          ++size;
+      }
+
+  if ((itr->mask & CUDA_SELECT_SNGL) && size > 1)
+    size = 1;
+
+  return size;
 }
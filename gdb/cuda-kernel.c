@@ -20,11 +20,13 @@
 #include "defs.h"
 #include "frame.h"
 #include "gdb_assert.h"
+#include "hashtab.h"
 #include "ui-out.h"
 
 #include "cuda-api.h"
 #include "cuda-asm.h"
 #include "cuda-context.h"
+#include "cuda-elf-image.h"
 #include "cuda-iterator.h"
 #include "cuda-modules.h"
 #include "cuda-options.h"
@@ -69,9 +71,11 @@ struct kernel_st {
   char              dimensions[128]; /* A string repr. of the kernel dimensions. */
   CUDBGKernelType   type;            /* The kernel type: system or application. */
   CUDBGKernelOrigin origin;          /* The kernel origin: CPU or GPU */
-  disasm_cache_t    disasm_cache;    /* the cached disassembled instructions */
   kernel_t          next;            /* next kernel on the same device */
   unsigned int      depth;           /* kernel nest level (0 - host launched kernel) */
+  bool              terminated;      /* Has the kernel been seen terminating? */
+  kernel_t          present_prev;    /* previous kernel not yet terminated */
+  kernel_t          present_next;    /* next kernel not yet terminated */
 };
 
 static void
@@ -169,9 +173,11 @@ kernel_new (uint32_t dev_id, uint64_t grid_id, uint64_t virt_code_base,
   kernel->block_dim                = block_dim;
   kernel->type                     = type;
   kernel->origin                   = origin;
-  kernel->disasm_cache             = disasm_cache_create ();
   kernel->next                     = NULL;
   kernel->depth                    = !parent_kernel ? 0 : parent_kernel->depth + 1;
+  kernel->terminated               = false;
+  kernel->present_prev             = NULL;
+  kernel->present_next             = NULL;
 
   snprintf (kernel->dimensions, sizeof (kernel->dimensions), "<<<(%d,%d,%d),(%d,%d,%d)>>>",
             grid_dim.x, grid_dim.y, grid_dim.z, block_dim.x, block_dim.y, block_dim.z);
@@ -200,7 +206,6 @@ kernel_delete (kernel_t kernel)
                        (unsigned long long)kernel->id, kernel->name, kernel->dimensions,
                        kernel->dev_id, kernel->depth);
 
-  disasm_cache_destroy (kernel->disasm_cache);
   xfree (kernel->name);
   xfree (kernel->args);
   xfree (kernel);
@@ -456,21 +461,52 @@ kernel_compute_sms_mask (kernel_t kernel)
   return sms_mask;
 }
 
+/* The disassembly cache is shared by all the kernels of the same module and
+   lives as long as the module ELF image. */
+static disasm_cache_t
+kernel_get_disasm_cache (kernel_t kernel)
+{
+  elf_image_t elf_image;
+
+  if (!kernel->module)
+    return NULL;
+
+  elf_image = module_get_elf_image (kernel->module);
+  return elf_image ? cuda_elf_image_get_disasm_cache (elf_image) : NULL;
+}
+
 const char*
 kernel_disassemble (kernel_t kernel, uint64_t pc, uint32_t *inst_size)
 {
   gdb_assert (kernel);
   gdb_assert (inst_size);
 
-  return disasm_cache_find_instruction (kernel->disasm_cache, pc, inst_size);
+  return disasm_cache_find_instruction (kernel_get_disasm_cache (kernel),
+                                        pc, inst_size);
+}
+
+bool
+kernel_find_stop_pc (kernel_t kernel, uint64_t pc, uint64_t range_start,
+                     uint64_t range_end, bool skip_subroutines,
+                     uint64_t *stop_pc, uint32_t *inst_size, uint32_t *branches)
+{
+  gdb_assert (kernel);
+
+  return disasm_cache_find_stop_pc (kernel_get_disasm_cache (kernel), pc,
+                                    range_start, range_end, skip_subroutines,
+                                    stop_pc, inst_size, branches);
 }
 
 void
 kernel_flush_disasm_cache (kernel_t kernel)
 {
+  disasm_cache_t disasm_cache;
+
   gdb_assert (kernel);
 
-  disasm_cache_flush (kernel->disasm_cache);
+  disasm_cache = kernel_get_disasm_cache (kernel);
+  if (disasm_cache)
+    disasm_cache_flush (disasm_cache);
 }
 
 void
@@ -501,6 +537,152 @@ kernel_print (kernel_t kernel)
 /* head of the system list of kernels */
 static kernel_t kernels = NULL;
 
+/* head of the list of kernels not yet seen terminating. Kernels that have
+   terminated but are kept alive for their children are not on this list,
+   so that walking it does not query the grid status of dead kernels. */
+static kernel_t present_kernels = NULL;
+
+/* kernel lookup tables, indexed by (dev_id, grid_id) and by kernel id */
+static htab_t kernels_by_grid_id = NULL;
+static htab_t kernels_by_kernel_id = NULL;
+
+typedef struct {
+  uint32_t dev_id;
+  uint64_t grid_id;
+} kernel_grid_key_t;
+
+static hashval_t
+kernel_hash_grid_id (uint32_t dev_id, uint64_t grid_id)
+{
+  return iterative_hash_object (grid_id, dev_id);
+}
+
+static hashval_t
+kernel_hash_kernel_id (uint64_t kernel_id)
+{
+  return iterative_hash_object (kernel_id, 0);
+}
+
+static hashval_t
+kernel_hash_by_grid_id (const void *item)
+{
+  const struct kernel_st *kernel = item;
+
+  return kernel_hash_grid_id (kernel->dev_id, kernel->grid_id);
+}
+
+static int
+kernel_eq_grid_id (const void *item, const void *key)
+{
+  const struct kernel_st *kernel = item;
+  const kernel_grid_key_t *grid_key = key;
+
+  return kernel->dev_id == grid_key->dev_id && kernel->grid_id == grid_key->grid_id;
+}
+
+static hashval_t
+kernel_hash_by_kernel_id (const void *item)
+{
+  const struct kernel_st *kernel = item;
+
+  return kernel_hash_kernel_id (kernel->id);
+}
+
+static int
+kernel_eq_kernel_id (const void *item, const void *key)
+{
+  const struct kernel_st *kernel = item;
+  const uint64_t *kernel_id = key;
+
+  return kernel->id == *kernel_id;
+}
+
+static void
+kernels_index_kernel (kernel_t kernel)
+{
+  kernel_grid_key_t grid_key;
+  void **slot;
+
+  if (!kernels_by_grid_id)
+    {
+      kernels_by_grid_id = htab_create_alloc (64, kernel_hash_by_grid_id,
+                                              kernel_eq_grid_id, NULL,
+                                              xcalloc, xfree);
+      kernels_by_kernel_id = htab_create_alloc (64, kernel_hash_by_kernel_id,
+                                                kernel_eq_kernel_id, NULL,
+                                                xcalloc, xfree);
+    }
+
+  /* the most recent kernel wins if a grid id is reused while an older
+     kernel with the same grid id is still kept alive for its children. */
+  grid_key.dev_id  = kernel->dev_id;
+  grid_key.grid_id = kernel->grid_id;
+  slot = htab_find_slot_with_hash (kernels_by_grid_id, &grid_key,
+                                   kernel_hash_grid_id (kernel->dev_id, kernel->grid_id),
+                                   INSERT);
+  *slot = kernel;
+
+  slot = htab_find_slot_with_hash (kernels_by_kernel_id, &kernel->id,
+                                   kernel_hash_kernel_id (kernel->id), INSERT);
+  *slot = kernel;
+}
+
+static void
+kernels_unindex_kernel (kernel_t kernel)
+{
+  kernel_grid_key_t grid_key;
+  kernel_t other;
+  hashval_t hash;
+  void **slot;
+
+  grid_key.dev_id  = kernel->dev_id;
+  grid_key.grid_id = kernel->grid_id;
+  hash = kernel_hash_grid_id (kernel->dev_id, kernel->grid_id);
+  slot = htab_find_slot_with_hash (kernels_by_grid_id, &grid_key, hash,
+                                   NO_INSERT);
+  if (slot && *slot == kernel)
+    {
+      /* an older kernel with the same grid id, still kept alive for its
+         children, takes over the entry. The list is newest first. */
+      for (other = kernels; other; other = kernels_get_next_kernel (other))
+        if (other != kernel && other->dev_id == kernel->dev_id &&
+            other->grid_id == kernel->grid_id)
+          break;
+
+      if (other)
+        *slot = other;
+      else
+        htab_clear_slot (kernels_by_grid_id, slot);
+    }
+
+  htab_remove_elt_with_hash (kernels_by_kernel_id, &kernel->id,
+                             kernel_hash_kernel_id (kernel->id));
+}
+
+static void
+kernels_add_present_kernel (kernel_t kernel)
+{
+  kernel->present_prev = NULL;
+  kernel->present_next = present_kernels;
+  if (present_kernels)
+    present_kernels->present_prev = kernel;
+  present_kernels = kernel;
+}
+
+static void
+kernels_remove_present_kernel (kernel_t kernel)
+{
+  if (kernel->present_prev)
+    kernel->present_prev->present_next = kernel->present_next;
+  else if (present_kernels == kernel)
+    present_kernels = kernel->present_next;
+  if (kernel->present_next)
+    kernel->present_next->present_prev = kernel->present_prev;
+
+  kernel->present_prev = NULL;
+  kernel->present_next = NULL;
+}
+
 void
 kernels_print (void)
 {
@@ -538,6 +720,9 @@ kernels_start_kernel (uint32_t dev_id, uint64_t grid_id,
 
   kernel->next = kernels;
   kernels = kernel;
+
+  kernels_index_kernel (kernel);
+  kernels_add_present_kernel (kernel);
 }
 
 static void
@@ -565,14 +750,24 @@ kernels_add_parent_kernel (uint32_t dev_id, uint64_t grid_id, uint64_t *parent_g
                         parent_grid_info.origin);
 }
 
-void
-kernels_terminate_kernel (kernel_t kernel)
+/* Terminate KERNEL, and delete it once it has no children left.  Deleting
+   it may in turn delete its terminated parent, and so on up.  If NEXT is
+   not NULL, it is the cursor of a walk over the list of kernels: it is
+   moved past every kernel deleted here, so that it never dangles. */
+static void
+kernels_terminate_kernel_1 (kernel_t kernel, kernel_t *next)
 {
-  kernel_t  prev, ker;
+  kernel_t  prev, ker, parent;
 
   if (!kernel)
     return;
 
+  if (!kernel->terminated)
+    {
+      kernel->terminated = true;
+      kernels_remove_present_kernel (kernel);
+    }
+
   // must keep kernel object until all the children have terminated
   if (kernel->children)
     return;
@@ -588,7 +783,22 @@ kernels_terminate_kernel (kernel_t kernel)
   else
     kernels = kernels_get_next_kernel (kernel);
 
+  if (next && *next == kernel)
+    *next = kernels_get_next_kernel (kernel);
+
+  parent = kernel->parent;
+  kernels_unindex_kernel (kernel);
   kernel_delete (kernel);
+
+  /* the parent may have been waiting for its last child to go away */
+  if (parent && parent->terminated && !parent->children)
+    kernels_terminate_kernel_1 (parent, next);
+}
+
+void
+kernels_terminate_kernel (kernel_t kernel)
+{
+  kernels_terminate_kernel_1 (kernel, NULL);
 }
 
 void
@@ -601,9 +811,11 @@ kernels_terminate_module (module_t module)
   kernel = kernels_get_first_kernel ();
   while (kernel)
     {
+      /* A child comes before its parent in the list, and terminating
+         the child may delete the parent: next_kernel is kept valid. */
       next_kernel = kernels_get_next_kernel (kernel);
       if (kernel_get_module (kernel) == module)
-        kernels_terminate_kernel (kernel);
+        kernels_terminate_kernel_1 (kernel, &next_kernel);
       kernel = next_kernel;
     }
 }
@@ -623,28 +835,45 @@ kernels_get_next_kernel (kernel_t kernel)
   return kernel->next;
 }
 
+/* Kernels not yet seen terminating. This is a superset of the kernels
+   present on the hardware: callers still need kernel_is_present(). */
+kernel_t
+kernels_get_first_present_kernel (void)
+{
+  return present_kernels;
+}
+
+kernel_t
+kernels_get_next_present_kernel (kernel_t kernel)
+{
+  if (!kernel)
+    return NULL;
+
+  return kernel->present_next;
+}
+
 kernel_t
 kernels_find_kernel_by_grid_id (uint32_t dev_id, uint64_t grid_id)
 {
-  kernel_t kernel;
+  kernel_grid_key_t grid_key;
 
-  for (kernel = kernels; kernel; kernel = kernels_get_next_kernel (kernel))
-    if (kernel->dev_id == dev_id && kernel->grid_id == grid_id)
-      return kernel;
+  if (!kernels_by_grid_id)
+    return NULL;
 
-  return NULL;
+  grid_key.dev_id  = dev_id;
+  grid_key.grid_id = grid_id;
+  return htab_find_with_hash (kernels_by_grid_id, &grid_key,
+                              kernel_hash_grid_id (dev_id, grid_id));
 }
 
 kernel_t
 kernels_find_kernel_by_kernel_id (uint64_t kernel_id)
 {
-  kernel_t kernel;
-
-  for (kernel = kernels; kernel; kernel = kernels_get_next_kernel (kernel))
-    if (kernel->id == kernel_id)
-      return kernel;
+  if (!kernels_by_kernel_id)
+    return NULL;
 
-  return NULL;
+  return htab_find_with_hash (kernels_by_kernel_id, &kernel_id,
+                              kernel_hash_kernel_id (kernel_id));
 }
 
 void
@@ -652,7 +881,8 @@ kernels_update_args (void)
 {
   kernel_t kernel;
 
-  for (kernel = kernels_get_first_kernel (); kernel; kernel = kernels_get_next_kernel (kernel))
+  for (kernel = kernels_get_first_present_kernel (); kernel;
+       kernel = kernels_get_next_present_kernel (kernel))
     if (!kernel->args && kernel_is_present (kernel))
       kernel_populate_args (kernel);
 }
@@ -664,10 +894,10 @@ kernels_update_terminated (void)
   kernel_t      next_kernel;
 
   /* rediscover the kernels currently running on the hardware */
-  kernel = kernels_get_first_kernel ();
+  kernel = kernels_get_first_present_kernel ();
   while (kernel)
     {
-      next_kernel = kernels_get_next_kernel (kernel);
+      next_kernel = kernels_get_next_present_kernel (kernel);
 
       if (kernel_is_present (kernel))
         kernel->launched = true;
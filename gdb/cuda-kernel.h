@@ -49,6 +49,13 @@ void                kernel_print              (kernel_t kernel);
 void                kernel_flush_disasm_cache (kernel_t kernel);
 const char*         kernel_disassemble        (kernel_t kernel, uint64_t pc,
                                            uint32_t *inst_size);
+bool                kernel_find_stop_pc       (kernel_t kernel, uint64_t pc,
+                                               uint64_t range_start,
+                                               uint64_t range_end,
+                                               bool skip_subroutines,
+                                               uint64_t *stop_pc,
+                                               uint32_t *inst_size,
+                                               uint32_t *branches);
 
 void      kernels_start_kernel     (uint32_t dev_id, uint64_t grid_id,
                                     uint64_t virt_code_base,
@@ -64,6 +71,8 @@ void      kernels_update_args       (void);
 void      kernels_print             (void);
 kernel_t  kernels_get_first_kernel  (void);
 kernel_t  kernels_get_next_kernel   (kernel_t kernel);
+kernel_t  kernels_get_first_present_kernel (void);
+kernel_t  kernels_get_next_present_kernel  (kernel_t kernel);
 kernel_t  kernels_find_kernel_by_grid_id   (uint32_t dev_id, uint64_t grid_id);
 kernel_t  kernels_find_kernel_by_kernel_id (uint64_t kernel_id);
 
@@ -0,0 +1,136 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* PC to source line cache.
+
+   Listing the threads of a kernel looks up the source line of every
+   thread.  Threads are stopped at a handful of PCs, but are listed in
+   logical order, so consecutive threads rarely share a PC and every
+   thread used to cost a search of the line table.  find_pc_line results
+   are memoized here by PC, so that the cost is per distinct PC.  The
+   stops of device stepping, autostep in particular, also look up their
+   PCs here, as every warp steps over the same lines.
+
+   The line of a PC only depends on the loaded objfiles, so the memo is
+   kept across resumes and only dropped whenever the set of objfiles
+   changes, since a PC of an unloaded CUDA module may then belong to
+   another module. */
+
+#include "defs.h"
+#include "gdb_assert.h"
+#include "hashtab.h"
+#include "observer.h"
+
+#include "cuda-linecache.h"
+
+typedef struct {
+  CORE_ADDR              pc;
+  struct symtab_and_line sal;
+} cuda_linecache_entry_t;
+
+static htab_t linecache;
+
+static struct {
+  uint64_t lookups;
+  uint64_t hits;
+  uint64_t invalidations;
+} linecache_stats;
+
+static hashval_t
+entry_hash (const void *item)
+{
+  const cuda_linecache_entry_t *entry = item;
+
+  return iterative_hash_object (entry->pc, 0);
+}
+
+static int
+entry_eq (const void *a, const void *b)
+{
+  const cuda_linecache_entry_t *e1 = a;
+  const cuda_linecache_entry_t *e2 = b;
+
+  return e1->pc == e2->pc;
+}
+
+struct symtab_and_line
+cuda_linecache_find_pc_line (CORE_ADDR pc)
+{
+  cuda_linecache_entry_t key, *entry;
+  struct symtab_and_line sal;
+  void **slot;
+
+  ++linecache_stats.lookups;
+
+  if (!linecache)
+    linecache = htab_create_alloc (64, entry_hash, entry_eq, xfree,
+                                   xcalloc, xfree);
+
+  key.pc = pc;
+  entry = htab_find (linecache, &key);
+  if (entry)
+    {
+      ++linecache_stats.hits;
+      return entry->sal;
+    }
+
+  sal = find_pc_line (pc, 0);
+
+  entry = xmalloc (sizeof *entry);
+  entry->pc  = pc;
+  entry->sal = sal;
+
+  slot = htab_find_slot (linecache, entry, INSERT);
+  *slot = entry;
+
+  return entry->sal;
+}
+
+void
+cuda_linecache_invalidate (void)
+{
+  if (!linecache || !htab_elements (linecache))
+    return;
+
+  ++linecache_stats.invalidations;
+  htab_empty (linecache);
+}
+
+static void
+cuda_linecache_new_objfile (struct objfile *objfile)
+{
+  cuda_linecache_invalidate ();
+}
+
+void
+cuda_linecache_print_statistics (void)
+{
+  printf_unfiltered (_("Line cache: %u entries, %llu lookups, %llu hits, "
+                       "%llu invalidations\n"),
+                     linecache ? (unsigned) htab_elements (linecache) : 0,
+                     (unsigned long long) linecache_stats.lookups,
+                     (unsigned long long) linecache_stats.hits,
+                     (unsigned long long) linecache_stats.invalidations);
+}
+
+void _initialize_cuda_linecache (void);
+
+void
+_initialize_cuda_linecache (void)
+{
+  observer_attach_new_objfile (cuda_linecache_new_objfile);
+}
@@ -0,0 +1,30 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CUDA_LINECACHE_H
+#define _CUDA_LINECACHE_H 1
+
+#include "cuda-defs.h"
+#include "symtab.h"
+
+struct symtab_and_line cuda_linecache_find_pc_line (CORE_ADDR pc);
+
+void cuda_linecache_invalidate (void);
+
+void cuda_linecache_print_statistics (void);
+
+#endif
@@ -39,6 +39,7 @@
 #include "cuda-commands.h"
 #include "cuda-events.h"
 #include "cuda-exceptions.h"
+#include "cuda-memcache.h"
 #include "cuda-notifications.h"
 #include "cuda-options.h"
 #include "cuda-tdep.h"
@@ -128,6 +129,12 @@ cuda_nat_xfer_partial (struct target_ops *ops,
   /* Either readbuf or writebuf must be a valid pointer */
   gdb_assert (readbuf != NULL || writebuf != NULL);
 
+  /* Host writes can land in pinned, mapped or managed memory that the
+     device reads too */
+  if (writebuf && (object == TARGET_OBJECT_MEMORY ||
+                   object == TARGET_OBJECT_STACK_MEMORY))
+    cuda_memcache_invalidate ();
+
   /* If focus is not set on device, call the host routines directly */
   if (!cuda_focus_is_device ())
     {
@@ -180,7 +187,7 @@ cuda_nat_xfer_partial (struct target_ops *ops,
       if (cuda_coords_get_current_physical (&dev, &sm, &wp, &ln))
         return -EINVAL;
       if (readbuf)
-        cuda_api_read_local_memory (dev, sm, wp, ln, offset, readbuf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_LOCAL, dev, sm, wp, ln, offset, readbuf, len);
       else
         cuda_api_write_local_memory (dev, sm, wp, ln, offset, writebuf, len);
       return len;
@@ -391,6 +398,9 @@ cuda_do_resume (struct target_ops *ops, ptid_t ptid,
         for (dev = 0; dev < cuda_system_get_num_devices (); ++dev)
             device_resume (dev);
 
+      // the host may store to memory shared with the devices
+      cuda_memcache_invalidate_generic ();
+
       // resume the host
       host_target_ops.to_resume (ops, ptid, sstep, ts);
       return;
@@ -437,6 +447,7 @@ cuda_do_resume (struct target_ops *ops, ptid_t ptid,
         device_resume (dev);
 
   // resume the host
+  cuda_memcache_invalidate_generic ();
   host_target_ops.to_resume (ops, ptid, 0, ts);
 }
 
@@ -1187,7 +1198,10 @@ cuda_get_cudbg_api (void)
 
                      &api);
   if (res == CUDBG_SUCCESS)
-    cuda_api_set_api (api);
+    {
+      cuda_api_set_api (api);
+      cuda_api_set_batching (true);
+    }
 
   cuda_api_handle_get_api_error (res);
 
@@ -0,0 +1,400 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Device memory cache.
+
+   Reads from the CUDA memory segments go through a cache of fixed-size
+   lines, the device counterpart of dcache.c.  A line is keyed by the
+   segment, the coordinates the segment is private to and the line-aligned
+   address, so that reading the fields of a structure or walking a list
+   costs one API call per line instead of one per value.  Lines are
+   recycled in least-recently-used order once the cache is full.
+
+   Device memory only changes while the device runs or when it is written
+   to, so the cache of a device is dropped when the device is invalidated
+   and the whole cache on every write to device or host memory: the host
+   shares pinned, mapped and managed memory with the devices.  For the
+   same reason, the generic lines are dropped whenever the host runs,
+   including when it is single-stepped while the devices stay suspended.
+   Single-stepping a warp only drops the writable segments of its device:
+   code, constant and parameter memory are read-only for the kernel.
+   Global memory is reachable from every device through peer access, so
+   the generic lines of all the devices are dropped whenever any device
+   runs.
+
+   Reads larger than a line bypass the cache.  So does a read whose line
+   cannot be filled, e.g. because the line runs past the end of a shared
+   memory window; the exact range is then read directly and any error is
+   reported as before. */
+
+#include "defs.h"
+#include "exceptions.h"
+#include "gdb_assert.h"
+#include "gdb_string.h"
+#include "hashtab.h"
+
+#include "cuda-api.h"
+#include "cuda-memcache.h"
+#include "cuda-options.h"
+
+typedef struct cuda_memcache_line_st {
+  /* Least-recently-used list, most recent first */
+  struct cuda_memcache_line_st *prev;
+  struct cuda_memcache_line_st *next;
+
+  cuda_memcache_segment_t segment;
+  uint32_t  dev;
+  uint32_t  sm;
+  uint32_t  wp;
+  uint32_t  ln;
+  CORE_ADDR addr;
+  gdb_byte  data[1];    /* line_size bytes at addr */
+} *cuda_memcache_line_t;
+
+static struct {
+  htab_t                lines;
+  cuda_memcache_line_t  newest;
+  cuda_memcache_line_t  oldest;
+  uint32_t              num_lines;
+  uint32_t              line_size;  /* of the lines currently in the cache */
+} memcache;
+
+typedef struct {
+  uint64_t lookups;
+  uint64_t hits;
+} cuda_memcache_segment_stats_t;
+
+static struct {
+  cuda_memcache_segment_stats_t segment[CUDA_MEMCACHE_SEGMENT_MAX];
+  uint64_t fills;
+  uint64_t failed_fills;
+  uint64_t bypasses;
+  uint64_t evictions;
+  uint64_t invalidations;
+} memcache_stats;
+
+static const char *segment_names[CUDA_MEMCACHE_SEGMENT_MAX] = {
+  "code", "const", "param", "shared", "local", "generic",
+};
+
+static bool
+segment_is_writable (cuda_memcache_segment_t segment)
+{
+  return segment != CUDA_MEMCACHE_CODE &&
+         segment != CUDA_MEMCACHE_CONST &&
+         segment != CUDA_MEMCACHE_PARAM;
+}
+
+/* Clear the coordinates the segment is not private to, so that lanes
+   sharing the memory share the lines. */
+static void
+normalize_coords (cuda_memcache_segment_t segment,
+                  uint32_t *sm, uint32_t *wp, uint32_t *ln)
+{
+  switch (segment)
+    {
+    case CUDA_MEMCACHE_CODE:
+    case CUDA_MEMCACHE_CONST:
+      *sm = *wp = *ln = 0;
+      break;
+    case CUDA_MEMCACHE_PARAM:
+    case CUDA_MEMCACHE_SHARED:
+      *ln = 0;
+      break;
+    default:
+      break;
+    }
+}
+
+static hashval_t
+line_hash (const void *item)
+{
+  const struct cuda_memcache_line_st *line = item;
+  hashval_t hash;
+
+  hash = iterative_hash_object (line->addr, line->segment);
+  hash = iterative_hash_object (line->dev, hash);
+  hash = iterative_hash_object (line->sm, hash);
+  hash = iterative_hash_object (line->wp, hash);
+  return iterative_hash_object (line->ln, hash);
+}
+
+static int
+line_eq (const void *a, const void *b)
+{
+  const struct cuda_memcache_line_st *l1 = a;
+  const struct cuda_memcache_line_st *l2 = b;
+
+  return l1->addr == l2->addr && l1->segment == l2->segment &&
+         l1->dev == l2->dev && l1->sm == l2->sm &&
+         l1->wp == l2->wp && l1->ln == l2->ln;
+}
+
+static void
+lru_unlink (cuda_memcache_line_t line)
+{
+  if (line->prev)
+    line->prev->next = line->next;
+  else
+    memcache.newest = line->next;
+  if (line->next)
+    line->next->prev = line->prev;
+  else
+    memcache.oldest = line->prev;
+  line->prev = line->next = NULL;
+}
+
+static void
+lru_push (cuda_memcache_line_t line)
+{
+  line->prev = NULL;
+  line->next = memcache.newest;
+  if (memcache.newest)
+    memcache.newest->prev = line;
+  memcache.newest = line;
+  if (!memcache.oldest)
+    memcache.oldest = line;
+}
+
+static void
+line_delete (cuda_memcache_line_t line)
+{
+  lru_unlink (line);
+  htab_remove_elt (memcache.lines, line);
+  xfree (line);
+  --memcache.num_lines;
+}
+
+/* Read LEN bytes of SEGMENT straight from the debugger API */
+static void
+read_direct (cuda_memcache_segment_t segment, uint32_t dev, uint32_t sm,
+             uint32_t wp, uint32_t ln, CORE_ADDR addr, gdb_byte *buf, int len)
+{
+  switch (segment)
+    {
+    case CUDA_MEMCACHE_CODE:
+      cuda_api_read_code_memory (dev, addr, buf, len);
+      break;
+    case CUDA_MEMCACHE_CONST:
+      cuda_api_read_const_memory (dev, addr, buf, len);
+      break;
+    case CUDA_MEMCACHE_PARAM:
+      cuda_api_read_param_memory (dev, sm, wp, addr, buf, len);
+      break;
+    case CUDA_MEMCACHE_SHARED:
+      cuda_api_read_shared_memory (dev, sm, wp, addr, buf, len);
+      break;
+    case CUDA_MEMCACHE_LOCAL:
+      cuda_api_read_local_memory (dev, sm, wp, ln, addr, buf, len);
+      break;
+    case CUDA_MEMCACHE_GENERIC:
+      cuda_api_read_generic_memory (dev, sm, wp, ln, addr, buf, len);
+      break;
+    default:
+      gdb_assert_not_reached ("unknown device memory segment");
+    }
+}
+
+/* Return the line holding KEY, reading it from the device if needed.
+   Returns NULL if the line could not be read. */
+static cuda_memcache_line_t
+line_lookup (cuda_memcache_line_t key)
+{
+  volatile struct gdb_exception e;
+  cuda_memcache_line_t line;
+  void **slot;
+
+  ++memcache_stats.segment[key->segment].lookups;
+
+  slot = htab_find_slot (memcache.lines, key, INSERT);
+  if (*slot)
+    {
+      ++memcache_stats.segment[key->segment].hits;
+      line = *slot;
+      lru_unlink (line);
+      lru_push (line);
+      return line;
+    }
+
+  line = xmalloc (offsetof (struct cuda_memcache_line_st, data) + memcache.line_size);
+  *line = *key;
+
+  ++memcache_stats.fills;
+  TRY_CATCH (e, RETURN_MASK_ERROR)
+    {
+      read_direct (line->segment, line->dev, line->sm, line->wp, line->ln,
+                   line->addr, line->data, memcache.line_size);
+    }
+  if (e.reason < 0)
+    {
+      ++memcache_stats.failed_fills;
+      htab_clear_slot (memcache.lines, slot);
+      xfree (line);
+      return NULL;
+    }
+
+  *slot = line;
+  lru_push (line);
+  ++memcache.num_lines;
+
+  while (memcache.num_lines > cuda_options_memcache_size ())
+    {
+      ++memcache_stats.evictions;
+      line_delete (memcache.oldest);
+    }
+
+  return line;
+}
+
+void
+cuda_memcache_read (cuda_memcache_segment_t segment, uint32_t dev,
+                    uint32_t sm, uint32_t wp, uint32_t ln,
+                    CORE_ADDR addr, gdb_byte *buf, int len)
+{
+  struct cuda_memcache_line_st key;
+  cuda_memcache_line_t line;
+  CORE_ADDR end = addr + len;
+  CORE_ADDR chunk_end;
+  uint32_t line_size = cuda_options_memcache_line_size ();
+
+  gdb_assert (segment < CUDA_MEMCACHE_SEGMENT_MAX);
+
+  if (!cuda_options_memcache_size () || len > line_size)
+    {
+      ++memcache_stats.bypasses;
+      read_direct (segment, dev, sm, wp, ln, addr, buf, len);
+      return;
+    }
+
+  /* The line size was changed since the lines were read */
+  if (memcache.line_size != line_size)
+    {
+      cuda_memcache_invalidate ();
+      memcache.line_size = line_size;
+    }
+
+  if (!memcache.lines)
+    memcache.lines = htab_create_alloc (256, line_hash, line_eq, NULL,
+                                        xcalloc, xfree);
+
+  normalize_coords (segment, &sm, &wp, &ln);
+
+  memset (&key, 0, sizeof key);
+  key.segment = segment;
+  key.dev     = dev;
+  key.sm      = sm;
+  key.wp      = wp;
+  key.ln      = ln;
+
+  /* A read fits in one line, or straddles two */
+  while (addr < end)
+    {
+      key.addr  = addr & ~(CORE_ADDR) (line_size - 1);
+      chunk_end = min (end, key.addr + line_size);
+
+      line = line_lookup (&key);
+      if (!line)
+        {
+          read_direct (segment, dev, sm, wp, ln, addr, buf, end - addr);
+          return;
+        }
+
+      memcpy (buf, line->data + (addr - key.addr), chunk_end - addr);
+      buf  += chunk_end - addr;
+      addr  = chunk_end;
+    }
+}
+
+void
+cuda_memcache_invalidate (void)
+{
+  if (!memcache.num_lines)
+    return;
+
+  ++memcache_stats.invalidations;
+  while (memcache.oldest)
+    line_delete (memcache.oldest);
+}
+
+void
+cuda_memcache_invalidate_device (uint32_t dev, bool writable_only)
+{
+  cuda_memcache_line_t line, next;
+
+  if (!memcache.num_lines)
+    return;
+
+  ++memcache_stats.invalidations;
+  for (line = memcache.newest; line; line = next)
+    {
+      next = line->next;
+      if ((line->dev == dev &&
+           (!writable_only || segment_is_writable (line->segment))) ||
+          line->segment == CUDA_MEMCACHE_GENERIC)
+        line_delete (line);
+    }
+}
+
+/* Drop the generic lines of all the devices.  Called when the host runs:
+   the inferior may have stored to memory it shares with the devices. */
+void
+cuda_memcache_invalidate_generic (void)
+{
+  cuda_memcache_line_t line, next;
+
+  if (!memcache.num_lines)
+    return;
+
+  ++memcache_stats.invalidations;
+  for (line = memcache.newest; line; line = next)
+    {
+      next = line->next;
+      if (line->segment == CUDA_MEMCACHE_GENERIC)
+        line_delete (line);
+    }
+}
+
+void
+cuda_memcache_print_statistics (void)
+{
+  uint32_t segment;
+  uint64_t lookups, hits;
+
+  printf_unfiltered (_("Device memory cache: %u of %u lines of %u bytes in use, "
+                       "%llu fills, %llu failed fills, %llu bypasses, "
+                       "%llu evictions, %llu invalidations\n"),
+                     memcache.num_lines, cuda_options_memcache_size (),
+                     cuda_options_memcache_line_size (),
+                     (unsigned long long) memcache_stats.fills,
+                     (unsigned long long) memcache_stats.failed_fills,
+                     (unsigned long long) memcache_stats.bypasses,
+                     (unsigned long long) memcache_stats.evictions,
+                     (unsigned long long) memcache_stats.invalidations);
+
+  for (segment = 0; segment < CUDA_MEMCACHE_SEGMENT_MAX; ++segment)
+    {
+      lookups = memcache_stats.segment[segment].lookups;
+      hits    = memcache_stats.segment[segment].hits;
+      if (!lookups)
+        continue;
+      printf_unfiltered (_("  %-8s %10llu lookups %10llu hits  %5.1f%% hit rate\n"),
+                         segment_names[segment],
+                         (unsigned long long) lookups,
+                         (unsigned long long) hits,
+                         100.0 * hits / lookups);
+    }
+}
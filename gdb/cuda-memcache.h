@@ -0,0 +1,43 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CUDA_MEMCACHE_H
+#define _CUDA_MEMCACHE_H 1
+
+#include "cuda-defs.h"
+
+typedef enum {
+  CUDA_MEMCACHE_CODE,
+  CUDA_MEMCACHE_CONST,
+  CUDA_MEMCACHE_PARAM,
+  CUDA_MEMCACHE_SHARED,
+  CUDA_MEMCACHE_LOCAL,
+  CUDA_MEMCACHE_GENERIC,
+  CUDA_MEMCACHE_SEGMENT_MAX,
+} cuda_memcache_segment_t;
+
+void cuda_memcache_read (cuda_memcache_segment_t segment, uint32_t dev,
+                         uint32_t sm, uint32_t wp, uint32_t ln,
+                         CORE_ADDR addr, gdb_byte *buf, int len);
+
+void cuda_memcache_invalidate (void);
+void cuda_memcache_invalidate_device (uint32_t dev, bool writable_only);
+void cuda_memcache_invalidate_generic (void);
+
+void cuda_memcache_print_statistics (void);
+
+#endif
@@ -21,6 +21,7 @@
 #include "objfiles.h"
 #include "source.h"
 
+#include "cuda-context.h"
 #include "cuda-defs.h"
 #include "cuda-elf-image.h"
 #include "cuda-options.h"
@@ -197,20 +198,26 @@ modules_find_module_by_id (modules_t modules, uint64_t module_id)
   return NULL;
 }
 
+static bool
+modules_own_elf_image (elf_image_t elf_image, void *data)
+{
+  module_t module = cuda_elf_image_get_module (elf_image);
+
+  return context_get_modules (module_get_context (module)) == data;
+}
+
 module_t
 modules_find_module_by_address (modules_t modules, CORE_ADDR addr)
 {
-  module_t    module = NULL;
   elf_image_t elf_image;
 
   gdb_assert (modules);
 
-  for (module = modules->head; module; module = module->next)
-  {
-    elf_image = module_get_elf_image (module);
-    if (cuda_elf_image_contains_address (elf_image, addr))
-      return module;
-  }
+  elf_image = cuda_elf_image_find_by_address_matching (addr,
+                                                       modules_own_elf_image,
+                                                       modules);
+  if (!elf_image)
+    return NULL;
 
-  return NULL;
+  return cuda_elf_image_get_module (elf_image);
 }
@@ -23,6 +23,13 @@
 #include "inferior.h"
 #include "gdbcmd.h"
 
+#include "cuda-asm.h"
+#include "cuda-autostep.h"
+#include "cuda-bpcond.h"
+#include "cuda-corelow.h"
+#include "cuda-elf-image.h"
+#include "cuda-linecache.h"
+#include "cuda-memcache.h"
 #include "cuda-options.h"
 #include "cuda-state.h"
 #include "cuda-convvars.h"
@@ -683,6 +690,53 @@ cuda_options_disassemble_from_elf_image (void)
   return cuda_disassemble_from == cuda_disassemble_from_elf_image;
 }
 
+/*
+ * set cuda state_snapshot
+ */
+const char  cuda_state_snapshot_lazy[]  = "lazy";
+const char  cuda_state_snapshot_eager[] = "eager";
+
+const char *cuda_state_snapshot_enums[] = {
+  cuda_state_snapshot_lazy,
+  cuda_state_snapshot_eager,
+  NULL
+};
+
+const char *cuda_state_snapshot;
+
+static void
+cuda_show_state_snapshot (struct ui_file *file, int from_tty,
+                          struct cmd_list_element *c, const char *value)
+{
+  printf_filtered ("CUDA warp state is read %s.\n",
+                   cuda_state_snapshot == cuda_state_snapshot_eager
+                   ? "eagerly, one whole SM at a time" : "lazily, one warp at a time");
+}
+
+static void
+cuda_options_initialize_state_snapshot (void)
+{
+  cuda_state_snapshot = cuda_state_snapshot_lazy;
+
+  add_setshow_enum_cmd ("state_snapshot", class_cuda,
+                        cuda_state_snapshot_enums, &cuda_state_snapshot,
+                        _("Choose whether the warp state of a stopped device is "
+                          "read lazily or as a whole-SM snapshot."),
+                        _("Show how the warp state of a stopped device is read."),
+                        _("Choose how the warp state of a stopped device is read:\n"
+                          "  lazy  : one warp at a time, when first needed\n"
+                          "  eager : the valid and broken warp masks and the state of\n"
+                          "          every valid warp of an SM, when the SM is first accessed\n"),
+                        NULL, cuda_show_state_snapshot,
+                        &setcudalist, &showcudalist);
+}
+
+bool
+cuda_options_state_snapshot_eager (void)
+{
+  return cuda_state_snapshot == cuda_state_snapshot_eager;
+}
+
 /*
  * set cuda hide_internal_frames
  */
@@ -1158,6 +1212,83 @@ cuda_options_variable_value_cache_enabled (void)
          cuda_variable_value_cache_enabled == AUTO_BOOLEAN_AUTO;
 }
 
+/*
+ * set cuda memcache_size
+ * set cuda memcache_line_size
+ */
+#define CUDA_MEMCACHE_DEFAULT_SIZE      1024
+#define CUDA_MEMCACHE_DEFAULT_LINE_SIZE 64
+
+static unsigned int cuda_memcache_size = CUDA_MEMCACHE_DEFAULT_SIZE;
+static unsigned int cuda_memcache_line_size = CUDA_MEMCACHE_DEFAULT_LINE_SIZE;
+
+static void
+cuda_set_memcache_size (char *args, int from_tty, struct cmd_list_element *c)
+{
+  cuda_memcache_invalidate ();
+}
+
+static void
+cuda_show_memcache_size (struct ui_file *file, int from_tty,
+                         struct cmd_list_element *c, const char *value)
+{
+  fprintf_filtered (file, _("Number of device memory cache lines is %s.\n"), value);
+}
+
+static void
+cuda_set_memcache_line_size (char *args, int from_tty, struct cmd_list_element *c)
+{
+  unsigned int size = cuda_memcache_line_size;
+
+  if (size < 8 || size > 4096 || (size & (size - 1)) != 0)
+    {
+      cuda_memcache_line_size = CUDA_MEMCACHE_DEFAULT_LINE_SIZE;
+      error (_("Invalid device memory cache line size: %u "
+               "(must be a power of 2 between 8 and 4096)."), size);
+    }
+  cuda_memcache_invalidate ();
+}
+
+static void
+cuda_show_memcache_line_size (struct ui_file *file, int from_tty,
+                              struct cmd_list_element *c, const char *value)
+{
+  fprintf_filtered (file, _("Device memory cache line size is %s bytes.\n"), value);
+}
+
+static void
+cuda_options_initialize_memcache (void)
+{
+  add_setshow_zuinteger_cmd ("memcache_size", class_cuda, &cuda_memcache_size,
+                             _("Set the number of device memory cache lines."),
+                             _("Show the number of device memory cache lines."),
+                             _("Reads from device memory are served from a cache of "
+                               "that many lines, dropped whenever the device resumes "
+                               "or its memory is written to. 0 disables the cache."),
+                             cuda_set_memcache_size, cuda_show_memcache_size,
+                             &setcudalist, &showcudalist);
+
+  add_setshow_zuinteger_cmd ("memcache_line_size", class_cuda, &cuda_memcache_line_size,
+                             _("Set the size of a device memory cache line."),
+                             _("Show the size of a device memory cache line."),
+                             _("Device memory is read a line at a time. The size is "
+                               "in bytes and must be a power of 2."),
+                             cuda_set_memcache_line_size, cuda_show_memcache_line_size,
+                             &setcudalist, &showcudalist);
+}
+
+unsigned int
+cuda_options_memcache_size (void)
+{
+  return cuda_memcache_size;
+}
+
+unsigned int
+cuda_options_memcache_line_size (void)
+{
+  return cuda_memcache_line_size;
+}
+
 static void
 cuda_print_statistics (char *args, int from_tty)
 {
@@ -1213,6 +1344,17 @@ cuda_print_statistics (char *args, int from_tty)
   do_cleanups (table_cleanup);
 
   printf_unfiltered ("Total time spend in CUDBG API is %f sec\n", total*1e-6);
+
+  cuda_system_print_statistics ();
+  disasm_cache_print_statistics ();
+  cuda_sstep_print_statistics ();
+  cuda_autostep_print_statistics ();
+  cuda_bpcond_print_statistics ();
+  cuda_elf_image_print_statistics ();
+  cuda_remote_print_statistics ();
+  cuda_memcache_print_statistics ();
+  cuda_linecache_print_statistics ();
+  cuda_core_print_statistics ();
 }
 
 
@@ -1334,6 +1476,38 @@ cuda_options_initialize_single_stepping_optimization (void)
 
 }
 
+/*
+ * set cuda batched_reads
+ */
+int cuda_batched_reads = 0;
+
+static void
+cuda_show_batched_reads (struct ui_file *file, int from_tty,
+                         struct cmd_list_element *c, const char *value)
+{
+  fprintf_filtered (file, _("CUDA batched reads are %s.\n"), value);
+}
+
+bool
+cuda_options_batched_reads_enabled (void)
+{
+  return cuda_batched_reads != 0;
+}
+
+static void
+cuda_options_initialize_batched_reads (void)
+{
+  add_setshow_boolean_cmd ("batched_reads", class_cuda, &cuda_batched_reads,
+                           _("Turn on/off batching of the CUDA device state reads"),
+                           _("Show if the CUDA device state reads are batched."),
+                           _("When enabled, the reads of the device state needed to"
+                             " populate the warps and lanes are sent to the CUDA"
+                             " debugger backend in batches, without waiting for the"
+                             " replies in between. Only for native debugging."),
+                           NULL, cuda_show_batched_reads,
+                           &setcudalist, &showcudalist);
+}
+
 static unsigned cuda_stop_signal = GDB_SIGNAL_URG;
 static const char *cuda_stop_signal_string = NULL;
 static const char *cuda_stop_signal_enum[] = {
@@ -1394,6 +1568,7 @@ cuda_options_initialize ()
   cuda_options_initialize_break_on_launch ();
   cuda_options_initialize_api_failures ();
   cuda_options_initialize_disassemble_from ();
+  cuda_options_initialize_state_snapshot ();
   cuda_options_initialize_hide_internal_frames ();
   cuda_options_initialize_show_kernel_events ();
   cuda_options_initialize_show_context_events ();
@@ -1404,8 +1579,10 @@ cuda_options_initialize ()
   cuda_options_initialize_software_preemption ();
   cuda_options_initialize_gpu_busy_check ();
   cuda_options_initialize_variable_value_cache_enabled ();
+  cuda_options_initialize_memcache ();
   cuda_options_initialize_stats ();
   cuda_options_initialize_value_extrapolation ();
   cuda_options_initialize_single_stepping_optimization ();
+  cuda_options_initialize_batched_reads ();
   cuda_options_initialize_stop_signal ();
 }
@@ -34,6 +34,7 @@ bool cuda_options_break_on_launch_application(void);
 bool cuda_options_break_on_launch_system (void);
 bool cuda_options_disassemble_from_device_memory (void);
 bool cuda_options_disassemble_from_elf_image (void);
+bool cuda_options_state_snapshot_eager (void);
 bool cuda_options_hide_internal_frames (void);
 void cuda_options_force_set_launch_notification_update (void);
 unsigned int cuda_options_show_kernel_events_depth (void);
@@ -53,10 +54,13 @@ bool cuda_options_notify_random (void);
 bool cuda_options_software_preemption (void);
 bool cuda_options_gpu_busy_check (void);
 bool cuda_options_variable_value_cache_enabled (void);
+unsigned int cuda_options_memcache_size (void);
+unsigned int cuda_options_memcache_line_size (void);
 bool cuda_options_statistics_collection_enabled (void);
 bool cuda_options_value_extrapolation_enabled (void);
 bool cuda_options_trace_domain_enabled (cuda_trace_domain_t);
 bool cuda_options_single_stepping_optimizations_enabled (void);
+bool cuda_options_batched_reads_enabled (void);
 /* Return GDB_SIGNAL_TRAP or GDB_SIGNAL_URG */
 unsigned cuda_options_stop_signal (void);
 
@@ -36,6 +36,53 @@ struct {
   long int buf_size;
 } pktbuf;
 
+/* Binary packets.  Once negotiated with cuda_remote_negotiate_packets, the
+   qnv. packets are replaced by qnb. ones carrying the same fields as raw
+   bytes, RSP-escaped, with no separators and strings NUL-terminated.  The
+   replies start with "OK;", or with "MP;" when the reply did not fit in one
+   packet, the rest being fetched with qnb.Retr;OFFSET like the vCUDA
+   replies.  Both sides build the raw fields in a growable buffer. */
+static bool binary_packets = false;
+
+struct cuda_bin_buf {
+  gdb_byte *buf;
+  size_t size;
+  size_t used;
+  size_t offset;
+};
+
+static struct cuda_bin_buf bin_request;
+static struct cuda_bin_buf bin_reply;
+
+static void
+bin_buf_reserve (struct cuda_bin_buf *bb, size_t size)
+{
+  if (bb->used + size <= bb->size)
+    return;
+
+  bb->size = max (bb->used + size, 2 * bb->size);
+  bb->buf = xrealloc (bb->buf, bb->size);
+}
+
+static void
+bin_buf_append (struct cuda_bin_buf *bb, const void *src, size_t size)
+{
+  bin_buf_reserve (bb, size);
+  memcpy (bb->buf + bb->used, src, size);
+  bb->used += size;
+}
+
+/* Per packet type traffic, the last entry counts the vCUDA API requests */
+struct cuda_packet_stats {
+  unsigned long long packets;
+  unsigned long long round_trips;
+  unsigned long long bytes_sent;
+  unsigned long long bytes_received;
+};
+
+static struct cuda_packet_stats packet_stats[CUDA_PACKET_TYPE_MAX + 1];
+static cuda_packet_type_t current_packet_type;
+
 void
 alloc_cuda_packet_buffer (void)
 {
@@ -62,6 +109,12 @@ append_string (const char *src, char *dest, bool sep)
 {
   char *p;
 
+  if (binary_packets)
+    {
+      bin_buf_append (&bin_request, src, strlen (src) + 1);
+      return dest;
+    }
+
   if (dest + strlen (src) - pktbuf.buf >= pktbuf.buf_size)
     error (_("Exceed the size of cuda packet.\n"));
 
@@ -81,6 +134,12 @@ append_bin (const gdb_byte *src, char *dest, int size, bool sep)
 {
   char *p;
 
+  if (binary_packets)
+    {
+      bin_buf_append (&bin_request, src, size);
+      return dest;
+    }
+
   if (dest + size * 2 - pktbuf.buf >= pktbuf.buf_size)
     error (_("Exceed the size of cuda packet.\n"));
 
@@ -98,7 +157,22 @@ append_bin (const gdb_byte *src, char *dest, int size, bool sep)
 static char *
 extract_string (char *src)
 {
-  return strtok (src, ";");
+  char *p;
+  size_t len;
+
+  if (!binary_packets)
+    return strtok (src, ";");
+
+  if (bin_reply.offset >= bin_reply.used)
+    return NULL;
+
+  p = (char *) bin_reply.buf + bin_reply.offset;
+  len = strnlen (p, bin_reply.used - bin_reply.offset);
+  if (bin_reply.offset + len == bin_reply.used)
+    error (_("The data in the cuda packet is not complete.\n"));
+  bin_reply.offset += len + 1;
+
+  return p;
 }
 
 static char *
@@ -106,6 +180,16 @@ extract_bin (char *src, gdb_byte *dest, int size)
 {
   char *p;
 
+  if (binary_packets)
+    {
+      if (bin_reply.offset + size > bin_reply.used)
+        error (_("The data in the cuda packet is not complete.\n"));
+      p = (char *) bin_reply.buf + bin_reply.offset;
+      memcpy (dest, p, size);
+      bin_reply.offset += size;
+      return p;
+    }
+
   p = extract_string (src);
   if (!p)
     error (_("The data in the cuda packet is not complete.\n")); 
@@ -113,17 +197,126 @@ extract_bin (char *src, gdb_byte *dest, int size)
   return p;
 }
 
+/* Start a packet of type PACKET_TYPE, returning where its fields go */
+static char *
+start_cuda_packet (cuda_packet_type_t packet_type)
+{
+  char *p;
+
+  current_packet_type = packet_type;
+
+  if (binary_packets)
+    {
+      bin_request.used = 0;
+      bin_buf_append (&bin_request, &packet_type, sizeof (packet_type));
+      return pktbuf.buf;
+    }
+
+  p = append_string ("qnv.", pktbuf.buf, false);
+  return append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+}
+
+/* Send the packet built since start_cuda_packet and receive its reply */
+static void
+exchange_cuda_packet (void)
+{
+  struct cuda_packet_stats *stats = &packet_stats[current_packet_type];
+  int len, out_len, recv_len;
+
+  stats->packets++;
+
+  if (!binary_packets)
+    {
+      len = strlen (pktbuf.buf);
+      putpkt (pktbuf.buf);
+      recv_len = getpkt_sane (&pktbuf.buf, &pktbuf.buf_size, 1);
+      stats->round_trips++;
+      stats->bytes_sent += len;
+      stats->bytes_received += max (recv_len, 0);
+      return;
+    }
+
+  len = strlen ("qnb.");
+  memcpy (pktbuf.buf, "qnb.", len);
+  len += remote_escape_output (bin_request.buf, bin_request.used,
+                               (gdb_byte *) pktbuf.buf + len, &out_len,
+                               pktbuf.buf_size - len);
+  if (out_len != bin_request.used)
+    error (_("Exceed the size of cuda packet.\n"));
+  putpkt_binary (pktbuf.buf, len);
+  stats->bytes_sent += len;
+
+  bin_reply.used = 0;
+  bin_reply.offset = 0;
+  for (;;)
+    {
+      recv_len = getpkt_sane (&pktbuf.buf, &pktbuf.buf_size, 1);
+      stats->round_trips++;
+      stats->bytes_received += max (recv_len, 0);
+
+      if (recv_len < 3 ||
+          (strncmp (pktbuf.buf, "OK;", 3) != 0 &&
+           strncmp (pktbuf.buf, "MP;", 3) != 0))
+        error (_("Invalid reply to a cuda packet.\n"));
+
+      /* Escaped data never grows when unescaped */
+      bin_buf_reserve (&bin_reply, recv_len);
+      bin_reply.used += remote_unescape_input ((gdb_byte *) pktbuf.buf + 3,
+                                               recv_len - 3,
+                                               bin_reply.buf + bin_reply.used,
+                                               bin_reply.size - bin_reply.used);
+
+      if (strncmp (pktbuf.buf, "OK;", 3) == 0)
+        break;
+
+      len = xsnprintf (pktbuf.buf, pktbuf.buf_size, "qnb.Retr;%lu",
+                       (unsigned long) bin_reply.used);
+      putpkt_binary (pktbuf.buf, len);
+      stats->bytes_sent += len;
+    }
+}
+
+/* Switch to binary packets if cuda-gdbserver supports them. An older
+   server answers the unknown qnb. query with an empty packet. */
+void
+cuda_remote_negotiate_packets (void)
+{
+  int len;
+
+  binary_packets = false;
+
+  putpkt ("qnb.Supported");
+  len = getpkt_sane (&pktbuf.buf, &pktbuf.buf_size, 1);
+  if (len >= 2 && strncmp (pktbuf.buf, "OK", 2) == 0)
+    binary_packets = true;
+}
+
+bool
+cuda_remote_binary_packets (void)
+{
+  return binary_packets;
+}
+
+void
+cuda_remote_record_vcuda_packet (size_t sent, size_t received,
+                                 unsigned int round_trips)
+{
+  struct cuda_packet_stats *stats = &packet_stats[CUDA_PACKET_TYPE_MAX];
+
+  stats->packets++;
+  stats->round_trips += round_trips;
+  stats->bytes_sent += sent;
+  stats->bytes_received += received;
+}
+
 bool
 cuda_remote_notification_pending (void)
 {
-  char *p;
   bool ret_val;
   cuda_packet_type_t packet_type = NOTIFICATION_PENDING;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  start_cuda_packet (packet_type);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &ret_val, sizeof (ret_val));
   return ret_val;
@@ -132,14 +325,11 @@ cuda_remote_notification_pending (void)
 bool
 cuda_remote_notification_received (void)
 {
-  char *p;
   bool ret_val;
   cuda_packet_type_t packet_type = NOTIFICATION_RECEIVED;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  start_cuda_packet (packet_type);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &ret_val, sizeof (ret_val));
   return ret_val;
@@ -148,14 +338,11 @@ cuda_remote_notification_received (void)
 bool
 cuda_remote_notification_aliased_event (void)
 {
-  char *p;
   bool ret_val;
   cuda_packet_type_t packet_type = NOTIFICATION_ALIASED_EVENT;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  start_cuda_packet (packet_type);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &ret_val, sizeof (ret_val));
   return ret_val;
@@ -168,35 +355,27 @@ cuda_remote_notification_analyze (void)
   cuda_packet_type_t packet_type = NOTIFICATION_ANALYZE;
   struct thread_info *tp = inferior_thread ();
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &(tp->control.trap_expected), p, sizeof (tp->control.trap_expected), false);
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 }
 
 void
 cuda_remote_notification_mark_consumed (void)
 {
-  char *p;
   cuda_packet_type_t packet_type = NOTIFICATION_MARK_CONSUMED;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  start_cuda_packet (packet_type);
+  exchange_cuda_packet ();
 }
 
 void
 cuda_remote_notification_consume_pending (void)
 {
-  char *p;
   cuda_packet_type_t packet_type = NOTIFICATION_CONSUME_PENDING;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  start_cuda_packet (packet_type);
+  exchange_cuda_packet ();
 }
 
 void
@@ -213,14 +392,12 @@ cuda_remote_update_grid_id_in_sm (uint32_t dev, uint32_t sm)
 
   valid_warps_mask_c = sm_get_valid_warps_mask (dev, sm);
   num_warps = device_get_num_warps (dev);
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &dev, p, sizeof (dev), true);
   p = append_bin ((gdb_byte *) &sm,  p, sizeof (sm), true);
   p = append_bin ((gdb_byte *) &num_warps, p, sizeof (num_warps), false);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &valid_warps_mask_s, sizeof (valid_warps_mask_s));
   gdb_assert (valid_warps_mask_s == valid_warps_mask_c);
@@ -251,14 +428,12 @@ cuda_remote_update_block_idx_in_sm (uint32_t dev, uint32_t sm)
 
   valid_warps_mask_c = sm_get_valid_warps_mask (dev, sm);
   num_warps = device_get_num_warps (dev);
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &dev, p, sizeof (dev), true);
   p = append_bin ((gdb_byte *) &sm,  p, sizeof (sm), true);
   p = append_bin ((gdb_byte *) &num_warps, p, sizeof (num_warps), false);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &valid_warps_mask_s, sizeof (valid_warps_mask_s));
   gdb_assert (valid_warps_mask_s == valid_warps_mask_c);
@@ -289,15 +464,13 @@ cuda_remote_update_thread_idx_in_warp (uint32_t dev, uint32_t sm, uint32_t wp)
 
   valid_lanes_mask_c = warp_get_valid_lanes_mask (dev, sm, wp);
   num_lanes = device_get_num_lanes (dev);
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &dev, p, sizeof (dev), true);
   p = append_bin ((gdb_byte *) &sm,  p, sizeof (sm), true);
   p = append_bin ((gdb_byte *) &wp,  p, sizeof (wp), true);
   p = append_bin ((gdb_byte *) &num_lanes, p, sizeof (num_lanes), false);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &valid_lanes_mask_s, sizeof (valid_lanes_mask_s));
   gdb_assert (valid_lanes_mask_s == valid_lanes_mask_c);
@@ -314,6 +487,130 @@ cuda_remote_update_thread_idx_in_warp (uint32_t dev, uint32_t sm, uint32_t wp)
     error (_("Error: Failed to read the thread index (error=%u).\n"), res);
 }
 
+/* Read the warp masks of the SM and the state of all its valid warps with
+   a single packet.  The reply is streamed in several packets if needed,
+   which is only possible with binary packets. */
+bool
+cuda_remote_read_warp_state_in_sm (uint32_t dev, uint32_t sm, uint64_t *valid_warps_mask,
+                                   uint64_t *broken_warps_mask, CUDBGWarpState *states)
+{
+  CUDBGResult res;
+  char *p;
+  uint32_t wp;
+  uint32_t num_warps;
+  cuda_packet_type_t packet_type = READ_WARP_STATE_IN_SM;
+
+  if (!binary_packets)
+    return false;
+
+  num_warps = device_get_num_warps (dev);
+  p = start_cuda_packet (packet_type);
+  p = append_bin ((gdb_byte *) &dev, p, sizeof (dev), true);
+  p = append_bin ((gdb_byte *) &sm,  p, sizeof (sm), true);
+  p = append_bin ((gdb_byte *) &num_warps, p, sizeof (num_warps), false);
+
+  exchange_cuda_packet ();
+
+  extract_bin (pktbuf.buf, (gdb_byte *) &res, sizeof (res));
+  if (res != CUDBG_SUCCESS)
+    error (_("Error: Failed to read the warp state (dev=%u, sm=%u, error=%u).\n"),
+           dev, sm, res);
+  extract_bin (NULL, (gdb_byte *) valid_warps_mask, sizeof (*valid_warps_mask));
+  extract_bin (NULL, (gdb_byte *) broken_warps_mask, sizeof (*broken_warps_mask));
+  for (wp = 0; wp < num_warps; wp++)
+    if (*valid_warps_mask & (1ULL << wp))
+      extract_bin (NULL, (gdb_byte *) &states[wp], sizeof (states[wp]));
+
+  return true;
+}
+
+/* Pre-populate the state of the suspended devices right after a stop.  The
+   server returns, for every device, its exception SM mask and the warp
+   masks of all its SMs, plus the state of every valid warp of the SMs with
+   broken warps or an exception, which are the ones the stop is reported
+   on.  An SM the server could not read is left to be fetched lazily. */
+bool
+cuda_remote_read_stop_snapshot (void)
+{
+  CUDBGResult res;
+  char *p;
+  uint32_t dev;
+  uint32_t sm;
+  uint32_t wp;
+  uint32_t num_devices = 0;
+  uint32_t num_sms;
+  uint32_t num_warps;
+  uint64_t sm_exception_mask;
+  uint64_t valid_warps_mask;
+  uint64_t broken_warps_mask;
+  CUDBGWarpState *states;
+  struct cleanup *cleanups;
+  cuda_packet_type_t packet_type = READ_STOP_SNAPSHOT;
+
+  if (!binary_packets)
+    return false;
+
+  for (dev = 0; dev < cuda_system_get_num_devices (); dev++)
+    if (device_is_any_context_present (dev))
+      num_devices++;
+  if (num_devices == 0)
+    return false;
+
+  p = start_cuda_packet (packet_type);
+  p = append_bin ((gdb_byte *) &num_devices, p, sizeof (num_devices), true);
+  for (dev = 0; dev < cuda_system_get_num_devices (); dev++)
+    {
+      if (!device_is_any_context_present (dev))
+        continue;
+      num_sms   = device_get_num_sms (dev);
+      num_warps = device_get_num_warps (dev);
+      p = append_bin ((gdb_byte *) &dev, p, sizeof (dev), true);
+      p = append_bin ((gdb_byte *) &num_sms, p, sizeof (num_sms), true);
+      p = append_bin ((gdb_byte *) &num_warps, p, sizeof (num_warps), true);
+    }
+
+  exchange_cuda_packet ();
+
+  states = xmalloc (CUDBG_MAX_WARPS * sizeof (*states));
+  cleanups = make_cleanup (xfree, states);
+
+  for (dev = 0; dev < cuda_system_get_num_devices (); dev++)
+    {
+      if (!device_is_any_context_present (dev))
+        continue;
+
+      extract_bin (NULL, (gdb_byte *) &res, sizeof (res));
+      if (res != CUDBG_SUCCESS)
+        continue;
+      extract_bin (NULL, (gdb_byte *) &sm_exception_mask, sizeof (sm_exception_mask));
+      device_set_exception_state (dev, sm_exception_mask);
+
+      num_warps = device_get_num_warps (dev);
+      for (sm = 0; sm < device_get_num_sms (dev); sm++)
+        {
+          extract_bin (NULL, (gdb_byte *) &res, sizeof (res));
+          if (res != CUDBG_SUCCESS)
+            continue;
+          extract_bin (NULL, (gdb_byte *) &valid_warps_mask, sizeof (valid_warps_mask));
+          extract_bin (NULL, (gdb_byte *) &broken_warps_mask, sizeof (broken_warps_mask));
+
+          if (!broken_warps_mask && !((sm_exception_mask >> sm) & 1ULL))
+            {
+              sm_set_snapshot (dev, sm, valid_warps_mask, broken_warps_mask, NULL);
+              continue;
+            }
+
+          for (wp = 0; wp < num_warps; wp++)
+            if (valid_warps_mask & (1ULL << wp))
+              extract_bin (NULL, (gdb_byte *) &states[wp], sizeof (states[wp]));
+          sm_set_snapshot (dev, sm, valid_warps_mask, broken_warps_mask, states);
+        }
+    }
+
+  do_cleanups (cleanups);
+  return true;
+}
+
 void
 cuda_remote_initialize (CUDBGResult *get_debugger_api_res, CUDBGResult *set_callback_api_res,
                         CUDBGResult *initialize_api_res, bool *cuda_initialized,
@@ -325,14 +622,14 @@ cuda_remote_initialize (CUDBGResult *get_debugger_api_res, CUDBGResult *set_call
   bool memcheck            = cuda_options_memcheck ();
   bool launch_blocking     = cuda_options_launch_blocking ();
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type,     p, sizeof (packet_type), true);
+  cuda_remote_negotiate_packets ();
+
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &preemption,      p, sizeof (preemption), true);
   p = append_bin ((gdb_byte *) &memcheck,        p, sizeof (memcheck), true);
   p = append_bin ((gdb_byte *) &launch_blocking, p, sizeof (launch_blocking), false);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) get_debugger_api_res, sizeof (*get_debugger_api_res));
   extract_bin (NULL, (gdb_byte *) set_callback_api_res, sizeof (*set_callback_api_res));
@@ -351,12 +648,10 @@ cuda_remote_query_device_spec (uint32_t dev_id, uint32_t *num_sms, uint32_t *num
   CUDBGResult res;
   cuda_packet_type_t packet_type = QUERY_DEVICE_SPEC;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &dev_id, p, sizeof (uint32_t), false);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &res, sizeof (res));
   if (res != CUDBG_SUCCESS)
@@ -372,15 +667,12 @@ cuda_remote_query_device_spec (uint32_t dev_id, uint32_t *num_sms, uint32_t *num
 bool
 cuda_remote_check_pending_sigint (void)
 {
-  char *p;
   bool ret_val;
   cuda_packet_type_t packet_type = CHECK_PENDING_SIGINT;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
+  start_cuda_packet (packet_type);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &ret_val, sizeof (ret_val));
   return ret_val;
@@ -389,15 +681,12 @@ cuda_remote_check_pending_sigint (void)
 CUDBGResult
 cuda_remote_api_finalize (void)
 {
-  char *p;
   CUDBGResult res;
   cuda_packet_type_t packet_type = API_FINALIZE;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), true);
+  start_cuda_packet (packet_type);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 
   extract_bin (pktbuf.buf, (gdb_byte *) &res, sizeof (res));
   return res;
@@ -415,16 +704,14 @@ cuda_remote_set_option ()
 
   cuda_packet_type_t packet_type = SET_OPTION;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type,         p, sizeof (cuda_packet_type_t), true);
+  p = start_cuda_packet (packet_type);
   p = append_bin ((gdb_byte *) &general_trace,       p, sizeof (general_trace), true);
   p = append_bin ((gdb_byte *) &libcudbg_trace,      p, sizeof (libcudbg_trace), true);
   p = append_bin ((gdb_byte *) &notifications_trace, p, sizeof (notifications_trace), true);
   p = append_bin ((gdb_byte *) &notify_youngest,     p, sizeof (notify_youngest), true);
   p = append_string (stop_signal == GDB_SIGNAL_TRAP ? "SIGTRAP" : "SIGURG", p, false);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
 }
 
 void
@@ -438,21 +725,71 @@ cuda_remote_query_trace_message ()
       !cuda_options_debug_notifications ())
     return;
 
-  p = append_string ("qnv.", pktbuf.buf, false);
-  p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
+  p = start_cuda_packet (packet_type);
 
-  putpkt (pktbuf.buf);
-  getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+  exchange_cuda_packet ();
   p = extract_string (pktbuf.buf);
   while (strcmp ("NO_TRACE_MESSAGE", p) != 0)
     {
       fprintf (stderr, "%s\n", p);
 
-      p = append_string ("qnv.", pktbuf.buf, false);
-      p = append_bin ((gdb_byte *) &packet_type, p, sizeof (packet_type), false);
-      putpkt (pktbuf.buf);
-      getpkt (&pktbuf.buf, &pktbuf.buf_size, 1);
+      p = start_cuda_packet (packet_type);
+      exchange_cuda_packet ();
       p = extract_string (pktbuf.buf);
     }
   fflush (stderr);
 }
+
+static const char *cuda_packet_type_names[CUDA_PACKET_TYPE_MAX + 1] = {
+  "resumeDevice", "suspendDevice", "singleStepWarp", "setBreakpoint",
+  "unsetBreakpoint", "readGridId", "readBlockIdx", "readThreadIdx",
+  "readBrokenWarps", "readValidWarps", "readValidLanes", "readActiveLanes",
+  "readCodeMemory", "readConstMemory", "readGenericMemory",
+  "readPinnedMemory", "readParamMemory", "readSharedMemory",
+  "readTextureMemory", "readTextureMemoryBindless", "readLocalMemory",
+  "readRegister", "readPC", "readVirtualPC", "readLaneException",
+  "readCallDepth", "readSyscallCallDepth", "readVirtualReturnAddress",
+  "readErrorPC", "writeGenericMemory", "writePinnedMemory",
+  "writeParamMemory", "writeSharedMemory", "writeLocalMemory",
+  "writeRegister", "isDeviceCodeAddress", "disassemble",
+  "memcheckReadErrorAddress", "getNumDevices", "getGridStatus",
+  "getGridInfo", "getAdjustedCodeAddress", "getHostAddrFromDeviceAddr",
+  "notificationAnalyze", "notificationPending", "notificationReceived",
+  "notificationAliasedEvent", "notificationMarkConsumed",
+  "notificationConsumePending", "querySyncEvent", "queryAsyncEvent",
+  "ackSyncEvents", "updateGridIdInSm", "updateBlockIdxInSm",
+  "updateThreadIdxInWarp", "initializeTarget", "queryDeviceSpec",
+  "queryTraceMessage", "checkPendingSigint", "apiInitialize",
+  "apiFinalize", "clearAttachState", "requestCleanupOnDetach",
+  "setOption", "setAsyncLaunchNotifications", "readDeviceExceptionState",
+  "readWarpStateInSm",
+  "readStopSnapshot",
+  "vCUDA",
+};
+
+void
+cuda_remote_print_statistics (void)
+{
+  struct cuda_packet_stats *stats;
+  int type;
+
+  for (type = 0; type <= CUDA_PACKET_TYPE_MAX; ++type)
+    if (packet_stats[type].packets)
+      break;
+  if (type > CUDA_PACKET_TYPE_MAX)
+    return;
+
+  printf_unfiltered (_("Remote packets (%s encoding):\n"),
+                     binary_packets ? "binary" : "hex");
+  for (type = 0; type <= CUDA_PACKET_TYPE_MAX; ++type)
+    {
+      stats = &packet_stats[type];
+      if (!stats->packets)
+        continue;
+      printf_unfiltered (_("  %-28s %8llu packets %8llu round trips "
+                           "%10llu bytes sent %10llu bytes received\n"),
+                         cuda_packet_type_names[type], stats->packets,
+                         stats->round_trips, stats->bytes_sent,
+                         stats->bytes_received);
+    }
+}
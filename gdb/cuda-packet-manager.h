@@ -94,6 +94,12 @@ typedef enum {
     SET_OPTION,
     SET_ASYNC_LAUNCH_NOTIFICATIONS,
     READ_DEVICE_EXCEPTION_STATE,
+
+    /* bulk */
+    READ_WARP_STATE_IN_SM,
+    READ_STOP_SNAPSHOT,
+
+    CUDA_PACKET_TYPE_MAX,
 } cuda_packet_type_t;
 
 extern int hex2bin (const char *hex, gdb_byte *bin, int count);
@@ -102,6 +108,13 @@ extern int bin2hex (const gdb_byte *bin, char *hex, int count);
 void alloc_cuda_packet_buffer (void);
 void free_cuda_packet_buffer (void *unused);
 
+/* Packet encoding */
+void cuda_remote_negotiate_packets (void);
+bool cuda_remote_binary_packets (void);
+void cuda_remote_record_vcuda_packet (size_t sent, size_t received,
+                                      unsigned int round_trips);
+void cuda_remote_print_statistics (void);
+
 /* Device Properties */
 void cuda_remote_query_device_spec (uint32_t dev_id, uint32_t *num_sms, uint32_t *num_warps,
                                     uint32_t *num_lanes, uint32_t *num_registers, char **dev_type, char **sm_type);
@@ -122,6 +135,9 @@ bool cuda_remote_query_async_events (void);
 void cuda_remote_update_grid_id_in_sm (uint32_t dev, uint32_t sm);
 void cuda_remote_update_block_idx_in_sm (uint32_t dev, uint32_t sm);
 void cuda_remote_update_thread_idx_in_warp (uint32_t dev, uint32_t sm, uint32_t wp);
+bool cuda_remote_read_warp_state_in_sm (uint32_t dev, uint32_t sm, uint64_t *valid_warps_mask,
+                                        uint64_t *broken_warps_mask, CUDBGWarpState *states);
+bool cuda_remote_read_stop_snapshot (void);
 void cuda_remote_initialize (CUDBGResult *get_debugger_api_res, CUDBGResult *set_callback_api_res, 
                              CUDBGResult *initialize_api_res, bool *cuda_initialized, 
                              bool *cuda_debugging_enabled, bool *driver_is_compatiable);
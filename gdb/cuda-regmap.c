@@ -19,6 +19,7 @@
 #include "cuda-regmap.h"
 #include "gdb_assert.h"
 #include "obstack.h"
+#include "hashtab.h"
 #include "cuda-coords.h"
 #include "cuda-state.h"
 #include "cuda-options.h"
@@ -48,6 +49,11 @@
    The 8 high bits of a sass_reg are the register class (see cudadebugger.h).
    The low 24 bits are either the register index, or the offset in local
    memory, or the stack pointer register index and the offset.
+
+   Once loaded, the functions are hashed by name, and the mappings of each
+   function are indexed by PTX register name and start address, so that a
+   search only looks at the mappings of the register that may cover the
+   address.
  */
 
 /* Raw value decoding */
@@ -94,8 +100,21 @@ typedef struct {
   uint32_t idx;
 } regmap_map_t;
 
+/* The mappings of one PTX register, a slice of the function index */
 typedef struct {
+  const char *rname;
+  uint32_t first;
+  uint32_t count;
+  uint32_t max_idx;       // max location index across all addresses
+} regmap_reg_t;
+
+typedef struct regmap_func_st {
   char *name;
+  struct regmap_func_st *next;  // next function with the same name
+  uint32_t regs_no;
+  regmap_reg_t *regs;           // sorted by register name
+  regmap_map_t **index;         // sorted by register name, then start
+  uint32_t *max_end;            // running max of extended_end along a register slice
   uint32_t maps_no;
   regmap_map_t map[0];
 } regmap_func_t;
@@ -103,10 +122,17 @@ typedef struct {
 typedef struct cuda_regmap_table {
   struct objfile *owner;
   struct obstack *obstack;
+  htab_t funcs_by_name;
   uint32_t num_funcs;
   regmap_func_t *func[0];
 } regmap_table_t;
 
+/* Key used to look up a function by a possibly not NUL-terminated name */
+typedef struct {
+  const char *name;
+  uint32_t len;
+} regmap_func_key_t;
+
 /* Results query routines */
 regmap_t
 regmap_get_search_result (void)
@@ -482,6 +508,93 @@ regmap_extend_liverange (regmap_func_t *func)
     }
 }
 
+static int
+regmap_map_compare (const void *a, const void *b)
+{
+  const regmap_map_t *map1 = *(const regmap_map_t **) a;
+  const regmap_map_t *map2 = *(const regmap_map_t **) b;
+  int cmp;
+
+  cmp = strcmp (map1->rname, map2->rname);
+  if (cmp)
+    return cmp;
+  if (map1->start != map2->start)
+    return map1->start < map2->start ? -1 : 1;
+  /* Keep the mappings in table order otherwise */
+  return map1 < map2 ? -1 : map1 > map2;
+}
+
+/* Index the mappings of the function by register name and start address */
+static void
+regmap_index_func (regmap_func_t *func, struct obstack *obstack)
+{
+  regmap_reg_t *reg = NULL;
+  regmap_map_t *map;
+  uint32_t cnt;
+
+  func->index   = obstack_alloc (obstack, func->maps_no * sizeof (*func->index));
+  func->max_end = obstack_alloc (obstack, func->maps_no * sizeof (*func->max_end));
+  func->regs    = obstack_alloc (obstack, func->maps_no * sizeof (*func->regs));
+  func->regs_no = 0;
+
+  for (cnt = 0; cnt < func->maps_no; cnt++)
+    func->index[cnt] = &func->map[cnt];
+  qsort (func->index, func->maps_no, sizeof (*func->index), regmap_map_compare);
+
+  for (cnt = 0; cnt < func->maps_no; cnt++)
+    {
+      map = func->index[cnt];
+      if (!reg || strcmp (reg->rname, map->rname) != 0)
+        {
+          reg = &func->regs[func->regs_no++];
+          reg->rname   = map->rname;
+          reg->first   = cnt;
+          reg->count   = 0;
+          reg->max_idx = map->idx;
+          func->max_end[cnt] = map->extended_end;
+        }
+      else
+        func->max_end[cnt] = max (func->max_end[cnt - 1], map->extended_end);
+
+      reg->count++;
+      reg->max_idx = max (reg->max_idx, map->idx);
+    }
+}
+
+static hashval_t
+regmap_func_hash_name (const char *name, uint32_t len)
+{
+  return iterative_hash (name, len, 0);
+}
+
+static hashval_t
+regmap_func_hash (const void *item)
+{
+  const regmap_func_t *func = item;
+
+  return regmap_func_hash_name (func->name, strlen (func->name));
+}
+
+static int
+regmap_func_eq (const void *item, const void *key)
+{
+  const regmap_func_t *func = item;
+  const regmap_func_key_t *k = key;
+
+  return strncmp (func->name, k->name, k->len) == 0 && func->name[k->len] == 0;
+}
+
+static int
+regmap_func_eq_func (const void *item1, const void *item2)
+{
+  const regmap_func_t *func = item2;
+  regmap_func_key_t key;
+
+  key.name = func->name;
+  key.len  = strlen (func->name);
+  return regmap_func_eq (item1, &key);
+}
+
 /* Load regmap function record into cacheable in-memory representation */
 static int
 regmap_load_func (regmap_iterator_t *itr, regmap_table_t *table)
@@ -490,10 +603,11 @@ regmap_load_func (regmap_iterator_t *itr, regmap_table_t *table)
   char *rname, *fname;
   uint32_t num_entries = 0;
   uint32_t regs_found = 0;
-  regmap_func_t *func;
+  regmap_func_t *func, *prev;
   regmap_map_t *map;
   int cnt;
   uint32_t alloc_size;
+  void **slot;
 
   gdb_assert (itr);
   gdb_assert (table);
@@ -536,6 +650,18 @@ regmap_load_func (regmap_iterator_t *itr, regmap_table_t *table)
     }
 
   regmap_extend_liverange (func);
+  regmap_index_func (func, table->obstack);
+
+  /* Functions sharing a name are chained in table order */
+  slot = htab_find_slot (table->funcs_by_name, func, INSERT);
+  if (*slot)
+    {
+      for (prev = *slot; prev->next; prev = prev->next)
+        ;
+      prev->next = func;
+    }
+  else
+    *slot = func;
 
   table->func[table->num_funcs++] = func;
   return 0;
@@ -581,6 +707,10 @@ regmap_load_table (struct objfile *objfile)
   memset (table, 0, alloc_size);
   table->owner = objfile;
   table->obstack = obstack;
+  table->funcs_by_name = htab_create_alloc_ex (max (cnt, 1), regmap_func_hash,
+                                               regmap_func_eq_func, NULL, obstack,
+                                               hashtab_obstack_allocate,
+                                               dummy_obstack_deallocate);
   objfile->cuda_regmap = table;
 
   regmap_iterator_start (&itr, buffer, buffer_size);
@@ -639,6 +769,83 @@ regmap_table_print (struct objfile *objfile)
     }
 }
 
+/* Find the mappings of REG_NAME in FUNC that cover ADDR, and append them
+   to MATCHES in table order.  Returns the new number of matches. */
+static uint32_t
+regmap_func_search (regmap_func_t *func, const char *reg_name, uint64_t addr,
+                    regmap_map_t **matches, uint32_t num_matches)
+{
+  regmap_reg_t *reg = NULL;
+  regmap_map_t *map;
+  uint32_t lo, hi, mid;
+  uint32_t cnt, first_match = num_matches;
+  int cmp;
+
+  /* Find the register */
+  lo = 0;
+  hi = func->regs_no;
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      cmp = strcmp (func->regs[mid].rname, reg_name);
+      if (cmp == 0)
+        {
+          reg = &func->regs[mid];
+          break;
+        }
+      if (cmp < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  if (!reg)
+    return num_matches;
+
+  /* Save the maximum location index encountered for this register name */
+  if (cuda_regmap->output.max_location_index == ~0U ||
+      reg->max_idx > cuda_regmap->output.max_location_index)
+    cuda_regmap->output.max_location_index = reg->max_idx;
+
+  /* Find the first mapping starting after the address */
+  lo = reg->first;
+  hi = reg->first + reg->count;
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (func->index[mid]->start <= addr)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  /* Walk back over the mappings starting at or before the address, until
+     none of the remaining ones can reach it, even when extended. */
+  for (cnt = lo; cnt > reg->first && func->max_end[cnt - 1] >= addr; cnt--)
+    {
+      map = func->index[cnt - 1];
+
+      /* Discard this register reg if the address if out of range/extended range */
+      if (addr > (cuda_options_value_extrapolation_enabled () ?
+                  map->extended_end : map->end))
+        continue;
+
+      if (num_matches < REGMAP_MAX_ENTRIES)
+        matches[num_matches++] = map;
+    }
+
+  /* The walk found them by start address, the table order is the order
+     of the mappings in the function */
+  for (lo = first_match + 1; lo < num_matches; lo++)
+    for (hi = lo; hi > first_match && matches[hi - 1] > matches[hi]; hi--)
+      {
+        map = matches[hi];
+        matches[hi] = matches[hi - 1];
+        matches[hi - 1] = map;
+      }
+
+  return num_matches;
+}
+
 /* Generate regmap_t entry for given PTX register at given address in a given function */
 regmap_t
 regmap_table_search (struct objfile *objfile, const char *func_name,
@@ -646,10 +853,13 @@ regmap_table_search (struct objfile *objfile, const char *func_name,
 {
   char *tmp;
   uint32_t func_name_len;
-  uint32_t cnt;
+  uint32_t num_matches = 0;
+  uint32_t i;
   regmap_table_t *table;
   regmap_func_t *func;
-  regmap_map_t  *map, *map_end;
+  regmap_func_key_t key;
+  regmap_map_t *map;
+  regmap_map_t *matches[REGMAP_MAX_ENTRIES];
 
   gdb_assert (objfile);
   gdb_assert (func_name);
@@ -669,42 +879,30 @@ regmap_table_search (struct objfile *objfile, const char *func_name,
   cuda_regmap->output.max_location_index = ~0U;
   cuda_regmap->output.extrapolated = false;
 
-  /* Search in each function */
+  /* Search in each function with that name */
   table = regmap_load_table (objfile);
   if (!table || table->num_funcs == 0)
     return cuda_regmap;
 
-  for ( func = table->func[cnt = 0]; cnt < table->num_funcs; func = table->func[++cnt])
-  {
-     if (strncmp (func->name, func_name, func_name_len) != 0
-         || func->name[func_name_len] != 0)
-       continue;
-     for (map = &func->map[0], map_end = &func->map[func->maps_no]; map < map_end; map++)
-       {
-         /* Discard this register reg if the register name does not match */
-         if (strcmp (map->rname, reg_name+1) != 0)
-           continue;
-
-         /* Save the maximum location index encountered for this register name */
-         if (cuda_regmap->output.max_location_index == ~0U ||
-             map->idx > cuda_regmap->output.max_location_index)
-           cuda_regmap->output.max_location_index = map->idx;
-
-         /* Discard this register reg if the address if out of range/extended range */
-         if (addr < map->start ||
-             addr > (cuda_options_value_extrapolation_enabled () ?
-                    map->extended_end : map->end) )
-             continue;
-
-         /* Save the found element in the regmap object */
-         cuda_regmap->output.location_index[cuda_regmap->output.num_entries] = map->idx;
-         cuda_regmap->output.raw_value[cuda_regmap->output.num_entries] = map->target;
-         /* Mark output as extrapolated */
-         if (cuda_options_value_extrapolation_enabled () && addr > map->end)
-           cuda_regmap->output.extrapolated = true;
-         cuda_regmap->output.num_entries++;
-       }
-  }
+  key.name = func_name;
+  key.len  = func_name_len;
+  func = htab_find_with_hash (table->funcs_by_name, &key,
+                              regmap_func_hash_name (func_name, func_name_len));
+  for (; func; func = func->next)
+    num_matches = regmap_func_search (func, reg_name + 1, addr, matches, num_matches);
+
+  for (i = 0; i < num_matches; i++)
+    {
+      map = matches[i];
+
+      /* Save the found element in the regmap object */
+      cuda_regmap->output.location_index[cuda_regmap->output.num_entries] = map->idx;
+      cuda_regmap->output.raw_value[cuda_regmap->output.num_entries] = map->target;
+      /* Mark output as extrapolated */
+      if (cuda_options_value_extrapolation_enabled () && addr > map->end)
+        cuda_regmap->output.extrapolated = true;
+      cuda_regmap->output.num_entries++;
+    }
 
   return cuda_regmap;
 }
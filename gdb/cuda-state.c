@@ -20,35 +20,61 @@
 #include "defs.h"
 #include "breakpoint.h"
 #include "gdb_assert.h"
+#include "hashtab.h"
+#include "inferior.h"
+#include "observer.h"
 
 #include "cuda-context.h"
 #include "cuda-defs.h"
 #include "cuda-iterator.h"
+#include "cuda-memcache.h"
 #include "cuda-state.h"
 #include "cuda-utils.h"
 #include "cuda-packet-manager.h"
 #include "cuda-options.h"
 #include "cuda-elf-image.h"
+#include "libcudbgipc.h"
 
 #ifdef __ANDROID__
 #undef CUDBG_MAX_DEVICES
 #define CUDBG_MAX_DEVICES 4
 #endif /*__ANDROID__*/
 
+/* GPU register cache */
+#define CUDBG_CACHED_REGISTERS_COUNT 256
+#define CUDBG_CACHED_PREDICATES_COUNT 7
 typedef struct {
-  bool thread_idx_p;
-  bool pc_p;
-  bool exception_p;
-  bool virtual_pc_p;
-  bool timestamp_p;
-  CuDim3           thread_idx;
-  uint64_t         pc;
-  CUDBGException_t exception;
-  uint64_t         virtual_pc;
-  cuda_clock_t     timestamp;
+  uint32_t registers[CUDBG_CACHED_REGISTERS_COUNT];
+  uint32_t register_valid_mask[CUDBG_CACHED_REGISTERS_COUNT>>5];
+  uint32_t predicates[CUDBG_CACHED_PREDICATES_COUNT];
+  bool     predicates_valid_p;
+  uint32_t cc_register;
+  bool     cc_register_valid_p;
+} cuda_reg_cache_element_t;
+
+/* The state of the lanes of a warp, one array per field with one element
+   per lane.  The bit of a lane is set in the mask of a field when the field
+   of that lane is cached. */
+typedef struct {
+  uint32_t thread_idx_p;
+  uint32_t pc_p;
+  uint32_t exception_p;
+  uint32_t virtual_pc_p;
+  uint32_t timestamp_p;
+  CuDim3           *thread_idx;
+  uint64_t         *pc;
+  CUDBGException_t *exception;
+  uint64_t         *virtual_pc;
+  cuda_clock_t     *timestamp;
 } lane_state_t;
 
+/* The cached state of the SMs, warps and lanes of a device is stamped
+   with the device epoch it was read in.  Invalidating a whole device only
+   bumps its epoch: an SM or a warp whose stamp is behind is reset the next
+   time it is looked up (see sm_get and warp_get), so that the cost of a
+   resume is proportional to the state actually used during the stop. */
 typedef struct {
+  uint64_t epoch;         // device epoch the warp and lane state belong to
   bool valid_p;
   bool broken_p;
   bool block_idx_p;
@@ -58,6 +84,7 @@ typedef struct {
   bool active_lanes_mask_p;
   bool timestamp_p;
   bool error_pc_p;
+  bool exception_lanes_mask_p;
   bool     valid;
   bool     broken;
   bool     error_pc_available;
@@ -67,16 +94,27 @@ typedef struct {
   uint64_t error_pc;
   uint32_t valid_lanes_mask;
   uint32_t active_lanes_mask;
+  uint32_t exception_lanes_mask; // valid lanes with an exception
   cuda_clock_t     timestamp;
-  lane_state_t ln[CUDBG_MAX_LANES];
+  lane_state_t ln;
+  /* Register cache slab, one element per lane, allocated on first use.
+     A lane element is only valid if its bit is set in reg_cache_lanes_mask. */
+  cuda_reg_cache_element_t *reg_cache;
+  uint32_t reg_cache_lanes_mask;
 } warp_state_t;
 
 typedef struct {
+  uint64_t epoch;         // device epoch the masks belong to
   bool valid_warps_mask_p;
   bool broken_warps_mask_p;
+  bool snapshot_p;        // masks and valid warps read as one snapshot
+  bool exception_warps_mask_p;
   uint64_t valid_warps_mask;
   uint64_t broken_warps_mask;
-  warp_state_t wp[CUDBG_MAX_WARPS];
+  uint64_t exception_warps_mask; // valid warps with a lane exception
+  uint64_t stepped_warps_mask;   // warps single-stepped since the resume
+  uint64_t breakpoint_warps_mask; // warps at a breakpoint, see the stop report
+  warp_state_t *wp;       // num_warps warps
 } sm_state_t;
 
 typedef struct {
@@ -94,6 +132,7 @@ typedef struct {
   bool valid;             // at least one active lane
   /* the above fields are invalidated on resume */
   bool suspended;         // true if the device is suspended
+  bool preempted_step_p;  // warps stepped since the resume may have moved
   char dev_type[256];
   char dev_name[256];
   char sm_type[16];
@@ -105,7 +144,13 @@ typedef struct {
   uint32_t pci_dev_id;
   uint32_t pci_bus_id;
   uint64_t sm_exception_mask;
-  sm_state_t sm[CUDBG_MAX_SMS];
+  uint64_t epoch;         // bumped to drop the state of every SM and warp
+  /* The SM, warp and lane state is sized from the number of SMs, warps
+     and lanes of the device when first used.  WARPS and LANES are the
+     storage of every warp and lane of the device. */
+  sm_state_t *sm;
+  warp_state_t *warps;
+  lane_state_t lanes;
   contexts_t contexts;    // state for contexts associated with this device
 } device_state_t;
 
@@ -116,38 +161,82 @@ typedef struct {
   uint32_t suspended_devices_mask;
 } cuda_system_t;
 
+/* Register cache statistics */
+typedef struct {
+  uint64_t lookups;
+  uint64_t hits;
+  uint64_t fills;         // lane elements (re)started, cumulative
+} cuda_reg_cache_stats_t;
 
-/* GPU register cache */
-#define CUDBG_CACHED_REGISTERS_COUNT 256
-#define CUDBG_CACHED_PREDICATES_COUNT 7
+static cuda_reg_cache_stats_t cuda_reg_cache_stats;
+
+/* Warp state round trip statistics */
 typedef struct {
-  uint32_t dev;
-  uint32_t sm;
-  uint32_t wp;
-  uint32_t ln;
-  uint32_t registers[CUDBG_CACHED_REGISTERS_COUNT];
-  uint32_t register_valid_mask[CUDBG_CACHED_REGISTERS_COUNT>>5];
-  uint32_t predicates[CUDBG_CACHED_PREDICATES_COUNT];
-  bool     predicates_valid_p;
-  uint32_t cc_register;
-  bool     cc_register_valid_p;
-} cuda_reg_cache_element_t;
-DEF_VEC_O(cuda_reg_cache_element_t);
-static VEC(cuda_reg_cache_element_t) *cuda_register_cache = NULL;
+  uint64_t stops;
+  uint64_t snapshots;
+  uint64_t mask_reads;
+  uint64_t warp_state_reads;
+  uint64_t error_pc_reads;
+  uint64_t saved;         // round trips answered from a snapshot
+  uint64_t invalidations; // device invalidations
+  uint64_t warp_resets;   // warps reset after an invalidation
+} cuda_state_stats_t;
+
+static cuda_state_stats_t cuda_state_stats;
+
+/* The stop report: the warps that may be stopped at a breakpoint, i.e. the
+   broken warps and the warps single-stepped since the devices were last
+   resumed, with the PC of their active lanes.  It is built once from the
+   broken warps masks of every SM and answers the breakpoint queries of a
+   stop (see cuda_system_get_stop_report).  It is dropped whenever a warp
+   moves and whenever a breakpoint is created, deleted or modified. */
+static struct {
+  bool valid_p;
+  uint32_t num_warps;
+  uint32_t size;
+  cuda_stop_warp_t *warps;
+} cuda_stop_report;
+
+static struct {
+  uint64_t builds;
+  uint64_t warps;
+  uint64_t pc_lookups;    // distinct PCs looked up in the breakpoint table
+} cuda_stop_report_stats;
+
+/* The block index: the valid warps of every device grouped by block and
+   sorted by kernel, grid and block index, then by device and SM.  An entry
+   holds the warps of a block on one SM.  It is built once per stop and
+   lets the logical iterators walk kernels, blocks and threads in order
+   without collecting and sorting the warps themselves (see
+   cuda_system_get_block_index).  It is dropped whenever a warp may have
+   exited or moved. */
+static struct {
+  bool valid_p;
+  uint32_t num_blocks;
+  uint32_t size;
+  cuda_block_warps_t *blocks;
+} cuda_block_index;
 
+static struct {
+  uint64_t builds;
+  uint64_t blocks;
+} cuda_block_index_stats;
 
 const bool CACHED = true; // set to false to disable caching
-typedef enum { RECURSIVE, NON_RECURSIVE } recursion_t;
 
 static void device_initialize             (uint32_t dev_id);
 static void device_cleanup_contexts       (uint32_t dev_id);
 static void device_flush_disasm_cache     (uint32_t dev_id);
 static void device_update_exception_state (uint32_t dev_id);
-static void sm_invalidate                 (uint32_t dev_id, uint32_t sm_id, recursion_t);
-static void sm_set_exception_none         (uint32_t dev_id, uint32_t sm_id);
+static void sm_invalidate                 (uint32_t dev_id, uint32_t sm_id);
 static void warp_invalidate               (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
-static void lane_invalidate               (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id);
-static void lane_set_exception_none       (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id);
+static void warps_invalidate              (uint32_t dev_id, uint32_t sm_id, uint64_t wp_mask);
+static void update_warp_cached_info       (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
+static void warp_set_cached_info          (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
+                                           const CUDBGWarpState *state);
+static inline device_state_t *device_get  (uint32_t dev_id);
+static inline sm_state_t *sm_get          (uint32_t dev_id, uint32_t sm_id);
+static inline warp_state_t *warp_get      (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
 
 
 /******************************************************************************
@@ -158,6 +247,30 @@ static void lane_set_exception_none       (uint32_t dev_id, uint32_t sm_id, uint
 
 static cuda_system_t cuda_system_info;
 
+static void
+device_free_state (device_state_t *dev)
+{
+  uint32_t i;
+
+  if (!dev->sm)
+    return;
+
+  for (i = 0; i < dev->num_sms * dev->num_warps; ++i)
+    xfree (dev->warps[i].reg_cache);
+
+  xfree (dev->lanes.thread_idx);
+  xfree (dev->lanes.pc);
+  xfree (dev->lanes.exception);
+  xfree (dev->lanes.virtual_pc);
+  xfree (dev->lanes.timestamp);
+  xfree (dev->warps);
+  xfree (dev->sm);
+
+  dev->sm    = NULL;
+  dev->warps = NULL;
+  memset (&dev->lanes, 0, sizeof dev->lanes);
+}
+
 static void cuda_system_cleanup (void)
 {
   uint32_t dev_id;
@@ -167,7 +280,12 @@ static void cuda_system_cleanup (void)
   cuda_system_info.suspended_devices_mask = 0;
   for (dev_id = 0; dev_id < CUDBG_MAX_DEVICES; ++dev_id)
     if (cuda_system_info.dev[dev_id])
-      memset (cuda_system_info.dev[dev_id], 0, sizeof(device_state_t));
+      {
+        device_free_state (cuda_system_info.dev[dev_id]);
+        memset (cuda_system_info.dev[dev_id], 0, sizeof(device_state_t));
+      }
+  cuda_stop_report.valid_p = false;
+  cuda_block_index.valid_p = false;
 }
 
 void
@@ -221,7 +339,8 @@ cuda_system_get_num_present_kernels (void)
   if (!cuda_initialized)
     return 0;
 
-  for (kernel = kernels_get_first_kernel (); kernel; kernel = kernels_get_next_kernel (kernel))
+  for (kernel = kernels_get_first_present_kernel (); kernel;
+       kernel = kernels_get_next_present_kernel (kernel))
     if (kernel_is_present (kernel))
       ++num_present_kernel;
 
@@ -272,35 +391,296 @@ cuda_system_flush_disasm_cache (void)
     device_flush_disasm_cache (dev_id);
 }
 
+static void
+cuda_stop_report_invalidate (void)
+{
+  cuda_stop_report.valid_p = false;
+}
+
+static void
+cuda_block_index_invalidate (void)
+{
+  cuda_block_index.valid_p = false;
+}
+
+/* Whether there is a breakpoint at a PC of the stop report */
+typedef struct {
+  CORE_ADDR pc;
+  bool      at_breakpoint;
+} cuda_stop_report_pc_t;
+
+static hashval_t
+cuda_stop_report_pc_hash (const void *item)
+{
+  const cuda_stop_report_pc_t *entry = item;
+
+  return iterative_hash_object (entry->pc, 0);
+}
+
+static int
+cuda_stop_report_pc_eq (const void *a, const void *b)
+{
+  const cuda_stop_report_pc_t *e1 = a;
+  const cuda_stop_report_pc_t *e2 = b;
+
+  return e1->pc == e2->pc;
+}
+
+/* Look PC up in the breakpoint table, once per distinct PC */
+static bool
+cuda_stop_report_at_breakpoint (htab_t pcs, struct address_space *aspace,
+                                CORE_ADDR pc)
+{
+  cuda_stop_report_pc_t key, *entry;
+  void **slot;
+
+  key.pc = pc;
+  slot = htab_find_slot (pcs, &key, INSERT);
+  if (*slot)
+    return ((cuda_stop_report_pc_t *) *slot)->at_breakpoint;
+
+  entry = xmalloc (sizeof *entry);
+  entry->pc = pc;
+  entry->at_breakpoint = breakpoint_here_p (aspace, pc) != no_breakpoint_here;
+  *slot = entry;
+  ++cuda_stop_report_stats.pc_lookups;
+
+  return entry->at_breakpoint;
+}
+
+static void
+cuda_stop_report_build (void)
+{
+  struct address_space *aspace = NULL;
+  struct cleanup   *cleanups;
+  cuda_stop_warp_t *w;
+  sm_state_t       *sm;
+  htab_t            pcs;
+  uint64_t          warps_mask;
+  uint32_t          dev_id, sm_id, wp_id;
+
+  cuda_trace ("system: build the stop report");
+
+  if (!ptid_equal (inferior_ptid, null_ptid))
+    aspace = target_thread_address_space (inferior_ptid);
+
+  pcs = htab_create_alloc (16, cuda_stop_report_pc_hash, cuda_stop_report_pc_eq,
+                           xfree, xcalloc, xfree);
+  cleanups = make_cleanup_htab_delete (pcs);
+
+  cuda_stop_report.num_warps = 0;
+
+  for (dev_id = 0; dev_id < cuda_system_get_num_devices (); ++dev_id)
+    for (sm_id = 0; sm_id < device_get_num_sms (dev_id); ++sm_id)
+      {
+        sm = sm_get (dev_id, sm_id);
+        sm->breakpoint_warps_mask = 0;
+
+        /* With software preemption, the stepped warps may now live on any
+           SM: every valid warp is listed */
+        if (device_get (dev_id)->preempted_step_p)
+          warps_mask = ~0ULL;
+        else
+          warps_mask = sm_get_broken_warps_mask (dev_id, sm_id) | sm->stepped_warps_mask;
+        warps_mask &= sm_get_valid_warps_mask (dev_id, sm_id);
+        if (!warps_mask)
+          continue;
+
+        for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+          {
+            if (!((warps_mask >> wp_id) & 1ULL))
+              continue;
+
+            if (cuda_stop_report.num_warps >= cuda_stop_report.size)
+              {
+                cuda_stop_report.size = max (2 * cuda_stop_report.size, 64);
+                cuda_stop_report.warps = xrealloc (cuda_stop_report.warps,
+                                                   cuda_stop_report.size * sizeof (*w));
+              }
+
+            w = &cuda_stop_report.warps[cuda_stop_report.num_warps++];
+            w->dev = dev_id;
+            w->sm  = sm_id;
+            w->wp  = wp_id;
+            w->broken = (sm_get_broken_warps_mask (dev_id, sm_id) >> wp_id) & 1ULL;
+            w->active_lanes_mask = warp_get_active_lanes_mask (dev_id, sm_id, wp_id);
+            w->pc = 0;
+            w->at_breakpoint = false;
+
+            if (!w->active_lanes_mask)
+              continue;
+
+            w->pc = warp_get_active_virtual_pc (dev_id, sm_id, wp_id);
+            w->at_breakpoint = cuda_stop_report_at_breakpoint (pcs, aspace, w->pc);
+            if (w->at_breakpoint)
+              sm->breakpoint_warps_mask |= 1ULL << wp_id;
+          }
+      }
+
+  do_cleanups (cleanups);
+
+  cuda_stop_report.valid_p = true;
+  ++cuda_stop_report_stats.builds;
+  cuda_stop_report_stats.warps += cuda_stop_report.num_warps;
+}
+
+/* Return the warps of the stop report in *WARPS, and their number */
+uint32_t
+cuda_system_get_stop_report (const cuda_stop_warp_t **warps)
+{
+  if (!cuda_stop_report.valid_p)
+    cuda_stop_report_build ();
+
+  *warps = cuda_stop_report.warps;
+  return cuda_stop_report.num_warps;
+}
+
+/* Order of the block index: kernel, grid and block, then physical
+   coordinates */
+int
+cuda_block_warps_compare (const cuda_block_warps_t *b1,
+                          const cuda_block_warps_t *b2)
+{
+#define CUDA_BLOCK_WARPS_COMPARE(x,y) \
+  if ((x) != (y))                     \
+    return (x) < (y) ? -1 : 1;
+
+  CUDA_BLOCK_WARPS_COMPARE (b1->kernel_id,   b2->kernel_id);
+  CUDA_BLOCK_WARPS_COMPARE (b1->grid_id,     b2->grid_id);
+  CUDA_BLOCK_WARPS_COMPARE (b1->block_idx.x, b2->block_idx.x);
+  CUDA_BLOCK_WARPS_COMPARE (b1->block_idx.y, b2->block_idx.y);
+  CUDA_BLOCK_WARPS_COMPARE (b1->block_idx.z, b2->block_idx.z);
+  CUDA_BLOCK_WARPS_COMPARE (b1->dev,         b2->dev);
+  CUDA_BLOCK_WARPS_COMPARE (b1->sm,          b2->sm);
+
+#undef CUDA_BLOCK_WARPS_COMPARE
+  return 0;
+}
+
+static int
+cuda_block_index_compare (const void *a, const void *b)
+{
+  return cuda_block_warps_compare (a, b);
+}
+
+static void
+cuda_block_index_build (void)
+{
+  cuda_block_warps_t *b;
+  kernel_t  kernel;
+  uint64_t  warps_mask, kernel_id, grid_id;
+  uint32_t  dev_id, sm_id, wp_id, first, i;
+  CuDim3    block_idx;
+
+  cuda_trace ("system: build the block index");
+
+  cuda_block_index.num_blocks = 0;
+
+  for (dev_id = 0; dev_id < cuda_system_get_num_devices (); ++dev_id)
+    for (sm_id = 0; sm_id < device_get_num_sms (dev_id); ++sm_id)
+      {
+        warps_mask = sm_get_valid_warps_mask (dev_id, sm_id);
+        first = cuda_block_index.num_blocks;
+
+        for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+          {
+            if (!((warps_mask >> wp_id) & 1ULL))
+              continue;
+
+            kernel    = warp_get_kernel (dev_id, sm_id, wp_id);
+            kernel_id = kernel ? kernel_get_id (kernel) : CUDA_INVALID;
+            grid_id   = warp_get_grid_id (dev_id, sm_id, wp_id);
+            block_idx = warp_get_block_idx (dev_id, sm_id, wp_id);
+
+            /* An SM only runs a few blocks: look for the block among the
+               entries of the SM */
+            for (i = first; i < cuda_block_index.num_blocks; ++i)
+              {
+                b = &cuda_block_index.blocks[i];
+                if (b->kernel_id == kernel_id && b->grid_id == grid_id &&
+                    b->block_idx.x == block_idx.x &&
+                    b->block_idx.y == block_idx.y &&
+                    b->block_idx.z == block_idx.z)
+                  break;
+              }
+
+            if (i == cuda_block_index.num_blocks)
+              {
+                if (cuda_block_index.num_blocks >= cuda_block_index.size)
+                  {
+                    cuda_block_index.size = max (2 * cuda_block_index.size, 64);
+                    cuda_block_index.blocks = xrealloc (cuda_block_index.blocks,
+                                                        cuda_block_index.size * sizeof (*b));
+                  }
+
+                b = &cuda_block_index.blocks[cuda_block_index.num_blocks++];
+                b->kernel_id  = kernel_id;
+                b->grid_id    = grid_id;
+                b->block_idx  = block_idx;
+                b->dev        = dev_id;
+                b->sm         = sm_id;
+                b->warps_mask = 0;
+              }
+
+            cuda_block_index.blocks[i].warps_mask |= 1ULL << wp_id;
+          }
+      }
+
+  qsort (cuda_block_index.blocks, cuda_block_index.num_blocks,
+         sizeof (*cuda_block_index.blocks), cuda_block_index_compare);
+
+  cuda_block_index.valid_p = true;
+  ++cuda_block_index_stats.builds;
+  cuda_block_index_stats.blocks += cuda_block_index.num_blocks;
+}
+
+/* Return the entries of the block index in *BLOCKS, and their number */
+uint32_t
+cuda_system_get_block_index (const cuda_block_warps_t **blocks)
+{
+  if (!cuda_block_index.valid_p)
+    cuda_block_index_build ();
+
+  *blocks = cuda_block_index.blocks;
+  return cuda_block_index.num_blocks;
+}
+
 bool
 cuda_system_is_broken (cuda_clock_t clock)
 {
-  cuda_iterator itr;
-  cuda_coords_t c, filter = CUDA_WILDCARD_COORDS;
-  bool broken = false;
+  const cuda_stop_warp_t *warps;
+  uint32_t i, num_warps;
 
-  itr = cuda_iterator_create (CUDA_ITERATOR_TYPE_WARPS, &filter,
-                               CUDA_SELECT_VALID);
+  num_warps = cuda_system_get_stop_report (&warps);
 
-  for (cuda_iterator_start (itr);
-       !cuda_iterator_end (itr);
-       cuda_iterator_next (itr))
+  for (i = 0; i < num_warps; ++i)
     {
-      /* if we hit a breakpoint at an earlier time, we do not report it again. */
-      c = cuda_iterator_get_current (itr);
-      if (warp_get_timestamp (c.dev, c.sm, c.wp) < clock)
+      if (!warps[i].broken)
         continue;
 
-      if (!warp_is_broken (c.dev, c.sm, c.wp))
+      /* if we hit a breakpoint at an earlier time, we do not report it again. */
+      if (warp_get_timestamp (warps[i].dev, warps[i].sm, warps[i].wp) < clock)
         continue;
 
-      broken = true;
-      break;
+      return true;
     }
 
-  cuda_iterator_destroy (itr);
+  return false;
+}
+
+/* Whether a valid lane of any device has an exception.  Answered from the
+   device exception masks and the warp exception summaries of the flagged
+   SMs, see device_has_lane_exception. */
+bool
+cuda_system_has_lane_exception (void)
+{
+  uint32_t dev_id;
 
-  return broken;
+  for (dev_id = 0; dev_id < cuda_system_get_num_devices (); ++dev_id)
+    if (device_has_lane_exception (dev_id))
+      return true;
+
+  return false;
 }
 
 uint32_t
@@ -312,17 +692,13 @@ cuda_system_get_suspended_devices_mask (void)
 context_t
 cuda_system_find_context_by_addr (CORE_ADDR addr)
 {
-  uint32_t  dev_id;
-  context_t context;
+  elf_image_t elf_image;
 
-  for (dev_id = 0; dev_id < cuda_system_get_num_devices (); ++dev_id)
-    {
-      context = device_find_context_by_addr (dev_id, addr);
-      if (context)
-        return context;
-    }
+  elf_image = cuda_elf_image_find_by_address (addr);
+  if (!elf_image)
+    return NULL;
 
-  return NULL;
+  return module_get_context (cuda_elf_image_get_module (elf_image));
 }
 
 /******************************************************************************
@@ -379,16 +755,20 @@ void
 device_invalidate (uint32_t dev_id)
 {
   device_state_t *dev;
-  uint32_t sm_id;
 
   cuda_trace ("device %u: invalidate", dev_id);
   dev = device_get (dev_id);
 
-  for (sm_id = 0; sm_id < device_get_num_sms (dev_id); ++sm_id)
-    sm_invalidate (dev_id, sm_id, RECURSIVE);
-
+  /* Drop the state of every SM, warp and lane of the device at once, they
+     are reset when next looked up. */
+  ++dev->epoch;
+  ++cuda_state_stats.invalidations;
+  cuda_stop_report_invalidate ();
+  cuda_block_index_invalidate ();
+  cuda_memcache_invalidate_device (dev_id, false);
   device_invalidate_kernels(dev_id);
 
+  dev->sm_exception_mask_valid_p = false;
   dev->valid_p   = false;
 }
 
@@ -639,6 +1019,24 @@ device_has_exception (uint32_t dev_id)
   return dev->sm_exception_mask != 0;
 }
 
+/* Whether a valid lane of the device has an exception.  Only the SMs
+   flagged in the device exception mask are looked at, and only through
+   their warp exception summaries. */
+bool
+device_has_lane_exception (uint32_t dev_id)
+{
+  uint32_t sm_id;
+
+  if (!device_has_exception (dev_id))
+    return false;
+
+  for (sm_id = 0; sm_id < device_get_num_sms (dev_id); ++sm_id)
+    if (sm_get_exception_warps_mask (dev_id, sm_id))
+      return true;
+
+  return false;
+}
+
 uint64_t
 device_get_active_sms_mask (uint32_t dev_id)
 {
@@ -713,6 +1111,7 @@ device_resume (uint32_t dev_id)
   cuda_api_resume_device (dev_id);
 
   dev->suspended = false;
+  dev->preempted_step_p = false;
 
   cuda_system_info.suspended_devices_mask &= ~(1 << dev_id);
 }
@@ -745,6 +1144,9 @@ device_suspend (uint32_t dev_id)
 
   cuda_api_suspend_device (dev_id);
 
+  if (!cuda_system_info.suspended_devices_mask)
+    ++cuda_state_stats.stops;
+
   dev->suspended = true;
 
   cuda_system_info.suspended_devices_mask |= (1 << dev_id);
@@ -754,7 +1156,6 @@ static void
 device_update_exception_state (uint32_t dev_id)
 {
   device_state_t *dev;
-  uint32_t sm_id;
 
   cuda_trace ("device %u: Looking for exception SMs\n");
   dev = device_get (dev_id);
@@ -767,10 +1168,16 @@ device_update_exception_state (uint32_t dev_id)
   if (device_is_any_context_present (dev_id))
     cuda_api_read_device_exception_state (dev_id, &dev->sm_exception_mask);
 
-  for (sm_id = 0; sm_id < device_get_num_sms (dev_id); ++sm_id)
-    if (!((dev->sm_exception_mask >> sm_id) & 1ULL))
-      sm_set_exception_none (dev_id, sm_id);
+  dev->sm_exception_mask_valid_p = true;
+}
+
+/* Set the exception state of the device from a remote stop snapshot */
+void
+device_set_exception_state (uint32_t dev_id, uint64_t sm_exception_mask)
+{
+  device_state_t *dev = device_get (dev_id);
 
+  dev->sm_exception_mask = sm_exception_mask;
   dev->sm_exception_mask_valid_p = true;
 }
 
@@ -787,6 +1194,12 @@ cuda_system_set_device_spec (uint32_t dev_id, uint32_t num_sms,
   gdb_assert (num_warps <= CUDBG_MAX_WARPS);
   gdb_assert (num_lanes <= CUDBG_MAX_LANES);
 
+  /* The state is sized from the device spec.  The stop report and the
+     block index list warps of the freed state. */
+  device_free_state (dev);
+  cuda_stop_report_invalidate ();
+  cuda_block_index_invalidate ();
+
   dev->num_sms         = num_sms;
   dev->num_warps       = num_warps;
   dev->num_lanes       = num_lanes;
@@ -811,31 +1224,89 @@ cuda_system_set_device_spec (uint32_t dev_id, uint32_t num_sms,
  *
  ******************************************************************************/
 
+/* Allocate the state of the SMs, warps and lanes of the device */
+static void
+device_alloc_state (uint32_t dev_id)
+{
+  device_state_t *dev       = device_get (dev_id);
+  uint32_t        num_sms   = device_get_num_sms (dev_id);
+  uint32_t        num_warps = device_get_num_warps (dev_id);
+  uint32_t        num_lanes = device_get_num_lanes (dev_id);
+  uint32_t        num_all_lanes = num_sms * num_warps * num_lanes;
+  uint32_t        sm_id, wp_id, i;
+  warp_state_t   *wp;
+
+  gdb_assert (!dev->sm);
+
+  dev->sm    = xcalloc (num_sms, sizeof *dev->sm);
+  dev->warps = xcalloc (num_sms * num_warps, sizeof *dev->warps);
+
+  dev->lanes.thread_idx = xcalloc (num_all_lanes, sizeof *dev->lanes.thread_idx);
+  dev->lanes.pc         = xcalloc (num_all_lanes, sizeof *dev->lanes.pc);
+  dev->lanes.exception  = xcalloc (num_all_lanes, sizeof *dev->lanes.exception);
+  dev->lanes.virtual_pc = xcalloc (num_all_lanes, sizeof *dev->lanes.virtual_pc);
+  dev->lanes.timestamp  = xcalloc (num_all_lanes, sizeof *dev->lanes.timestamp);
+
+  for (sm_id = 0; sm_id < num_sms; ++sm_id)
+    {
+      dev->sm[sm_id].wp = &dev->warps[sm_id * num_warps];
+
+      for (wp_id = 0; wp_id < num_warps; ++wp_id)
+        {
+          wp = &dev->sm[sm_id].wp[wp_id];
+          i  = (sm_id * num_warps + wp_id) * num_lanes;
+
+          wp->ln.thread_idx = &dev->lanes.thread_idx[i];
+          wp->ln.pc         = &dev->lanes.pc[i];
+          wp->ln.exception  = &dev->lanes.exception[i];
+          wp->ln.virtual_pc = &dev->lanes.virtual_pc[i];
+          wp->ln.timestamp  = &dev->lanes.timestamp[i];
+        }
+    }
+}
+
+static void
+sm_reset (sm_state_t *sm)
+{
+  sm->valid_warps_mask_p     = false;
+  sm->broken_warps_mask_p    = false;
+  sm->snapshot_p             = false;
+  sm->exception_warps_mask_p = false;
+}
+
 static inline sm_state_t *
 sm_get (uint32_t dev_id, uint32_t sm_id)
 {
+  device_state_t *dev = device_get (dev_id);
+  sm_state_t *sm;
+
   gdb_assert (sm_id < device_get_num_sms (dev_id));
 
-  return &device_get(dev_id)->sm[sm_id];
+  if (!dev->sm)
+    device_alloc_state (dev_id);
+
+  sm = &dev->sm[sm_id];
+  if (sm->epoch != dev->epoch)
+    {
+      sm_reset (sm);
+      sm->stepped_warps_mask = 0;
+      sm->epoch = dev->epoch;
+    }
+
+  return sm;
 }
 
 static void
-sm_invalidate (uint32_t dev_id, uint32_t sm_id, recursion_t recursion)
+sm_invalidate (uint32_t dev_id, uint32_t sm_id)
 {
   device_state_t *dev = device_get (dev_id);
   sm_state_t *sm = sm_get (dev_id, sm_id);
-  uint32_t wp_id;
 
   cuda_trace ("device %u sm %u: invalidate", dev_id, sm_id);
 
-  if (recursion == RECURSIVE)
-    for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
-      warp_invalidate (dev_id, sm_id, wp_id);
-
   dev->sm_exception_mask_valid_p = false;
 
-  sm->valid_warps_mask_p  = false;
-  sm->broken_warps_mask_p = false;
+  sm_reset (sm);
 }
 
 bool
@@ -859,6 +1330,137 @@ sm_has_exception (uint32_t dev_id, uint32_t sm_id)
   return (dev->sm_exception_mask >> sm_id) & 1ULL;
 }
 
+/* Populate the SM from a snapshot computed by the remote target.  STATES
+   holds the state of the valid warps, indexed by warp id, or is NULL when
+   only the masks are known.  Warps whose state is still cached are left
+   alone.  Returns the number of warps updated. */
+uint32_t
+sm_set_snapshot (uint32_t dev_id, uint32_t sm_id, uint64_t valid_warps_mask,
+                 uint64_t broken_warps_mask, const CUDBGWarpState *states)
+{
+  sm_state_t *sm = sm_get (dev_id, sm_id);
+  uint32_t    wp_id;
+  uint32_t    count = 0;
+
+  if (!sm->valid_warps_mask_p)
+    sm->valid_warps_mask = valid_warps_mask;
+  if (!sm->broken_warps_mask_p)
+    sm->broken_warps_mask = broken_warps_mask;
+  sm->valid_warps_mask_p  = CACHED;
+  sm->broken_warps_mask_p = CACHED;
+
+  if (!states)
+    return 0;
+
+  for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+    if (((sm->valid_warps_mask >> wp_id) & 1ULL) &&
+        ((valid_warps_mask >> wp_id) & 1ULL) &&
+        !warp_get (dev_id, sm_id, wp_id)->valid_lanes_mask_p)
+      {
+        warp_set_cached_info (dev_id, sm_id, wp_id, &states[wp_id]);
+        ++count;
+      }
+
+  sm->snapshot_p = CACHED;
+  return count;
+}
+
+/* Remote targets speaking binary packets return the masks and the state of
+   every valid warp of the SM in a single packet. */
+static bool
+sm_snapshot_remote (uint32_t dev_id, uint32_t sm_id)
+{
+  uint64_t        valid_warps_mask;
+  uint64_t        broken_warps_mask;
+  CUDBGWarpState *states;
+  struct cleanup *cleanups;
+
+  if (!cuda_remote || !cuda_remote_binary_packets ())
+    return false;
+
+  states = xmalloc (device_get_num_warps (dev_id) * sizeof *states);
+  cleanups = make_cleanup (xfree, states);
+
+  if (!cuda_remote_read_warp_state_in_sm (dev_id, sm_id, &valid_warps_mask,
+                                          &broken_warps_mask, states))
+    {
+      do_cleanups (cleanups);
+      return false;
+    }
+
+  ++cuda_state_stats.mask_reads;
+  cuda_state_stats.warp_state_reads +=
+    sm_set_snapshot (dev_id, sm_id, valid_warps_mask, broken_warps_mask, states);
+  ++cuda_state_stats.snapshots;
+
+  do_cleanups (cleanups);
+  return true;
+}
+
+/* Read the valid and broken warp masks of the SM together with the state of
+   every valid warp, so that later queries on the SM are answered from the
+   cache.  Warps whose state is still cached are not read again.  The reads
+   are batched: one round trip for the masks, one for the warp states. */
+static void
+sm_snapshot (uint32_t dev_id, uint32_t sm_id)
+{
+  sm_state_t     *sm = sm_get (dev_id, sm_id);
+  warp_state_t   *wp;
+  uint32_t        wp_id;
+  uint64_t        read_mask = 0;
+  CUDBGWarpState *states;
+  struct cleanup *cleanups;
+
+  cuda_trace ("device %u sm %u: snapshot", dev_id, sm_id);
+
+  if (sm_snapshot_remote (dev_id, sm_id))
+    return;
+
+  cuda_api_batch_begin ();
+  if (!sm->valid_warps_mask_p)
+    {
+      cuda_api_batch_read_valid_warps (dev_id, sm_id, &sm->valid_warps_mask);
+      ++cuda_state_stats.mask_reads;
+    }
+  if (!sm->broken_warps_mask_p)
+    {
+      cuda_api_batch_read_broken_warps (dev_id, sm_id, &sm->broken_warps_mask);
+      ++cuda_state_stats.mask_reads;
+    }
+  cuda_api_batch_flush ();
+
+  sm->valid_warps_mask_p  = CACHED;
+  sm->broken_warps_mask_p = CACHED;
+
+  states = xmalloc (device_get_num_warps (dev_id) * sizeof *states);
+  cleanups = make_cleanup (xfree, states);
+
+  cuda_api_batch_begin ();
+  for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+    {
+      if (!((sm->valid_warps_mask >> wp_id) & 1ULL))
+        continue;
+
+      wp = warp_get (dev_id, sm_id, wp_id);
+      if (wp->valid_lanes_mask_p)
+        continue;
+
+      cuda_api_batch_read_warp_state (dev_id, sm_id, wp_id, &states[wp_id]);
+      ++cuda_state_stats.warp_state_reads;
+      read_mask |= 1ULL << wp_id;
+    }
+  cuda_api_batch_flush ();
+
+  for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+    if ((read_mask >> wp_id) & 1ULL)
+      warp_set_cached_info (dev_id, sm_id, wp_id, &states[wp_id]);
+
+  do_cleanups (cleanups);
+
+  sm->snapshot_p = CACHED;
+  ++cuda_state_stats.snapshots;
+}
+
 uint64_t
 sm_get_valid_warps_mask (uint32_t dev_id, uint32_t sm_id)
 {
@@ -868,7 +1470,15 @@ sm_get_valid_warps_mask (uint32_t dev_id, uint32_t sm_id)
   if (sm->valid_warps_mask_p)
     return sm->valid_warps_mask;
 
+  if (cuda_options_state_snapshot_eager () ||
+      (cuda_remote && cuda_remote_binary_packets ()))
+    {
+      sm_snapshot (dev_id, sm_id);
+      return sm->valid_warps_mask;
+    }
+
   cuda_api_read_valid_warps (dev_id, sm_id, &valid_warps_mask);
+  ++cuda_state_stats.mask_reads;
 
   sm->valid_warps_mask   = valid_warps_mask;
   sm->valid_warps_mask_p = CACHED;
@@ -885,7 +1495,15 @@ sm_get_broken_warps_mask (uint32_t dev_id, uint32_t sm_id)
   if (sm->broken_warps_mask_p)
     return sm->broken_warps_mask;
 
+  if (cuda_options_state_snapshot_eager () ||
+      (cuda_remote && cuda_remote_binary_packets ()))
+    {
+      sm_snapshot (dev_id, sm_id);
+      return sm->broken_warps_mask;
+    }
+
   cuda_api_read_broken_warps (dev_id, sm_id, &broken_warps_mask);
+  ++cuda_state_stats.mask_reads;
 
   sm->broken_warps_mask   = broken_warps_mask;
   sm->broken_warps_mask_p = CACHED;
@@ -893,18 +1511,44 @@ sm_get_broken_warps_mask (uint32_t dev_id, uint32_t sm_id)
   return broken_warps_mask;
 }
 
-static void
-sm_set_exception_none (uint32_t dev_id, uint32_t sm_id)
+/* The mask of the valid warps of the SM whose active lanes are at a
+   breakpoint, from the stop report. */
+uint64_t
+sm_get_breakpoint_warps_mask (uint32_t dev_id, uint32_t sm_id)
+{
+  const cuda_stop_warp_t *warps;
+
+  cuda_system_get_stop_report (&warps);
+
+  return sm_get (dev_id, sm_id)->breakpoint_warps_mask;
+}
+
+/* The mask of the valid warps of the SM with a lane exception.  Empty
+   unless the SM is flagged in the device exception mask. */
+uint64_t
+sm_get_exception_warps_mask (uint32_t dev_id, uint32_t sm_id)
 {
   sm_state_t *sm = sm_get (dev_id, sm_id);
-  uint32_t wp_id;
-  uint32_t ln_id;
+  uint64_t    valid_warps_mask;
+  uint32_t    wp_id;
 
-  cuda_trace ("device %u sm %u: setting no exceptions", dev_id, sm_id);
+  if (sm->exception_warps_mask_p)
+    return sm->exception_warps_mask;
 
-  for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
-    for (ln_id = 0; ln_id < device_get_num_lanes (dev_id); ++ln_id)
-      lane_set_exception_none (dev_id, sm_id, wp_id, ln_id);
+  sm->exception_warps_mask = 0;
+
+  if (sm_has_exception (dev_id, sm_id))
+    {
+      valid_warps_mask = sm_get_valid_warps_mask (dev_id, sm_id);
+      for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+        if (((valid_warps_mask >> wp_id) & 1ULL) &&
+            warp_get_exception_lanes_mask (dev_id, sm_id, wp_id))
+          sm->exception_warps_mask |= 1ULL << wp_id;
+    }
+
+  sm->exception_warps_mask_p = CACHED;
+
+  return sm->exception_warps_mask;
 }
 
 /******************************************************************************
@@ -913,40 +1557,87 @@ sm_set_exception_none (uint32_t dev_id, uint32_t sm_id)
  *
  ******************************************************************************/
 
+static void
+warp_reset (warp_state_t *wp)
+{
+  ++cuda_state_stats.warp_resets;
+
+  wp->ln.thread_idx_p = 0;
+  wp->ln.pc_p         = 0;
+  wp->ln.exception_p  = 0;
+  wp->ln.virtual_pc_p = 0;
+  wp->ln.timestamp_p  = 0;
+
+  wp->reg_cache_lanes_mask = 0;
+
+  wp->valid_p             = false;
+  wp->broken_p            = false;
+  wp->block_idx_p         = false;
+  wp->kernel_p            = false;
+  wp->grid_id_p           = false;
+  wp->valid_lanes_mask_p  = false;
+  wp->active_lanes_mask_p = false;
+  wp->timestamp_p         = false;
+  wp->error_pc_p          = false;
+  wp->exception_lanes_mask_p = false;
+}
+
 static inline warp_state_t *
 warp_get (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
 {
+  device_state_t *dev = device_get (dev_id);
+  warp_state_t *wp;
+
   gdb_assert (wp_id < device_get_num_warps (dev_id));
 
-  return &sm_get(dev_id, sm_id)->wp[wp_id];
+  wp = &sm_get (dev_id, sm_id)->wp[wp_id];
+  if (wp->epoch != dev->epoch)
+    {
+      warp_reset (wp);
+      wp->epoch = dev->epoch;
+    }
+
+  return wp;
 }
 
 static void
 warp_invalidate (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
 {
-  sm_state_t   *sm = sm_get (dev_id, sm_id);
-  warp_state_t *wp = warp_get (dev_id, sm_id, wp_id);
-  uint32_t      ln_id;
+  device_state_t *dev = device_get (dev_id);
+  sm_state_t     *sm = sm_get (dev_id, sm_id);
 
+  gdb_assert (wp_id < device_get_num_warps (dev_id));
 
-  for (ln_id = 0; ln_id < device_get_num_lanes (dev_id); ++ln_id)
-    lane_invalidate (dev_id, sm_id, wp_id, ln_id);
+  /* Put the warp behind the device epoch, it is reset when next used */
+  sm->wp[wp_id].epoch = dev->epoch - 1;
 
   // XXX decouple the masks from the SM state data structure to avoid this
   // little hack.
   /* If a warp is invalidated, we have to invalidate the warp masks in the
      corresponding SM. */
-  sm->valid_warps_mask_p  = false;
-  sm->broken_warps_mask_p = false;
+  sm->valid_warps_mask_p     = false;
+  sm->broken_warps_mask_p    = false;
+  sm->exception_warps_mask_p = false;
+}
 
-  wp->valid_p             = false;
-  wp->broken_p            = false;
-  wp->block_idx_p         = false;
-  wp->kernel_p            = false;
-  wp->grid_id_p           = false;
-  wp->valid_lanes_mask_p  = false;
-  wp->active_lanes_mask_p = false;
-  wp->timestamp_p         = false;
+/* Invalidate the warps of WP_MASK and the SM they live in, e.g. after they
+   were single-stepped.  The state of the other warps is kept. */
+static void
+warps_invalidate (uint32_t dev_id, uint32_t sm_id, uint64_t wp_mask)
+{
+  uint32_t wp_id;
+
+  for (wp_id = 0; wp_id < device_get_num_warps (dev_id); ++wp_id)
+    if ((wp_mask >> wp_id) & 1ULL)
+      warp_invalidate (dev_id, sm_id, wp_id);
+
+  /* must invalidate the SM since that's where the warp valid mask lives */
+  sm_invalidate (dev_id, sm_id);
+
+  /* The warps may have stepped onto a breakpoint without being broken */
+  sm_get (dev_id, sm_id)->stepped_warps_mask |= wp_mask;
+  cuda_stop_report_invalidate ();
+  cuda_block_index_invalidate ();
 }
 
 bool
@@ -965,18 +1656,17 @@ warps_resume_until (uint32_t dev_id, uint32_t sm_id, uint64_t mask, uint64_t pc)
   if (!cuda_api_resume_warps_until_pc (dev_id, sm_id, mask, pc))
     return false;
 
+  /* The warps may have written to memory, but not to the read-only segments */
+  cuda_memcache_invalidate_device (dev_id, true);
+
   if (cuda_options_software_preemption ())
     {
       device_invalidate (dev_id);
+      device_get (dev_id)->preempted_step_p = true;
       return true;
     }
   /* invalidate the cache for the warps that have been single-stepped. */
-  for (i = 0; i < device_get_num_warps (dev_id); ++i)
-       if (((mask>>i)&1) != 0)
-          warp_invalidate (dev_id, sm_id, i);
-
-  /* must invalidate the SM since that's where the warp valid mask lives */
-  sm_invalidate (dev_id, sm_id, NON_RECURSIVE);
+  warps_invalidate (dev_id, sm_id, mask);
 
   return true;
 }
@@ -988,7 +1678,6 @@ warp_single_step (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
   kernel_t kernel;
   uint64_t kernel_id;
   CuDim3   block_idx;
-  uint32_t i;
   bool rc;
 
   cuda_trace ("device %u sm %u warp %u: single-step", dev_id, sm_id, wp_id);
@@ -1003,25 +1692,21 @@ warp_single_step (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
   if (!rc)
     return rc;
 
+  cuda_memcache_invalidate_device (dev_id, true);
+
   if (cuda_options_software_preemption ())
     {
       device_invalidate (dev_id);
+      device_get (dev_id)->preempted_step_p = true;
       return true;
     }
 
   if (*single_stepped_warp_mask & ~(1ULL << wp_id))
-    {
-      warning ("Warp(s) other than the current warp had to be single-stepped.");
-      device_invalidate (dev_id);
-    }
+    warning ("Warp(s) other than the current warp had to be single-stepped.");
 
-  /* invalidate the cache for the warps that have been single-stepped. */
-  for (i = 0; i < device_get_num_warps (dev_id); ++i)
-    if ((1ULL << i) & *single_stepped_warp_mask)
-      warp_invalidate (dev_id, sm_id, i);
-
-  /* must invalidate the SM since that's where the warp valid mask lives */
-  sm_invalidate (dev_id, sm_id, NON_RECURSIVE);
+  /* invalidate the cache for the warps that have been single-stepped,
+     including the ones stepped along with the current warp. */
+  warps_invalidate (dev_id, sm_id, *single_stepped_warp_mask);
 
   return true;
 }
@@ -1061,10 +1746,15 @@ warp_has_error_pc (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
   bool error_pc_available = false;
   uint64_t error_pc = 0ULL;
 
-  //if (wp->error_pc_p)
-  //  return wp->error_pc_available;
+  /* The error PC is part of the warp state read by the SM snapshot */
+  if (wp->error_pc_p && sm_get (dev_id, sm_id)->snapshot_p)
+    {
+      ++cuda_state_stats.saved;
+      return wp->error_pc_available;
+    }
 
   cuda_api_read_error_pc (dev_id, sm_id, wp_id, &error_pc, &error_pc_available);
+  ++cuda_state_stats.error_pc_reads;
 
   wp->error_pc = error_pc;
   wp->error_pc_available = error_pc_available;
@@ -1074,45 +1764,49 @@ warp_has_error_pc (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
 }
 
 static void
-update_warp_cached_info (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
+warp_set_cached_info (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
+                      const CUDBGWarpState *state)
 {
-  lane_state_t *ln;
   warp_state_t *wp = warp_get (dev_id, sm_id, wp_id);
-  CUDBGWarpState state;
+  lane_state_t *ln = &wp->ln;
   uint32_t ln_id;
 
-  cuda_api_read_warp_state (dev_id, sm_id, wp_id, &state);
-
-  wp->error_pc = state.errorPC;
-  wp->error_pc_available = state.errorPCValid;
+  wp->error_pc = state->errorPC;
+  wp->error_pc_available = state->errorPCValid;
   wp->error_pc_p = CACHED;
 
-  wp->block_idx = state.blockIdx;
+  wp->block_idx = state->blockIdx;
   wp->block_idx_p = CACHED;
 
-  wp->grid_id = state.gridId;
+  wp->grid_id = state->gridId;
   wp->grid_id_p = CACHED;
 
-  wp->active_lanes_mask   = state.activeLanes;
+  wp->active_lanes_mask   = state->activeLanes;
   wp->active_lanes_mask_p = CACHED;
 
-  wp->valid_lanes_mask   = state.validLanes;
+  wp->valid_lanes_mask   = state->validLanes;
   wp->valid_lanes_mask_p = CACHED;
 
+  wp->exception_lanes_mask = 0;
+
   for (ln_id = 0; ln_id < device_get_num_lanes (dev_id); ln_id++) {
-    ln = &wp->ln[ln_id];
-    if ( !(state.validLanes & (1U<<ln_id)) ) continue;
-    ln->thread_idx = state.lane[ln_id].threadIdx;
-    ln->virtual_pc = state.lane[ln_id].virtualPC;
-    ln->exception = state.lane[ln_id].exception;
-    ln->exception_p = ln->thread_idx_p = ln->virtual_pc_p = CACHED;
-
-    if (!ln->timestamp_p)
-      {
-        ln->timestamp_p = true;
-        ln->timestamp = cuda_clock ();
-      }
+    if ( !(state->validLanes & (1U<<ln_id)) ) continue;
+    ln->thread_idx[ln_id] = state->lane[ln_id].threadIdx;
+    ln->virtual_pc[ln_id] = state->lane[ln_id].virtualPC;
+    ln->exception[ln_id] = state->lane[ln_id].exception;
+
+    if (ln->exception[ln_id] != CUDBG_EXCEPTION_NONE)
+      wp->exception_lanes_mask |= 1U << ln_id;
+
+    if (!(ln->timestamp_p & (1U << ln_id)))
+      ln->timestamp[ln_id] = cuda_clock ();
   }
+  wp->exception_lanes_mask_p = CACHED;
+
+  ln->exception_p  |= state->validLanes;
+  ln->thread_idx_p |= state->validLanes;
+  ln->virtual_pc_p |= state->validLanes;
+  ln->timestamp_p  |= state->validLanes;
   if (!wp->timestamp_p)
     {
       wp->timestamp_p = true;
@@ -1120,6 +1814,17 @@ update_warp_cached_info (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
     }
 }
 
+static void
+update_warp_cached_info (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
+{
+  CUDBGWarpState state;
+
+  cuda_api_read_warp_state (dev_id, sm_id, wp_id, &state);
+  ++cuda_state_stats.warp_state_reads;
+
+  warp_set_cached_info (dev_id, sm_id, wp_id, &state);
+}
+
 uint64_t
 warp_get_grid_id (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
 {
@@ -1220,6 +1925,23 @@ warp_get_active_lanes_mask (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
   return wp->active_lanes_mask;
 }
 
+/* The mask of the valid lanes of the warp with an exception */
+uint32_t
+warp_get_exception_lanes_mask (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
+{
+  warp_state_t *wp = warp_get (dev_id, sm_id, wp_id);
+
+  if (wp->exception_lanes_mask_p)
+    return wp->exception_lanes_mask;
+
+  if (!sm_has_exception (dev_id, sm_id) || !warp_is_valid (dev_id, sm_id, wp_id))
+    return 0;
+
+  update_warp_cached_info (dev_id, sm_id, wp_id);
+
+  return wp->exception_lanes_mask;
+}
+
 uint32_t
 warp_get_divergent_lanes_mask (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
 {
@@ -1296,13 +2018,15 @@ warp_get_error_pc (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id)
   bool error_pc_available = false;
   uint64_t error_pc = 0ULL;
 
-  /*if (wp->error_pc_p)
+  if (wp->error_pc_p && wp->error_pc_available
+      && sm_get (dev_id, sm_id)->snapshot_p)
     {
-      gdb_assert (wp->error_pc_available);
+      ++cuda_state_stats.saved;
       return wp->error_pc;
     }
-*/
+
   cuda_api_read_error_pc (dev_id, sm_id, wp_id, &error_pc, &error_pc_available);
+  ++cuda_state_stats.error_pc_reads;
 
   wp->error_pc = error_pc;
   wp->error_pc_available = error_pc_available;
@@ -1351,42 +2075,100 @@ warp_set_block_idx (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, CuDim3 *blo
 static cuda_reg_cache_element_t *
 cuda_reg_cache_find_element (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id)
 {
-  int idx;
+  warp_state_t   *wp  = warp_get (dev_id, sm_id, wp_id);
   cuda_reg_cache_element_t *elem;
-  cuda_reg_cache_element_t new_elem;
 
-  for (idx = 0;
-       VEC_iterate (cuda_reg_cache_element_t, cuda_register_cache, idx, elem);
-       ++idx)
-    if (elem->dev == dev_id && elem->sm == sm_id &&
-        elem->wp == wp_id && elem->ln == ln_id)
+  gdb_assert (ln_id < device_get_num_lanes (dev_id));
+
+  ++cuda_reg_cache_stats.lookups;
+
+  if (!wp->reg_cache)
+    wp->reg_cache = xcalloc (device_get_num_lanes (dev_id), sizeof *wp->reg_cache);
+
+  elem = &wp->reg_cache[ln_id];
+  if (wp->reg_cache_lanes_mask & (1U << ln_id))
+    {
+      ++cuda_reg_cache_stats.hits;
       return elem;
+    }
 
-  memset (&new_elem, 0, sizeof(new_elem));
-  new_elem.dev = dev_id;
-  new_elem.sm = sm_id;
-  new_elem.wp = wp_id;
-  new_elem.ln = ln_id;
+  memset (elem, 0, sizeof *elem);
+  wp->reg_cache_lanes_mask |= 1U << ln_id;
+  ++cuda_reg_cache_stats.fills;
 
-  return VEC_safe_push (cuda_reg_cache_element_t, cuda_register_cache, &new_elem);
+  return elem;
 }
 
-static void
-cuda_reg_cache_remove_element (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id)
+/* Number of lanes with a valid register cache element.  Warps behind the
+   epoch of their device are only reset when next used, their elements do
+   not count. */
+static uint64_t
+cuda_reg_cache_count_lanes (void)
 {
-  int idx;
-  cuda_reg_cache_element_t *elem;
+  device_state_t *dev;
+  uint64_t count = 0;
+  uint32_t dev_id, i;
 
-  for (idx = 0;
-       VEC_iterate (cuda_reg_cache_element_t, cuda_register_cache, idx, elem);
-       ++idx)
+  for (dev_id = 0; dev_id < CUDBG_MAX_DEVICES; ++dev_id)
     {
-       if (elem->dev != dev_id || elem->sm != sm_id ||
-           elem->wp != wp_id || elem->ln != ln_id)
-         continue;
-         VEC_unordered_remove(cuda_reg_cache_element_t, cuda_register_cache, idx);
-         break;
+      dev = cuda_system_info.dev[dev_id];
+      if (!dev || !dev->sm)
+        continue;
+
+      for (i = 0; i < dev->num_sms * dev->num_warps; ++i)
+        if (dev->warps[i].epoch == dev->epoch)
+          count += __builtin_popcount (dev->warps[i].reg_cache_lanes_mask);
     }
+
+  return count;
+}
+
+void
+cuda_system_print_statistics (void)
+{
+  uint64_t stops = max (cuda_state_stats.stops, 1);
+  uint64_t requests, round_trips;
+
+  printf_unfiltered (_("Register cache: %llu lookups, %llu hits, "
+                       "%llu fills, %llu lanes cached\n"),
+                     (unsigned long long) cuda_reg_cache_stats.lookups,
+                     (unsigned long long) cuda_reg_cache_stats.hits,
+                     (unsigned long long) cuda_reg_cache_stats.fills,
+                     (unsigned long long) cuda_reg_cache_count_lanes ());
+  printf_unfiltered (_("Warp state: %llu stops, %llu SM snapshots, "
+                       "%llu mask reads, %llu warp state reads, "
+                       "%llu error PC reads\n"),
+                     (unsigned long long) cuda_state_stats.stops,
+                     (unsigned long long) cuda_state_stats.snapshots,
+                     (unsigned long long) cuda_state_stats.mask_reads,
+                     (unsigned long long) cuda_state_stats.warp_state_reads,
+                     (unsigned long long) cuda_state_stats.error_pc_reads);
+  printf_unfiltered (_("Warp state invalidations: %llu devices, "
+                       "%llu warps reset\n"),
+                     (unsigned long long) cuda_state_stats.invalidations,
+                     (unsigned long long) cuda_state_stats.warp_resets);
+  printf_unfiltered (_("Stop reports: %llu built, %llu warps listed, "
+                       "%llu breakpoint lookups\n"),
+                     (unsigned long long) cuda_stop_report_stats.builds,
+                     (unsigned long long) cuda_stop_report_stats.warps,
+                     (unsigned long long) cuda_stop_report_stats.pc_lookups);
+  printf_unfiltered (_("Block indexes: %llu built, %llu blocks indexed\n"),
+                     (unsigned long long) cuda_block_index_stats.builds,
+                     (unsigned long long) cuda_block_index_stats.blocks);
+  printf_unfiltered (_("Warp state round trips per stop: %.1f, "
+                       "saved per stop: %.1f\n"),
+                     (double) (cuda_state_stats.mask_reads
+                               + cuda_state_stats.warp_state_reads
+                               + cuda_state_stats.error_pc_reads) / stops,
+                     (double) cuda_state_stats.saved / stops);
+
+  cudbgipcGetMessageStats (&requests, &round_trips);
+  printf_unfiltered (_("Debugger API: %llu requests in %llu round trips, "
+                       "per stop: %.1f requests, %.1f round trips\n"),
+                     (unsigned long long) requests,
+                     (unsigned long long) round_trips,
+                     (double) requests / stops,
+                     (double) round_trips / stops);
 }
 
 /******************************************************************************
@@ -1395,27 +2177,13 @@ cuda_reg_cache_remove_element (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
  *
  ******************************************************************************/
 
+/* Return the state of the lanes of the warp of lane LN_ID */
 static inline lane_state_t *
 lane_get (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id)
 {
   gdb_assert (ln_id < device_get_num_lanes (dev_id));
 
-  return &warp_get(dev_id, sm_id, wp_id)->ln[ln_id];
-}
-
-static void
-lane_invalidate (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id)
-{
-  lane_state_t *ln = lane_get (dev_id, sm_id, wp_id, ln_id);
-
-
-  ln->pc_p         = false;
-  ln->virtual_pc_p = false;
-  ln->thread_idx_p = false;
-  ln->exception_p  = false;
-  ln->timestamp_p  = false;
-
-  cuda_reg_cache_remove_element (dev_id, sm_id, wp_id, ln_id);
+  return &warp_get(dev_id, sm_id, wp_id)->ln;
 }
 
 bool
@@ -1428,10 +2196,10 @@ lane_is_valid (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id)
   valid_lanes_mask = warp_get_valid_lanes_mask (dev_id, sm_id, wp_id);
   valid = (valid_lanes_mask >> ln_id) & 1;
 
-  if (!ln->timestamp_p)
+  if (!(ln->timestamp_p & (1U << ln_id)))
     {
-      ln->timestamp_p = true;
-      ln->timestamp = cuda_clock ();
+      ln->timestamp_p |= 1U << ln_id;
+      ln->timestamp[ln_id] = cuda_clock ();
     }
 
   return valid;
@@ -1473,16 +2241,16 @@ lane_get_thread_idx (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t l
 
   /* In a remote session, we fetch the threadIdx of all valid thread in the warp using
    * one rsp packet to reduce the amount of communication. */
-  if (cuda_remote && !(ln->thread_idx_p)
+  if (cuda_remote && !(ln->thread_idx_p & (1U << ln_id))
       && warp_is_valid (dev_id, sm_id, wp_id))
     cuda_remote_update_thread_idx_in_warp (dev_id, sm_id, wp_id);
 
-  if (ln->thread_idx_p)
-    return ln->thread_idx;
+  if (ln->thread_idx_p & (1U << ln_id))
+    return ln->thread_idx[ln_id];
 
   update_warp_cached_info (dev_id, sm_id, wp_id);
 
-  return ln->thread_idx;
+  return ln->thread_idx[ln_id];
 }
 
 uint64_t
@@ -1490,43 +2258,82 @@ lane_get_virtual_pc (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t l
 {
   lane_state_t *ln = lane_get (dev_id, sm_id, wp_id, ln_id);
 
-  if (ln->virtual_pc_p)
-    return ln->virtual_pc;
+  if (ln->virtual_pc_p & (1U << ln_id))
+    return ln->virtual_pc[ln_id];
 
   update_warp_cached_info (dev_id, sm_id, wp_id);
 
-  return ln->virtual_pc;
+  return ln->virtual_pc[ln_id];
 }
 
 uint64_t
 lane_get_pc (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id)
 {
   lane_state_t *ln = lane_get (dev_id, sm_id, wp_id, ln_id);
-  warp_state_t *wp = warp_get (dev_id, sm_id, wp_id);
   uint64_t      pc;
-  uint32_t      other_ln_id;
+  uint64_t      pcs[CUDBG_MAX_LANES];
+  CUDBGResult   results[CUDBG_MAX_LANES];
+  uint32_t      other_ln_id, active_ln_id;
+  uint32_t      valid_lanes_mask, active_lanes_mask;
+  uint32_t      read_lanes_mask;
 
   gdb_assert (lane_is_valid (dev_id, sm_id, wp_id, ln_id));
 
-  if (ln->pc_p)
-    return ln->pc;
+  if (ln->pc_p & (1U << ln_id))
+    return ln->pc[ln_id];
 
-  cuda_api_read_pc (dev_id, sm_id, wp_id, ln_id, &pc);
+  valid_lanes_mask  = warp_get_valid_lanes_mask (dev_id, sm_id, wp_id);
+  active_lanes_mask = warp_get_active_lanes_mask (dev_id, sm_id, wp_id);
 
-  ln->pc_p = CACHED;
-  ln->pc   = pc;
+  /* The lanes of a warp are usually walked one after the other.  When the
+     reads can be pipelined, read the PC of every valid lane still missing
+     one along with LN_ID, in a single batch.  All the active lanes share the
+     same PC: only one of them is read.  Only a failure to read the PC of
+     LN_ID is an error, the other lanes are then just left uncached. */
+  cuda_api_batch_begin ();
+  cuda_api_batch_read_pc (dev_id, sm_id, wp_id, ln_id, &pcs[ln_id]);
+  read_lanes_mask = 1U << ln_id;
 
-  /* Optimization: all the active lanes share the same virtual PC */
-  if (lane_is_active (dev_id, sm_id, wp_id, ln_id))
+  if (cuda_api_batch_supported ())
     for (other_ln_id = 0; other_ln_id < device_get_num_lanes (dev_id); ++other_ln_id)
-      if (lane_is_valid (dev_id, sm_id, wp_id, other_ln_id) &&
-          lane_is_active (dev_id, sm_id, wp_id, other_ln_id))
+      {
+        if (!((valid_lanes_mask >> other_ln_id) & 1) ||
+            ((ln->pc_p | read_lanes_mask) >> other_ln_id) & 1)
+          continue;
+        if (((active_lanes_mask >> other_ln_id) & 1) &&
+            (read_lanes_mask & active_lanes_mask))
+          continue;
+
+        cuda_api_batch_try_read_pc (dev_id, sm_id, wp_id, other_ln_id,
+                                    &pcs[other_ln_id], &results[other_ln_id]);
+        read_lanes_mask |= 1U << other_ln_id;
+      }
+  cuda_api_batch_flush ();
+  results[ln_id] = CUDBG_SUCCESS;
+
+  for (other_ln_id = 0; other_ln_id < device_get_num_lanes (dev_id); ++other_ln_id)
+    {
+      if (!((read_lanes_mask >> other_ln_id) & 1) ||
+          results[other_ln_id] != CUDBG_SUCCESS)
+        continue;
+
+      pc = pcs[other_ln_id];
+      if (!((active_lanes_mask >> other_ln_id) & 1))
         {
-          wp->ln[other_ln_id].pc_p = CACHED;
-          wp->ln[other_ln_id].pc   = pc;
+          ln->pc_p |= 1U << other_ln_id;
+          ln->pc[other_ln_id] = pc;
+          continue;
         }
 
-  return ln->pc;
+      for (active_ln_id = 0; active_ln_id < device_get_num_lanes (dev_id); ++active_ln_id)
+        if ((valid_lanes_mask & active_lanes_mask) >> active_ln_id & 1)
+          {
+            ln->pc_p |= 1U << active_ln_id;
+            ln->pc[active_ln_id] = pc;
+          }
+    }
+
+  return ln->pc[ln_id];
 }
 
 CUDBGException_t
@@ -1537,12 +2344,16 @@ lane_get_exception (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln
 
   gdb_assert (lane_is_valid (dev_id, sm_id, wp_id, ln_id));
 
-  if (ln->exception_p)
-    return ln->exception;
+  /* Lanes of the SMs not flagged in the device exception mask are healthy */
+  if (!sm_has_exception (dev_id, sm_id))
+    return CUDBG_EXCEPTION_NONE;
+
+  if (ln->exception_p & (1U << ln_id))
+    return ln->exception[ln_id];
 
   update_warp_cached_info (dev_id, sm_id, wp_id);
 
-  return ln->exception;
+  return ln->exception[ln_id];
 }
 
 uint32_t
@@ -1550,12 +2361,16 @@ lane_get_register (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_
                    uint32_t regno)
 {
   uint32_t value;
+  uint32_t first, count, num_regs, i;
   cuda_reg_cache_element_t *elem;
 
   gdb_assert (lane_is_valid (dev_id, sm_id, wp_id, ln_id));
 
-  /* If register can not be cached - read it directly */
-  if (regno > CUDBG_CACHED_REGISTERS_COUNT)
+  /* If register can not be cached - read it directly.  A register past the
+     register file of the device is read alone, and left to the API to
+     reject. */
+  num_regs = device_get_num_registers (dev_id);
+  if (regno >= CUDBG_CACHED_REGISTERS_COUNT || regno >= num_regs)
     {
       cuda_api_read_register (dev_id, sm_id, wp_id, ln_id, regno, &value);
       return value;
@@ -1565,14 +2380,26 @@ lane_get_register (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_
   if ( (elem->register_valid_mask[regno>>5]&(1UL<<(regno&31))) != 0)
     return elem->registers[regno];
 
-  if (regno < 32)
-  {
-    cuda_api_read_register_range (dev_id, sm_id, wp_id, ln_id, regno&~31, 32, &elem->registers[regno&~31]);
-    elem->register_valid_mask[regno>>5]|=0xffffffff;
-  } else {
-    cuda_api_read_register (dev_id, sm_id, wp_id, ln_id, regno, &elem->registers[regno]);
-    elem->register_valid_mask[regno>>5]|=1UL<<(regno&31);
-  }
+  /* Fill the cache a block of 32 registers at a time.  Every request is a
+     round trip to a remote target, so there the whole cached register file
+     of the lane is read at once. */
+  if (cuda_remote)
+    {
+      first = 0;
+      count = CUDBG_CACHED_REGISTERS_COUNT;
+    }
+  else
+    {
+      first = regno & ~31;
+      count = 32;
+    }
+  if (first + count > num_regs)
+    count = num_regs - first;
+
+  cuda_api_read_register_range (dev_id, sm_id, wp_id, ln_id, first, count,
+                                &elem->registers[first]);
+  for (i = first; i < first + count; ++i)
+    elem->register_valid_mask[i>>5] |= 1UL << (i&31);
 
   return elem->registers[regno];
 }
@@ -1587,7 +2414,7 @@ lane_set_register (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_
 
   cuda_api_write_register (dev_id, sm_id, wp_id, ln_id, regno, value);
   /* If register can not be cached - read it directly */
-  if (regno > CUDBG_CACHED_REGISTERS_COUNT)
+  if (regno >= CUDBG_CACHED_REGISTERS_COUNT)
       return;
 
   elem = cuda_reg_cache_find_element (dev_id, sm_id, wp_id, ln_id);
@@ -1717,9 +2544,9 @@ lane_get_timestamp (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,uint32_t ln_
 {
   lane_state_t *ln = lane_get (dev_id, sm_id, wp_id, ln_id);;
 
-  gdb_assert (ln->timestamp_p);
+  gdb_assert (ln->timestamp_p & (1U << ln_id));
 
-  return ln->timestamp;
+  return ln->timestamp[ln_id];
 }
 
 uint64_t
@@ -1767,16 +2594,22 @@ lane_set_thread_idx (uint32_t dev_id, uint32_t sm_id,
   gdb_assert (cuda_remote);
   gdb_assert (lane_is_valid (dev_id, sm_id, wp_id, ln_id));
 
-  ln->thread_idx = *thread_idx;
-  ln->thread_idx_p = true;
+  ln->thread_idx[ln_id] = *thread_idx;
+  ln->thread_idx_p |= 1U << ln_id;
 }
 
 static void
-lane_set_exception_none (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
-                         uint32_t ln_id)
+cuda_state_breakpoint_changed (struct breakpoint *b)
 {
-  lane_state_t *ln = lane_get (dev_id, sm_id, wp_id, ln_id);
+  cuda_stop_report_invalidate ();
+}
 
-  ln->exception = CUDBG_EXCEPTION_NONE;
-  ln->exception_p = true;
+void _initialize_cuda_state (void);
+
+void
+_initialize_cuda_state (void)
+{
+  observer_attach_breakpoint_created (cuda_state_breakpoint_changed);
+  observer_attach_breakpoint_deleted (cuda_state_breakpoint_changed);
+  observer_attach_breakpoint_modified (cuda_state_breakpoint_changed);
 }
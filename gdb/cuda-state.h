@@ -30,9 +30,37 @@ uint32_t cuda_system_get_num_present_kernels      (void);
 void     cuda_system_resolve_breakpoints          (int bp_number_from);
 void     cuda_system_cleanup_breakpoints          (void);
 void     cuda_system_cleanup_contexts             (void);
+/* A warp of the stop report: a broken warp, or a warp single-stepped since
+   the devices were resumed. */
+typedef struct {
+  uint32_t dev;
+  uint32_t sm;
+  uint32_t wp;
+  uint64_t pc;                  // virtual PC of the active lanes
+  uint32_t active_lanes_mask;
+  bool     broken;
+  bool     at_breakpoint;       // the active lanes are at a breakpoint
+} cuda_stop_warp_t;
+
+/* The warps of a resident block on one SM, see cuda_system_get_block_index */
+typedef struct {
+  uint64_t kernel_id;
+  uint64_t grid_id;
+  CuDim3   block_idx;
+  uint32_t dev;
+  uint32_t sm;
+  uint64_t warps_mask;
+} cuda_block_warps_t;
+
 bool     cuda_system_is_broken                    (cuda_clock_t);
+uint32_t cuda_system_get_stop_report              (const cuda_stop_warp_t **warps);
+uint32_t cuda_system_get_block_index              (const cuda_block_warps_t **blocks);
+int      cuda_block_warps_compare                 (const cuda_block_warps_t *b1,
+                                                   const cuda_block_warps_t *b2);
+bool     cuda_system_has_lane_exception           (void);
 uint32_t cuda_system_get_suspended_devices_mask   (void);
 void     cuda_system_flush_disasm_cache           (void);
+void     cuda_system_print_statistics             (void);
 
 void     cuda_system_set_device_spec    (uint32_t, uint32_t, uint32_t,
                                          uint32_t, uint32_t, char *, char *);
@@ -56,6 +84,7 @@ bool        device_is_valid                (uint32_t dev_id);
 bool        device_is_any_context_present  (uint32_t dev_id);
 bool        device_is_active_context       (uint32_t dev_id, context_t context);
 bool        device_has_exception           (uint32_t dev_id);
+bool        device_has_lane_exception      (uint32_t dev_id);
 uint64_t    device_get_active_sms_mask     (uint32_t dev_id);
 contexts_t  device_get_contexts            (uint32_t dev_id);
 
@@ -66,12 +95,19 @@ void        device_print      (uint32_t dev_id);
 void        device_resume     (uint32_t dev_id);
 void        device_suspend    (uint32_t dev_id);
 void        device_invalidate (uint32_t dev_id);
+void        device_set_exception_state (uint32_t dev_id, uint64_t sm_exception_mask);
 
 /* SM State */
 bool        sm_is_valid                    (uint32_t dev_id, uint32_t sm_id);
 bool        sm_has_exception               (uint32_t dev_id, uint32_t sm_id);
 uint64_t    sm_get_valid_warps_mask        (uint32_t dev_id, uint32_t sm_id);
 uint64_t    sm_get_broken_warps_mask       (uint32_t dev_id, uint32_t sm_id);
+uint64_t    sm_get_exception_warps_mask    (uint32_t dev_id, uint32_t sm_id);
+uint64_t    sm_get_breakpoint_warps_mask   (uint32_t dev_id, uint32_t sm_id);
+uint32_t    sm_set_snapshot                (uint32_t dev_id, uint32_t sm_id,
+                                            uint64_t valid_warps_mask,
+                                            uint64_t broken_warps_mask,
+                                            const CUDBGWarpState *states);
 
 /* Warp State */
 bool     warp_is_valid                 (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
@@ -83,6 +119,7 @@ uint64_t warp_get_grid_id              (uint32_t dev_id, uint32_t sm_id, uint32_
 uint32_t warp_get_valid_lanes_mask     (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
 uint32_t warp_get_active_lanes_mask    (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
 uint32_t warp_get_divergent_lanes_mask (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
+uint32_t warp_get_exception_lanes_mask (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
 uint32_t warp_get_lowest_active_lane   (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
 uint64_t warp_get_active_pc            (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
 uint64_t warp_get_active_virtual_pc    (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id);
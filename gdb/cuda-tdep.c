@@ -17,6 +17,7 @@
 
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <ctype.h>
 #include <sys/syscall.h>
 #include <pthread.h>
@@ -72,6 +73,7 @@
 #include "cuda-elf-image.h"
 #include "cuda-frame.h"
 #include "cuda-iterator.h"
+#include "cuda-memcache.h"
 #include "cuda-modules.h"
 #include "cuda-notifications.h"
 #include "cuda-options.h"
@@ -386,29 +388,26 @@ cuda_trace_domain (cuda_trace_domain_t domain, const char *fmt, ...)
 bool
 cuda_breakpoint_hit_p (cuda_clock_t clock)
 {
-  cuda_iterator itr;
-  cuda_coords_t c, filter = CUDA_WILDCARD_COORDS;
-  bool breakpoint_hit = false;
+  const cuda_stop_warp_t *w, *warps;
+  uint32_t i, num_warps, ln;
 
-  itr = cuda_iterator_create (CUDA_ITERATOR_TYPE_LANES, &filter,
-                               CUDA_SELECT_VALID | CUDA_SELECT_BKPT);
+  num_warps = cuda_system_get_stop_report (&warps);
 
-  for (cuda_iterator_start (itr);
-       !cuda_iterator_end (itr);
-       cuda_iterator_next (itr))
+  for (i = 0; i < num_warps; ++i)
     {
+      w = &warps[i];
+      if (!w->at_breakpoint)
+        continue;
+
       /* if we hit a breakpoint at an earlier time, we do not report it again. */
-      c = cuda_iterator_get_current (itr);
-      if (lane_get_timestamp (c.dev, c.sm, c.wp, c.ln) < clock)
+      ln = __builtin_ctz (w->active_lanes_mask);
+      if (lane_get_timestamp (w->dev, w->sm, w->wp, ln) < clock)
         continue;
 
-      breakpoint_hit = true;
-      break;
+      return true;
     }
 
-  cuda_iterator_destroy (itr);
-
-  return breakpoint_hit;
+  return false;
 }
 
 /* Return the name of register REGNUM. */
@@ -791,39 +790,20 @@ cuda_print_insn (bfd_vma pc, disassemble_info *info)
 bool
 cuda_is_device_code_address (CORE_ADDR addr)
 {
-  struct objfile *objfile;
   struct obj_section *osect = NULL;
-  asection           *section = NULL;
-  bool found_in_cpu_symtab = false;
   bool is_cuda_addr = false;
 
   /* Zero and (CORE_ADDR)-1 are CPU addresses */
   if (addr == 0 || addr == (CORE_ADDR)-1LL)
     return false;
 
-  /*Iterate over all ELF sections */
-  ALL_OBJSECTIONS(objfile, osect)
-    {
-      section = osect->the_bfd_section;
-      if (!section) continue;
-      /* Check if addr belongs to CUDA ELF */
-      if (objfile->cuda_objfile)
-        {
-          /* Skip sections that do not have code */
-          if (!(section->flags & SEC_CODE))
-            continue;
-          if (section->vma > addr || section->vma + section->size < addr)
-            continue;
-          return true;
-        }
-
-      /* Check if address belongs to one of the host ELFs */
-      if (obj_section_addr(osect) <= addr && obj_section_endaddr(osect) > addr)
-        found_in_cpu_symtab = true;
-    }
+  /* Check if addr belongs to the code of one of the CUDA ELFs */
+  if (cuda_elf_image_find_by_address (addr))
+    return true;
 
-  /* If address was found on CPU and wasn't found on any of the CUDA ELFs - return false */
-  if (found_in_cpu_symtab)
+  /* If address was found in one of the host ELFs - return false */
+  osect = find_pc_section (addr);
+  if (osect && !osect->objfile->cuda_objfile)
     return false;
 
   /* Fallback to backend API call */
@@ -1433,26 +1413,21 @@ cuda_elf_make_msymbol_special (asymbol *sym, struct minimal_symbol *msym)
     }
 }
 
-/* Temporary: intercept memory addresses when accessing known
-   addresses pointing to CUDA RT variables. Returns 0 if found a CUDA
-   RT variable, and 1 otherwise. */
-static int
-read_cudart_variable (uint64_t address, void * buffer, unsigned amount)
+/* Read the CUDA RT variable at ADDRESS as seen by the given lane.
+   Returns 0 if found a CUDA RT variable, and 1 otherwise. */
+int
+cuda_read_builtin_variable (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id,
+                            uint32_t ln_id, uint64_t address,
+                            void *buffer, unsigned amount)
 {
   CuDim3 thread_idx, block_dim;
   CuDim3 block_idx, grid_dim;
   uint32_t num_lanes;
-  uint32_t dev_id, sm_id, wp_id, ln_id;
   kernel_t kernel;
 
   if (address < CUDBG_BUILTINS_MAX)
     return 1;
 
-  if (!cuda_focus_is_device ())
-    return 1;
-
-  cuda_coords_get_current_physical (&dev_id, &sm_id, &wp_id, &ln_id);
-
   if (CUDBG_THREADIDX_OFFSET <= address)
     {
       thread_idx = lane_get_thread_idx (dev_id, sm_id, wp_id, ln_id);
@@ -1481,7 +1456,6 @@ read_cudart_variable (uint64_t address, void * buffer, unsigned amount)
     }
   else if (CUDBG_WARPSIZE_OFFSET <= address)
     {
-      dev_id    = cuda_current_device ();
       num_lanes = device_get_num_lanes (dev_id);
       memcpy (buffer, &num_lanes, amount);
     }
@@ -1491,6 +1465,26 @@ read_cudart_variable (uint64_t address, void * buffer, unsigned amount)
   return 0;
 }
 
+/* Temporary: intercept memory addresses when accessing known
+   addresses pointing to CUDA RT variables. Returns 0 if found a CUDA
+   RT variable, and 1 otherwise. */
+static int
+read_cudart_variable (uint64_t address, void * buffer, unsigned amount)
+{
+  uint32_t dev_id, sm_id, wp_id, ln_id;
+
+  if (address < CUDBG_BUILTINS_MAX)
+    return 1;
+
+  if (!cuda_focus_is_device ())
+    return 1;
+
+  cuda_coords_get_current_physical (&dev_id, &sm_id, &wp_id, &ln_id);
+
+  return cuda_read_builtin_variable (dev_id, sm_id, wp_id, ln_id,
+                                     address, buffer, amount);
+}
+
 /* Read LEN bytes of CUDA memory at address ADDRESS, placing the
    result in GDB's memory at BUF. Returns 0 on success, and 1
    otherwise. This is used only by partial_memory_read. */
@@ -1519,17 +1513,17 @@ cuda_read_memory_partial (CORE_ADDR address, gdb_byte *buf, int len, struct type
         return 1;
 
       if (TYPE_CUDA_CODE(type))
-        cuda_api_read_code_memory (dev, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_CODE, dev, sm, wp, ln, address, buf, len);
       else if (TYPE_CUDA_CONST(type))
-        cuda_api_read_const_memory (dev, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_CONST, dev, sm, wp, ln, address, buf, len);
       else if (TYPE_CUDA_GENERIC(type))
-        cuda_api_read_generic_memory (dev, sm, wp, ln, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_GENERIC, dev, sm, wp, ln, address, buf, len);
       else if (TYPE_CUDA_GLOBAL(type))
-        cuda_api_read_generic_memory (dev, sm, wp, ln, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_GENERIC, dev, sm, wp, ln, address, buf, len);
       else if (TYPE_CUDA_PARAM(type))
-        cuda_api_read_param_memory (dev, sm, wp, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_PARAM, dev, sm, wp, ln, address, buf, len);
       else if (TYPE_CUDA_SHARED(type))
-        cuda_api_read_shared_memory (dev, sm, wp, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_SHARED, dev, sm, wp, ln, address, buf, len);
       else if (TYPE_CUDA_TEX(type))
         {
           cuda_texture_dereference_tex_contents (address, &tex_id, &dim, &coords, &is_bindless);
@@ -1539,7 +1533,7 @@ cuda_read_memory_partial (CORE_ADDR address, gdb_byte *buf, int len, struct type
             cuda_api_read_texture_memory (dev, sm, wp, tex_id, dim, coords, buf, len);
         }
       else if (TYPE_CUDA_LOCAL(type))
-        cuda_api_read_local_memory (dev, sm, wp, ln, address, buf, len);
+        cuda_memcache_read (CUDA_MEMCACHE_LOCAL, dev, sm, wp, ln, address, buf, len);
       else
         error (_("Unknown storage specifier."));
       return 0;
@@ -1587,7 +1581,7 @@ cuda_read_memory (CORE_ADDR address, struct value *val, struct type *type, int l
   if (value_stack (val))
    {
       cuda_coords_get_current_physical (&dev, &sm, &wp, &ln);
-      cuda_api_read_local_memory (dev, sm, wp, ln, address, buf, len);
+      cuda_memcache_read (CUDA_MEMCACHE_LOCAL, dev, sm, wp, ln, address, buf, len);
       return;
    }
 
@@ -1807,25 +1801,28 @@ cuda_sstep_set_ptid (ptid_t ptid)
   cuda_sstep_info.ptid = ptid;
 }
 
+/* Single-stepping statistics */
+static struct {
+  uint64_t steps;
+  uint64_t fast_steps;
+  uint64_t branches;
+  double   time;
+} cuda_sstep_stats;
+
 static bool
 cuda_control_flow_instruction (const char *inst, bool skip_subroutines)
 {
+  uint32_t cf;
+
   if (!inst) return true;
-  if (strstr(inst, "SSY")!=0) return true;
-  if (strstr(inst, "BAR.SYNC")!=0) return true;
-  if (strstr(inst, "BAR.RED")!=0) return true;
-  if (strstr(inst, "BRA")!=0) return true;
-  if (strstr(inst, "BRK")!=0) return true;
-  if (strstr(inst, "NOP.S")!=0) return true;
-  if (strstr(inst, "SYNC")!=0) return true;
-  if (strstr(inst, "EXIT")!=0) return true;
-  if (strstr(inst, "RET")!=0) return true;
-  if (strstr(inst, "JMP")!=0) return true;
-  if (strstr(inst, "JCAL")!=0 && !skip_subroutines) return true;
-  if (strstr(inst, "CAL")!=0 && !skip_subroutines) return true;
 
-  return false;
+  cf = disasm_classify_instruction (inst, NULL);
+  if (skip_subroutines)
+    cf &= ~CUDA_CF_CALL;
+
+  return cf != 0;
 }
+
 static bool
 cuda_sstep_fast (ptid_t ptid)
 {
@@ -1833,8 +1830,9 @@ cuda_sstep_fast (ptid_t ptid)
   struct thread_info *tp = inferior_thread();
   kernel_t kernel = cuda_current_kernel ();
   struct address_space *aspace = NULL;
-  const char *inst;
+  const char *inst = NULL;
   uint32_t inst_size;
+  uint32_t branches = 0;
   uint64_t active_pc, pc, end_pc, adj_pc;
   bool skip_subroutines, rc;
 
@@ -1863,23 +1861,29 @@ cuda_sstep_fast (ptid_t ptid)
   cuda_coords_get_current_physical (&dev_id, &sm_id, &wp_id, NULL);
   end_pc = pc = get_frame_pc (get_current_frame ());
 
-  /* Iterate over instructions until the end of the step/next line range */
-  /* Break if instruction that can potentially alter program counter has been encountered  */
-  do {
-    inst = kernel_disassemble (kernel, end_pc, &inst_size);
-    cuda_trace_domain (CUDA_TRACE_BREAKPOINT, "%s: pc=0x%llx inst %.*s",
-                       __func__, (long long) end_pc, 20, inst);
-    if (cuda_control_flow_instruction(inst, skip_subroutines)) break;
-    end_pc += inst_size;
-  } while (end_pc < tp->control.step_range_end);
+  /* Look the resume PC up in the control-flow map of the function.  Without
+     it, iterate over instructions until the end of the step/next line range
+     and break if instruction that can potentially alter program counter has
+     been encountered  */
+  if (!kernel_find_stop_pc (kernel, pc, tp->control.step_range_start,
+                            tp->control.step_range_end, skip_subroutines,
+                            &end_pc, &inst_size, &branches))
+    do {
+      inst = kernel_disassemble (kernel, end_pc, &inst_size);
+      cuda_trace_domain (CUDA_TRACE_BREAKPOINT, "%s: pc=0x%llx inst %.*s",
+                         __func__, (long long) end_pc, 20, inst);
+      if (cuda_control_flow_instruction(inst, skip_subroutines)) break;
+      end_pc += inst_size;
+    } while (end_pc < tp->control.step_range_end);
 
  /* The above loop might increment end_pc beyond step_range_end.
      In that case, adjust it to the step_range_end. */
   if (end_pc > tp->control.step_range_end)
     end_pc = tp->control.step_range_end;
 
-  /* Do not attempt to accelerate if stepping over less than 3 instructions */
-  if (end_pc <= pc || end_pc - pc < 3*inst_size) {
+  /* Do not attempt to accelerate if stepping over a single instruction, a
+     resume costs as much as a single-step then */
+  if (end_pc <= pc || end_pc - pc < 2*inst_size) {
     cuda_trace_domain  (CUDA_TRACE_BREAKPOINT,
          "%s: Advantage is not big enough: pc=0x%llx end_pc=0x%llx inst_size = %u",
          __func__, (long long)pc, (long long)end_pc, (unsigned)inst_size);
@@ -1891,7 +1895,7 @@ cuda_sstep_fast (ptid_t ptid)
   end_pc = adj_pc > tp->control.step_range_end ? tp->control.step_range_end - inst_size : adj_pc ;
 
   /* Check again, if window is big enough */
-  if (end_pc <= pc || end_pc - pc < 3*inst_size) {
+  if (end_pc <= pc || end_pc - pc < 2*inst_size) {
     cuda_trace_domain  (CUDA_TRACE_BREAKPOINT,
          "%s: Advantage is not big enough: pc=0x%llx end_pc=0x%llx inst_size = %u",
          __func__, (long long)pc, (long long)end_pc, (unsigned)inst_size);
@@ -1900,9 +1904,8 @@ cuda_sstep_fast (ptid_t ptid)
 
 
   cuda_trace_domain (CUDA_TRACE_BREAKPOINT,
-       "%s: trying to step from %llx to %llx (inst %.*s)",
-       __func__, (long long)pc, (long long)end_pc,
-       (inst == NULL || strlen(inst)> 20) ? 20 : (int)strlen(inst), inst);
+       "%s: trying to step from %llx to %llx across %u branches",
+       __func__, (long long)pc, (long long)end_pc, branches);
 
   /* If breakpoint is set at the current (or current active) PC - temporarily unset it*/
   aspace = target_thread_address_space (ptid);
@@ -1924,6 +1927,12 @@ cuda_sstep_fast (ptid_t ptid)
   if (!rc && active_pc != pc && breakpoint_here_p (aspace, active_pc))
     cuda_api_set_breakpoint (dev_id, active_pc);
 
+  if (rc)
+    {
+      cuda_sstep_stats.fast_steps++;
+      cuda_sstep_stats.branches += branches;
+    }
+
   return rc;
 }
 
@@ -1940,6 +1949,7 @@ cuda_sstep_execute (ptid_t ptid)
   bool     sstep_other_warps;
   bool     grid_id_changed;
   bool     rc = true;
+  struct timeval start, end;
 
   gdb_assert (!cuda_sstep_info.active);
   gdb_assert (cuda_focus_is_device ());
@@ -1976,6 +1986,8 @@ cuda_sstep_execute (ptid_t ptid)
               dev_id, sm_id, (unsigned long long)cuda_sstep_info.warp_mask);
   gdb_assert (cuda_sstep_info.warp_mask & (1ULL << wp_id));
 
+  gettimeofday (&start, NULL);
+
   if (cuda_options_software_preemption ())
     {
       /* If sw preemption is enabled, then only step
@@ -1992,10 +2004,16 @@ cuda_sstep_execute (ptid_t ptid)
   else if (!cuda_sstep_fast (ptid))
     {
       /* Single-step all the warps in the warp mask. */
-      for (wp = 0; wp < CUDBG_MAX_WARPS; ++wp)
+      for (wp = 0; wp < device_get_num_warps (dev_id); ++wp)
         if (cuda_sstep_info.warp_mask & (1ULL << wp) &&
             warp_is_valid (dev_id, sm_id, wp))
           {
+            /* Stepping an earlier warp of the mask may have stepped this
+               one too (e.g. at a barrier).  Stepping it again would move
+               it two instructions in one step. */
+            if (stepped_warp_mask & (1ULL << wp))
+              continue;
+
             rc = warp_single_step (dev_id, sm_id, wp, &warp_mask);
             if (!rc) break;
             stepped_warp_mask |= warp_mask;
@@ -2008,19 +2026,53 @@ cuda_sstep_execute (ptid_t ptid)
 
   /* If any warps are marked invalid, but are in the warp_mask
      clear them. This can happen if we stepped a warp over an exit */
-  for (wp = 0; wp < CUDBG_MAX_WARPS; ++wp)
+  for (wp = 0; wp < device_get_num_warps (dev_id); ++wp)
     if (cuda_sstep_info.warp_mask & (1ULL << wp) &&
         !warp_is_valid (dev_id, sm_id, wp))
       cuda_sstep_info.warp_mask &= ~(1ULL << wp);
 
+  gettimeofday (&end, NULL);
+  cuda_sstep_stats.steps++;
+  cuda_sstep_stats.time += (end.tv_sec - start.tv_sec) +
+                           (end.tv_usec - start.tv_usec) * 1e-6;
+
   return rc;
 }
 
+void
+cuda_sstep_print_statistics (void)
+{
+  printf_unfiltered (_("Single-stepping: %llu steps, %llu resumed to a PC, "
+                       "%llu branches followed, %.0f steps/sec\n"),
+                     (unsigned long long) cuda_sstep_stats.steps,
+                     (unsigned long long) cuda_sstep_stats.fast_steps,
+                     (unsigned long long) cuda_sstep_stats.branches,
+                     cuda_sstep_stats.time > 0
+                     ? cuda_sstep_stats.steps / cuda_sstep_stats.time : 0.0);
+}
+
+/* Warps of the SM in focus to single-step together with the warp in focus,
+   see cuda_sstep_set_lockstep_mask */
+static uint64_t cuda_sstep_lockstep_mask;
+
+/* Single-step the warps of WARP_MASK, on the SM in focus, in lock-step with
+   the warp in focus when the next step starts.  Used by autostep, which
+   steps the warps sharing an autostep PC as a group. */
+void
+cuda_sstep_set_lockstep_mask (uint64_t warp_mask)
+{
+  cuda_sstep_lockstep_mask = warp_mask;
+}
+
 void
 cuda_sstep_initialize (bool stepping)
 {
   if (stepping && cuda_focus_is_device ())
-    cuda_sstep_info.warp_mask = (1ULL << cuda_current_warp ());
+    {
+      cuda_sstep_info.warp_mask = (1ULL << cuda_current_warp ());
+      if (cuda_sstep_lockstep_mask & cuda_sstep_info.warp_mask)
+        cuda_sstep_info.warp_mask = cuda_sstep_lockstep_mask;
+    }
   else
     cuda_sstep_info.warp_mask = 0ULL;
   cuda_sstep_info.grid_id_valid = false;
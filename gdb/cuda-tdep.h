@@ -159,9 +159,11 @@ uint64_t cuda_sstep_wp_mask (void);
 ptid_t   cuda_sstep_ptid (void);
 void     cuda_sstep_set_ptid (ptid_t ptid);
 void     cuda_sstep_initialize (bool stepping);
+void     cuda_sstep_set_lockstep_mask (uint64_t warp_mask);
 bool     cuda_sstep_execute (ptid_t ptid);
 void     cuda_sstep_reset (bool sstep);
 bool     cuda_sstep_kernel_has_terminated (void);
+void     cuda_sstep_print_statistics (void);
 
 /*Registers */
 bool          cuda_get_dwarf_register_string (reg_t reg, char *deviceReg, size_t sz);
@@ -193,6 +195,8 @@ int cuda_read_memory_partial (CORE_ADDR address, gdb_byte *buf, int len, struct
 void cuda_read_memory  (CORE_ADDR address, struct value *val, struct type *type, int len);
 int cuda_write_memory_partial (CORE_ADDR address, const gdb_byte *buf, struct type *type);
 void cuda_write_memory (CORE_ADDR address, const gdb_byte *buf, struct type *type);
+int cuda_read_builtin_variable (uint32_t dev_id, uint32_t sm_id, uint32_t wp_id, uint32_t ln_id,
+                                uint64_t address, void *buffer, unsigned amount);
 
 /*Breakpoints */
 void cuda_resolve_breakpoints (int bp_number_from, elf_image_t elf_image);
@@ -0,0 +1,307 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Loopback benchmark for the libcudbgipc transports.
+ *
+ * A forked child stands in for the debugger backend and answers every
+ * request with a reply of REPLY bytes, first over a pair of FIFOs framed
+ * like libcudbgipc.c, then over the shared-memory ring. The parent reports
+ * the round trip latency and throughput of both. With -b, BATCH requests
+ * are written back to back before their replies are read, the way
+ * cudbgipcFlush pipelines a batch. No driver is needed.
+ *
+ * Build:
+ *   cc -O2 cudbgipc-loopback.c libcudbgipc-ring.c -o cudbgipc-loopback
+ * Usage:
+ *   cudbgipc-loopback [-n COUNT] [-s REQUEST] [-r REPLY] [-b BATCH]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "libcudbgipc-ring.h"
+
+static char dir[256];
+static uint64_t count = 100000;
+static uint64_t requestSize = 32;
+static uint64_t replySize = 64;
+static uint64_t batch = 1;
+
+static double
+now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static int
+readAll(int fd, void *buf, uint64_t size)
+{
+    uint64_t offset;
+    ssize_t n;
+
+    for (offset = 0; offset < size; offset += n) {
+        n = read(fd, (char *)buf + offset, size - offset);
+        if (n == 0)
+            return -1;
+        if (n < 0) {
+            if (errno == EINTR)
+                n = 0;
+            else
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+writeAll(int fd, const void *buf, uint64_t size)
+{
+    uint64_t offset;
+    ssize_t n;
+
+    for (offset = 0; offset < size; offset += n) {
+        n = write(fd, (const char *)buf + offset, size - offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                n = 0;
+            else
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/* Build a message of SIZE bytes, including the 64-bit size header */
+static char *
+makeMessage(uint64_t size)
+{
+    char *msg = calloc(1, size);
+
+    memcpy(msg, &size, sizeof size);
+    return msg;
+}
+
+static void
+report(const char *name, double elapsed)
+{
+    printf("%-6s %10llu requests in %10llu round trips  %8.2f usec/request  %10.0f requests/sec  %8.2f MB/s\n",
+           name, (unsigned long long)count, (unsigned long long)(count / batch),
+           elapsed * 1e6 / count, count / elapsed,
+           count * (double)(requestSize + replySize) / elapsed / 1e6);
+}
+
+static void
+fifoServer(const char *reqName, const char *repName)
+{
+    char *reply = makeMessage(replySize);
+    char *request = NULL;
+    uint64_t size;
+    int in, out;
+
+    in  = open(reqName, O_RDONLY);
+    out = open(repName, O_WRONLY);
+    if (in == -1 || out == -1)
+        _exit(1);
+
+    while (readAll(in, &size, sizeof size) == 0) {
+        request = realloc(request, size);
+        if (readAll(in, request, size - sizeof size))
+            break;
+        if (writeAll(out, reply, replySize))
+            break;
+    }
+
+    _exit(0);
+}
+
+static double
+fifoBenchmark(void)
+{
+    char reqName[300], repName[300];
+    char *request = malloc(requestSize * batch);
+    char *reply = malloc(replySize);
+    uint64_t i, j, size;
+    double start, elapsed;
+    pid_t pid;
+    int in, out;
+
+    snprintf(reqName, sizeof reqName, "%s/pipe.req", dir);
+    snprintf(repName, sizeof repName, "%s/pipe.rep", dir);
+    if (mkfifo(reqName, S_IRUSR | S_IWUSR) || mkfifo(repName, S_IRUSR | S_IWUSR)) {
+        perror("mkfifo");
+        exit(1);
+    }
+
+    pid = fork();
+    if (pid == 0)
+        fifoServer(reqName, repName);
+
+    out = open(reqName, O_WRONLY);
+    in  = open(repName, O_RDONLY);
+
+    memset(request, 0, requestSize * batch);
+    for (j = 0; j < batch; ++j)
+        memcpy(request + j * requestSize, &requestSize, sizeof requestSize);
+
+    start = now();
+    for (i = 0; i < count; i += batch) {
+        if (writeAll(out, request, requestSize * batch)) {
+            fprintf(stderr, "fifo transport failure\n");
+            exit(1);
+        }
+        for (j = 0; j < batch; ++j) {
+            if (readAll(in, &size, sizeof size) ||
+                readAll(in, reply, size - sizeof size)) {
+                fprintf(stderr, "fifo transport failure\n");
+                exit(1);
+            }
+        }
+    }
+    elapsed = now() - start;
+
+    close(out);
+    close(in);
+    waitpid(pid, NULL, 0);
+    unlink(reqName);
+    unlink(repName);
+    free(request);
+    free(reply);
+
+    return elapsed;
+}
+
+static void
+ringServer(const char *name)
+{
+    char *reply = makeMessage(replySize);
+    CUDBGIPCRing_t *ring;
+    void *request;
+    uint64_t size;
+
+    ring = cudbgipcRingAttach(name);
+    if (!ring)
+        _exit(1);
+
+    while (cudbgipcRingReceive(ring, &request, &size))
+        if (!cudbgipcRingSend(ring, reply, replySize))
+            break;
+
+    cudbgipcRingDestroy(ring);
+    _exit(0);
+}
+
+static double
+ringBenchmark(void)
+{
+    char name[300];
+    char *request = makeMessage(requestSize);
+    CUDBGIPCRing_t *ring;
+    void *reply;
+    uint64_t i, j, size;
+    double start, elapsed;
+    pid_t pid;
+
+    snprintf(name, sizeof name, "%s/ring", dir);
+    ring = cudbgipcRingCreate(name);
+    if (!ring) {
+        fprintf(stderr, "shared memory transport unsupported\n");
+        exit(1);
+    }
+
+    pid = fork();
+    if (pid == 0)
+        ringServer(name);
+
+    while (!cudbgipcRingIsConnected(ring))
+        usleep(1000);
+
+    start = now();
+    for (i = 0; i < count; i += batch) {
+        for (j = 0; j < batch; ++j) {
+            if (!cudbgipcRingSend(ring, request, requestSize)) {
+                fprintf(stderr, "ring transport failure\n");
+                exit(1);
+            }
+        }
+        for (j = 0; j < batch; ++j) {
+            if (!cudbgipcRingReceive(ring, &reply, &size) ||
+                size != replySize) {
+                fprintf(stderr, "ring transport failure\n");
+                exit(1);
+            }
+        }
+    }
+    elapsed = now() - start;
+
+    cudbgipcRingDestroy(ring);
+    waitpid(pid, NULL, 0);
+    free(request);
+
+    return elapsed;
+}
+
+int
+main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:r:b:")) != -1) {
+        switch (opt) {
+        case 'n': count       = strtoull(optarg, NULL, 0); break;
+        case 's': requestSize = strtoull(optarg, NULL, 0); break;
+        case 'r': replySize   = strtoull(optarg, NULL, 0); break;
+        case 'b': batch       = strtoull(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n COUNT] [-s REQUEST] [-r REPLY] [-b BATCH]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!count || requestSize < sizeof (uint64_t) || replySize < sizeof (uint64_t)) {
+        fprintf(stderr, "COUNT must be positive, message sizes at least 8 bytes\n");
+        return 1;
+    }
+
+    if (!batch || count % batch || requestSize * batch > 4096) {
+        fprintf(stderr, "BATCH must divide COUNT and its requests fit in 4096 bytes\n");
+        return 1;
+    }
+
+    snprintf(dir, sizeof dir, "/tmp/cudbgipc-loopback.XXXXXX");
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    report("fifo", fifoBenchmark());
+    report("ring", ringBenchmark());
+
+    rmdir(dir);
+    return 0;
+}
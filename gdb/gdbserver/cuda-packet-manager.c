@@ -34,12 +34,45 @@ extern ptid_t last_ptid;
 extern struct target_waitstatus last_ws;
 char *buf_head = NULL;
 
+/* Binary packets, see gdb/cuda-packet-manager.c.  While a qnb. packet is
+   processed, the fields are read from the unescaped request and the reply
+   is built in a growable buffer, escaped and streamed out by
+   cuda_send_binary_reply. */
+static bool binary_packets = false;
+
+struct cuda_bin_buf {
+  unsigned char *buf;
+  size_t size;
+  size_t used;
+  size_t offset;
+};
+
+static struct cuda_bin_buf bin_request;
+static struct cuda_bin_buf bin_reply;
+
+static void
+bin_buf_reserve (struct cuda_bin_buf *bb, size_t size)
+{
+  if (bb->used + size <= bb->size)
+    return;
+
+  bb->size = bb->used + size > 2 * bb->size ? bb->used + size : 2 * bb->size;
+  bb->buf = xrealloc (bb->buf, bb->size);
+}
 
 char *
 append_string (const char *src, char *dest, bool sep)
 {
   char *p;
 
+  if (binary_packets)
+    {
+      bin_buf_reserve (&bin_reply, strlen (src) + 1);
+      memcpy (bin_reply.buf + bin_reply.used, src, strlen (src) + 1);
+      bin_reply.used += strlen (src) + 1;
+      return dest;
+    }
+
   if (dest + strlen (src) - buf_head >= PBUFSIZ)
     error ("Exceed the size of cuda packet.\n");
 
@@ -58,6 +91,14 @@ append_bin (const unsigned char *src, char *dest, int size, bool sep)
 {
   char *p;
 
+  if (binary_packets)
+    {
+      bin_buf_reserve (&bin_reply, size);
+      memcpy (bin_reply.buf + bin_reply.used, src, size);
+      bin_reply.used += size;
+      return dest;
+    }
+
   if (dest + size * 2 - buf_head >= PBUFSIZ)
     error ("Exceed the size of cuda packet.\n");
 
@@ -74,7 +115,22 @@ append_bin (const unsigned char *src, char *dest, int size, bool sep)
 char *
 extract_string (char *src)
 {
-  return strtok (src, ";");
+  char *p;
+  size_t len;
+
+  if (!binary_packets)
+    return strtok (src, ";");
+
+  if (bin_request.offset >= bin_request.used)
+    return NULL;
+
+  p = (char *) bin_request.buf + bin_request.offset;
+  len = strnlen (p, bin_request.used - bin_request.offset);
+  if (bin_request.offset + len == bin_request.used)
+    error ("The data in the cuda packet is not complete.\n");
+  bin_request.offset += len + 1;
+
+  return p;
 }
 
 char *
@@ -82,6 +138,16 @@ extract_bin (char *src, unsigned char *dest, int size)
 {
   char *p;
 
+  if (binary_packets)
+    {
+      if (bin_request.offset + size > bin_request.used)
+        error ("The data in the cuda packet is not complete.\n");
+      p = (char *) bin_request.buf + bin_request.offset;
+      memcpy (dest, p, size);
+      bin_request.offset += size;
+      return p;
+    }
+
   p = extract_string (src);
   if (!p)
     error ("The data in the cuda packet is not complete.\n");
@@ -89,7 +155,6 @@ extract_bin (char *src, unsigned char *dest, int size)
   return p;
 }
 
-
 static uint64_t cuda_resumed_devices_mask = 0LL;
 
 bool
@@ -1282,12 +1347,121 @@ cuda_process_query_trace_message (char *buf)
 }
 
 void
-handle_cuda_packet (char *buf)
+cuda_process_read_warp_state_in_sm_packet (char *buf)
 {
-  cuda_packet_type_t packet_type;
-  buf_head = buf;
-  extract_bin (buf + strlen ("qnv."), (unsigned char *) &packet_type, sizeof (packet_type));
+  CUDBGResult res;
+  char *p;
+  uint32_t dev;
+  uint32_t sm;
+  uint32_t wp;
+  uint32_t num_warps;
+  uint64_t valid_warps_mask = 0;
+  uint64_t broken_warps_mask = 0;
+  CUDBGWarpState *states;
+
+  extract_bin (NULL, (unsigned char *) &dev, sizeof (dev));
+  extract_bin (NULL, (unsigned char *) &sm,  sizeof (sm));
+  extract_bin (NULL, (unsigned char *) &num_warps, sizeof (num_warps));
+
+  if (num_warps > CUDBG_MAX_WARPS)
+    num_warps = CUDBG_MAX_WARPS;
+  states = xmalloc (num_warps * sizeof (*states));
+
+  res = cudbgAPI->readValidWarps (dev, sm, &valid_warps_mask);
+  if (res == CUDBG_SUCCESS)
+    res = cudbgAPI->readBrokenWarps (dev, sm, &broken_warps_mask);
+  for (wp = 0; wp < num_warps && res == CUDBG_SUCCESS; wp++)
+    if (valid_warps_mask & (1ULL << wp))
+      res = cudbgAPI->readWarpState (dev, sm, wp, &states[wp]);
+
+  /* The warp states are only sent once they all could be read */
+  p = append_bin ((unsigned char *) &res, buf, sizeof (res), true);
+  if (res == CUDBG_SUCCESS)
+    {
+      p = append_bin ((unsigned char *) &valid_warps_mask, p, sizeof (valid_warps_mask), true);
+      p = append_bin ((unsigned char *) &broken_warps_mask, p, sizeof (broken_warps_mask), true);
+      for (wp = 0; wp < num_warps; wp++)
+        if (valid_warps_mask & (1ULL << wp))
+          p = append_bin ((unsigned char *) &states[wp], p, sizeof (states[wp]), true);
+    }
+
+  xfree (states);
+}
 
+/* Compute the stop snapshot of the suspended devices, see
+   cuda_remote_read_stop_snapshot.  Per device: the exception SM mask, then
+   per SM the warp masks and, for the SMs with broken warps or an
+   exception, the state of every valid warp.  Each SM carries its own
+   result so that one unreadable SM does not void the whole snapshot. */
+void
+cuda_process_read_stop_snapshot_packet (char *buf)
+{
+  CUDBGResult res;
+  char *p = buf;
+  uint32_t i;
+  uint32_t dev;
+  uint32_t sm;
+  uint32_t wp;
+  uint32_t num_devices;
+  uint32_t num_sms;
+  uint32_t num_warps;
+  uint64_t sm_exception_mask;
+  uint64_t valid_warps_mask;
+  uint64_t broken_warps_mask;
+  CUDBGWarpState *states;
+
+  states = xmalloc (CUDBG_MAX_WARPS * sizeof (*states));
+
+  extract_bin (NULL, (unsigned char *) &num_devices, sizeof (num_devices));
+  for (i = 0; i < num_devices; i++)
+    {
+      extract_bin (NULL, (unsigned char *) &dev, sizeof (dev));
+      extract_bin (NULL, (unsigned char *) &num_sms, sizeof (num_sms));
+      extract_bin (NULL, (unsigned char *) &num_warps, sizeof (num_warps));
+      if (num_sms > CUDBG_MAX_SMS)
+        num_sms = CUDBG_MAX_SMS;
+      if (num_warps > CUDBG_MAX_WARPS)
+        num_warps = CUDBG_MAX_WARPS;
+
+      sm_exception_mask = 0;
+      res = cudbgAPI->readDeviceExceptionState (dev, &sm_exception_mask);
+      p = append_bin ((unsigned char *) &res, p, sizeof (res), true);
+      if (res != CUDBG_SUCCESS)
+        continue;
+      p = append_bin ((unsigned char *) &sm_exception_mask, p, sizeof (sm_exception_mask), true);
+
+      for (sm = 0; sm < num_sms; sm++)
+        {
+          valid_warps_mask = 0;
+          broken_warps_mask = 0;
+          res = cudbgAPI->readValidWarps (dev, sm, &valid_warps_mask);
+          if (res == CUDBG_SUCCESS)
+            res = cudbgAPI->readBrokenWarps (dev, sm, &broken_warps_mask);
+          if (res == CUDBG_SUCCESS &&
+              (broken_warps_mask || ((sm_exception_mask >> sm) & 1ULL)))
+            for (wp = 0; wp < num_warps && res == CUDBG_SUCCESS; wp++)
+              if (valid_warps_mask & (1ULL << wp))
+                res = cudbgAPI->readWarpState (dev, sm, wp, &states[wp]);
+
+          p = append_bin ((unsigned char *) &res, p, sizeof (res), true);
+          if (res != CUDBG_SUCCESS)
+            continue;
+          p = append_bin ((unsigned char *) &valid_warps_mask, p, sizeof (valid_warps_mask), true);
+          p = append_bin ((unsigned char *) &broken_warps_mask, p, sizeof (broken_warps_mask), true);
+          if (!broken_warps_mask && !((sm_exception_mask >> sm) & 1ULL))
+            continue;
+          for (wp = 0; wp < num_warps; wp++)
+            if (valid_warps_mask & (1ULL << wp))
+              p = append_bin ((unsigned char *) &states[wp], p, sizeof (states[wp]), true);
+        }
+    }
+
+  xfree (states);
+}
+
+static void
+cuda_dispatch_packet (char *buf, cuda_packet_type_t packet_type)
+{
   switch (packet_type)
     {
     case RESUME_DEVICE:
@@ -1476,12 +1650,91 @@ handle_cuda_packet (char *buf)
     case READ_DEVICE_EXCEPTION_STATE:
       cuda_process_api_read_device_exception_state (buf);
       break;
+    case READ_WARP_STATE_IN_SM:
+      cuda_process_read_warp_state_in_sm_packet (buf);
+      break;
+    case READ_STOP_SNAPSHOT:
+      cuda_process_read_stop_snapshot_packet (buf);
+      break;
     default:
       error ("unknown cuda packet.\n");
       break;
     }
 }
 
+void
+handle_cuda_packet (char *buf)
+{
+  cuda_packet_type_t packet_type;
+
+  binary_packets = false;
+  buf_head = buf;
+  extract_bin (buf + strlen ("qnv."), (unsigned char *) &packet_type, sizeof (packet_type));
+
+  cuda_dispatch_packet (buf, packet_type);
+}
+
+/* Send the binary reply from OFFSET on, as much as fits in one packet */
+static void
+cuda_send_binary_reply (char *buf, size_t offset, int *new_packet_len)
+{
+  int out_len;
+
+  memcpy (buf, "OK;", strlen ("OK;"));
+  *new_packet_len  = strlen ("OK;");
+  *new_packet_len += remote_escape_output (bin_reply.buf + offset,
+                                           bin_reply.used - offset,
+                                           (gdb_byte *) buf + strlen ("OK;"),
+                                           &out_len, PBUFSIZ - strlen ("OK;"));
+  if (out_len != bin_reply.used - offset)
+    memcpy (buf, "MP", 2);
+}
+
+void
+handle_cuda_binary_packet (char *buf, int packet_len, int *new_packet_len)
+{
+  cuda_packet_type_t packet_type;
+  size_t offset;
+
+  if (strcmp (buf, "qnb.Supported") == 0)
+    {
+      strcpy (buf, "OK");
+      *new_packet_len = strlen ("OK");
+      return;
+    }
+
+  /* The rest of a reply that did not fit in one packet */
+  if (strncmp (buf, "qnb.Retr;", strlen ("qnb.Retr;")) == 0)
+    {
+      offset = (size_t) atol (buf + strlen ("qnb.Retr;"));
+      if (offset >= bin_reply.used)
+        {
+          sprintf (buf, "E%02d", EINVAL);
+          *new_packet_len = 3;
+          return;
+        }
+      cuda_send_binary_reply (buf, offset, new_packet_len);
+      return;
+    }
+
+  packet_len -= strlen ("qnb.");
+  bin_request.used = 0;
+  bin_request.offset = 0;
+  bin_buf_reserve (&bin_request, packet_len);
+  bin_request.used = remote_unescape_input ((gdb_byte *) buf + strlen ("qnb."),
+                                            packet_len, bin_request.buf,
+                                            bin_request.size);
+  bin_reply.used = 0;
+
+  binary_packets = true;
+  buf_head = buf;
+  extract_bin (NULL, (unsigned char *) &packet_type, sizeof (packet_type));
+  cuda_dispatch_packet (buf, packet_type);
+  binary_packets = false;
+
+  cuda_send_binary_reply (buf, 0, new_packet_len);
+}
+
 void
 cuda_append_api_finalize_res (char *buf)
 {
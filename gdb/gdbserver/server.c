@@ -109,6 +109,7 @@ int disable_packet_vCont;
 int disable_packet_Tthread;
 int disable_packet_qC;
 int disable_packet_qfThreadInfo;
+int disable_packet_qnb;
 
 /* Last status reported to GDB.  */
 static struct target_waitstatus last_status;
@@ -1597,6 +1598,11 @@ handle_query (char *own_buf, int packet_len, int *new_packet_len_p)
       handle_cuda_packet (own_buf);
       return;
     }
+  if (strncmp ("qnb.", own_buf, 4) == 0 && !disable_packet_qnb)
+    {
+      handle_cuda_binary_packet (own_buf, packet_len, new_packet_len_p);
+      return;
+    }
 
   /* Reply the current thread id.  */
   if (strcmp ("qC", own_buf) == 0 && !disable_packet_qC)
@@ -2621,7 +2627,8 @@ gdbserver_show_disableable (FILE *stream)
 	   "  qfThreadInfo\tThread listing\n"
 	   "  Tthread     \tPassing the thread specifier in the "
 	   "T stop reply packet\n"
-	   "  threads     \tAll of the above\n");
+	   "  threads     \tAll of the above\n"
+	   "  qnb         \tBinary CUDA packets\n");
 }
 
 
@@ -2804,6 +2811,8 @@ main (int argc, char *argv[])
 		disable_packet_qC = 1;
 	      else if (strcmp ("qfThreadInfo", tok) == 0)
 		disable_packet_qfThreadInfo = 1;
+	      else if (strcmp ("qnb", tok) == 0)
+		disable_packet_qnb = 1;
 	      else if (strcmp ("threads", tok) == 0)
 		{
 		  disable_packet_vCont = 1;
@@ -236,6 +236,7 @@ extern int disable_packet_vCont;
 extern int disable_packet_Tthread;
 extern int disable_packet_qC;
 extern int disable_packet_qfThreadInfo;
+extern int disable_packet_qnb;
 
 extern int run_once;
 extern int multi_process;
@@ -271,6 +272,7 @@ extern int handle_target_event (int err, gdb_client_data client_data);
 
 /* CUDA - Functions from cuda-packet-manager.c */
 extern void handle_cuda_packet (char *buf);
+extern void handle_cuda_binary_packet (char *buf, int packet_len, int *new_packet_len);
 extern int handle_vCuda (char *, int, int *);
 
 /* CUDA - Fuctions from cuda-tdep-server.c */
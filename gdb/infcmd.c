@@ -77,6 +77,7 @@
 #include "cli/cli-utils.h"
 #include "cuda-exceptions.h"
 #include "cuda-utils.h"
+#include "cuda-linecache.h"
 
 /* Local functions: */
 
@@ -1080,9 +1081,18 @@ step_once (int skip_subroutines, int single_inst, int count, int thread)
 	    }
 
 	  pc = get_frame_pc (frame);
-	  find_pc_line_pc_range (pc,
-				 &tp->control.step_range_start,
-				 &tp->control.step_range_end);
+	  if (cuda_focus_is_device ())
+	    {
+	      /* CUDA - autostep steps every warp over the same lines */
+	      struct symtab_and_line sal = cuda_linecache_find_pc_line (pc);
+
+	      tp->control.step_range_start = sal.pc;
+	      tp->control.step_range_end = sal.end;
+	    }
+	  else
+	    find_pc_line_pc_range (pc,
+				   &tp->control.step_range_start,
+				   &tp->control.step_range_end);
 
 	  /* If we have no line info, switch to stepi mode.  */
 	  if (tp->control.step_range_end == 0 && step_stop_if_no_debug)
@@ -81,6 +81,7 @@
 #include "cuda-state.h"
 #include "cuda-iterator.h"
 #include "cuda-autostep.h"
+#include "cuda-linecache.h"
 #include "cuda-options.h"
 
 /* Prototypes for local functions */
@@ -5207,7 +5208,12 @@ process_event_stop_test:
 	}
     }
 
-  stop_pc_sal = find_pc_line (stop_pc, 0);
+  /* CUDA - device PCs are looked up through the line cache, since every
+     step of an autostep stops at one */
+  if (cuda_focus_is_device ())
+    stop_pc_sal = cuda_linecache_find_pc_line (stop_pc);
+  else
+    stop_pc_sal = find_pc_line (stop_pc, 0);
 
   /* CUDA : The PC that the line belongs to may need to be adjusted */
   cuda_adjust_device_code_address (stop_pc_sal.pc, &stop_pc_sal.pc);
@@ -2089,6 +2089,233 @@ cudbgGetDeviceName (uint32_t dev, char *buf, uint32_t buf_size)
     return result;
 }
 
+/*
+ * Batched reads
+ *
+ * Reads queued between cudbgBatchBegin and cudbgBatchFlush are pipelined by
+ * libcudbgipc: the requests are written back to back and the replies are
+ * unpacked into the caller buffers by the flush, each read getting its own
+ * result. Without an open batch, or when the transport cannot pipeline
+ * requests, every read is performed immediately instead.
+ */
+typedef struct {
+    void *dst;
+    uint32_t size;
+    CUDBGResult *result;
+} cudbgBatchEntry_t;
+
+static cudbgBatchEntry_t cudbgBatchEntries[CUDBGIPC_BATCH_MAX_REQUESTS];
+static uint32_t cudbgBatchCount = 0;
+static bool cudbgBatchOpen = false;
+
+static CUDBGResult
+cudbgBatchSend (void)
+{
+    CUDBGResult res, result;
+    cudbgBatchEntry_t *entry;
+    uint32_t count, i;
+    char *ipc_buf;
+
+    CUDBG_IPC_PROFILE_START();
+
+    res = cudbgipcFlush(&count);
+    gdb_assert (res != CUDBG_SUCCESS || count == cudbgBatchCount);
+
+    for (i = 0; i < cudbgBatchCount; ++i) {
+        entry = &cudbgBatchEntries[i];
+        if (res == CUDBG_SUCCESS)
+            res = cudbgipcReceive((void **)&ipc_buf, NULL);
+        if (res != CUDBG_SUCCESS) {
+            *entry->result = res;
+            continue;
+        }
+
+        result = *(CUDBGResult *)ipc_buf;
+        ipc_buf += sizeof(CUDBGResult);
+        memcpy(entry->dst, ipc_buf, entry->size);
+        *entry->result = result;
+    }
+
+    cudbgBatchCount = 0;
+
+    CUDBG_IPC_PROFILE_END(CUDBGIPC_API_STAT_BATCH, "batch");
+
+    return res;
+}
+
+/* Queue the request built so far. Its reply carries SIZE bytes after the
+   result, to be copied to DST. */
+static CUDBGResult
+cudbgBatchQueue (void *dst, uint32_t size, CUDBGResult *result)
+{
+    cudbgBatchEntry_t *entry;
+    CUDBGResult res;
+
+    res = cudbgipcQueue();
+    if (res != CUDBG_SUCCESS)
+        return res;
+
+    entry = &cudbgBatchEntries[cudbgBatchCount++];
+    entry->dst = dst;
+    entry->size = size;
+    entry->result = result;
+    *result = CUDBG_ERROR_UNKNOWN;
+
+    if (cudbgipcBatchFull())
+        return cudbgBatchSend();
+
+    return CUDBG_SUCCESS;
+}
+
+/* False when every read of a batch costs a round trip of its own */
+bool
+cudbgBatchSupported (void)
+{
+    return cudbgipcBatchSupported();
+}
+
+static bool
+cudbgBatchActive (void)
+{
+    return cudbgBatchOpen && cudbgipcBatchSupported();
+}
+
+CUDBGResult
+cudbgBatchBegin (void)
+{
+    gdb_assert (!cudbgBatchOpen);
+
+    cudbgBatchOpen = true;
+    return CUDBG_SUCCESS;
+}
+
+CUDBGResult
+cudbgBatchFlush (void)
+{
+    gdb_assert (cudbgBatchOpen);
+
+    cudbgBatchOpen = false;
+    return cudbgBatchCount ? cudbgBatchSend() : CUDBG_SUCCESS;
+}
+
+CUDBGResult
+cudbgBatchReadValidWarps (uint32_t dev, uint32_t sm, uint64_t *validWarpsMask, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadValidWarps(dev, sm, validWarpsMask);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readValidWarps);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+
+    return cudbgBatchQueue(validWarpsMask, sizeof(*validWarpsMask), result);
+}
+
+CUDBGResult
+cudbgBatchReadBrokenWarps (uint32_t dev, uint32_t sm, uint64_t *brokenWarpsMask, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadBrokenWarps(dev, sm, brokenWarpsMask);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readBrokenWarps);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+
+    return cudbgBatchQueue(brokenWarpsMask, sizeof(*brokenWarpsMask), result);
+}
+
+CUDBGResult
+cudbgBatchReadWarpState (uint32_t dev, uint32_t sm, uint32_t wp, CUDBGWarpState *state, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadWarpState(dev, sm, wp, state);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readWarpState);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+    CUDBG_IPC_APPEND(&wp,sizeof(wp));
+
+    return cudbgBatchQueue(state, sizeof(*state), result);
+}
+
+CUDBGResult
+cudbgBatchReadThreadIdx (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, CuDim3 *threadIdx, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadThreadIdx(dev, sm, wp, ln, threadIdx);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readThreadIdx);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+    CUDBG_IPC_APPEND(&wp,sizeof(wp));
+    CUDBG_IPC_APPEND(&ln,sizeof(ln));
+
+    return cudbgBatchQueue(threadIdx, sizeof(*threadIdx), result);
+}
+
+CUDBGResult
+cudbgBatchReadPC (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *pc, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadPC(dev, sm, wp, ln, pc);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readPC);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+    CUDBG_IPC_APPEND(&wp,sizeof(wp));
+    CUDBG_IPC_APPEND(&ln,sizeof(ln));
+
+    return cudbgBatchQueue(pc, sizeof(*pc), result);
+}
+
+CUDBGResult
+cudbgBatchReadRegisterRange (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint32_t index, uint32_t registers_size, uint32_t *registers, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadRegisterRange(dev, sm, wp, ln, index, registers_size, registers);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readRegisterRange);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+    CUDBG_IPC_APPEND(&wp,sizeof(wp));
+    CUDBG_IPC_APPEND(&ln,sizeof(ln));
+    CUDBG_IPC_APPEND(&index,sizeof(index));
+    CUDBG_IPC_APPEND(&registers_size,sizeof(registers_size));
+
+    return cudbgBatchQueue(registers, registers_size*sizeof(uint32_t), result);
+}
+
+CUDBGResult
+cudbgBatchReadGenericMemory (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t addr, void *buf, uint32_t buf_size, CUDBGResult *result)
+{
+    if (!cudbgBatchActive()) {
+        *result = cudbgReadGenericMemory(dev, sm, wp, ln, addr, buf, buf_size);
+        return CUDBG_SUCCESS;
+    }
+
+    CUDBG_IPC_BEGIN(CUDBGAPIREQ_readGenericMemory);
+    CUDBG_IPC_APPEND(&dev,sizeof(dev));
+    CUDBG_IPC_APPEND(&sm,sizeof(sm));
+    CUDBG_IPC_APPEND(&wp,sizeof(wp));
+    CUDBG_IPC_APPEND(&ln,sizeof(ln));
+    CUDBG_IPC_APPEND(&addr,sizeof(addr));
+    CUDBG_IPC_APPEND(&buf_size,sizeof(buf_size));
+
+    return cudbgBatchQueue(buf, buf_size, result);
+}
+
 static const struct CUDBGAPI_st cudbgCurrentApi={
     /* Initialization */
     cudbgInitialize,
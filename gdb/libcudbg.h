@@ -19,6 +19,8 @@
 #ifndef LIBCUDB_H
 #define LIBCUDB_H 1
 
+#include <cudadebugger.h>
+
 typedef enum {
     /* Deprecated API Version Query */
     CUDBGAPIREQ_STUB_getAPI,
@@ -159,4 +161,17 @@ typedef struct  {
 } CUDBGCBMSG_t;
 #pragma pack(pop)
 
+/* Batched reads, see libcudbg.c. Only a failure to queue or flush the batch
+   is returned; the result of each read is stored in RESULT by the flush. */
+bool        cudbgBatchSupported (void);
+CUDBGResult cudbgBatchBegin (void);
+CUDBGResult cudbgBatchFlush (void);
+CUDBGResult cudbgBatchReadValidWarps (uint32_t dev, uint32_t sm, uint64_t *validWarpsMask, CUDBGResult *result);
+CUDBGResult cudbgBatchReadBrokenWarps (uint32_t dev, uint32_t sm, uint64_t *brokenWarpsMask, CUDBGResult *result);
+CUDBGResult cudbgBatchReadWarpState (uint32_t dev, uint32_t sm, uint32_t wp, CUDBGWarpState *state, CUDBGResult *result);
+CUDBGResult cudbgBatchReadThreadIdx (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, CuDim3 *threadIdx, CUDBGResult *result);
+CUDBGResult cudbgBatchReadPC (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t *pc, CUDBGResult *result);
+CUDBGResult cudbgBatchReadRegisterRange (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint32_t index, uint32_t registers_size, uint32_t *registers, CUDBGResult *result);
+CUDBGResult cudbgBatchReadGenericMemory (uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln, uint64_t addr, void *buf, uint32_t buf_size, CUDBGResult *result);
+
 #endif
@@ -0,0 +1,545 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This file is shared by cuda-gdb, cuda-gdbserver and the loopback
+   benchmark, so it only depends on libc. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "libcudbgipc-ring.h"
+
+#define CUDBGIPC_RING_PAD        ((uint64_t)-1LL)  /* skip to the ring start */
+#define CUDBGIPC_RING_SPIN       2000              /* polls before sleeping */
+#define CUDBGIPC_RING_WAIT_MS    100               /* re-check the peer this often */
+#define CUDBGIPC_RING_ALIGN(x)   (((x) + 7) & ~(uint64_t)7)
+#define CUDBGIPC_RING_HDR_SIZE   4096
+
+/* One direction of the channel. Head and tail are running byte counts,
+   always multiples of 8. */
+typedef struct {
+    volatile uint64_t head;          /* bytes produced */
+    volatile uint64_t tail;          /* bytes consumed */
+    volatile uint32_t dataSeq;       /* bumped every time head moves */
+    volatile uint32_t spaceSeq;      /* bumped every time tail moves */
+    volatile uint32_t dataWaiters;   /* consumers sleeping on dataSeq */
+    volatile uint32_t spaceWaiters;  /* producers sleeping on spaceSeq */
+    char pad[32];
+} CUDBGIPCRingQueue_t;
+
+/* Layout of the shared region: this header, padded to 4KB, then the request
+   ring (client to server) and the reply ring (server to client). */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    volatile uint32_t connected;     /* set by the server once mapped */
+    volatile uint32_t closed;        /* set by either side when leaving */
+    volatile int32_t clientPid;
+    volatile int32_t serverPid;
+    CUDBGIPCRingQueue_t queues[2];
+} CUDBGIPCRingHeader_t;
+
+struct CUDBGIPCRing_st {
+    CUDBGIPCRingRole_t role;
+    char path[256];
+    CUDBGIPCRingHeader_t *hdr;
+    size_t mapSize;
+    CUDBGIPCRingQueue_t *out;
+    CUDBGIPCRingQueue_t *in;
+    char *outData;
+    char *inData;
+    uint64_t pending;                /* bytes of the last message not released */
+    char *bounce;                    /* copy of messages larger than the ring */
+    uint64_t bounceSize;
+};
+
+/* Returns true if the wait timed out */
+#ifdef __linux__
+static bool
+cudbgipcRingFutexWait(volatile uint32_t *addr, uint32_t val)
+{
+    struct timespec ts;
+
+    ts.tv_sec = 0;
+    ts.tv_nsec = CUDBGIPC_RING_WAIT_MS * 1000000L;
+    return syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0) == -1 &&
+           errno == ETIMEDOUT;
+}
+
+static void
+cudbgipcRingFutexWake(volatile uint32_t *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+#else
+static bool
+cudbgipcRingFutexWait(volatile uint32_t *addr, uint32_t val)
+{
+    usleep(100);
+    return true;
+}
+
+static void
+cudbgipcRingFutexWake(volatile uint32_t *addr)
+{
+}
+#endif
+
+/* Spinning only helps when the peer can run at the same time */
+static int
+cudbgipcRingSpinCount(void)
+{
+    static int spin = -1;
+
+    if (spin < 0)
+        spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? CUDBGIPC_RING_SPIN : 0;
+
+    return spin;
+}
+
+bool
+cudbgipcRingSupported(void)
+{
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* A peer that crashed or was killed never sets closed. A process that
+   is gone, or a zombie waiting to be reaped, will not answer either. */
+static bool
+cudbgipcRingPeerAlive(CUDBGIPCRing_t *ring)
+{
+    pid_t pid;
+#ifdef __linux__
+    char name[64], buf[512], *p;
+    ssize_t len;
+    int fd;
+#endif
+
+    pid = ring->role == CUDBGIPC_RING_CLIENT ? ring->hdr->serverPid
+                                             : ring->hdr->clientPid;
+    if (pid <= 0)
+        return true;
+
+    if (kill(pid, 0) && errno == ESRCH)
+        return false;
+
+#ifdef __linux__
+    snprintf(name, sizeof (name), "/proc/%d/stat", (int)pid);
+    fd = open(name, O_RDONLY);
+    if (fd == -1)
+        return errno != ENOENT;
+    len = read(fd, buf, sizeof (buf) - 1);
+    close(fd);
+    if (len <= 0)
+        return true;
+    buf[len] = '\0';
+
+    /* The state follows the command name, which may hold parentheses */
+    p = strrchr(buf, ')');
+    if (p && p[1] == ' ' && (p[2] == 'Z' || p[2] == 'X'))
+        return false;
+#endif
+
+    return true;
+}
+
+/* Give up on a dead peer as if it had closed the ring, so that later
+   requests do not wait for it either. */
+static bool
+cudbgipcRingCheckPeer(CUDBGIPCRing_t *ring)
+{
+    if (cudbgipcRingPeerAlive(ring))
+        return true;
+
+    ring->hdr->closed = 1;
+    __sync_synchronize();
+    return false;
+}
+
+static bool
+cudbgipcRingWaitData(CUDBGIPCRing_t *ring, uint64_t need)
+{
+    CUDBGIPCRingQueue_t *q = ring->in;
+    uint32_t seq;
+    bool timedOut;
+    int spin, maxSpin = cudbgipcRingSpinCount();
+
+    for (spin = 0; ; ++spin) {
+        if (q->head - q->tail >= need)
+            break;
+        if (ring->hdr->closed)
+            return false;
+        if (spin < maxSpin)
+            continue;
+
+        seq = q->dataSeq;
+        __sync_synchronize();
+        if (q->head - q->tail >= need)
+            break;
+        __sync_fetch_and_add(&q->dataWaiters, 1);
+        timedOut = cudbgipcRingFutexWait(&q->dataSeq, seq);
+        __sync_fetch_and_sub(&q->dataWaiters, 1);
+        if (timedOut && !cudbgipcRingCheckPeer(ring))
+            return false;
+    }
+
+    __sync_synchronize();
+    return true;
+}
+
+static bool
+cudbgipcRingWaitSpace(CUDBGIPCRing_t *ring, uint64_t need)
+{
+    CUDBGIPCRingQueue_t *q = ring->out;
+    uint64_t capacity = ring->hdr->capacity;
+    uint32_t seq;
+    bool timedOut;
+    int spin, maxSpin = cudbgipcRingSpinCount();
+
+    for (spin = 0; ; ++spin) {
+        if (capacity - (q->head - q->tail) >= need)
+            break;
+        if (ring->hdr->closed)
+            return false;
+        if (spin < maxSpin)
+            continue;
+
+        seq = q->spaceSeq;
+        __sync_synchronize();
+        if (capacity - (q->head - q->tail) >= need)
+            break;
+        __sync_fetch_and_add(&q->spaceWaiters, 1);
+        timedOut = cudbgipcRingFutexWait(&q->spaceSeq, seq);
+        __sync_fetch_and_sub(&q->spaceWaiters, 1);
+        if (timedOut && !cudbgipcRingCheckPeer(ring))
+            return false;
+    }
+
+    __sync_synchronize();
+    return true;
+}
+
+static void
+cudbgipcRingProduce(CUDBGIPCRing_t *ring, uint64_t bytes)
+{
+    CUDBGIPCRingQueue_t *q = ring->out;
+
+    __sync_synchronize();
+    q->head += bytes;
+    __sync_fetch_and_add(&q->dataSeq, 1);
+    if (q->dataWaiters)
+        cudbgipcRingFutexWake(&q->dataSeq);
+}
+
+static void
+cudbgipcRingConsume(CUDBGIPCRing_t *ring, uint64_t bytes)
+{
+    CUDBGIPCRingQueue_t *q = ring->in;
+
+    if (!bytes)
+        return;
+
+    __sync_synchronize();
+    q->tail += bytes;
+    __sync_fetch_and_add(&q->spaceSeq, 1);
+    if (q->spaceWaiters)
+        cudbgipcRingFutexWake(&q->spaceSeq);
+}
+
+static CUDBGIPCRing_t *
+cudbgipcRingMap(const char *path, int fd, CUDBGIPCRingRole_t role, size_t mapSize)
+{
+    CUDBGIPCRing_t *ring;
+    void *map;
+
+    map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    ring = calloc(1, sizeof *ring);
+    if (!ring) {
+        munmap(map, mapSize);
+        return NULL;
+    }
+
+    snprintf(ring->path, sizeof (ring->path), "%s", path);
+    ring->role    = role;
+    ring->hdr     = map;
+    ring->mapSize = mapSize;
+    if (role == CUDBGIPC_RING_CLIENT) {
+        ring->out     = &ring->hdr->queues[0];
+        ring->in      = &ring->hdr->queues[1];
+        ring->outData = (char *)map + CUDBGIPC_RING_HDR_SIZE;
+        ring->inData  = ring->outData + CUDBGIPC_RING_CAPACITY;
+    } else {
+        ring->out     = &ring->hdr->queues[1];
+        ring->in      = &ring->hdr->queues[0];
+        ring->inData  = (char *)map + CUDBGIPC_RING_HDR_SIZE;
+        ring->outData = ring->inData + CUDBGIPC_RING_CAPACITY;
+    }
+
+    return ring;
+}
+
+CUDBGIPCRing_t *
+cudbgipcRingCreate(const char *path)
+{
+    CUDBGIPCRing_t *ring;
+    size_t mapSize = CUDBGIPC_RING_HDR_SIZE + 2 * CUDBGIPC_RING_CAPACITY;
+    int fd;
+
+    if (!cudbgipcRingSupported())
+        return NULL;
+
+    if (unlink(path) && errno != ENOENT)
+        return NULL;
+
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL, S_IRGRP | S_IWGRP | S_IRUSR | S_IWUSR);
+    if (fd == -1)
+        return NULL;
+
+    if (ftruncate(fd, mapSize)) {
+        close(fd);
+        unlink(path);
+        return NULL;
+    }
+
+    ring = cudbgipcRingMap(path, fd, CUDBGIPC_RING_CLIENT, mapSize);
+    close(fd);
+    if (!ring) {
+        unlink(path);
+        return NULL;
+    }
+
+    /* The file is zero-filled, so only the identification is left */
+    ring->hdr->capacity  = CUDBGIPC_RING_CAPACITY;
+    ring->hdr->version   = CUDBGIPC_RING_VERSION;
+    ring->hdr->clientPid = getpid();
+    __sync_synchronize();
+    ring->hdr->magic    = CUDBGIPC_RING_MAGIC;
+
+    return ring;
+}
+
+CUDBGIPCRing_t *
+cudbgipcRingAttach(const char *path)
+{
+    CUDBGIPCRing_t *ring;
+    size_t mapSize = CUDBGIPC_RING_HDR_SIZE + 2 * CUDBGIPC_RING_CAPACITY;
+    struct stat st;
+    int fd;
+
+    if (!cudbgipcRingSupported())
+        return NULL;
+
+    fd = open(path, O_RDWR);
+    if (fd == -1)
+        return NULL;
+
+    if (fstat(fd, &st) || (size_t)st.st_size != mapSize) {
+        close(fd);
+        return NULL;
+    }
+
+    ring = cudbgipcRingMap(path, fd, CUDBGIPC_RING_SERVER, mapSize);
+    close(fd);
+    if (!ring)
+        return NULL;
+
+    if (ring->hdr->magic != CUDBGIPC_RING_MAGIC ||
+        ring->hdr->version != CUDBGIPC_RING_VERSION ||
+        ring->hdr->capacity != CUDBGIPC_RING_CAPACITY ||
+        ring->hdr->closed) {
+        munmap(ring->hdr, ring->mapSize);
+        free(ring);
+        return NULL;
+    }
+
+    ring->hdr->serverPid = getpid();
+    __sync_synchronize();
+    ring->hdr->connected = 1;
+
+    return ring;
+}
+
+void
+cudbgipcRingDestroy(CUDBGIPCRing_t *ring)
+{
+    int i;
+
+    if (!ring)
+        return;
+
+    /* Wake up the peer so that it notices we are gone */
+    ring->hdr->closed = 1;
+    __sync_synchronize();
+    for (i = 0; i < 2; ++i) {
+        __sync_fetch_and_add(&ring->hdr->queues[i].dataSeq, 1);
+        __sync_fetch_and_add(&ring->hdr->queues[i].spaceSeq, 1);
+        cudbgipcRingFutexWake(&ring->hdr->queues[i].dataSeq);
+        cudbgipcRingFutexWake(&ring->hdr->queues[i].spaceSeq);
+    }
+
+    munmap(ring->hdr, ring->mapSize);
+    if (ring->role == CUDBGIPC_RING_CLIENT)
+        unlink(ring->path);
+    free(ring->bounce);
+    free(ring);
+}
+
+bool
+cudbgipcRingIsConnected(CUDBGIPCRing_t *ring)
+{
+    return ring && ring->hdr->connected && !ring->hdr->closed;
+}
+
+bool
+cudbgipcRingSend(CUDBGIPCRing_t *ring, const void *data, uint64_t size)
+{
+    CUDBGIPCRingQueue_t *q = ring->out;
+    uint64_t capacity = ring->hdr->capacity;
+    uint64_t record = CUDBGIPC_RING_ALIGN(size);
+    uint64_t pos, skip, offset, chunk, copy, room;
+
+    if (size < sizeof (uint64_t))
+        return false;
+
+    /* Messages that fit are written contiguously so that the receiver can
+       use them in place, padding to the start of the ring if needed. */
+    if (record <= capacity) {
+        pos = q->head % capacity;
+        if (pos + record > capacity) {
+            skip = capacity - pos;
+            if (!cudbgipcRingWaitSpace(ring, skip))
+                return false;
+            *(uint64_t *)(ring->outData + pos) = CUDBGIPC_RING_PAD;
+            cudbgipcRingProduce(ring, skip);
+            pos = 0;
+        }
+
+        if (!cudbgipcRingWaitSpace(ring, record))
+            return false;
+        memcpy(ring->outData + pos, data, size);
+        cudbgipcRingProduce(ring, record);
+        return true;
+    }
+
+    /* Larger messages are streamed through the ring piece by piece */
+    for (offset = 0; offset < record; offset += chunk) {
+        if (!cudbgipcRingWaitSpace(ring, sizeof (uint64_t)))
+            return false;
+
+        pos   = q->head % capacity;
+        room  = capacity - (q->head - q->tail);
+        chunk = record - offset;
+        if (chunk > room)
+            chunk = room;
+        if (chunk > capacity - pos)
+            chunk = capacity - pos;
+
+        copy = offset < size ? size - offset : 0;
+        if (copy > chunk)
+            copy = chunk;
+        memcpy(ring->outData + pos, (const char *)data + offset, copy);
+        memset(ring->outData + pos + copy, 0, chunk - copy);
+        cudbgipcRingProduce(ring, chunk);
+    }
+
+    return true;
+}
+
+bool
+cudbgipcRingReceive(CUDBGIPCRing_t *ring, void **data, uint64_t *size)
+{
+    CUDBGIPCRingQueue_t *q = ring->in;
+    uint64_t capacity = ring->hdr->capacity;
+    uint64_t pos, msgSize, record, offset, chunk;
+
+    /* The previous message is no longer in use */
+    cudbgipcRingConsume(ring, ring->pending);
+    ring->pending = 0;
+
+    for (;;) {
+        if (!cudbgipcRingWaitData(ring, sizeof (uint64_t)))
+            return false;
+
+        pos = q->tail % capacity;
+        msgSize = *(uint64_t *)(ring->inData + pos);
+        if (msgSize != CUDBGIPC_RING_PAD)
+            break;
+        cudbgipcRingConsume(ring, capacity - pos);
+    }
+
+    if (msgSize < sizeof (uint64_t))
+        return false;
+
+    record = CUDBGIPC_RING_ALIGN(msgSize);
+    *size = msgSize;
+
+    if (record <= capacity) {
+        if (!cudbgipcRingWaitData(ring, record))
+            return false;
+        *data = ring->inData + pos;
+        ring->pending = record;
+        return true;
+    }
+
+    if (ring->bounceSize < record) {
+        char *bounce = realloc(ring->bounce, record);
+        if (!bounce)
+            return false;
+        ring->bounce = bounce;
+        ring->bounceSize = record;
+    }
+
+    for (offset = 0; offset < record; offset += chunk) {
+        if (!cudbgipcRingWaitData(ring, sizeof (uint64_t)))
+            return false;
+
+        pos   = q->tail % capacity;
+        chunk = q->head - q->tail;
+        if (chunk > record - offset)
+            chunk = record - offset;
+        if (chunk > capacity - pos)
+            chunk = capacity - pos;
+
+        memcpy(ring->bounce + offset, ring->inData + pos, chunk);
+        cudbgipcRingConsume(ring, chunk);
+    }
+
+    *data = ring->bounce;
+    return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * NVIDIA CUDA Debugger CUDA-GDB Copyright (C) 2007-2015 NVIDIA Corporation
+ * Written by CUDA-GDB team at NVIDIA <cudatools@nvidia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBCUDBGIPC_RING_H
+#define LIBCUDBGIPC_RING_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Shared-memory request/reply transport.
+ *
+ * The debug client creates a file-backed region under the session
+ * directory holding one byte ring per direction. A backend that supports
+ * the transport maps the same file and marks it as connected; until then
+ * the client keeps using the FIFOs. Messages use the same framing as the
+ * FIFOs: a 64-bit total size followed by the payload. Wakeups go through
+ * futexes on Linux, with a short spin first since most replies arrive
+ * within microseconds. Each side records its pid, and a wait that times
+ * out gives up once the peer process is gone.
+ */
+
+#define CUDBGIPC_RING_MAGIC     0x474e5243U   /* "CRNG" */
+#define CUDBGIPC_RING_VERSION   2
+#define CUDBGIPC_RING_CAPACITY  (1 << 20)     /* bytes per direction */
+
+typedef enum {
+    CUDBGIPC_RING_CLIENT,
+    CUDBGIPC_RING_SERVER,
+} CUDBGIPCRingRole_t;
+
+typedef struct CUDBGIPCRing_st CUDBGIPCRing_t;
+
+bool cudbgipcRingSupported(void);
+
+/* Client side: create the region, server side: map an existing one. */
+CUDBGIPCRing_t *cudbgipcRingCreate(const char *path);
+CUDBGIPCRing_t *cudbgipcRingAttach(const char *path);
+void            cudbgipcRingDestroy(CUDBGIPCRing_t *ring);
+
+bool cudbgipcRingIsConnected(CUDBGIPCRing_t *ring);
+
+/* Send one message. DATA starts with the 64-bit message size. */
+bool cudbgipcRingSend(CUDBGIPCRing_t *ring, const void *data, uint64_t size);
+
+/* Receive one message. The returned buffer points straight into the ring
+   whenever the message is contiguous, and stays valid until the next call
+   on the same ring. */
+bool cudbgipcRingReceive(CUDBGIPCRing_t *ring, void **data, uint64_t *size);
+
+#endif
@@ -42,6 +42,7 @@
 #include <cuda-utils.h>
 #include <libcudbg.h>
 #include <libcudbgipc.h>
+#include <libcudbgipc-ring.h>
 #include <cudadebugger.h>
 
 /*Forward declarations */
@@ -52,7 +53,13 @@ CUDBGNotifyNewEventCallback cudbgDebugClientCallback = NULL;
 CUDBGIPC_t commOut;
 CUDBGIPC_t commIn;
 CUDBGIPC_t commCB;
+static CUDBGIPCRing_t *commRing = NULL;
 static bool cudbgPreInitComplete = false;
+static uint64_t messageRequests = 0;
+static uint64_t messageRoundTrips = 0;
+/* Set when replies of a batch could not be collected: the next reply read
+   from the channel could belong to any of them. */
+static bool batchDesynced = false;
 pthread_t callbackEventThreadHandle;
 pthread_t cudagdbMainThreadHandle;
 struct timespec cudbgipc_profile_start;
@@ -92,6 +99,23 @@ cudbgCallbackHandler(void *arg)
     return NULL;
 }
 
+/* If cuda-gdb is launched as root, make the file writeable by UID of debugged process */
+static bool
+cudbgipcChownToInferior(const char *name)
+{
+#ifndef GDBSERVER
+    if (getuid() == 0) {
+         int pid = (int) PIDGET (inferior_ptid);
+         if (pid > 0 && !cuda_gdb_chown_to_pid_uid (pid, name)) {
+             cudbgipc_trace("Changing ownership to pid %d uid failed for %s, errno=%d",
+                       pid, name, errno);
+             return false;
+         }
+    }
+#endif
+    return true;
+}
+
 static CUDBGResult
 cudbgipcCreate(CUDBGIPC_t *ipc, int from, int to, int flags)
 {
@@ -119,17 +143,8 @@ cudbgipcCreate(CUDBGIPC_t *ipc, int from, int to, int flags)
         return CUDBG_ERROR_COMMUNICATION_FAILURE;
     }
 
-    /* If cuda-gdb is launched as root, make pipes are writeable by UID of debugged process */
-#ifndef GDBSERVER
-    if (getuid() == 0) {
-         int pid = (int) PIDGET (inferior_ptid);
-         if (pid > 0 && !cuda_gdb_chown_to_pid_uid (pid, ipc->name)) {
-             cudbgipc_trace("Changing ownership to pid %d uid failed for %s, errno=%d",
-                       pid, ipc->name, errno);
-             return CUDBG_ERROR_COMMUNICATION_FAILURE;
-         }
-    }
-#endif
+    if (!cudbgipcChownToInferior(ipc->name))
+        return CUDBG_ERROR_COMMUNICATION_FAILURE;
 
     if ((ipc->fd = open(ipc->name, flags)) == -1) {
         cudbgipc_trace("Pipe opening failure (from=%u, to=%u, flags=%x, file=%s, errno=%d)",
@@ -146,10 +161,11 @@ cudbgipcCreate(CUDBGIPC_t *ipc, int from, int to, int flags)
         }
     }
 
-    /* Initialize message */
-    ipc->dataSize = sizeof(ipc->dataSize);
-    ipc->data     = malloc(sizeof(ipc->dataSize));
-    memset(ipc->data, 0, ipc->dataSize);
+    /* Initialize message, unless one is already being built */
+    if (!ipc->data) {
+        ipc->dataSize = sizeof(ipc->dataSize);
+        ipc->data     = calloc(1, sizeof(ipc->dataSize));
+    }
 
     /* Indicate successful initialization */
     ipc->from        = from;
@@ -179,6 +195,7 @@ cudbgipcDestroy(CUDBGIPC_t *ipc)
 
     bzero(ipc->name, sizeof (ipc->name));
     free(ipc->data);
+    ipc->data = NULL;
     ipc->from = 0;
     ipc->to = 0;
     ipc->initialized = false;
@@ -235,6 +252,63 @@ cudbgipcInitializeCommCB(void)
     return CUDBG_SUCCESS;
 }
 
+/* Create the shared-memory ring next to the FIFOs. It is only used once
+   the backend has mapped it; until then requests keep going through the
+   FIFOs. */
+static void
+cudbgipcInitializeRing(void)
+{
+    char name[256];
+
+    snprintf(name, sizeof (name), "%s/ring.%d.%d",
+             cuda_gdb_session_get_dir (),
+             LIBCUDBG_PIPE_ENDPOINT_DEBUG_CLIENT,
+             LIBCUDBG_PIPE_ENDPOINT_RPCD);
+
+    commRing = cudbgipcRingCreate(name);
+    if (!commRing) {
+        cudbgipc_trace("shared memory transport unavailable (file=%s, errno=%d)",
+                       name, errno);
+        return;
+    }
+
+    if (!cudbgipcChownToInferior(name)) {
+        cudbgipcRingDestroy(commRing);
+        commRing = NULL;
+        return;
+    }
+
+    cudbgipc_trace("created shared memory ring (file=%s)", name);
+}
+
+static CUDBGResult
+cudbgipcRequestRing(void **d, size_t *size)
+{
+    void *reply;
+    uint64_t replySize;
+
+    memcpy(commOut.data, (char*)&commOut.dataSize, sizeof(commOut.dataSize));
+    if (!cudbgipcRingSend(commRing, commOut.data, commOut.dataSize)) {
+        cudbgipc_trace("Ring send error (dataSize=%lu)", (unsigned long)commOut.dataSize);
+        return CUDBG_ERROR_COMMUNICATION_FAILURE;
+    }
+
+    memset(commOut.data, 0, sizeof(commOut.dataSize));
+    commOut.dataSize = sizeof(commOut.dataSize);
+
+    if (!cudbgipcRingReceive(commRing, &reply, &replySize)) {
+        cudbgipc_trace("Ring receive error");
+        return CUDBG_ERROR_COMMUNICATION_FAILURE;
+    }
+
+    /* Same layout as cudbgipcPull: the payload without the size header,
+       which is left in place in the ring. */
+    *d = (char *)reply + sizeof(uint64_t);
+    if (size) *size = replySize;
+
+    return CUDBG_SUCCESS;
+}
+
 #ifndef GDBSERVER
 /*
  * CUDADBG API call RSP wrapper protocol
@@ -288,6 +362,8 @@ cudbgipcRequestRemote(void **d, size_t *size)
     static char *recvBuffer = NULL;
     static long recvBufferSize = 0;
     size_t totalRecvSize = 0;
+    size_t sentBytes = 0, recvTotal = 0;
+    unsigned int roundTrips = 0;
     int recvBytes;
 
     if (!recvBuffer) {
@@ -296,14 +372,16 @@ cudbgipcRequestRemote(void **d, size_t *size)
     }
 
     putpkt_binary (outBuffer, outBufferUsed);
-
+    sentBytes += outBufferUsed;
 
     do {
         recvBytes = getpkt_sane (&recvBuffer, &recvBufferSize, 0);
+        ++roundTrips;
 
         /* Handle errors */
         if (recvBytes < 3)
             return CUDBG_ERROR_COMMUNICATION_FAILURE;
+        recvTotal += recvBytes;
         if (memcmp (recvBuffer, "OK;", strlen("OK;")) != 0 &&
             memcmp (recvBuffer, "MP;", strlen("MP;")) != 0) {
             gdb_assert (recvBuffer[0] == 'E' &&
@@ -311,6 +389,7 @@ cudbgipcRequestRemote(void **d, size_t *size)
                   recvBuffer[2]>='0' && recvBuffer[2]<='9');
 
             outBufferUsed = snprintf (outBuffer, outBufferSize, "vCUDA;");
+            cuda_remote_record_vcuda_packet (sentBytes, recvTotal, roundTrips);
             return atoi(recvBuffer+1);
         }
 
@@ -325,9 +404,12 @@ cudbgipcRequestRemote(void **d, size_t *size)
         if (memcmp (recvBuffer, "MP;", strlen ("MP;")) == 0) {
             outBufferUsed = snprintf (outBuffer, outBufferSize, "vCUDARetr;%lu", (unsigned long)totalRecvSize);
             putpkt_binary (outBuffer, outBufferUsed);
+            sentBytes += outBufferUsed;
         }
     } while ( memcmp (recvBuffer, "OK;", strlen ("OK;")) != 0);
 
+    cuda_remote_record_vcuda_packet (sentBytes, recvTotal, roundTrips);
+
     outBufferUsed = snprintf (outBuffer, outBufferSize, "vCUDA;");
     *d = inBuffer;
     if (size)
@@ -338,35 +420,43 @@ cudbgipcRequestRemote(void **d, size_t *size)
 #endif
 
 static CUDBGResult
-cudbgipcPush(CUDBGIPC_t *out)
+cudbgipcWrite(CUDBGIPC_t *out, const char *buf, uint64_t size)
 {
     int64_t writeCount = 0;
     uint64_t offset = 0;
-    char *buf;
-
-    gdb_assert (out);
 
-    /* Push out the header (size) */
-    memcpy(out->data, (char*)&out->dataSize, sizeof(out->dataSize));
-    buf = out->data;
-
-    /* Push out the data */
-    for (offset = 0, writeCount = 0; offset < out->dataSize; offset += writeCount) {
-        writeCount = write(out->fd, buf + offset, out->dataSize - offset);
+    for (offset = 0, writeCount = 0; offset < size; offset += writeCount) {
+        writeCount = write(out->fd, buf + offset, size - offset);
         if (writeCount < 0) {
             /* Forward SIGINT received during syscall to main thread signal handler */
             if (errno == EINTR && pthread_self() != cudagdbMainThreadHandle)
               pthread_kill (cudagdbMainThreadHandle, SIGINT);
 
             if (errno != EAGAIN && errno != EINTR) {
-                cudbgipc_trace("Fifo write error (from=%u, to=%u, out->dataSize=%lu, offset=%lu, errno=%d)",
-                               out->from, out->to, (unsigned long)out->dataSize, (unsigned long)offset, errno);
+                cudbgipc_trace("Fifo write error (from=%u, to=%u, size=%lu, offset=%lu, errno=%d)",
+                               out->from, out->to, (unsigned long)size, (unsigned long)offset, errno);
                 return CUDBG_ERROR_COMMUNICATION_FAILURE;
             }
             writeCount = 0;
         }
     }
 
+    return CUDBG_SUCCESS;
+}
+
+static CUDBGResult
+cudbgipcPush(CUDBGIPC_t *out)
+{
+    CUDBGResult res;
+
+    gdb_assert (out);
+
+    /* Push out the header (size) and the data */
+    memcpy(out->data, (char*)&out->dataSize, sizeof(out->dataSize));
+    res = cudbgipcWrite(out, out->data, out->dataSize);
+    if (res != CUDBG_SUCCESS)
+        return res;
+
     memset(out->data, 0, sizeof(out->dataSize));
     out->dataSize = sizeof(out->dataSize);
     return CUDBG_SUCCESS;
@@ -475,12 +565,19 @@ cudbgipcAppendLocal(void *d, uint32_t size)
     uint32_t dataSize = 0;
     void *data = NULL;
 
-    if (!commOut.initialized) {
+    if (!commOut.initialized && !cudbgipcRingIsConnected(commRing)) {
         res = cudbgipcInitializeCommOut();
         if (res != CUDBG_SUCCESS)
             return res;
     }
 
+    if (!commOut.data) {
+        commOut.dataSize = sizeof(commOut.dataSize);
+        commOut.data     = calloc(1, sizeof(commOut.dataSize));
+        if (!commOut.data)
+            return CUDBG_ERROR_COMMUNICATION_FAILURE;
+    }
+
     dataSize = commOut.dataSize + size;
     if ((data = realloc(commOut.data, dataSize)) == NULL)
         return CUDBG_ERROR_COMMUNICATION_FAILURE;
@@ -509,10 +606,21 @@ cudbgipcRequest(void **d, size_t *size)
 {
     CUDBGResult res;
 
+    ++messageRequests;
+    ++messageRoundTrips;
+
 #ifndef GDBSERVER
     if (cuda_remote)
         return cudbgipcRequestRemote (d, size);
 #endif
+    if (batchDesynced) {
+        cudbgipc_trace("cudbgipcRequest: replies of an earlier batch are lost");
+        return CUDBG_ERROR_COMMUNICATION_FAILURE;
+    }
+
+    if (cudbgipcRingIsConnected(commRing))
+        return cudbgipcRequestRing(d, size);
+
     res = cudbgipcPush(&commOut);
     if (res != CUDBG_SUCCESS) {
         cudbgipc_trace("cudbgipcRequest push failed (res=%d)", res);
@@ -537,6 +645,194 @@ cudbgipcRequest(void **d, size_t *size)
     return CUDBG_SUCCESS;
 }
 
+/* Pipelined requests */
+static char    *batchData = NULL;
+static uint64_t batchSize = 0;
+static uint64_t batchAlloc = 0;
+static uint32_t batchQueued = 0;
+static uint32_t batchPending = 0;
+
+bool
+cudbgipcBatchSupported(void)
+{
+#ifndef GDBSERVER
+    /* vCUDA packets carry one request each */
+    if (cuda_remote)
+        return false;
+#endif
+    return true;
+}
+
+bool
+cudbgipcBatchFull(void)
+{
+    return batchQueued >= CUDBGIPC_BATCH_MAX_REQUESTS ||
+           batchSize + CUDBGIPC_BATCH_MAX_REQUEST_SIZE > CUDBGIPC_BATCH_MAX_BYTES;
+}
+
+/* Move the message built in commOut to the end of the batch */
+CUDBGResult
+cudbgipcQueue(void)
+{
+    char *data;
+
+    gdb_assert (cudbgipcBatchSupported());
+    gdb_assert (commOut.data);
+
+    if (batchQueued >= CUDBGIPC_BATCH_MAX_REQUESTS ||
+        batchSize + commOut.dataSize > CUDBGIPC_BATCH_MAX_BYTES) {
+        cudbgipc_trace("batch overflow (queued=%u, size=%lu)",
+                       batchQueued, (unsigned long)batchSize);
+        return CUDBG_ERROR_COMMUNICATION_FAILURE;
+    }
+
+    if (batchSize + commOut.dataSize > batchAlloc) {
+        if ((data = realloc(batchData, CUDBGIPC_BATCH_MAX_BYTES)) == NULL)
+            return CUDBG_ERROR_COMMUNICATION_FAILURE;
+        batchData = data;
+        batchAlloc = CUDBGIPC_BATCH_MAX_BYTES;
+    }
+
+    memcpy(commOut.data, (char*)&commOut.dataSize, sizeof(commOut.dataSize));
+    memcpy(batchData + batchSize, commOut.data, commOut.dataSize);
+    batchSize += commOut.dataSize;
+    ++batchQueued;
+
+    memset(commOut.data, 0, sizeof(commOut.dataSize));
+    commOut.dataSize = sizeof(commOut.dataSize);
+
+    return CUDBG_SUCCESS;
+}
+
+/* Send every queued message. COUNT is set to the number of replies the
+   caller must now collect with cudbgipcReceive. */
+CUDBGResult
+cudbgipcFlush(uint32_t *count)
+{
+    CUDBGResult res = CUDBG_SUCCESS;
+    uint64_t offset, msgSize;
+
+    gdb_assert (batchPending == 0);
+
+    if (batchDesynced) {
+        cudbgipc_trace("cudbgipcFlush: replies of an earlier batch are lost");
+        batchQueued = 0;
+        batchSize = 0;
+        *count = 0;
+        return CUDBG_ERROR_COMMUNICATION_FAILURE;
+    }
+
+    *count = batchQueued;
+    if (!batchQueued)
+        return CUDBG_SUCCESS;
+
+    if (cudbgipcRingIsConnected(commRing)) {
+        for (offset = 0; offset < batchSize; offset += msgSize) {
+            memcpy(&msgSize, batchData + offset, sizeof(msgSize));
+            if (!cudbgipcRingSend(commRing, batchData + offset, msgSize)) {
+                cudbgipc_trace("Ring send error (dataSize=%lu)", (unsigned long)msgSize);
+                res = CUDBG_ERROR_COMMUNICATION_FAILURE;
+                break;
+            }
+        }
+    } else {
+        /* A single write: the batch never exceeds what the FIFO can hold */
+        res = cudbgipcWrite(&commOut, batchData, batchSize);
+    }
+
+    messageRequests += batchQueued;
+    ++messageRoundTrips;
+
+    batchPending = res == CUDBG_SUCCESS ? batchQueued : 0;
+    batchQueued = 0;
+    batchSize = 0;
+
+    if (res != CUDBG_SUCCESS) {
+        cudbgipc_trace("cudbgipcFlush failed (res=%d)", res);
+        *count = 0;
+    }
+
+    return res;
+}
+
+/* A reply of a flushed batch could not be collected. Read out and drop
+   the replies still pending, so that they are not taken for the replies of
+   the next requests. If they cannot be read either, the channel is out of
+   sync and every later request fails. */
+static void
+cudbgipcDrain(bool replyLost)
+{
+    void *reply;
+    uint64_t replySize;
+
+    while (!replyLost && batchPending > 0) {
+        --batchPending;
+        if (cudbgipcRingIsConnected(commRing))
+            replyLost = !cudbgipcRingReceive(commRing, &reply, &replySize);
+        else
+            replyLost = cudbgipcWait(&commIn) != CUDBG_SUCCESS ||
+                        cudbgipcPull(&commIn) != CUDBG_SUCCESS;
+    }
+
+    if (replyLost) {
+        cudbgipc_trace("batch replies lost, channel out of sync");
+        batchDesynced = true;
+    }
+    batchPending = 0;
+}
+
+/* Collect the next reply of a flushed batch. As with cudbgipcRequest, the
+   reply stays valid until the next call. */
+CUDBGResult
+cudbgipcReceive(void **d, size_t *size)
+{
+    CUDBGResult res;
+    void *reply;
+    uint64_t replySize;
+
+    gdb_assert (batchPending > 0);
+    --batchPending;
+
+    if (cudbgipcRingIsConnected(commRing)) {
+        if (!cudbgipcRingReceive(commRing, &reply, &replySize)) {
+            cudbgipc_trace("Ring receive error");
+            cudbgipcDrain(true);
+            return CUDBG_ERROR_COMMUNICATION_FAILURE;
+        }
+        *d = (char *)reply + sizeof(uint64_t);
+        if (size) *size = replySize;
+        return CUDBG_SUCCESS;
+    }
+
+    /* Nothing of the reply has been read yet: the others can be drained */
+    res = cudbgipcWait(&commIn);
+    if (res != CUDBG_SUCCESS) {
+        cudbgipc_trace("cudbgipcReceive wait failed (res=%d)", res);
+        cudbgipcDrain(false);
+        return res;
+    }
+
+    /* A reply read in part leaves the channel out of sync */
+    res = cudbgipcPull(&commIn);
+    if (res != CUDBG_SUCCESS) {
+        cudbgipc_trace("cudbgipcReceive pull failed (res=%d)", res);
+        cudbgipcDrain(true);
+        return res;
+    }
+
+    *d = commIn.data;
+    if (size) *size = commIn.dataSize;
+
+    return CUDBG_SUCCESS;
+}
+
+void
+cudbgipcGetMessageStats(uint64_t *requests, uint64_t *roundTrips)
+{
+    *requests = messageRequests;
+    *roundTrips = messageRoundTrips;
+}
+
 CUDBGResult
 cudbgipcCBWaitForData(void *d, uint32_t size)
 {
@@ -587,6 +883,8 @@ cudbgipcInitialize(void)
     if (res != CUDBG_SUCCESS)
         return CUDBG_ERROR_COMMUNICATION_FAILURE;
 
+    cudbgipcInitializeRing();
+
     cudagdbMainThreadHandle = pthread_self();
     if (pthread_create(&callbackEventThreadHandle, NULL, cudbgCallbackHandler, NULL))
         return CUDBG_ERROR_COMMUNICATION_FAILURE;
@@ -610,10 +908,22 @@ cudbgipcFinalize(void)
         return CUDBG_ERROR_INTERNAL;
     }
 
-    res = cudbgipcDestroy(&commOut);
-    if (res != CUDBG_SUCCESS) {
-        cudbgipc_trace ("post finalize error finalizing ipc (res = %d)\n", res);
-        return res;
+    cudbgipcRingDestroy(commRing);
+    commRing = NULL;
+
+    free(batchData);
+    batchData = NULL;
+    batchAlloc = batchSize = 0;
+    batchQueued = batchPending = 0;
+    batchDesynced = false;
+
+    /* commOut is never opened when all the requests went through the ring */
+    if (commOut.initialized) {
+        res = cudbgipcDestroy(&commOut);
+        if (res != CUDBG_SUCCESS) {
+            cudbgipc_trace ("post finalize error finalizing ipc (res = %d)\n", res);
+            return res;
+        }
     }
 
     res = cudbgipcDestroy(&commIn);
@@ -61,8 +61,27 @@ CUDBGResult cudbgipcCBWaitForData(void *data, uint32_t size);
 CUDBGResult cudbgipcInitialize(void);
 CUDBGResult cudbgipcFinalize(void);
 
+/* Pipelined requests. A message built with cudbgipcAppend can be queued
+   instead of sent. cudbgipcFlush then writes all the queued messages back to
+   back and the replies are collected in order with cudbgipcReceive, so that
+   the whole batch costs a single round trip. A batch is bounded so that the
+   requests always fit in the FIFO without the backend reading them. */
+#define CUDBGIPC_BATCH_MAX_REQUESTS     64
+#define CUDBGIPC_BATCH_MAX_REQUEST_SIZE 64
+#define CUDBGIPC_BATCH_MAX_BYTES        4096
+
+bool        cudbgipcBatchSupported(void);
+bool        cudbgipcBatchFull(void);
+CUDBGResult cudbgipcQueue(void);
+CUDBGResult cudbgipcFlush(uint32_t *count);
+CUDBGResult cudbgipcReceive(void **d, size_t *size);
+
+/* Requests sent and the number of times the client waited for replies */
+void cudbgipcGetMessageStats(uint64_t *requests, uint64_t *roundTrips);
+
 /* Debugger API profiling collection typedefs/macros */
 #define CUDBGIPC_API_STAT_MAX 256
+#define CUDBGIPC_API_STAT_BATCH (CUDBGIPC_API_STAT_MAX - 1)
 typedef struct {
     const char *name;
     long times_called;
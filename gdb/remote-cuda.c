@@ -29,6 +29,7 @@
 
 #include "remote-cuda.h"
 #include "cuda-exceptions.h"
+#include "cuda-memcache.h"
 #include "cuda-packet-manager.h"
 #include "cuda-state.h"
 #include "cuda-utils.h"
@@ -60,6 +61,9 @@ cuda_do_resume (struct target_ops *ops, ptid_t ptid,
         for (dev = 0; dev < cuda_system_get_num_devices (); ++dev)
             device_resume (dev);
 
+      // the host may store to memory shared with the devices
+      cuda_memcache_invalidate_generic ();
+
       // resume the host
       host_target_ops->to_resume (ops, ptid, sstep, ts);
       return;
@@ -87,6 +91,7 @@ cuda_do_resume (struct target_ops *ops, ptid_t ptid,
         device_resume (dev);
 
   // resume the host
+  cuda_memcache_invalidate_generic ();
   host_target_ops->to_resume (ops, ptid, 0, ts);
 }
 
@@ -412,6 +417,12 @@ cuda_remote_wait (struct target_ops *ops,
 
   kernels_update_terminated ();
 
+  /* Fetch the state of the SMs the stop is about in one round trip instead
+     of reading it warp by warp.  Not worth it for a single-step, which only
+     looks at the stepped warp. */
+  if (!cuda_sstep_is_active ())
+    cuda_remote_read_stop_snapshot ();
+
   /* Decide which thread/kernel to switch focus to. */
   if (cuda_exception_hit_p (cuda_exception))
     {
@@ -700,6 +711,13 @@ cuda_remote_xfer_partial (struct target_ops *ops,
   uint32_t dev, sm, wp, ln;
 
   gdb_assert (host_target_ops);
+
+  /* Host writes can land in pinned, mapped or managed memory that the
+     device reads too */
+  if (writebuf && (object == TARGET_OBJECT_MEMORY ||
+                   object == TARGET_OBJECT_STACK_MEMORY))
+    cuda_memcache_invalidate ();
+
   /* If focus set on device, call the host routines directly */
   if (!cuda_focus_is_device ())
     {
@@ -727,7 +745,7 @@ cuda_remote_xfer_partial (struct target_ops *ops,
       cuda_coords_get_current_physical (&dev, &sm, &wp, &ln);
       if (readbuf)
         {
-          cuda_api_read_local_memory (dev, sm, wp, ln, offset, readbuf, len);
+          cuda_memcache_read (CUDA_MEMCACHE_LOCAL, dev, sm, wp, ln, offset, readbuf, len);
           nbytes = len;
         }
       else if (writebuf)
@@ -52,7 +52,6 @@ typedef unsigned char bool;
 #define ELFOSABI_CUDA		0x33
 #define ELFOSABIV_LATEST	0x7
 
-#define MAPIDENT_LEN		128
 #define TMPBUF_LEN		256
 #define DISASM_TMP_TEMPLATE	"/tmp/cudacore_disassembly_XXXXXX"
 
@@ -64,22 +63,111 @@ typedef struct {
 	Elf64_Shdr *shdr;
 } MemorySeg;
 
-/* Note: for now using string key (and fixed length) */
+/* Dense index of the device state tables, by device, SM, warp and lane
+ * number. Entries are NULL when the core dump has no record for them. */
 typedef struct {
-	char ident[MAPIDENT_LEN];
+	CudbgThreadTableEntry *tte;
+	Elf_Scn *localMemScn;
+	Elf_Scn *regsScn;
+	Elf_Scn *predScn;
+	CudbgBacktraceTableEntry *bt;	/* Backtrace table of the lane */
+	size_t btCount;
+} CudaCoreLane;
+
+typedef struct {
+	CudbgWarpTableEntry *wte;
+	CudaCoreLane *lanes;		/* numLanesPerWarp entries */
+} CudaCoreWarp;
+
+typedef struct {
+	CudbgSmTableEntry *ste;
+	CudbgCTATableEntry *ctate;
+	Elf_Scn *sharedMemScn;
+	CudaCoreWarp *warps;		/* numWarpsPerSM entries */
+} CudaCoreSm;
+
+/* Disassembled instruction */
+typedef struct {
+	uint64_t addr;
+	char *insn;
+	UT_hash_handle hh;
+} DisasmEntry;
+
+/* Function disassembled for a device, by start address */
+typedef struct {
+	uint64_t start;
+	CUDBGResult result;		/* Of the nvdisasm run */
+	UT_hash_handle hh;
+} DisasmRange;
+
+typedef struct {
+	CudbgDeviceTableEntry *dte;
+	CudaCoreSm *sms;		/* numSMs entries */
+	DisasmEntry *disasmCache;	/* Instructions by address */
+	DisasmRange *disasmRanges;	/* Functions in disasmCache */
+} CudaCoreDevice;
+
+/* Objects looked up by 64-bit identifier */
+typedef enum {
+	ID_MAP_GRID,
+	ID_MAP_CONTEXT,
+	ID_MAP_ELF_IMAGE,
+	ID_MAP_RELF_IMAGE,
+} IdMapKind;
+
+typedef struct {
+	uint64_t id;
+	uint32_t dev;
+	uint32_t kind;
+} IdMapKey;
+
+typedef struct {
+	IdMapKey key;
 	void *entryPtr;
+	Elf_Scn *scn;			/* Parameter memory of a grid */
 	UT_hash_handle hh;
-} MapEntry;
+} IdMapEntry;
+
+/* Tables found in the core dump sections, so that child sections can
+ * resolve their parent entry from the sh_link/sh_info pair. */
+typedef struct {
+	uint32_t type;			/* Section type, 0 if not a table */
+	void *table;
+	size_t count;
+	size_t entrySize;
+	CudbgDeviceTableEntry *dte;	/* Parents shared by all the entries */
+	CudbgSmTableEntry *ste;
+	CudbgWarpTableEntry *wte;
+	CudbgContextTableEntry *cte;
+	IdMapEntry *ids;		/* Id map entries of the rows, if any */
+} CudaCoreSection;
+
+typedef struct CudaCoreAlloc_st {
+	union {
+		struct CudaCoreAlloc_st *next;
+		uint64_t align;
+	} u;
+} CudaCoreAlloc;
 
 typedef struct CudaCoreEvent_st {
 	CUDBGEvent event;
 	struct CudaCoreEvent_st *next;
 } CudaCoreEvent;
 
+/* Address range of a function of a relocated ELF image */
+typedef struct {
+	uint64_t start;
+	uint64_t end;
+	uint64_t maxEnd;		/* Largest end up to this range */
+	Elf *e;				/* ELF image of the function */
+	Elf_Scn *scn;			/* Section holding the function code */
+} CodeRange;
+
 typedef struct CudaCoreELFImage_st {
 	CudbgDeviceTableEntry *dte;
 	Elf *e;
 	Elf_Scn *scn;
+	Elf *image;			/* Image opened in memory, or NULL */
 	struct CudaCoreELFImage_st *next;
 } CudaCoreELFImage;
 
@@ -91,9 +179,16 @@ struct CudaCore_st {
 	size_t strndx;			/* String table section index */
 
 	size_t numDevices;		/* Number of CUDA devices */
-	MapEntry *tableEntriesMap;	/* Hash map with state information */
+	CudbgDeviceTableEntry *deviceTable;
+	CudaCoreDevice *devices;	/* Device state index by device id */
+	size_t numDeviceIds;		/* Size of the devices array */
+	CudaCoreSection *sections;	/* Tables by section index */
+	IdMapEntry *idMap;		/* Hash map of grids, contexts and ELFs */
+	CudaCoreAlloc *allocs;		/* Index memory, freed with the core */
+	CudaCoreDisasmStats disasmStats;
 	UT_array *managedMemorySegs;	/* Sorted array of managed memory segments */
 	UT_array *globalMemorySegs;	/* Sorted array of global memory segments */
+	UT_array *codeRanges;		/* Sorted array of function ranges */
 
 	CudaCoreEvent *eventHead;	/* Single linked list of CUDA Events */
 	CudaCoreELFImage *relocatedELFImageHead;
@@ -123,15 +218,12 @@ struct CudaCore_st {
 	VERIFY(val != NULL, CUDBG_ERROR_INVALID_ARGS,			\
 	       "Invalid argument '" #val "'.")
 
-#ifndef _MSC_VER
-#define GET_TABLE_ENTRY(entry, errcode, key, args...)			\
+#define GET_TABLE_ENTRY(entry, errcode, lookup)				\
 	do {								\
-		(entry) = cuCoreGetMapEntry(&curcc->tableEntriesMap,	\
-					    key, ##args);		\
+		(entry) = (lookup);					\
 		if ((entry) == NULL)					\
 			return errcode;					\
 	} while (0)
-#endif /*_MSC_VER*/
 
 /**/
 #ifndef _MSC_VER
@@ -151,16 +243,41 @@ struct CudaCore_st {
 void dbgprintf(int level, const char *fmt, ...) _PRINTF_ARGS(2, 3);
 int cuCoreSortMemorySegs(const void *a, const void *b);
 void cuCoreSetErrorMsg(const char *fmt, ...) _PRINTF_ARGS(1, 2);
-void *cuCoreGetMapEntry(MapEntry **map, const char *fmt, ...) _PRINTF_ARGS(2, 3);
+CudbgDeviceTableEntry *cuCoreGetDevice(CudaCore *cc, uint32_t dev);
+CudbgCTATableEntry *cuCoreGetCTA(CudaCore *cc, uint32_t dev, uint32_t sm);
+CudbgWarpTableEntry *cuCoreGetWarp(CudaCore *cc, uint32_t dev, uint32_t sm,
+				   uint32_t wp);
+CudbgThreadTableEntry *cuCoreGetLane(CudaCore *cc, uint32_t dev, uint32_t sm,
+				     uint32_t wp, uint32_t ln);
+CudbgBacktraceTableEntry *cuCoreGetBacktrace(CudaCore *cc, uint32_t dev,
+					     uint32_t sm, uint32_t wp,
+					     uint32_t ln, uint32_t level);
+CudbgGridTableEntry *cuCoreGetGrid(CudaCore *cc, uint32_t dev,
+				   uint64_t gridId);
+CudbgContextTableEntry *cuCoreGetContext(CudaCore *cc, uint32_t dev,
+					 uint64_t contextId);
+Elf_Scn *cuCoreGetSharedMemory(CudaCore *cc, uint32_t dev, uint32_t sm);
+Elf_Scn *cuCoreGetLocalMemory(CudaCore *cc, uint32_t dev, uint32_t sm,
+			      uint32_t wp, uint32_t ln);
+Elf_Scn *cuCoreGetRegisters(CudaCore *cc, uint32_t dev, uint32_t sm,
+			    uint32_t wp, uint32_t ln);
+Elf_Scn *cuCoreGetPredicates(CudaCore *cc, uint32_t dev, uint32_t sm,
+			     uint32_t wp, uint32_t ln);
+Elf_Scn *cuCoreGetParamMemory(CudaCore *cc, uint32_t dev, uint64_t gridId);
+Elf_Scn *cuCoreGetELFImage(CudaCore *cc, uint64_t handle, bool relocated);
 size_t cuCoreGetNumDevices(CudaCore *cc);
 const char *cuCoreGetStrTabByIndex(CudaCore *cc, size_t idx);
 const CUDBGEvent *cuCoreGetEvent(CudaCore *cc);
 int cuCoreDeleteEvent(CudaCore *cc);
 int cuCoreReadSectionHeader(Elf_Scn *scn, Elf64_Shdr **shdr);
 int cuCoreReadSectionData(Elf *e, Elf_Scn *scn, Elf_Data *data);
+CodeRange *cuCoreFindCodeRange(CudaCore *cc, uint64_t addr, uint32_t sz);
+CUDBGResult cuCoreDisassemble(CudaCore *cc, uint32_t dev, uint64_t addr,
+			      const char **insn);
 
 /* Inner ELF images */
 typedef uint64_t cs_t;
+#define PTR2CS(ptr)	((cs_t)(uintptr_t)(ptr))
 void cuCoreExecuteCallStack(CudaCore *cc, cs_t *callStack);
 int cuCoreIterateELFImages(CudaCore *cc, cs_t *callStack);
 /* Callback type: ProcessELF */
@@ -213,14 +330,6 @@ static _INLINE int getBit(uint64_t val, unsigned bitNo) {
 			return errcode;					\
 		}							\
 	} while (0)
-
-#define GET_TABLE_ENTRY(entry, errcode, key, ...)			\
-	do {								\
-		(entry) = cuCoreGetMapEntry(&curcc->tableEntriesMap,	\
-					    key, __VA_ARGS__);		\
-		if ((entry) == NULL)					\
-			return errcode;					\
-	} while (0)
 #endif /* _MSC_VER */
 
 #endif /* _COMMON_H_ */
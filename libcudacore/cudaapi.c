@@ -36,18 +36,6 @@
 
 #define DEF_API_CALL(name)	static CUDBGResult cuCoreApi_##name
 #define API_CALL(name)		cuCoreApi_##name
-#define PTR2CS(ptr)		((cs_t)(uintptr_t)(ptr))
-
-#ifdef _WIN32
-#include <fcntl.h>
-
-static int mkstemp(char *name)
-{
-	if (_mktemp_s (name, TMPBUF_LEN))
-		return -1;
-	return open (name, O_RDWR);
-}
-#endif
 
 static __THREAD CudaCore *curcc;
 
@@ -82,14 +70,13 @@ DEF_API_CALL(getElfImage)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(size);
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_INVALID_MODULE,
-			"%celf_handle%llx",
-			relocated ? 'r' : 'u', gte->moduleHandle);
+			cuCoreGetELFImage(curcc, gte->moduleHandle, relocated));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -119,7 +106,8 @@ DEF_API_CALL(getNumSMs)(uint32_t dev, uint32_t *numSMs)
 
 	VERIFY_ARG(numSMs);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", dev);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, dev));
 
 	*numSMs = dte->numSMs;
 
@@ -134,7 +122,8 @@ DEF_API_CALL(getNumWarps)(uint32_t dev, uint32_t *numWarps)
 
 	VERIFY_ARG(numWarps);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", dev);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, dev));
 
 	*numWarps = dte->numWarpsPerSM;
 
@@ -149,7 +138,8 @@ DEF_API_CALL(getNumLanes)(uint32_t dev, uint32_t *numLanes)
 
 	VERIFY_ARG(numLanes);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", dev);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, dev));
 
 	*numLanes = dte->numLanesPerWarp;
 
@@ -164,7 +154,8 @@ DEF_API_CALL(getNumRegisters)(uint32_t dev, uint32_t *numRegs)
 
 	VERIFY_ARG(numRegs);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", dev);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, dev));
 
 	*numRegs = dte->numRegsPerLane;
 
@@ -203,18 +194,9 @@ DEF_API_CALL(lookupDeviceCodeSymbol)(char *symName, bool *symFound,
 DEF_API_CALL(readCodeMemory)(uint32_t dev, uint64_t addr, void *buf,
 			     uint32_t sz)
 {
-	CUDBGResult ret = CUDBG_ERROR_INVALID_MEMORY_ACCESS;
-
-	cs_t callStack[] = {
-		PTR2CS(cuCoreIterateELFImages), true,
-		PTR2CS(cuCoreIterateELFSections),
-		PTR2CS(cuCoreIterateSymbolTable),
-		PTR2CS(cuCoreFilterSymbolByType), STT_FUNC, PTR2CS(NULL),
-		PTR2CS(cuCoreFilterSymbolByAddress), addr, sz, PTR2CS(NULL),
-		PTR2CS(cuCoreReadSymbolSection), PTR2CS(NULL),
-		PTR2CS(cuCoreReadSymbolData), addr, PTR2CS(buf), sz, PTR2CS(&ret),
-		PTR2CS(NULL),
-	};
+	CodeRange *range;
+	Elf_Data data;
+	uint64_t offset;
 
 	TRACE_FUNC("dev=%u addr=0x%llx buf=%p sz=%u", dev, addr, buf, sz);
 
@@ -222,9 +204,21 @@ DEF_API_CALL(readCodeMemory)(uint32_t dev, uint64_t addr, void *buf,
 
 	memset(buf, 0, sz);
 
-	cuCoreExecuteCallStack(curcc, callStack);
+	range = cuCoreFindCodeRange(curcc, addr, sz);
+	if (range == NULL)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	if (cuCoreReadSectionData(range->e, range->scn, &data) != 0)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	offset = addr - range->start;
+
+	if (offset + sz > data.d_size)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
 
-	return ret;
+	memcpy(buf, (char *)data.d_buf + offset, sz);
+
+	return CUDBG_SUCCESS;
 }
 
 DEF_API_CALL(readGlobalMemory)(uint64_t addr, void *buf, uint32_t sz)
@@ -269,7 +263,7 @@ DEF_API_CALL(readSharedMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(buf);
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u_shared", sm, dev);
+			cuCoreGetSharedMemory(curcc, dev, sm));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -297,7 +291,7 @@ DEF_API_CALL(readLocalMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(buf);
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u_local", ln, wp, sm, dev);
+			cuCoreGetLocalMemory(curcc, dev, sm, wp, ln));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -332,13 +326,13 @@ DEF_API_CALL(readGenericMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(buf);
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	GET_TABLE_ENTRY(cte, CUDBG_ERROR_INVALID_CONTEXT,
-			"ctx%llu_dev%u", gte->contextId, dev);
+			cuCoreGetContext(curcc, dev, gte->contextId));
 
 	if (addr >= cte->sharedWindowBase && addr < cte->localWindowBase) {
 		return API_CALL(readSharedMemory)(dev, sm, wp,
@@ -368,13 +362,13 @@ DEF_API_CALL(readParamMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(buf);
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_UNKNOWN,
-			"grid%llu_dev%u_param", ctate->gridId64, dev);
+			cuCoreGetParamMemory(curcc, dev, ctate->gridId64));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -416,13 +410,13 @@ DEF_API_CALL(readWarpState)(uint32_t devId, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(state);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, devId);
+			cuCoreGetWarp(curcc, devId, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, devId);
+			cuCoreGetCTA(curcc, devId, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, devId);
+			cuCoreGetGrid(curcc, devId, ctate->gridId64));
 
 	memset(state, 0, sizeof(*state));
 	state->gridId = gte->gridId64;
@@ -446,7 +440,7 @@ DEF_API_CALL(readWarpState)(uint32_t devId, uint32_t sm, uint32_t wp,
 
 		/* For every valid lane there must be a corresponding ThreadTableEntry */
 		GET_TABLE_ENTRY(tte, CUDBG_ERROR_INTERNAL,
-				"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, devId);
+				cuCoreGetLane(curcc, devId, sm, wp, ln));
 
 		state->lane[ln].virtualPC = tte->virtualPC;
 		state->lane[ln].threadIdx.x = tte->threadIdxX;
@@ -469,7 +463,7 @@ DEF_API_CALL(readThreadIdx)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(threadIdx);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, dev);
+			cuCoreGetLane(curcc, dev, sm, wp, ln));
 
 	threadIdx->x = tte->threadIdxX;
 	threadIdx->y = tte->threadIdxY;
@@ -488,7 +482,7 @@ DEF_API_CALL(readVirtualPC)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(pc);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, dev);
+			cuCoreGetLane(curcc, dev, sm, wp, ln));
 
 	*pc = tte->virtualPC;
 
@@ -507,16 +501,16 @@ DEF_API_CALL(getTID)(uint32_t dev, uint32_t sm, uint32_t wp, uint32_t *tid)
 	VERIFY_ARG(tid);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	GET_TABLE_ENTRY(cte, CUDBG_ERROR_INVALID_CONTEXT,
-			"ctx%llu_dev%u", gte->contextId, dev);
+			cuCoreGetContext(curcc, dev, gte->contextId));
 
 	*tid = cte->tid;
 
@@ -534,10 +528,10 @@ DEF_API_CALL(readBlockIdx)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(blockIdx);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	blockIdx->x = ctate->blockIdxX;
 	blockIdx->y = ctate->blockIdxY;
@@ -558,13 +552,13 @@ DEF_API_CALL(getBlockDim)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(blockDim);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	blockDim->x = gte->blockDimX;
 	blockDim->y = gte->blockDimY;
@@ -585,13 +579,13 @@ DEF_API_CALL(getGridDim)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(gridDim);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	gridDim->x = gte->gridDimX;
 	gridDim->y = gte->gridDimY;
@@ -612,13 +606,13 @@ DEF_API_CALL(readGridId)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(gridId64);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	*gridId64 = gte->gridId64;
 
@@ -638,10 +632,10 @@ DEF_API_CALL(getGridInfo)(uint32_t devId, uint64_t gridId, CUDBGGridInfo *info)
 		return CUDBG_ERROR_INVALID_DEVICE;
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", gridId, devId);
+			cuCoreGetGrid(curcc, devId, gridId));
 
 	GET_TABLE_ENTRY(cte, CUDBG_ERROR_INVALID_CONTEXT,
-			"ctx%llu_dev%u", gte->contextId, devId);
+			cuCoreGetContext(curcc, devId, gte->contextId));
 
 	assert(gridId == gte->gridId64);
 	memset(info, 0, sizeof(*info));
@@ -678,7 +672,7 @@ DEF_API_CALL(getGridStatus)(uint32_t devId, uint64_t gridId,
 		return CUDBG_ERROR_INVALID_DEVICE;
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", gridId, devId);
+			cuCoreGetGrid(curcc, devId, gridId));
 
 	*status = gte->gridStatus;
 
@@ -717,7 +711,7 @@ DEF_API_CALL(readRegisterRange)(uint32_t devId, uint32_t sm, uint32_t wp,
 		return CUDBG_ERROR_INVALID_ARGS;
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_INVALID_ARGS,
-			"regs_dev%u_sm%u_wp%u_ln%u", devId, sm, wp, ln);
+			cuCoreGetRegisters(curcc, devId, sm, wp, ln));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -765,8 +759,7 @@ DEF_API_CALL(readBrokenWarps)(uint32_t devId, uint32_t sm,
 
 	*brokenWarpsMask = 0;
 	for (wp = 0; wp < warpsPerSM; ++wp) {
-		wte = cuCoreGetMapEntry(&curcc->tableEntriesMap,
-					"wp%u_sm%u_dev%u", wp, sm, devId);
+		wte = cuCoreGetWarp(curcc, devId, sm, wp);
 		if (wte && wte->isWarpBroken)
 			*brokenWarpsMask |= 1ULL << wp;
 	}
@@ -791,8 +784,7 @@ DEF_API_CALL(readValidWarps)(uint32_t devId, uint32_t sm,
 
 	*validWarpsMask = 0;
 	for (wp = 0; wp < warpsPerSM; ++wp) {
-		if (cuCoreGetMapEntry(&curcc->tableEntriesMap,
-				      "wp%u_sm%u_dev%u", wp, sm, devId))
+		if (cuCoreGetWarp(curcc, devId, sm, wp))
 			*validWarpsMask |= 1ULL << wp;
 	}
 
@@ -810,7 +802,7 @@ DEF_API_CALL(readValidLanes)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(validLanesMask);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	*validLanesMask = wte->validLanesMask;
 
@@ -828,7 +820,7 @@ DEF_API_CALL(readActiveLanes)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(activeLanesMask);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	*activeLanesMask = wte->activeLanesMask;
 
@@ -844,7 +836,8 @@ DEF_API_CALL(getSmType)(uint32_t devId, char *buf, uint32_t sz)
 
 	VERIFY_ARG(buf);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", devId);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, devId));
 
 	smType = cuCoreGetStrTabByIndex(curcc, dte->smType);
 	strncpy(buf, smType, sz);
@@ -861,7 +854,8 @@ DEF_API_CALL(getDeviceName)(uint32_t devId, char *buf, uint32_t sz)
 
 	VERIFY_ARG(buf);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", devId);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, devId));
 
 	devName = cuCoreGetStrTabByIndex(curcc, dte->devName);
 	strncpy(buf, devName, sz);
@@ -880,7 +874,8 @@ DEF_API_CALL(getDevicePCIBusInfo)(uint32_t devId, uint32_t *pciBusId,
 	VERIFY_ARG(pciBusId);
 	VERIFY_ARG(pciDevId);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", devId);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, devId));
 
 	*pciDevId = dte->pciDevId;
 	*pciBusId = dte->pciBusId;
@@ -897,7 +892,8 @@ DEF_API_CALL(getDeviceType)(uint32_t devId, char *buf, uint32_t sz)
 
 	VERIFY_ARG(buf);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", devId);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, devId));
 
 	devType = cuCoreGetStrTabByIndex(curcc, dte->devType);
 	strncpy(buf, devType, sz);
@@ -989,7 +985,7 @@ DEF_API_CALL(readErrorPC)(uint32_t devId, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(errorPCValid);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, devId);
+			cuCoreGetWarp(curcc, devId, sm, wp));
 
 	*errorPC = wte->errorPC;
 	*errorPCValid = wte->errorPCValid;
@@ -1007,7 +1003,7 @@ DEF_API_CALL(readPC)(uint32_t devId, uint32_t sm, uint32_t wp, uint32_t ln,
 	VERIFY_ARG(pc);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, devId);
+			cuCoreGetLane(curcc, devId, sm, wp, ln));
 
 	*pc = tte->physPC;
 
@@ -1027,8 +1023,7 @@ DEF_API_CALL(getElfImageByHandle)(uint32_t devId, uint64_t handle,
 	VERIFY_ARG(elfImage);
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_INVALID_ARGS,
-			"%celf_handle%llx",
-			type ? 'r':'u', handle);
+			cuCoreGetELFImage(curcc, handle, type));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -1052,7 +1047,7 @@ DEF_API_CALL(readLaneException)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(exception);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, dev);
+			cuCoreGetLane(curcc, dev, sm, wp, ln));
 
 	*exception = (CUDBGException_t)tte->exception;
 
@@ -1070,7 +1065,7 @@ DEF_API_CALL(readLaneStatus)(uint32_t devId, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(error);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, devId);
+			cuCoreGetLane(curcc, devId, sm, wp, ln));
 
 	*error = tte->exception != CUDBG_EXCEPTION_UNKNOWN;
 
@@ -1088,7 +1083,7 @@ DEF_API_CALL(readSyscallCallDepth)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(depth);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, dev);
+			cuCoreGetLane(curcc, dev, sm, wp, ln));
 
 	*depth = tte->syscallCallDepth;
 
@@ -1106,7 +1101,7 @@ DEF_API_CALL(readCallDepth)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(depth);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, dev);
+			cuCoreGetLane(curcc, dev, sm, wp, ln));
 
 	*depth = tte->callDepth;
 
@@ -1124,7 +1119,7 @@ DEF_API_CALL(readReturnAddress)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(ra);
 
 	GET_TABLE_ENTRY(bte, CUDBG_ERROR_INVALID_CALL_LEVEL,
-			"bt%u_ln%u_wp%u_sm%u_dev%u", level, ln, wp, sm, dev);
+			cuCoreGetBacktrace(curcc, dev, sm, wp, ln, level));
 
 	*ra = bte->returnAddress;
 
@@ -1143,7 +1138,7 @@ DEF_API_CALL(readVirtualReturnAddress)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(ra);
 
 	GET_TABLE_ENTRY(bte, CUDBG_ERROR_INVALID_CALL_LEVEL,
-			"bt%u_ln%u_wp%u_sm%u_dev%u", level, ln, wp, sm, dev);
+			cuCoreGetBacktrace(curcc, dev, sm, wp, ln, level));
 
 	*ra = bte->virtualReturnAddress;
 
@@ -1201,7 +1196,8 @@ DEF_API_CALL(getNumPredicates)(uint32_t dev, uint32_t *numPredicates)
 
 	VERIFY_ARG(numPredicates);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", dev);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, dev));
 
 	*numPredicates = dte->numPredicatesPrLane;
 
@@ -1235,7 +1231,7 @@ DEF_API_CALL(readPredicates)(uint32_t dev, uint32_t sm, uint32_t wp,
 		return CUDBG_ERROR_INVALID_ARGS;
 
 	GET_TABLE_ENTRY(scn, CUDBG_ERROR_INVALID_ARGS,
-			"pred_dev%u_sm%u_wp%u_ln%u", dev, sm, wp, ln);
+			cuCoreGetPredicates(curcc, dev, sm, wp, ln));
 
 	if (cuCoreReadSectionData(curcc->e, scn, &data) != 0)
 		return CUDBG_ERROR_UNKNOWN;
@@ -1261,7 +1257,7 @@ DEF_API_CALL(readCCRegister)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(val);
 
 	GET_TABLE_ENTRY(tte, CUDBG_ERROR_INVALID_LANE,
-			"ln%u_wp%u_sm%u_dev%u", ln, wp, sm, dev);
+			cuCoreGetLane(curcc, dev, sm, wp, ln));
 
 	*val = tte->ccRegister;
 
@@ -1284,13 +1280,13 @@ DEF_API_CALL(getGridAttributes)(uint32_t dev, uint32_t sm, uint32_t wp,
 	VERIFY_ARG(pairs);
 
 	GET_TABLE_ENTRY(wte, CUDBG_ERROR_INVALID_WARP,
-			"wp%u_sm%u_dev%u", wp, sm, dev);
+			cuCoreGetWarp(curcc, dev, sm, wp));
 
 	GET_TABLE_ENTRY(ctate, CUDBG_ERROR_UNKNOWN,
-			"cta_sm%u_dev%u", sm, dev);
+			cuCoreGetCTA(curcc, dev, sm));
 
 	GET_TABLE_ENTRY(gte, CUDBG_ERROR_INVALID_GRID,
-			"grid%llu_dev%u", ctate->gridId64, dev);
+			cuCoreGetGrid(curcc, dev, ctate->gridId64));
 
 	for (pairId = 0; pairId < numPairs; ++pairId) {
 		pair = &pairs[pairId];
@@ -1368,13 +1364,7 @@ DEF_API_CALL(disassemble)(uint32_t dev, uint64_t addr, uint32_t *instSize,
 			  char *buf, uint32_t sz)
 {
 	CudbgDeviceTableEntry *dte;
-	uint64_t inst;
-	size_t len;
-	FILE *f;
-	int tmpFd;
-	const char *termPath = "*/";
-	char *p, *q;
-	char command[TMPBUF_LEN], tmpbuf[TMPBUF_LEN], tmpFilename[TMPBUF_LEN];
+	const char *insn;
 	CUDBGResult rc;
 
 	TRACE_FUNC("dev=%u addr=0x%llx instSize=%p buf=%p sz=%u",
@@ -1383,66 +1373,19 @@ DEF_API_CALL(disassemble)(uint32_t dev, uint64_t addr, uint32_t *instSize,
 	VERIFY_ARG(instSize);
 	VERIFY_ARG(buf);
 
-	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE, "dev%u", dev);
+	GET_TABLE_ENTRY(dte, CUDBG_ERROR_INVALID_DEVICE,
+			cuCoreGetDevice(curcc, dev));
 
-	rc = API_CALL(readCodeMemory)(dev, addr, &inst, sizeof(inst));
+	rc = cuCoreDisassemble(curcc, dev, addr, &insn);
 	if (rc != CUDBG_SUCCESS)
 		return rc;
 
 	*instSize = dte->instructionSize;
 
-	DPRINTF(30, "Instruction at 0x%llx: 0x%llx\n", addr, inst);
-
-	_SNPRINTF(tmpFilename, sizeof(tmpFilename), DISASM_TMP_TEMPLATE);
-	tmpFd = mkstemp(tmpFilename);
-	VERIFY(tmpFd != -1, CUDBG_ERROR_UNKNOWN, "Call to mkstemp failed.");
-	VERIFY(write(tmpFd, (void *)&inst, sizeof(inst)) == sizeof(inst),
-	       CUDBG_ERROR_UNKNOWN, "Write to temporary file failed");
-	close(tmpFd);
-
-	_SNPRINTF(command, sizeof(command), "nvdisasm -raw -b SM%u%u %s",
-		 dte->smMajor, dte->smMinor, tmpFilename);
-
-	DPRINTF(30, "Running command '%s'.\n", command);
-
-	f = _POPEN(command, "r");
-	if (!f) {
-		unlink(tmpFilename);
-		cuCoreSetErrorMsg("Could not execute dissassembly command");
-		return CUDBG_ERROR_UNKNOWN;
-	}
-
-	/* Read command output */
-	for (;;) {
-		if (!fgets(tmpbuf, sizeof(tmpbuf), f)) {
-			_PCLOSE(f);
-			unlink(tmpFilename);
-			return CUDBG_ERROR_UNKNOWN;
-		}
-
-		if ((p = strstr(tmpbuf, termPath))) {
-			p += 4;
-			break;
-		}
-	}
-
-	_PCLOSE(f);
-	unlink(tmpFilename);
-
-	len = strlen(p);
-
-	/* Strip out leading whitespace */
-	for (; len && *p == ' '; ++p);
-
-	/* Strip out trailing junk (everything after ";" ) */
-	if ((q = strstr(p, ";")))
-		*q = 0;
-
-	/* Recompute length */
-	len = strlen(p);
+	DPRINTF(30, "Instruction at 0x%llx: %s\n", addr, insn);
 
 	/* Write out the result */
-	strncpy(buf, p, sz);
+	strncpy(buf, insn, sz);
 
 	return CUDBG_SUCCESS;
 }
@@ -45,8 +45,15 @@
 #define ERRMSG_LEN			256
 
 static __THREAD char lastErrMsg[ERRMSG_LEN];
-static int cuCoreAddMapEntry(MapEntry **, void *, const char *, ...)
- _PRINTF_ARGS(3,4);
+
+#ifdef _WIN32
+static int mkstemp(char *name)
+{
+	if (_mktemp_s (name, TMPBUF_LEN))
+		return -1;
+	return open (name, O_RDWR);
+}
+#endif
 
 void cuCoreSetErrorMsg(const char *fmt, ...)
 {
@@ -248,50 +255,294 @@ static int cuCoreGenericReadTable(Elf *e, Elf_Scn *scn,
 	return 0;
 }
 
-static int cuCoreAddMapEntry(MapEntry **map, void *entryPtr,
-			     const char *fmt, ...)
+static void *cuCoreAlloc(CudaCore *cc, size_t size)
 {
-	MapEntry *mapEntry;
-	va_list args;
+	CudaCoreAlloc *alloc;
 
-	va_start(args, fmt);
+	alloc = calloc(1, sizeof(*alloc) + size);
+	VERIFY(alloc != NULL, NULL, "Could not allocate memory");
 
-	mapEntry = malloc(sizeof(*mapEntry));
-	VERIFY(mapEntry != NULL, -1, "Could not allocate memory");
+	alloc->u.next = cc->allocs;
+	cc->allocs = alloc;
 
-	vsnprintf(mapEntry->ident, MAPIDENT_LEN, fmt, args);
-	mapEntry->entryPtr = entryPtr;
+	return alloc + 1;
+}
 
-	DPRINTF(80, "Mapped '%s' to %p\n", mapEntry->ident, entryPtr);
+static CudaCoreSection *cuCoreAddSectionTable(CudaCore *cc, Elf_Scn *scn,
+					      uint32_t type, void *table,
+					      size_t count, size_t entrySize)
+{
+	CudaCoreSection *section;
+	size_t ndxscn;
 
-	HASH_ADD_STR(*map, ident, mapEntry);
+	ndxscn = elfGetSectionIndex(cc->e, scn);
+	VERIFY(ndxscn < cc->shnum, NULL, "Invalid section index %llu",
+	       (unsigned long long)ndxscn);
 
-	return 0;
+	section = &cc->sections[ndxscn];
+	section->type = type;
+	section->table = table;
+	section->count = count;
+	section->entrySize = entrySize;
+
+	return section;
 }
 
-void *cuCoreGetMapEntry(MapEntry **map, const char *fmt, ...)
+/* Return the row at the given offset of a table section, as referenced by
+ * the sh_link/sh_info pair of a child section. */
+static void *cuCoreGetSectionRow(CudaCore *cc, size_t ndxscn, size_t offset,
+				 uint32_t type, CudaCoreSection **section)
 {
-	MapEntry *mapEntry;
-	va_list args;
-	char ident[MAPIDENT_LEN];
+	CudaCoreSection *s;
 
-	va_start(args, fmt);
-	vsnprintf(ident, MAPIDENT_LEN, fmt, args);
+	if (ndxscn >= cc->shnum)
+		return NULL;
+
+	s = &cc->sections[ndxscn];
+	if (s->type != type || s->table == NULL || offset >= s->count)
+		return NULL;
+
+	if (section != NULL)
+		*section = s;
+
+	return (char *)s->table + offset * s->entrySize;
+}
+
+static CudbgDeviceTableEntry *cuCoreGetDeviceByIndex(CudaCore *cc,
+						     size_t idx)
+{
+	if (cc->deviceTable == NULL || idx >= cc->numDevices)
+		return NULL;
+
+	return &cc->deviceTable[idx];
+}
+
+static IdMapEntry *cuCoreFindId(CudaCore *cc, IdMapKind kind,
+				uint32_t dev, uint64_t id)
+{
+	IdMapEntry *idEntry;
+	IdMapKey key;
+
+	key.id = id;
+	key.dev = dev;
+	key.kind = kind;
+
+	HASH_FIND(hh, cc->idMap, &key, sizeof(key), idEntry);
+
+	return idEntry;
+}
+
+static void cuCoreAddId(CudaCore *cc, IdMapEntry *idEntry, IdMapKind kind,
+			uint32_t dev, uint64_t id, void *entryPtr)
+{
+	idEntry->key.id = id;
+	idEntry->key.dev = dev;
+	idEntry->key.kind = kind;
+	idEntry->entryPtr = entryPtr;
+
+	DPRINTF(80, "Mapped id %u:%llu dev%u to %p\n", kind,
+		(unsigned long long)id, dev, entryPtr);
+
+	HASH_ADD(hh, cc->idMap, key, sizeof(idEntry->key), idEntry);
+}
+
+static CudaCoreSm *cuCoreFindSm(CudaCore *cc, uint32_t dev, uint32_t sm)
+{
+	CudaCoreDevice *device;
+
+	if (dev >= cc->numDeviceIds)
+		return NULL;
+
+	device = &cc->devices[dev];
+	if (device->dte == NULL || sm >= device->dte->numSMs)
+		return NULL;
+
+	return &device->sms[sm];
+}
+
+static CudaCoreWarp *cuCoreFindWarp(CudaCore *cc, uint32_t dev, uint32_t sm,
+				    uint32_t wp)
+{
+	CudaCoreSm *smEntry = cuCoreFindSm(cc, dev, sm);
+
+	if (smEntry == NULL || wp >= cc->devices[dev].dte->numWarpsPerSM)
+		return NULL;
+
+	return &smEntry->warps[wp];
+}
+
+static CudaCoreLane *cuCoreFindLane(CudaCore *cc, uint32_t dev, uint32_t sm,
+				    uint32_t wp, uint32_t ln)
+{
+	CudaCoreWarp *warp = cuCoreFindWarp(cc, dev, sm, wp);
+
+	if (warp == NULL || warp->lanes == NULL ||
+	    ln >= cc->devices[dev].dte->numLanesPerWarp)
+		return NULL;
+
+	return &warp->lanes[ln];
+}
+
+CudbgDeviceTableEntry *cuCoreGetDevice(CudaCore *cc, uint32_t dev)
+{
+	VERIFY(dev < cc->numDeviceIds && cc->devices[dev].dte != NULL, NULL,
+	       "Device %u not found", dev);
+
+	return cc->devices[dev].dte;
+}
+
+CudbgCTATableEntry *cuCoreGetCTA(CudaCore *cc, uint32_t dev, uint32_t sm)
+{
+	CudaCoreSm *smEntry = cuCoreFindSm(cc, dev, sm);
+
+	VERIFY(smEntry != NULL && smEntry->ctate != NULL, NULL,
+	       "CTA not found on dev%u sm%u", dev, sm);
+
+	return smEntry->ctate;
+}
+
+CudbgWarpTableEntry *cuCoreGetWarp(CudaCore *cc, uint32_t dev, uint32_t sm,
+				   uint32_t wp)
+{
+	CudaCoreWarp *warp = cuCoreFindWarp(cc, dev, sm, wp);
+
+	VERIFY(warp != NULL && warp->wte != NULL, NULL,
+	       "Warp dev%u sm%u wp%u not found", dev, sm, wp);
+
+	return warp->wte;
+}
+
+CudbgThreadTableEntry *cuCoreGetLane(CudaCore *cc, uint32_t dev, uint32_t sm,
+				     uint32_t wp, uint32_t ln)
+{
+	CudaCoreLane *lane = cuCoreFindLane(cc, dev, sm, wp, ln);
+
+	VERIFY(lane != NULL && lane->tte != NULL, NULL,
+	       "Lane dev%u sm%u wp%u ln%u not found", dev, sm, wp, ln);
+
+	return lane->tte;
+}
+
+CudbgBacktraceTableEntry *cuCoreGetBacktrace(CudaCore *cc, uint32_t dev,
+					     uint32_t sm, uint32_t wp,
+					     uint32_t ln, uint32_t level)
+{
+	CudaCoreLane *lane = cuCoreFindLane(cc, dev, sm, wp, ln);
+	size_t i;
+
+	VERIFY(lane != NULL && lane->bt != NULL, NULL,
+	       "Backtrace of dev%u sm%u wp%u ln%u not found", dev, sm, wp, ln);
+
+	/* Levels are normally stored in order */
+	if (level < lane->btCount && lane->bt[level].level == level)
+		return &lane->bt[level];
+
+	for (i = 0; i < lane->btCount; ++i)
+		if (lane->bt[i].level == level)
+			return &lane->bt[i];
+
+	VERIFY(false, NULL, "Backtrace level %u of dev%u sm%u wp%u ln%u "
+	       "not found", level, dev, sm, wp, ln);
+}
+
+CudbgGridTableEntry *cuCoreGetGrid(CudaCore *cc, uint32_t dev,
+				   uint64_t gridId)
+{
+	IdMapEntry *idEntry = cuCoreFindId(cc, ID_MAP_GRID, dev, gridId);
+
+	VERIFY(idEntry != NULL, NULL, "Grid %llu not found on dev%u",
+	       (unsigned long long)gridId, dev);
 
-	HASH_FIND_STR(*map, ident, mapEntry);
-	VERIFY(mapEntry != NULL, NULL, "Map entry '%s' not found", ident);
+	return idEntry->entryPtr;
+}
+
+CudbgContextTableEntry *cuCoreGetContext(CudaCore *cc, uint32_t dev,
+					 uint64_t contextId)
+{
+	IdMapEntry *idEntry = cuCoreFindId(cc, ID_MAP_CONTEXT, dev, contextId);
+
+	VERIFY(idEntry != NULL, NULL, "Context %llu not found on dev%u",
+	       (unsigned long long)contextId, dev);
+
+	return idEntry->entryPtr;
+}
+
+Elf_Scn *cuCoreGetSharedMemory(CudaCore *cc, uint32_t dev, uint32_t sm)
+{
+	CudaCoreSm *smEntry = cuCoreFindSm(cc, dev, sm);
+
+	VERIFY(smEntry != NULL && smEntry->sharedMemScn != NULL, NULL,
+	       "Shared memory of dev%u sm%u not found", dev, sm);
+
+	return smEntry->sharedMemScn;
+}
 
-	DPRINTF(90, "Got map entry '%s' %p\n",
-		mapEntry->ident, mapEntry->entryPtr);
+Elf_Scn *cuCoreGetLocalMemory(CudaCore *cc, uint32_t dev, uint32_t sm,
+			      uint32_t wp, uint32_t ln)
+{
+	CudaCoreLane *lane = cuCoreFindLane(cc, dev, sm, wp, ln);
+
+	VERIFY(lane != NULL && lane->localMemScn != NULL, NULL,
+	       "Local memory of dev%u sm%u wp%u ln%u not found",
+	       dev, sm, wp, ln);
 
-	return mapEntry->entryPtr;
+	return lane->localMemScn;
+}
+
+Elf_Scn *cuCoreGetRegisters(CudaCore *cc, uint32_t dev, uint32_t sm,
+			    uint32_t wp, uint32_t ln)
+{
+	CudaCoreLane *lane = cuCoreFindLane(cc, dev, sm, wp, ln);
+
+	VERIFY(lane != NULL && lane->regsScn != NULL, NULL,
+	       "Registers of dev%u sm%u wp%u ln%u not found",
+	       dev, sm, wp, ln);
+
+	return lane->regsScn;
+}
+
+Elf_Scn *cuCoreGetPredicates(CudaCore *cc, uint32_t dev, uint32_t sm,
+			     uint32_t wp, uint32_t ln)
+{
+	CudaCoreLane *lane = cuCoreFindLane(cc, dev, sm, wp, ln);
+
+	VERIFY(lane != NULL && lane->predScn != NULL, NULL,
+	       "Predicates of dev%u sm%u wp%u ln%u not found",
+	       dev, sm, wp, ln);
+
+	return lane->predScn;
+}
+
+Elf_Scn *cuCoreGetParamMemory(CudaCore *cc, uint32_t dev, uint64_t gridId)
+{
+	IdMapEntry *idEntry = cuCoreFindId(cc, ID_MAP_GRID, dev, gridId);
+
+	VERIFY(idEntry != NULL && idEntry->scn != NULL, NULL,
+	       "Parameter memory of grid %llu on dev%u not found",
+	       (unsigned long long)gridId, dev);
+
+	return idEntry->scn;
+}
+
+Elf_Scn *cuCoreGetELFImage(CudaCore *cc, uint64_t handle, bool relocated)
+{
+	IdMapEntry *idEntry;
+
+	idEntry = cuCoreFindId(cc, relocated ? ID_MAP_RELF_IMAGE :
+			       ID_MAP_ELF_IMAGE, 0, handle);
+	VERIFY(idEntry != NULL, NULL, "ELF image 0x%llx not found",
+	       (unsigned long long)handle);
+
+	return idEntry->scn;
 }
 
 static int cuCoreReadDeviceTable(CudaCore *cc, Elf_Scn *scn)
 {
 	size_t dte_count;
 	CudbgDeviceTableEntry *dt, *dte;
-	size_t i;
+	CudaCoreDevice *device;
+	CudaCoreWarp *warps;
+	size_t i, sm;
 
 	if (cuCoreGenericReadTable(cc->e, scn,
 				   &dte_count,
@@ -301,18 +552,29 @@ static int cuCoreReadDeviceTable(CudaCore *cc, Elf_Scn *scn)
 		return -1;
 
 	cc->numDevices = dte_count;
+	cc->deviceTable = dt;
+
+	for (i = 0; i < dte_count; ++i)
+		if (dt[i].devId >= cc->numDeviceIds)
+			cc->numDeviceIds = dt[i].devId + 1;
+
+	cc->devices = cuCoreAlloc(cc, cc->numDeviceIds * sizeof(*cc->devices));
+	if (cc->devices == NULL)
+		return -1;
 
 	for (i = 0; i < dte_count; ++i) {
 		dte = &dt[i];
+		device = &cc->devices[dte->devId];
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-				      "dev%u",
-				      dte->devId))
+		device->dte = dte;
+		device->sms = cuCoreAlloc(cc, dte->numSMs * sizeof(*device->sms));
+		warps = cuCoreAlloc(cc, (size_t)dte->numSMs * dte->numWarpsPerSM *
+				    sizeof(*warps));
+		if (device->sms == NULL || warps == NULL)
 			return -1;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-			"devtbl_offset%llu", (unsigned long long)i))
-			return -1;
+		for (sm = 0; sm < dte->numSMs; ++sm)
+			device->sms[sm].warps = &warps[sm * dte->numWarpsPerSM];
 	}
 
 	return 0;
@@ -323,6 +585,7 @@ static int cuCoreReadGridTable(CudaCore *cc, Elf_Scn *scn)
 	size_t gte_count;
 	CudbgGridTableEntry *gt, *gte;
 	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *section;
 	size_t parent, offset;
 	size_t i;
 
@@ -333,32 +596,23 @@ static int cuCoreReadGridTable(CudaCore *cc, Elf_Scn *scn)
 				   &parent, &offset) != 0)
 		return -1;
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"devtbl_offset%llu",
-				(unsigned long long)offset);
+	dte = cuCoreGetDeviceByIndex(cc, offset);
 	VERIFY(dte != NULL, -1, "Could not find Device table entry");
 
-	for (i = 0; i < gte_count; ++i) {
-		gte = &gt[i];
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, gte,
-				      "grid%llu_dev%u",
-				      (unsigned long long)gte->gridId64,
-				      dte->devId))
-			return -1;
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_GRID_TABLE, gt,
+					gte_count, sizeof(*gt));
+	if (section == NULL)
+		return -1;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, gte,
-				      "grid_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn),
-					  (unsigned long long)i))
-			return -1;
+	section->dte = dte;
+	section->ids = cuCoreAlloc(cc, gte_count * sizeof(*section->ids));
+	if (section->ids == NULL)
+		return -1;
 
-		/* Index dte by grid section and offset */
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-				      "grid_section%llu_offset%llu_dev",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn),
-					  (unsigned long long)i))
-			return -1;
+	for (i = 0; i < gte_count; ++i) {
+		gte = &gt[i];
+		cuCoreAddId(cc, &section->ids[i], ID_MAP_GRID, dte->devId,
+			    gte->gridId64, gte);
 	}
 
 	return 0;
@@ -369,6 +623,8 @@ static int cuCoreReadSmTable(CudaCore *cc, Elf_Scn *scn)
 	size_t ste_count;
 	CudbgSmTableEntry *st, *ste;
 	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *section;
+	CudaCoreSm *smEntry;
 	size_t parent, offset;
 	size_t i;
 
@@ -379,30 +635,24 @@ static int cuCoreReadSmTable(CudaCore *cc, Elf_Scn *scn)
 				   &parent, &offset) != 0)
 		return -1;
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"devtbl_offset%llu",
-				(unsigned long long)offset);
+	dte = cuCoreGetDeviceByIndex(cc, offset);
 	VERIFY(dte != NULL, -1, "Could not find Device table entry");
 
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_SM_TABLE, st,
+					ste_count, sizeof(*st));
+	if (section == NULL)
+		return -1;
+
+	section->dte = dte;
+
 	for (i = 0; i < ste_count; ++i) {
 		ste = &st[i];
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ste,
-				      "sm%u_dev%u",
-				      ste->smId,
-				      dte->devId))
-			return -1;
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ste,
-				      "smtbl_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+		smEntry = cuCoreFindSm(cc, dte->devId, ste->smId);
+		VERIFY(smEntry != NULL, -1, "Invalid SM id %u on dev%u",
+		       ste->smId, dte->devId);
 
-		/* Link SM table entry to device */
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-				      "smtbl_section%llu_offset%llu_dev",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+		smEntry->ste = ste;
 	}
 
 	return 0;
@@ -411,11 +661,11 @@ static int cuCoreReadSmTable(CudaCore *cc, Elf_Scn *scn)
 static int cuCoreReadCTATable(CudaCore *cc, Elf_Scn *scn)
 {
 	size_t ctate_count;
-	CudbgCTATableEntry *ctat, *ctate;
+	CudbgCTATableEntry *ctat;
 	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *smSection, *section;
+	CudaCoreSm *smEntry;
 	size_t parent, offset;
-	size_t i;
 
 	if (cuCoreGenericReadTable(cc->e, scn,
 				   &ctate_count,
@@ -424,40 +674,24 @@ static int cuCoreReadCTATable(CudaCore *cc, Elf_Scn *scn)
 				   &parent, &offset) != 0)
 		return -1;
 
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"smtbl_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
+	ste = cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_SM_TABLE,
+				  &smSection);
 	VERIFY(ste != NULL, -1, "Could not find SM table entry");
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"smtbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by SM");
-
-	for (i = 0; i < ctate_count; ++i) {
-		ctate = &ctat[i];
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ctate,
-				      "cta_sm%u_dev%u",
-				      ste->smId,
-				      dte->devId))
-			return -1;
+	smEntry = cuCoreFindSm(cc, smSection->dte->devId, ste->smId);
+	VERIFY(smEntry != NULL, -1, "Could not find SM index entry");
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ctate,
-				      "ctatbl_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_CTA_TABLE, ctat,
+					ctate_count, sizeof(*ctat));
+	if (section == NULL)
+		return -1;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ste,
-				      "ctatbl_section%llu_offset%llu_sm",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+	section->dte = smSection->dte;
+	section->ste = ste;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-				      "ctatbl_section%llu_offset%llu_dev",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
-	}
+	/* CTAs are only looked up by SM */
+	if (ctate_count > 0)
+		smEntry->ctate = &ctat[ctate_count - 1];
 
 	return 0;
 }
@@ -467,8 +701,10 @@ static int cuCoreReadWarpTable(CudaCore *cc, Elf_Scn *scn)
 	size_t wte_count;
 	CudbgWarpTableEntry *wt, *wte;
 	CudbgCTATableEntry *ctate;
-	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *ctaSection, *section;
+	CudaCoreWarp *warp;
+	CudaCoreLane *lanes;
+	uint32_t numLanes;
 	size_t parent, offset;
 	size_t i;
 
@@ -479,45 +715,34 @@ static int cuCoreReadWarpTable(CudaCore *cc, Elf_Scn *scn)
 				   &parent, &offset) != 0)
 		return -1;
 
-	ctate = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				  "ctatbl_section%llu_offset%llu",
-				  (unsigned long long)parent, (unsigned long long)offset);
+	ctate = cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_CTA_TABLE,
+				    &ctaSection);
 	VERIFY(ctate != NULL, -1, "Could not find CTA table entry");
 
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"ctatbl_section%llu_offset%llu_sm",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(ste != NULL, -1, "Could not find SM table entry by CTA");
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_WP_TABLE, wt,
+					wte_count, sizeof(*wt));
+	if (section == NULL)
+		return -1;
+
+	section->dte = ctaSection->dte;
+	section->ste = ctaSection->ste;
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"ctatbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by CTA");
+	/* Lanes of all the warps of the table are allocated at once */
+	numLanes = section->dte->numLanesPerWarp;
+	lanes = cuCoreAlloc(cc, wte_count * numLanes * sizeof(*lanes));
+	if (lanes == NULL)
+		return -1;
 
 	for (i = 0; i < wte_count; ++i) {
 		wte = &wt[i];
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, wte,
-				      "wp%u_sm%u_dev%u",
-				      wte->warpId,
-				      ste->smId,
-				      dte->devId))
-			return -1;
+		warp = cuCoreFindWarp(cc, section->dte->devId,
+				      section->ste->smId, wte->warpId);
+		VERIFY(warp != NULL, -1, "Invalid warp id %u on dev%u sm%u",
+		       wte->warpId, section->dte->devId, section->ste->smId);
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, wte,
-				      "wptbl_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ste,
-				      "wptbl_section%llu_offset%llu_sm",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-				      "wptbl_section%llu_offset%llu_dev",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+		warp->wte = wte;
+		warp->lanes = &lanes[i * numLanes];
 	}
 
 	return 0;
@@ -528,108 +753,77 @@ static int cuCoreReadThreadTable(CudaCore *cc, Elf_Scn *scn)
 	size_t tt_count;
 	CudbgThreadTableEntry *tt, *tte;
 	CudbgWarpTableEntry *wte;
-	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *wpSection, *section;
+	CudaCoreLane *lane;
 	size_t parent, offset;
 	size_t i;
 
-	cuCoreGenericReadTable(cc->e, scn, &tt_count, (void **)&tt,
-			       sizeof(CudbgThreadTableEntry),
-			       &parent, &offset);
+	if (cuCoreGenericReadTable(cc->e, scn, &tt_count, (void **)&tt,
+				   sizeof(CudbgThreadTableEntry),
+				   &parent, &offset) != 0)
+		return -1;
 
-	wte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"wptbl_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
+	wte = cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_WP_TABLE,
+				  &wpSection);
 	VERIFY(wte != NULL, -1, "Could not find Warp table entry");
 
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"wptbl_section%llu_offset%llu_sm",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(ste != NULL, -1, "Could not find SM table entry by Warp");
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_LN_TABLE, tt,
+					tt_count, sizeof(*tt));
+	if (section == NULL)
+		return -1;
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"wptbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by Warp");
+	section->dte = wpSection->dte;
+	section->ste = wpSection->ste;
+	section->wte = wte;
 
 	for (i = 0; i < tt_count; ++i) {
 		tte = &tt[i];
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, tte,
-				      "ln%u_wp%u_sm%u_dev%u",
-				      tte->ln, wte->warpId,
-				      ste->smId, dte->devId))
-			return -1;
+		lane = cuCoreFindLane(cc, section->dte->devId,
+				      section->ste->smId, wte->warpId, tte->ln);
+		VERIFY(lane != NULL, -1, "Invalid lane id %u on dev%u sm%u wp%u",
+		       tte->ln, section->dte->devId, section->ste->smId,
+		       wte->warpId);
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, tte,
-				      "lntbl_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+		lane->tte = tte;
+	}
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, wte,
-				      "lntbl_section%llu_offset%llu_wp",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+	return 0;
+}
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, ste,
-				      "lntbl_section%llu_offset%llu_sm",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+/* Return the lane index entry of the thread table row referenced by the
+ * sh_link/sh_info pair of a section. */
+static CudaCoreLane *cuCoreGetLaneBySection(CudaCore *cc, size_t parent,
+					    size_t offset)
+{
+	CudbgThreadTableEntry *tte;
+	CudaCoreSection *lnSection;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, dte,
-				      "lntbl_section%llu_offset%llu_dev",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
-	}
+	tte = cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_LN_TABLE,
+				  &lnSection);
+	VERIFY(tte != NULL, NULL, "Could not find Thread table entry");
 
-	return 0;
+	return cuCoreFindLane(cc, lnSection->dte->devId, lnSection->ste->smId,
+			      lnSection->wte->warpId, tte->ln);
 }
 
 static int cuCoreReadBacktraceTable(CudaCore *cc, Elf_Scn *scn)
 {
 	size_t bt_count;
-	CudbgBacktraceTableEntry *bt, *bte;
-	CudbgThreadTableEntry *tte;
-	CudbgWarpTableEntry *wte;
-	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudbgBacktraceTableEntry *bt;
+	CudaCoreLane *lane;
 	size_t parent, offset;
-	size_t i;
 
-	cuCoreGenericReadTable(cc->e, scn, &bt_count, (void **)&bt,
-			       sizeof(CudbgBacktraceTableEntry),
-			       &parent, &offset);
-
-	tte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(tte != NULL, -1, "Could not find Thread table entry");
-
-	wte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_wp",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(wte != NULL, -1, "Could not find Warp table entry by Lane");
-
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_sm",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(ste != NULL, -1, "Could not find SM table entry by Lane");
-
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by Lane");
-
-	for (i = 0; i < bt_count; ++i) {
-		bte = &bt[i];
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, bte,
-				      "bt%u_ln%u_wp%u_sm%u_dev%u",
-				      bte->level, tte->ln,
-				      wte->warpId, ste->smId,
-				      dte->devId))
-			return -1;
-	}
+	if (cuCoreGenericReadTable(cc->e, scn, &bt_count, (void **)&bt,
+				   sizeof(CudbgBacktraceTableEntry),
+				   &parent, &offset) != 0)
+		return -1;
+
+	lane = cuCoreGetLaneBySection(cc, parent, offset);
+	VERIFY(lane != NULL, -1, "Could not find Lane by Backtrace table");
+
+	lane->bt = bt;
+	lane->btCount = bt_count;
 
 	return 0;
 }
@@ -639,6 +833,7 @@ static int cuCoreReadContextTable(CudaCore *cc, Elf_Scn *scn)
 	size_t cte_count;
 	CudbgContextTableEntry *ct, *cte;
 	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *section;
 	size_t parent, offset;
 	size_t i;
 	CUDBGEvent event;
@@ -650,24 +845,23 @@ static int cuCoreReadContextTable(CudaCore *cc, Elf_Scn *scn)
 				   &parent, &offset) != 0)
 		return -1;
 
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_CTX_TABLE, ct,
+					cte_count, sizeof(*ct));
+	if (section == NULL)
+		return -1;
+
+	section->ids = cuCoreAlloc(cc, cte_count * sizeof(*section->ids));
+	if (section->ids == NULL)
+		return -1;
+
 	for (i = 0; i < cte_count; ++i) {
 		cte = &ct[i];
 
-		dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-					"devtbl_offset%u",
-					cte->deviceIdx);
+		dte = cuCoreGetDeviceByIndex(cc, cte->deviceIdx);
 		VERIFY(dte != NULL, -1, "Could not find Device table entry");
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, cte,
-				      "ctx%llu_dev%u",
-				      (unsigned long long)cte->contextId,
-				      dte->devId))
-			return -1;
-
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, cte,
-				      "ctxtbl_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+		cuCoreAddId(cc, &section->ids[i], ID_MAP_CONTEXT, dte->devId,
+			    cte->contextId, cte);
 
 		/* Add context created event */
 		event.kind = CUDBG_EVENT_CTX_CREATE;
@@ -691,40 +885,33 @@ static int cuCoreReadContextTable(CudaCore *cc, Elf_Scn *scn)
 static int cuCoreReadModuleTable(CudaCore *cc, Elf_Scn *scn)
 {
 	size_t mt_count;
-	CudbgModuleTableEntry *mt, *mte;
+	CudbgModuleTableEntry *mt;
 	CudbgContextTableEntry *cte;
+	CudaCoreSection *section;
 	size_t parent, offset;
-	size_t i;
 
-	cuCoreGenericReadTable(cc->e, scn, &mt_count, (void **)&mt,
-			       sizeof(CudbgModuleTableEntry),
-			       &parent, &offset);
+	if (cuCoreGenericReadTable(cc->e, scn, &mt_count, (void **)&mt,
+				   sizeof(CudbgModuleTableEntry),
+				   &parent, &offset) != 0)
+		return -1;
 
-	cte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"ctxtbl_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
+	cte = cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_CTX_TABLE, NULL);
 	VERIFY(cte != NULL, -1, "Could not find Context table entry");
 
-	for (i = 0; i < mt_count; ++i) {
-		mte = &mt[i];
+	section = cuCoreAddSectionTable(cc, scn, CUDBG_SHT_MOD_TABLE, mt,
+					mt_count, sizeof(*mt));
+	if (section == NULL)
+		return -1;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, mte,
-				      "modtbl_section%llu_offset%llu",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
+	section->cte = cte;
 
-		if (cuCoreAddMapEntry(&cc->tableEntriesMap, cte,
-				      "modtbl_section%llu_offset%llu_ctx",
-					  (unsigned long long)elfGetSectionIndex(cc->e, scn), (unsigned long long)i))
-			return -1;
-	}
 	return 0;
 }
 
 static int cuCoreReadSharedMemorySection(CudaCore *cc, Elf_Scn *scn)
 {
-	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *ctaSection;
+	CudaCoreSm *smEntry;
 	Elf64_Shdr *shdr;
 	size_t parent, offset;
 
@@ -734,75 +921,38 @@ static int cuCoreReadSharedMemorySection(CudaCore *cc, Elf_Scn *scn)
 	parent = shdr->sh_link;
 	offset = shdr->sh_info;
 
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"ctatbl_section%llu_offset%llu_sm",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(ste != NULL, -1, "Could not find SM table entry");
+	VERIFY(cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_CTA_TABLE,
+				   &ctaSection) != NULL,
+	       -1, "Could not find CTA table entry");
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"ctatbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry");
+	smEntry = cuCoreFindSm(cc, ctaSection->dte->devId,
+			       ctaSection->ste->smId);
+	VERIFY(smEntry != NULL, -1, "Could not find SM index entry");
 
-	if (cuCoreAddMapEntry(&cc->tableEntriesMap, scn,
-			      "cta_sm%u_dev%u_shared",
-			      ste->smId,
-			      dte->devId))
-		return -1;
+	smEntry->sharedMemScn = scn;
 
 	return 0;
 }
 
 static int cuCoreReadLocalMemorySection(CudaCore *cc, Elf_Scn *scn)
 {
-	CudbgThreadTableEntry *tte;
-	CudbgWarpTableEntry *wte;
-	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreLane *lane;
 	Elf64_Shdr *shdr;
-	size_t parent, offset;
 
 	if (cuCoreReadSectionHeader(scn, &shdr) != 0)
 		return -1;
 
-	parent = shdr->sh_link;
-	offset = shdr->sh_info;
+	lane = cuCoreGetLaneBySection(cc, shdr->sh_link, shdr->sh_info);
+	VERIFY(lane != NULL, -1, "Could not find Lane by Local memory");
 
-	tte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(tte != NULL, -1, "Could not find Thread table entry");
-
-	wte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_wp",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(wte != NULL, -1, "Could not find Warp table entry by Lane");
-
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_sm",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(ste != NULL, -1, "Could not find SM table entry by Lane");
-
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by Lane");
-
-	if (cuCoreAddMapEntry(&cc->tableEntriesMap, scn,
-			      "ln%u_wp%u_sm%u_dev%u_local",
-			      tte->ln,
-			      wte->warpId,
-			      ste->smId,
-			      dte->devId))
-		return -1;
+	lane->localMemScn = scn;
 
 	return 0;
 }
 
 static int cuCoreReadParamMemorySection(CudaCore *cc, Elf_Scn *scn)
 {
-	CudbgGridTableEntry *gte;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *gridSection;
 	Elf64_Shdr *shdr;
 	size_t parent, offset;
 
@@ -812,21 +962,11 @@ static int cuCoreReadParamMemorySection(CudaCore *cc, Elf_Scn *scn)
 	parent = shdr->sh_link;
 	offset = shdr->sh_info;
 
-	gte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"grid_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(gte != NULL, -1, "Could not find Grid table entry");
+	VERIFY(cuCoreGetSectionRow(cc, parent, offset, CUDBG_SHT_GRID_TABLE,
+				   &gridSection) != NULL,
+	       -1, "Could not find Grid table entry");
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"grid_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by Grid");
-
-	if (cuCoreAddMapEntry(&cc->tableEntriesMap, scn,
-			      "grid%llu_dev%u_param",
-			      (unsigned long long)gte->gridId64,
-			      dte->devId))
-		return -1;
+	gridSection->ids[offset].scn = scn;
 
 	return 0;
 }
@@ -855,43 +995,62 @@ static void cuCoreRemoveELFImage(CudaCoreELFImage **elf)
 	CudaCoreELFImage *tmp = *elf;
 	assert(tmp != NULL);
 	*elf = tmp->next;
+	if (tmp->image != NULL)
+		elfFree(tmp->image);
 	free(tmp);
 }
 
+/* Return the ELF handle of an image embedded in the core dump. The handle
+ * is created on first use and kept until the core dump is freed. */
+static Elf *cuCoreGetELFImageHandle(CudaCoreELFImage *elfImage)
+{
+	Elf_Data data;
+
+	if (elfImage->image != NULL)
+		return elfImage->image;
+
+	if (cuCoreReadSectionData(elfImage->e, elfImage->scn, &data) != 0)
+		return NULL;
+
+	elfImage->image = elfOpenInMemory(data.d_buf, data.d_size, NULL);
+	VERIFY(elfImage->image != NULL, NULL,
+	       "Failed loading ELF from memory: %s", elfErrorMsg());
+
+	return elfImage->image;
+}
+
 static int cuCoreReadELFImage(CudaCore *cc, Elf_Scn *scn, bool reloc)
 {
 	Elf64_Shdr *hdr;
 	CudbgModuleTableEntry *mte;
 	CudbgContextTableEntry *cte;
 	CudbgDeviceTableEntry *dte;
+	CudaCoreSection *modSection;
+	IdMapEntry *idEntry;
 	CUDBGEvent event;
 
 	if (cuCoreReadSectionHeader(scn, &hdr))
 		return -1;
 
-	mte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"modtbl_section%u_offset%u",
-				hdr->sh_link, hdr->sh_info);
+	mte = cuCoreGetSectionRow(cc, hdr->sh_link, hdr->sh_info,
+				  CUDBG_SHT_MOD_TABLE, &modSection);
 	VERIFY(mte != NULL, -1, "Could not find Module table entry");
 
 	/* Hash the ELFs SCN by module handle */
-	if (cuCoreAddMapEntry(&cc->tableEntriesMap, scn,
-			      "%celf_handle%llx",
-			      reloc ? 'r' : 'u',
-			      (unsigned long long)readUint64(&mte->moduleHandle)))
+	idEntry = cuCoreAlloc(cc, sizeof(*idEntry));
+	if (idEntry == NULL)
 		return -1;
 
+	idEntry->scn = scn;
+	cuCoreAddId(cc, idEntry, reloc ? ID_MAP_RELF_IMAGE : ID_MAP_ELF_IMAGE,
+		    0, readUint64(&mte->moduleHandle), scn);
+
 	if (!reloc)
 		return 0;
 
-	cte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"modtbl_section%u_offset%u_ctx",
-				hdr->sh_link, hdr->sh_info);
-	VERIFY(cte != NULL, -1, "Could not find Context table entry");
+	cte = modSection->cte;
 
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"devtbl_offset%u",
-				cte->deviceIdx);
+	dte = cuCoreGetDeviceByIndex(cc, cte->deviceIdx);
 	VERIFY(dte != NULL, -1, "Could not find Device table entry");
 
 	/* Add module loaded event */
@@ -921,46 +1080,22 @@ static int cuCoreReadRelocatedELFImage(CudaCore *cc, Elf_Scn *scn)
 	return cuCoreReadELFImage(cc, scn, true);
 }
 
-static int cuCoreReadThreadInfo(const char *key, CudaCore *cc, Elf_Scn *scn)
+static int cuCoreReadThreadInfo(CudaCore *cc, Elf_Scn *scn, bool predicates)
 {
-	CudbgThreadTableEntry *tte;
-	CudbgWarpTableEntry *wte;
-	CudbgSmTableEntry *ste;
-	CudbgDeviceTableEntry *dte;
+	CudaCoreLane *lane;
 	Elf64_Shdr *shdr;
-	size_t parent, offset;
 
 	if (cuCoreReadSectionHeader(scn, &shdr) != 0)
 		return -1;
 
-	parent = shdr->sh_link;
-	offset = shdr->sh_info;
+	lane = cuCoreGetLaneBySection(cc, shdr->sh_link, shdr->sh_info);
+	VERIFY(lane != NULL, -1, "Could not find Lane by %s section",
+	       predicates ? "predicates" : "registers");
 
-	tte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(tte != NULL, -1, "Could not find Thread table entry");
-
-	wte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_wp",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(wte != NULL, -1, "Could not find Warp table entry by Lane");
-
-	ste = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_sm",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(ste != NULL, -1, "Could not find SM table entry by Lane");
-
-	dte = cuCoreGetMapEntry(&cc->tableEntriesMap,
-				"lntbl_section%llu_offset%llu_dev",
-				(unsigned long long)parent, (unsigned long long)offset);
-	VERIFY(dte != NULL, -1, "Could not find Device table entry by Lane");
-
-	/* Hash by dev, sm, wp and ln indexes */
-	if (cuCoreAddMapEntry(&cc->tableEntriesMap, scn,
-			      "%s_dev%u_sm%u_wp%u_ln%u", key,
-			      dte->devId, ste->smId, wte->warpId, tte->ln))
-		return -1;
+	if (predicates)
+		lane->predScn = scn;
+	else
+		lane->regsScn = scn;
 
 	return 0;
 }
@@ -1052,9 +1187,9 @@ static int cuCoreProcessSection(CudaCore *cc, bool *processed, Elf_Scn *scn)
 	case CUDBG_SHT_CTA_TABLE:
 		return cuCoreReadCTATable(cc, scn);
 	case CUDBG_SHT_DEV_REGS:
-		return cuCoreReadThreadInfo("regs", cc, scn);
+		return cuCoreReadThreadInfo(cc, scn, false);
 	case CUDBG_SHT_DEV_PRED:
-		return cuCoreReadThreadInfo("pred", cc, scn);
+		return cuCoreReadThreadInfo(cc, scn, true);
 	default:
 		DPRINTF(5, "Found section of unknown type (0x%x)\n",
 			shdr->sh_type);
@@ -1081,6 +1216,13 @@ static int cuCoreReadSections(CudaCore *cc)
 	processed = calloc(cc->shnum, sizeof(*processed));
 	VERIFY(processed != NULL, -1, "Could not allocate memory");
 
+	cc->sections = calloc(cc->shnum, sizeof(*cc->sections));
+	if (cc->sections == NULL) {
+		free(processed);
+		cuCoreSetErrorMsg("Could not allocate memory");
+		return -1;
+	}
+
 	while ((scn = elfGetNextSection(cc->e, scn)) != NULL) {
 		if (cuCoreProcessSection(cc, processed, scn) != 0) {
 			ret = -1;
@@ -1171,24 +1313,13 @@ int cuCoreIterateELFImages(CudaCore *cc, cs_t *callStack)
 	for (elfImage = relocated ? cc->relocatedELFImageHead : NULL;
 			elfImage != NULL && ret == 0;
 			elfImage = elfImage->next) {
-		Elf_Data data;
-
-		if (cuCoreReadSectionData(elfImage->e, elfImage->scn, &data) != 0) {
-			DPRINTF(1, "Skipping: %s\n", cuCoreErrorMsg());
-			continue;
-		}
-
-
-		e = elfOpenInMemory(data.d_buf, data.d_size, NULL);
+		e = cuCoreGetELFImageHandle(elfImage);
 		if (e == NULL) {
-			DPRINTF(1, "Skipping: Failed loading ELF from memory: %s\n",
-				elfErrorMsg());
+			DPRINTF(1, "Skipping: %s\n", cuCoreErrorMsg());
 			continue;
 		}
 
 		ret = processELF(cc, e, callStack);
-
-		elfFree(e);
 	}
 
 	return ret;
@@ -1413,6 +1544,324 @@ int cuCoreReadSymbolData(CudaCore *cc, Elf *e, Elf_Scn *scn,
 	return 1;
 }
 
+/* Code range array descriptor */
+static UT_icd codeRange_icd = { sizeof(CodeRange), NULL, NULL, NULL };
+
+static int cuCoreSortCodeRanges(const void *a, const void *b)
+{
+	const CodeRange *rangeA = a;
+	const CodeRange *rangeB = b;
+
+	if (rangeA->start != rangeB->start)
+		return rangeA->start > rangeB->start ? 1 : -1;
+	if (rangeA->end != rangeB->end)
+		return rangeA->end > rangeB->end ? 1 : -1;
+	return 0;
+}
+
+/* Callback type: ProcessSymbol */
+static int cuCoreAddCodeRange(CudaCore *cc, Elf *e, Elf_Scn *scn,
+			      Elf64_Shdr *shdr, Elf64_Sym *sym,
+			      cs_t *callStack)
+{
+	CodeRange range;
+
+	range.start = readUint64(&sym->st_value);
+	range.end = range.start + readUint64(&sym->st_size);
+	range.maxEnd = range.end;
+	range.e = e;
+	range.scn = elfGetSection(e, sym->st_shndx);
+
+	if (range.scn == NULL || range.end == range.start)
+		return 0;
+
+	utarray_push_back(cc->codeRanges, &range);
+
+	return 0;
+}
+
+static int cuCoreBuildCodeRanges(CudaCore *cc)
+{
+	CodeRange *range;
+	uint64_t maxEnd = 0;
+	unsigned i;
+
+	cs_t callStack[] = {
+		PTR2CS(cuCoreIterateELFImages), true,
+		PTR2CS(cuCoreIterateELFSections),
+		PTR2CS(cuCoreIterateSymbolTable),
+		PTR2CS(cuCoreFilterSymbolByType), STT_FUNC, PTR2CS(NULL),
+		PTR2CS(cuCoreAddCodeRange),
+		PTR2CS(NULL),
+	};
+
+	utarray_new(cc->codeRanges, &codeRange_icd);
+
+	cuCoreExecuteCallStack(cc, callStack);
+
+	utarray_sort(cc->codeRanges, cuCoreSortCodeRanges);
+
+	/* Functions may overlap: keep the largest end seen so far to know
+	 * when to stop searching backward. */
+	for (i = 0; i < utarray_len(cc->codeRanges); ++i) {
+		range = (CodeRange *)_utarray_eltptr(cc->codeRanges, i);
+		if (range->end > maxEnd)
+			maxEnd = range->end;
+		range->maxEnd = maxEnd;
+	}
+
+	DPRINTF(10, "Indexed %u function ranges.\n",
+		utarray_len(cc->codeRanges));
+
+	return 0;
+}
+
+/* Find the function range containing [addr, addr + sz). The index is built
+ * on first use, once all the ELF images have been loaded. */
+CodeRange *cuCoreFindCodeRange(CudaCore *cc, uint64_t addr, uint32_t sz)
+{
+	CodeRange *range;
+	unsigned lo, hi, mid;
+
+	if (cc->codeRanges == NULL && cuCoreBuildCodeRanges(cc) != 0)
+		return NULL;
+
+	/* Find the first range starting after addr */
+	lo = 0;
+	hi = utarray_len(cc->codeRanges);
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		range = (CodeRange *)_utarray_eltptr(cc->codeRanges, mid);
+		if (range->start <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* Walk back through the ranges that may still contain addr */
+	while (lo-- > 0) {
+		range = (CodeRange *)_utarray_eltptr(cc->codeRanges, lo);
+		if (range->maxEnd <= addr)
+			break;
+		if (addr + sz <= range->end)
+			return range;
+	}
+
+	return NULL;
+}
+
+static int cuCoreAddDisasmEntry(CudaCoreDevice *device, uint64_t addr,
+				const char *insn)
+{
+	DisasmEntry *entry;
+
+	HASH_FIND(hh, device->disasmCache, &addr, sizeof(addr), entry);
+	if (entry != NULL)
+		return 0;
+
+	entry = malloc(sizeof(*entry));
+	VERIFY(entry != NULL, -1, "Could not allocate memory");
+
+	entry->addr = addr;
+	entry->insn = strdup(insn);
+	if (entry->insn == NULL) {
+		free(entry);
+		cuCoreSetErrorMsg("Could not allocate memory");
+		return -1;
+	}
+
+	HASH_ADD(hh, device->disasmCache, addr, sizeof(entry->addr), entry);
+
+	return 0;
+}
+
+/* Parse one line of nvdisasm raw output. Instruction lines start with
+ * their offset in the input as a comment, followed by the instruction and
+ * a comment with its encoding. Other lines are ignored. */
+static bool cuCoreParseDisasmLine(char *line, uint64_t *offset, char **insn)
+{
+	unsigned long long value;
+	char *p, *q;
+	int n = 0;
+
+	for (p = line; *p == ' ' || *p == '\t'; ++p);
+
+	if (sscanf(p, "/*%llx*/%n", &value, &n) != 1 || n == 0)
+		return false;
+
+	/* Strip out leading whitespace */
+	for (p += n; *p == ' ' || *p == '\t'; ++p);
+
+	/* Strip out trailing junk (everything after ";" ) */
+	if ((q = strchr(p, ';')))
+		*q = 0;
+	for (q = p + strlen(p); q > p && (q[-1] == ' ' || q[-1] == '\n' ||
+				       q[-1] == '\r' || q[-1] == '\t'); --q)
+		*(q - 1) = 0;
+
+	if (*p == 0)
+		return false;
+
+	*offset = value;
+	*insn = p;
+
+	return true;
+}
+
+/* Disassemble a block of code starting at addr in a single nvdisasm run,
+ * and cache all the instructions found in its output. */
+static CUDBGResult cuCoreRunDisassembler(CudaCore *cc, CudaCoreDevice *device,
+					 uint64_t addr, const void *code,
+					 size_t size)
+{
+	CudbgDeviceTableEntry *dte = device->dte;
+	uint64_t offset;
+	FILE *f;
+	int tmpFd;
+	char *insn;
+	char command[TMPBUF_LEN + 64], tmpbuf[TMPBUF_LEN];
+	char tmpFilename[TMPBUF_LEN];
+	CUDBGResult rc = CUDBG_SUCCESS;
+
+	_SNPRINTF(tmpFilename, sizeof(tmpFilename), DISASM_TMP_TEMPLATE);
+	tmpFd = mkstemp(tmpFilename);
+	VERIFY(tmpFd != -1, CUDBG_ERROR_UNKNOWN, "Call to mkstemp failed.");
+	if (write(tmpFd, code, size) != (ssize_t)size) {
+		close(tmpFd);
+		unlink(tmpFilename);
+		cuCoreSetErrorMsg("Write to temporary file failed");
+		return CUDBG_ERROR_UNKNOWN;
+	}
+	close(tmpFd);
+
+	_SNPRINTF(command, sizeof(command), "nvdisasm -raw -b SM%u%u %s",
+		 dte->smMajor, dte->smMinor, tmpFilename);
+
+	DPRINTF(30, "Running command '%s' on %llu bytes at 0x%llx.\n", command,
+		(unsigned long long)size, (unsigned long long)addr);
+
+	f = _POPEN(command, "r");
+	if (!f) {
+		unlink(tmpFilename);
+		cuCoreSetErrorMsg("Could not execute dissassembly command");
+		return CUDBG_ERROR_UNKNOWN;
+	}
+
+	++cc->disasmStats.spawns;
+
+	/* Read command output */
+	while (fgets(tmpbuf, sizeof(tmpbuf), f)) {
+		if (!cuCoreParseDisasmLine(tmpbuf, &offset, &insn) ||
+		    offset >= size)
+			continue;
+
+		if (cuCoreAddDisasmEntry(device, addr + offset, insn) != 0) {
+			rc = CUDBG_ERROR_UNKNOWN;
+			break;
+		}
+
+		++cc->disasmStats.instructions;
+	}
+
+	_PCLOSE(f);
+	unlink(tmpFilename);
+
+	return rc;
+}
+
+/* Return the disassembly of the instruction at addr. The whole function
+ * containing addr is disassembled on the first request, and the following
+ * requests are served from the device cache. */
+CUDBGResult cuCoreDisassemble(CudaCore *cc, uint32_t dev, uint64_t addr,
+			      const char **insn)
+{
+	CudaCoreDevice *device;
+	CodeRange *range;
+	DisasmEntry *entry;
+	DisasmRange *disasmRange;
+	Elf_Data data;
+	uint64_t size;
+	CUDBGResult rc;
+
+	VERIFY(cuCoreGetDevice(cc, dev) != NULL, CUDBG_ERROR_INVALID_DEVICE,
+	       "Device %u not found", dev);
+
+	device = &cc->devices[dev];
+
+	++cc->disasmStats.requests;
+
+	HASH_FIND(hh, device->disasmCache, &addr, sizeof(addr), entry);
+	if (entry != NULL) {
+		++cc->disasmStats.cacheHits;
+		*insn = entry->insn;
+		return CUDBG_SUCCESS;
+	}
+
+	range = cuCoreFindCodeRange(cc, addr, device->dte->instructionSize);
+	if (range == NULL)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	if (cuCoreReadSectionData(range->e, range->scn, &data) != 0)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	if (addr - range->start + device->dte->instructionSize > data.d_size)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	/* Devices of different architectures disassemble the same code
+	 * differently: each device keeps its own set of functions. */
+	HASH_FIND(hh, device->disasmRanges, &range->start,
+		  sizeof(range->start), disasmRange);
+	if (disasmRange == NULL) {
+		disasmRange = malloc(sizeof(*disasmRange));
+		VERIFY(disasmRange != NULL, CUDBG_ERROR_UNKNOWN,
+		       "Could not allocate memory");
+		disasmRange->start = range->start;
+		HASH_ADD(hh, device->disasmRanges, start,
+			 sizeof(disasmRange->start), disasmRange);
+
+		size = range->end - range->start;
+		if (size > data.d_size)
+			size = data.d_size;
+
+		/* A failed run (e.g. no nvdisasm) is not retried, and neither
+		 * is any instruction of the function on its own. */
+		disasmRange->result = cuCoreRunDisassembler(cc, device,
+							    range->start,
+							    data.d_buf, size);
+		if (disasmRange->result != CUDBG_SUCCESS)
+			return disasmRange->result;
+
+		HASH_FIND(hh, device->disasmCache, &addr, sizeof(addr), entry);
+	}
+
+	VERIFY(disasmRange->result == CUDBG_SUCCESS, disasmRange->result,
+	       "Disassembly of the function at 0x%llx failed",
+	       (unsigned long long)disasmRange->start);
+
+	/* Not an instruction boundary of the function listing: disassemble
+	 * that instruction alone. */
+	if (entry == NULL) {
+		rc = cuCoreRunDisassembler(cc, device, addr,
+					   (char *)data.d_buf + (addr - range->start),
+					   device->dte->instructionSize);
+		if (rc != CUDBG_SUCCESS)
+			return rc;
+
+		HASH_FIND(hh, device->disasmCache, &addr, sizeof(addr), entry);
+		if (entry == NULL)
+			return CUDBG_ERROR_UNKNOWN;
+	}
+
+	*insn = entry->insn;
+
+	return CUDBG_SUCCESS;
+}
+
+void cuCoreGetDisasmStats(CudaCore *cc, CudaCoreDisasmStats *stats)
+{
+	*stats = cc->disasmStats;
+}
+
 static int cuCoreInit(CudaCore *cc)
 {
 	Elf64_Ehdr *ehdr;
@@ -1440,9 +1889,9 @@ static int cuCoreInit(CudaCore *cc)
 	utarray_sort(cc->managedMemorySegs, cuCoreSortMemorySegs);
 	utarray_sort(cc->globalMemorySegs, cuCoreSortMemorySegs);
 
-	{ /* Get statistic on generic hash map */
-		unsigned int entries = HASH_COUNT(cc->tableEntriesMap);
-		DPRINTF(10, "Table entries map contains %d elements.\n",
+	{ /* Get statistic on id hash map */
+		unsigned int entries = HASH_COUNT(cc->idMap);
+		DPRINTF(10, "Id map contains %d elements.\n",
 			entries);
 	}
 
@@ -1461,19 +1910,42 @@ void cuCoreFree(CudaCore *cc)
 	while (cc->relocatedELFImageHead != NULL)
 		cuCoreRemoveELFImage(&cc->relocatedELFImageHead);
 
-	{ /* Cleanup table entries map */
-		MapEntry *mapEntry, *tmp;
-		HASH_ITER(hh, cc->tableEntriesMap, mapEntry, tmp) {
-			HASH_DEL(cc->tableEntriesMap, mapEntry);
-			free(mapEntry);
+	{ /* Cleanup disassembly caches */
+		DisasmEntry *entry, *tmp;
+		DisasmRange *disasmRange, *tmpRange;
+		size_t dev;
+
+		for (dev = 0; dev < cc->numDeviceIds; ++dev) {
+			HASH_ITER(hh, cc->devices[dev].disasmCache, entry, tmp) {
+				HASH_DEL(cc->devices[dev].disasmCache, entry);
+				free(entry->insn);
+				free(entry);
+			}
+			HASH_ITER(hh, cc->devices[dev].disasmRanges,
+				  disasmRange, tmpRange) {
+				HASH_DEL(cc->devices[dev].disasmRanges,
+					 disasmRange);
+				free(disasmRange);
+			}
 		}
 	}
 
+	/* Cleanup table index, the entries are owned by the allocations */
+	HASH_CLEAR(hh, cc->idMap);
+	while (cc->allocs != NULL) {
+		CudaCoreAlloc *alloc = cc->allocs;
+		cc->allocs = alloc->u.next;
+		free(alloc);
+	}
+	free(cc->sections);
+
 	/* Cleanup memory segments arrays */
 	if (cc->managedMemorySegs)
 		utarray_free(cc->managedMemorySegs);
 	if (cc->globalMemorySegs)
 		utarray_free(cc->globalMemorySegs);
+	if (cc->codeRanges)
+		utarray_free(cc->codeRanges);
 
 	if (cc->e != NULL)
 		elfFree(cc->e);
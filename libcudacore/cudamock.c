@@ -0,0 +1,2089 @@
+/*
+ * Copyright (c) 2014-2015 NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Simulated device for the CUDA debugger API.
+ *
+ * The device state is computed from a handful of parameters instead of
+ * being read from a core dump, so that the debugger can be exercised on
+ * grids of any size without a GPU.  The blocks of the grids are made
+ * resident round-robin over the SMs until the SMs are full; the blocks
+ * of a grid are interleaved with the blocks of the other grids.
+ *
+ * Lane PCs, exceptions, registers and memory contents are functions of
+ * the coordinates of the lane.  Writes to registers and memory are kept
+ * in an overlay so that they can be read back.  Every API call is
+ * counted and can be delayed to model the cost of a round trip to the
+ * driver.
+ *
+ * Every device runs the same grids, as if a launch were split over the
+ * devices.  The grids of a device run the functions of a single module,
+ * whose ELF image only has a section and a symbol for each function: no
+ * debug information.  The warps at the entry of their function are broken,
+ * so that a breakpoint there finds them.  With nested launches, the grids
+ * after the first are launched from the device by the first grid, which
+ * has then finished.
+ */
+
+#include "libcudacore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+#define DEF_API_CALL(name)	static CUDBGResult cuMockApi_##name
+#define API_CALL(name)		cuMockApi_##name
+
+/* Count the call and apply the simulated latency */
+#define MOCK_CALL(name)							\
+	do {								\
+		++curcm->stats[MOCK_CALL_##name].calls;			\
+		if (curcm->latency)					\
+			usleep(curcm->latency);				\
+	} while (0)
+
+#define MOCK_TID		1
+#define MOCK_CONTEXT_ID		0xc0de0000ULL
+#define MOCK_MODULE_ID		0x30de0000ULL
+#define MOCK_CODE_BASE		0x10000000ULL
+#define MOCK_FUNCTION_SIZE	0x10000ULL
+#define MOCK_INSN_SIZE		8
+#define MOCK_GLOBAL_BASE	0x200000000ULL
+#define MOCK_FUNCTION_PREFIX	"mock_kernel_"
+
+/* API calls implemented by the simulated device */
+#define MOCK_CALLS(X)							\
+	X(getNumDevices) X(getNumSMs) X(getNumWarps) X(getNumLanes)	\
+	X(getNumRegisters) X(getNumPredicates) X(getDeviceType)		\
+	X(getDeviceName) X(getSmType) X(getDevicePCIBusInfo)		\
+	X(readValidWarps) X(readBrokenWarps) X(readValidLanes)		\
+	X(readActiveLanes) X(readGridId) X(readBlockIdx)		\
+	X(readThreadIdx) X(readPC) X(readVirtualPC)			\
+	X(readLaneException) X(readLaneStatus) X(readErrorPC)		\
+	X(readWarpState) X(readDeviceExceptionState)			\
+	X(readCallDepth) X(readSyscallCallDepth)			\
+	X(readVirtualReturnAddress) X(readRegister)			\
+	X(readRegisterRange) X(readPredicates) X(readCCRegister)	\
+	X(writeRegister) X(readCodeMemory) X(readConstMemory)		\
+	X(readParamMemory) X(readSharedMemory) X(readLocalMemory)	\
+	X(readGenericMemory) X(readGlobalMemory) X(writeParamMemory)	\
+	X(writeSharedMemory) X(writeLocalMemory)			\
+	X(writeGenericMemory) X(writeGlobalMemory) X(getBlockDim)	\
+	X(getGridDim) X(getTID) X(getGridInfo) X(getGridStatus)	\
+	X(getGridAttributes) X(disassemble)				\
+	X(getAdjustedCodeAddress) X(isDeviceCodeAddress)		\
+	X(lookupDeviceCodeSymbol) X(getManagedMemoryRegionInfo)	\
+	X(getNextEvent) X(getElfImage32) X(getElfImage)			\
+	X(getElfImageByHandle) X(memcheckReadErrorAddress)
+
+#define MOCK_CALL_ENUM(name)	MOCK_CALL_##name,
+#define MOCK_CALL_NAME(name)	#name,
+
+enum {
+	MOCK_CALLS(MOCK_CALL_ENUM)
+	MOCK_CALL_MAX
+};
+
+static const char *mockCallNames[MOCK_CALL_MAX] = {
+	MOCK_CALLS(MOCK_CALL_NAME)
+};
+
+/* Memory segments and registers, as keys of the write overlay */
+typedef enum {
+	MOCK_SEG_REGISTER,
+	MOCK_SEG_PARAM,
+	MOCK_SEG_SHARED,
+	MOCK_SEG_LOCAL,
+	MOCK_SEG_GLOBAL,
+} MockSegment;
+
+typedef struct {
+	uint64_t addr;			/* Address, or register number */
+	uint32_t segment;
+	uint32_t dev;
+	uint32_t sm;
+	uint32_t wp;
+	uint32_t ln;
+} MockWriteKey;
+
+/* A written register, or a written byte of memory */
+typedef struct {
+	MockWriteKey key;
+	uint32_t value;
+	UT_hash_handle hh;
+} MockWrite;
+
+/* Resident warp, as mapped from its hardware coordinates */
+typedef struct {
+	uint32_t dev;
+	uint32_t grid;			/* Grid index, from 0 */
+	uint64_t block;			/* Linear block index in the grid */
+	uint32_t warp;			/* Warp index in the block */
+	uint64_t globalWarp;		/* Warp index over the devices */
+	uint32_t validLanes;
+} MockWarp;
+
+struct CudaMock_st {
+	/* Device geometry */
+	uint32_t numDevices;
+	uint32_t numSMs;
+	uint32_t numWarps;
+	uint32_t numLanes;
+	uint32_t numRegs;
+	uint32_t numPredicates;
+	char smType[16];
+
+	/* Grids, all of the same dimensions */
+	uint32_t numGrids;
+	uint32_t firstGrid;		/* First running grid, 1 if nested */
+	CuDim3 gridDim;
+	CuDim3 blockDim;
+	uint64_t gridBlocks;		/* Blocks per grid */
+	uint32_t blockThreads;		/* Threads per block */
+	uint32_t warpsPerBlock;
+	uint32_t blocksPerSM;		/* Resident blocks per SM */
+	uint64_t residentBlocks;	/* Resident blocks per device */
+
+	uint32_t numPCs;		/* Distinct PCs of the lanes */
+	uint64_t exceptionStride;	/* One warp in N has an exception */
+	uint32_t latency;		/* Delay of every call, in usec */
+
+	/* Segment sizes */
+	uint32_t paramSize;
+	uint32_t sharedSize;
+	uint32_t localSize;
+	uint32_t constSize;
+
+	void *elfImage[CUDBG_MAX_DEVICES]; /* Of the module of every device */
+	uint64_t elfImageSize;
+
+	MockWrite *writes;		/* Write overlay */
+	uint32_t nextEvent;		/* Index of the next event to report */
+	CudaMockCallStats stats[MOCK_CALL_MAX];
+};
+
+static __THREAD CudaMock *curcm;
+
+/* Configuration */
+
+static int mockParseDim(const char *str, CuDim3 *dim)
+{
+	char *end;
+
+	dim->x = dim->y = dim->z = 1;
+
+	dim->x = strtoul(str, &end, 0);
+	if (*end == 'x') {
+		dim->y = strtoul(end + 1, &end, 0);
+		if (*end == 'x')
+			dim->z = strtoul(end + 1, &end, 0);
+	}
+
+	return *end != '\0' || !dim->x || !dim->y || !dim->z;
+}
+
+static int mockParseUInt(const char *str, uint64_t *val)
+{
+	char *end;
+
+	*val = strtoull(str, &end, 0);
+
+	return end == str || *end != '\0';
+}
+
+static int mockConfigure(CudaMock *cm, const char *config)
+{
+	char *copy, *param, *value, *save = NULL;
+	uint64_t threads = 0, exceptions = 0, blocks, val;
+	bool haveGrid = false, haveDevices = false, haveSMs = false;
+	int err = 0;
+
+	copy = strdup(config ? config : "");
+	VERIFY(copy != NULL, -1, "Could not allocate memory");
+
+	for (param = strtok_r(copy, ",", &save); param != NULL && !err;
+	     param = strtok_r(NULL, ",", &save)) {
+		value = strchr(param, '=');
+		if (value == NULL) {
+			cuCoreSetErrorMsg("Missing value of '%s'", param);
+			err = -1;
+			break;
+		}
+		*value++ = '\0';
+
+		if (strcmp(param, "grid") == 0) {
+			err = mockParseDim(value, &cm->gridDim);
+			haveGrid = true;
+		} else if (strcmp(param, "block") == 0) {
+			err = mockParseDim(value, &cm->blockDim);
+		} else if (strcmp(param, "smtype") == 0) {
+			snprintf(cm->smType, sizeof(cm->smType), "%s", value);
+		} else if (mockParseUInt(value, &val)) {
+			err = -1;
+		} else if (strcmp(param, "devices") == 0) {
+			cm->numDevices = val;
+			haveDevices = true;
+		} else if (strcmp(param, "sms") == 0) {
+			cm->numSMs = val;
+			haveSMs = true;
+		} else if (strcmp(param, "warps") == 0) {
+			cm->numWarps = val;
+		} else if (strcmp(param, "lanes") == 0) {
+			cm->numLanes = val;
+		} else if (strcmp(param, "regs") == 0) {
+			cm->numRegs = val;
+		} else if (strcmp(param, "grids") == 0) {
+			cm->numGrids = val;
+		} else if (strcmp(param, "nested") == 0) {
+			cm->firstGrid = val != 0;
+		} else if (strcmp(param, "threads") == 0) {
+			threads = val;
+		} else if (strcmp(param, "pcs") == 0) {
+			cm->numPCs = val;
+		} else if (strcmp(param, "exceptions") == 0) {
+			exceptions = val;
+		} else if (strcmp(param, "latency") == 0) {
+			cm->latency = val;
+		} else if (strcmp(param, "shared") == 0) {
+			cm->sharedSize = val;
+		} else if (strcmp(param, "local") == 0) {
+			cm->localSize = val;
+		} else {
+			cuCoreSetErrorMsg("Unknown parameter '%s'", param);
+			err = -1;
+			break;
+		}
+
+		if (err)
+			cuCoreSetErrorMsg("Invalid value of '%s': %s",
+					  param, value);
+	}
+
+	free(copy);
+	if (err)
+		return err;
+
+	if (!cm->numDevices || cm->numDevices > CUDBG_MAX_DEVICES ||
+	    !cm->numSMs || cm->numSMs > CUDBG_MAX_SMS ||
+	    !cm->numWarps || cm->numWarps > CUDBG_MAX_WARPS ||
+	    cm->numGrids <= cm->firstGrid || !cm->numPCs ||
+	    !cm->numLanes || cm->numLanes > CUDBG_MAX_LANES) {
+		cuCoreSetErrorMsg("Invalid device geometry");
+		return -1;
+	}
+
+	cm->blockThreads = cm->blockDim.x * cm->blockDim.y * cm->blockDim.z;
+	cm->warpsPerBlock = (cm->blockThreads + cm->numLanes - 1) /
+			    cm->numLanes;
+	cm->blocksPerSM = cm->numWarps / cm->warpsPerBlock;
+	if (!cm->blocksPerSM) {
+		cuCoreSetErrorMsg("A block of %u threads does not fit in an SM",
+				  cm->blockThreads);
+		return -1;
+	}
+
+	/* A thread count is rounded up to whole blocks, and split over the
+	 * devices.  Unless given, there are enough devices and SMs for all
+	 * the blocks to be resident, as far as the debugger API allows, so
+	 * that every block of a larger grid has its own state. */
+	if (!haveGrid && threads) {
+		blocks = (threads + cm->blockThreads - 1) / cm->blockThreads;
+		if (!haveDevices) {
+			val = (uint64_t)cm->blocksPerSM *
+			      (haveSMs ? cm->numSMs : CUDBG_MAX_SMS);
+			val = (blocks * (cm->numGrids - cm->firstGrid) +
+			       val - 1) / val;
+			cm->numDevices = val < CUDBG_MAX_DEVICES ?
+					 (uint32_t)val : CUDBG_MAX_DEVICES;
+		}
+		blocks = (blocks + cm->numDevices - 1) / cm->numDevices;
+		VERIFY(blocks <= UINT32_MAX, -1, "Too many blocks in a grid");
+		cm->gridDim.x = blocks;
+		cm->gridDim.y = cm->gridDim.z = 1;
+	}
+	cm->gridBlocks = (uint64_t)cm->gridDim.x * cm->gridDim.y *
+			 cm->gridDim.z;
+
+	if (!haveSMs) {
+		val = (cm->gridBlocks * (cm->numGrids - cm->firstGrid) +
+		       cm->blocksPerSM - 1) /
+		      cm->blocksPerSM;
+		if (val > CUDBG_MAX_SMS)
+			val = CUDBG_MAX_SMS;
+		if (val > cm->numSMs)
+			cm->numSMs = val;
+	}
+
+	cm->residentBlocks = cm->gridBlocks * (cm->numGrids - cm->firstGrid);
+	if (cm->residentBlocks > (uint64_t)cm->blocksPerSM * cm->numSMs)
+		cm->residentBlocks = (uint64_t)cm->blocksPerSM * cm->numSMs;
+
+	if (exceptions) {
+		cm->exceptionStride = cm->residentBlocks * cm->warpsPerBlock *
+				      cm->numDevices / exceptions;
+		if (!cm->exceptionStride)
+			cm->exceptionStride = 1;
+	}
+
+	return 0;
+}
+
+/* Device state */
+
+static bool mockGetWarp(uint32_t dev, uint32_t sm, uint32_t wp, MockWarp *w)
+{
+	uint64_t resident;
+	uint32_t threads;
+
+	if (dev >= curcm->numDevices || sm >= curcm->numSMs ||
+	    wp >= curcm->numWarps)
+		return false;
+
+	if (wp / curcm->warpsPerBlock >= curcm->blocksPerSM)
+		return false;
+
+	resident = (uint64_t)(wp / curcm->warpsPerBlock) * curcm->numSMs + sm;
+	if (resident >= curcm->residentBlocks)
+		return false;
+
+	w->dev = dev;
+	w->grid = curcm->firstGrid +
+		  resident % (curcm->numGrids - curcm->firstGrid);
+	w->block = resident / (curcm->numGrids - curcm->firstGrid);
+	w->warp = wp % curcm->warpsPerBlock;
+	w->globalWarp = (dev * curcm->residentBlocks + resident) *
+			curcm->warpsPerBlock + w->warp;
+
+	threads = curcm->blockThreads - w->warp * curcm->numLanes;
+	if (threads >= 32)
+		w->validLanes = ~0U;
+	else
+		w->validLanes = (1U << threads) - 1;
+	if (curcm->numLanes < 32)
+		w->validLanes &= (1U << curcm->numLanes) - 1;
+
+	return true;
+}
+
+static bool mockGetLane(uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln,
+			MockWarp *w)
+{
+	return mockGetWarp(dev, sm, wp, w) && ln < curcm->numLanes &&
+	       getBit(w->validLanes, ln);
+}
+
+/* Every device has its own copy of the code, one function per grid */
+static uint64_t mockFunctionEntry(const CudaMock *cm, uint32_t dev,
+				  uint32_t grid)
+{
+	return MOCK_CODE_BASE +
+	       ((uint64_t)dev * cm->numGrids + grid) * MOCK_FUNCTION_SIZE;
+}
+
+static uint64_t mockLanePC(const MockWarp *w, uint32_t ln)
+{
+	return mockFunctionEntry(curcm, w->dev, w->grid) +
+	       ((w->globalWarp + ln) % curcm->numPCs) * MOCK_INSN_SIZE;
+}
+
+/* Threads of a warp run when they are at the PC of its first valid lane */
+static uint32_t mockActiveLanes(const MockWarp *w)
+{
+	uint32_t ln, first = 0, active = 0;
+
+	while (!getBit(w->validLanes, first))
+		++first;
+
+	for (ln = first; ln < curcm->numLanes; ++ln)
+		if (getBit(w->validLanes, ln) &&
+		    mockLanePC(w, ln) == mockLanePC(w, first))
+			active |= 1U << ln;
+
+	return active;
+}
+
+static bool mockWarpHasException(const MockWarp *w)
+{
+	return curcm->exceptionStride &&
+	       w->globalWarp % curcm->exceptionStride == 0;
+}
+
+/* The warps with an exception are broken, as are the warps whose active
+ * lanes are at the entry of their function, as if stopped at a breakpoint
+ * there */
+static bool mockWarpIsBroken(const MockWarp *w)
+{
+	uint32_t first = 0;
+
+	while (!getBit(w->validLanes, first))
+		++first;
+
+	return mockWarpHasException(w) ||
+	       mockLanePC(w, first) == mockFunctionEntry(curcm, w->dev, w->grid);
+}
+
+/* The first lane of a warp with an exception made an illegal access */
+static CUDBGException_t mockLaneException(const MockWarp *w, uint32_t ln)
+{
+	if (mockWarpHasException(w) && ln == 0)
+		return CUDBG_EXCEPTION_LANE_ILLEGAL_ADDRESS;
+
+	return CUDBG_EXCEPTION_NONE;
+}
+
+static void mockLinearToDim(uint64_t idx, const CuDim3 *dim, CuDim3 *res)
+{
+	res->x = idx % dim->x;
+	res->y = (idx / dim->x) % dim->y;
+	res->z = idx / ((uint64_t)dim->x * dim->y);
+}
+
+static uint32_t mockThreadInBlock(const MockWarp *w, uint32_t ln)
+{
+	return w->warp * curcm->numLanes + ln;
+}
+
+/* Thread index over the grids of all the devices */
+static uint64_t mockGlobalThread(const MockWarp *w, uint32_t ln)
+{
+	return (w->dev * curcm->gridBlocks + w->block) * curcm->blockThreads +
+	       mockThreadInBlock(w, ln);
+}
+
+/* ELF image */
+
+/* Sections of the image, followed by the text section of every grid */
+#define MOCK_SCN_SHSTRTAB	1
+#define MOCK_SCN_STRTAB		2
+#define MOCK_SCN_SYMTAB		3
+#define MOCK_SCN_TEXT		4
+
+/* Append str to a string table, and return its offset in the table */
+static uint32_t mockAddString(char *table, uint32_t *size, const char *str)
+{
+	uint32_t offset = *size;
+
+	strcpy(table + offset, str);
+	*size += strlen(str) + 1;
+
+	return offset;
+}
+
+/* Build the relocated image of the module of device dev: a text section
+ * and a function symbol for every grid, the size of its PCs.  The code
+ * reads as zeros, like the code memory. */
+static int mockBuildElfImage(CudaMock *cm, uint32_t dev)
+{
+	uint32_t numScns = MOCK_SCN_TEXT + cm->numGrids;
+	uint64_t functionSize, symOffset, strOffset, shstrOffset, shdrOffset;
+	uint32_t strSize = 1, shstrSize = 1, strPos = 1, shstrPos = 1;
+	uint32_t grid;
+	unsigned char *image;
+	Elf64_Ehdr *ehdr;
+	Elf64_Shdr *shdr;
+	Elf64_Sym *sym;
+	char name[64];
+
+	VERIFY(numScns < 0xff00, -1, "Too many grids for an ELF image");
+
+	functionSize = (uint64_t)cm->numPCs * MOCK_INSN_SIZE;
+	if (functionSize > MOCK_FUNCTION_SIZE)
+		functionSize = MOCK_FUNCTION_SIZE;
+
+	shstrSize += sizeof(".shstrtab") + sizeof(".strtab") + sizeof(".symtab");
+	for (grid = 0; grid < cm->numGrids; ++grid) {
+		snprintf(name, sizeof(name), MOCK_FUNCTION_PREFIX "%u", grid);
+		strSize += strlen(name) + 1;
+		shstrSize += strlen(".text.") + strlen(name) + 1;
+	}
+
+	/* Header, code, symbols, strings, then the section headers */
+	symOffset = sizeof(*ehdr) + cm->numGrids * functionSize;
+	strOffset = symOffset + (cm->numGrids + 1) * sizeof(*sym);
+	shstrOffset = strOffset + strSize;
+	shdrOffset = (shstrOffset + shstrSize + 7) & ~7ULL;
+
+	cm->elfImageSize = shdrOffset + numScns * sizeof(*shdr);
+	cm->elfImage[dev] = calloc(1, cm->elfImageSize);
+	VERIFY(cm->elfImage[dev] != NULL, -1, "Could not allocate memory");
+
+	image = cm->elfImage[dev];
+	ehdr = (Elf64_Ehdr *)image;
+	sym = (Elf64_Sym *)(image + symOffset);
+	shdr = (Elf64_Shdr *)(image + shdrOffset);
+
+	ehdr->e_ident[EI_MAG0] = ELFMAG0;
+	ehdr->e_ident[EI_MAG1] = ELFMAG1;
+	ehdr->e_ident[EI_MAG2] = ELFMAG2;
+	ehdr->e_ident[EI_MAG3] = ELFMAG3;
+	ehdr->e_ident[EI_CLASS] = ELFCLASS64;
+	ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+	ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr->e_type = ET_EXEC;
+	ehdr->e_machine = EM_CUDA;
+	ehdr->e_version = EV_CURRENT;
+	ehdr->e_shoff = shdrOffset;
+	ehdr->e_ehsize = sizeof(*ehdr);
+	ehdr->e_shentsize = sizeof(*shdr);
+	ehdr->e_shnum = numScns;
+	ehdr->e_shstrndx = MOCK_SCN_SHSTRTAB;
+
+	shdr[MOCK_SCN_SHSTRTAB].sh_name =
+		mockAddString((char *)image + shstrOffset, &shstrPos,
+			      ".shstrtab");
+	shdr[MOCK_SCN_SHSTRTAB].sh_type = SHT_STRTAB;
+	shdr[MOCK_SCN_SHSTRTAB].sh_offset = shstrOffset;
+	shdr[MOCK_SCN_SHSTRTAB].sh_size = shstrSize;
+	shdr[MOCK_SCN_SHSTRTAB].sh_addralign = 1;
+
+	shdr[MOCK_SCN_STRTAB].sh_name =
+		mockAddString((char *)image + shstrOffset, &shstrPos,
+			      ".strtab");
+	shdr[MOCK_SCN_STRTAB].sh_type = SHT_STRTAB;
+	shdr[MOCK_SCN_STRTAB].sh_offset = strOffset;
+	shdr[MOCK_SCN_STRTAB].sh_size = strSize;
+	shdr[MOCK_SCN_STRTAB].sh_addralign = 1;
+
+	shdr[MOCK_SCN_SYMTAB].sh_name =
+		mockAddString((char *)image + shstrOffset, &shstrPos,
+			      ".symtab");
+	shdr[MOCK_SCN_SYMTAB].sh_type = SHT_SYMTAB;
+	shdr[MOCK_SCN_SYMTAB].sh_offset = symOffset;
+	shdr[MOCK_SCN_SYMTAB].sh_size = (cm->numGrids + 1) * sizeof(*sym);
+	shdr[MOCK_SCN_SYMTAB].sh_link = MOCK_SCN_STRTAB;
+	shdr[MOCK_SCN_SYMTAB].sh_info = 1;	/* First global symbol */
+	shdr[MOCK_SCN_SYMTAB].sh_addralign = 8;
+	shdr[MOCK_SCN_SYMTAB].sh_entsize = sizeof(*sym);
+
+	for (grid = 0; grid < cm->numGrids; ++grid) {
+		snprintf(name, sizeof(name), MOCK_FUNCTION_PREFIX "%u", grid);
+		sym[grid + 1].st_name =
+			mockAddString((char *)image + strOffset, &strPos, name);
+		sym[grid + 1].st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+		sym[grid + 1].st_shndx = MOCK_SCN_TEXT + grid;
+		sym[grid + 1].st_value = mockFunctionEntry(cm, dev, grid);
+		sym[grid + 1].st_size = functionSize;
+
+		snprintf(name, sizeof(name), ".text." MOCK_FUNCTION_PREFIX "%u",
+			 grid);
+		shdr[MOCK_SCN_TEXT + grid].sh_name =
+			mockAddString((char *)image + shstrOffset, &shstrPos,
+				      name);
+		shdr[MOCK_SCN_TEXT + grid].sh_type = SHT_PROGBITS;
+		shdr[MOCK_SCN_TEXT + grid].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+		shdr[MOCK_SCN_TEXT + grid].sh_addr =
+			mockFunctionEntry(cm, dev, grid);
+		shdr[MOCK_SCN_TEXT + grid].sh_offset = sizeof(*ehdr) +
+						       grid * functionSize;
+		shdr[MOCK_SCN_TEXT + grid].sh_size = functionSize;
+		shdr[MOCK_SCN_TEXT + grid].sh_addralign = MOCK_INSN_SIZE;
+	}
+
+	return 0;
+}
+
+/* Write overlay */
+
+static MockWrite *mockFindWrite(MockSegment segment, uint32_t dev,
+				uint32_t sm, uint32_t wp, uint32_t ln,
+				uint64_t addr)
+{
+	MockWriteKey key;
+	MockWrite *write;
+
+	memset(&key, 0, sizeof(key));
+	key.segment = segment;
+	key.dev = dev;
+	key.sm = sm;
+	key.wp = wp;
+	key.ln = ln;
+	key.addr = addr;
+
+	HASH_FIND(hh, curcm->writes, &key, sizeof(key), write);
+
+	return write;
+}
+
+static CUDBGResult mockAddWrite(MockSegment segment, uint32_t dev,
+				uint32_t sm, uint32_t wp, uint32_t ln,
+				uint64_t addr, uint32_t value)
+{
+	MockWrite *write;
+
+	write = mockFindWrite(segment, dev, sm, wp, ln, addr);
+	if (write == NULL) {
+		write = calloc(1, sizeof(*write));
+		if (write == NULL)
+			return CUDBG_ERROR_INTERNAL;
+		write->key.segment = segment;
+		write->key.dev = dev;
+		write->key.sm = sm;
+		write->key.wp = wp;
+		write->key.ln = ln;
+		write->key.addr = addr;
+		HASH_ADD(hh, curcm->writes, key, sizeof(write->key), write);
+	}
+	write->value = value;
+
+	return CUDBG_SUCCESS;
+}
+
+/* Memory reads as the little-endian words SEED + ADDR / 4, unless written */
+static void mockReadMemory(MockSegment segment, uint32_t dev, uint32_t sm,
+			   uint32_t wp, uint32_t ln, uint64_t seed,
+			   uint64_t addr, void *buf, uint32_t sz)
+{
+	uint8_t *bytes = buf;
+	MockWrite *write;
+	uint32_t word;
+	uint32_t i;
+
+	for (i = 0; i < sz; ++i) {
+		word = (uint32_t)(seed + ((addr + i) >> 2));
+		bytes[i] = word >> (((addr + i) & 3) * 8);
+	}
+
+	if (curcm->writes == NULL)
+		return;
+
+	for (i = 0; i < sz; ++i) {
+		write = mockFindWrite(segment, dev, sm, wp, ln, addr + i);
+		if (write)
+			bytes[i] = write->value;
+	}
+}
+
+static CUDBGResult mockWriteMemory(MockSegment segment, uint32_t dev,
+				   uint32_t sm, uint32_t wp, uint32_t ln,
+				   uint64_t addr, const void *buf, uint32_t sz)
+{
+	const uint8_t *bytes = buf;
+	CUDBGResult rc;
+	uint32_t i;
+
+	for (i = 0; i < sz; ++i) {
+		rc = mockAddWrite(segment, dev, sm, wp, ln, addr + i,
+				  bytes[i]);
+		if (rc != CUDBG_SUCCESS)
+			return rc;
+	}
+
+	return CUDBG_SUCCESS;
+}
+
+static bool mockInSegment(uint64_t addr, uint32_t sz, uint64_t size)
+{
+	return addr <= size && sz <= size - addr;
+}
+
+static uint32_t mockReadRegister(const MockWarp *w, uint32_t sm, uint32_t wp,
+				 uint32_t ln, uint32_t regno)
+{
+	MockWrite *write;
+
+	if (curcm->writes) {
+		write = mockFindWrite(MOCK_SEG_REGISTER, w->dev, sm, wp, ln,
+				      regno);
+		if (write)
+			return write->value;
+	}
+
+	switch (regno) {
+	case 0:
+		return mockThreadInBlock(w, ln);
+	case 1:
+		return (uint32_t)w->block;
+	default:
+		return (uint32_t)(mockGlobalThread(w, ln) * 2654435761U) ^
+		       (regno * 40503U);
+	}
+}
+
+/* Device properties */
+
+DEF_API_CALL(doNothing)()
+{
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(notSupported)()
+{
+	return CUDBG_ERROR_UNKNOWN;
+}
+
+DEF_API_CALL(getNumDevices)(uint32_t *numDev)
+{
+	MOCK_CALL(getNumDevices);
+	VERIFY_ARG(numDev);
+
+	*numDev = curcm->numDevices;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getNumSMs)(uint32_t dev, uint32_t *numSMs)
+{
+	MOCK_CALL(getNumSMs);
+	VERIFY_ARG(numSMs);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*numSMs = curcm->numSMs;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getNumWarps)(uint32_t dev, uint32_t *numWarps)
+{
+	MOCK_CALL(getNumWarps);
+	VERIFY_ARG(numWarps);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*numWarps = curcm->numWarps;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getNumLanes)(uint32_t dev, uint32_t *numLanes)
+{
+	MOCK_CALL(getNumLanes);
+	VERIFY_ARG(numLanes);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*numLanes = curcm->numLanes;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getNumRegisters)(uint32_t dev, uint32_t *numRegs)
+{
+	MOCK_CALL(getNumRegisters);
+	VERIFY_ARG(numRegs);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*numRegs = curcm->numRegs;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getNumPredicates)(uint32_t dev, uint32_t *numPredicates)
+{
+	MOCK_CALL(getNumPredicates);
+	VERIFY_ARG(numPredicates);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*numPredicates = curcm->numPredicates;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getDeviceType)(uint32_t dev, char *buf, uint32_t sz)
+{
+	MOCK_CALL(getDeviceType);
+	VERIFY_ARG(buf);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	strncpy(buf, "GK110", sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getDeviceName)(uint32_t dev, char *buf, uint32_t sz)
+{
+	MOCK_CALL(getDeviceName);
+	VERIFY_ARG(buf);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	strncpy(buf, "Simulated Device", sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getSmType)(uint32_t dev, char *buf, uint32_t sz)
+{
+	MOCK_CALL(getSmType);
+	VERIFY_ARG(buf);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	strncpy(buf, curcm->smType, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getDevicePCIBusInfo)(uint32_t dev, uint32_t *pciBusId,
+				  uint32_t *pciDevId)
+{
+	MOCK_CALL(getDevicePCIBusInfo);
+	VERIFY_ARG(pciBusId);
+	VERIFY_ARG(pciDevId);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*pciBusId = dev;
+	*pciDevId = 0;
+
+	return CUDBG_SUCCESS;
+}
+
+/* Device state inspection */
+
+DEF_API_CALL(readValidWarps)(uint32_t dev, uint32_t sm, uint64_t *validWarpsMask)
+{
+	MockWarp w;
+	uint32_t wp;
+
+	MOCK_CALL(readValidWarps);
+	VERIFY_ARG(validWarpsMask);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+	if (sm >= curcm->numSMs)
+		return CUDBG_ERROR_INVALID_SM;
+
+	*validWarpsMask = 0;
+	for (wp = 0; wp < curcm->numWarps && wp < 64; ++wp)
+		if (mockGetWarp(dev, sm, wp, &w))
+			*validWarpsMask |= 1ULL << wp;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readBrokenWarps)(uint32_t dev, uint32_t sm,
+			      uint64_t *brokenWarpsMask)
+{
+	MockWarp w;
+	uint32_t wp;
+
+	MOCK_CALL(readBrokenWarps);
+	VERIFY_ARG(brokenWarpsMask);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+	if (sm >= curcm->numSMs)
+		return CUDBG_ERROR_INVALID_SM;
+
+	*brokenWarpsMask = 0;
+	for (wp = 0; wp < curcm->numWarps && wp < 64; ++wp)
+		if (mockGetWarp(dev, sm, wp, &w) && mockWarpIsBroken(&w))
+			*brokenWarpsMask |= 1ULL << wp;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readValidLanes)(uint32_t dev, uint32_t sm, uint32_t wp,
+			     uint32_t *validLanesMask)
+{
+	MockWarp w;
+
+	MOCK_CALL(readValidLanes);
+	VERIFY_ARG(validLanesMask);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*validLanesMask = w.validLanes;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readActiveLanes)(uint32_t dev, uint32_t sm, uint32_t wp,
+			      uint32_t *activeLanesMask)
+{
+	MockWarp w;
+
+	MOCK_CALL(readActiveLanes);
+	VERIFY_ARG(activeLanesMask);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*activeLanesMask = mockActiveLanes(&w);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readGridId)(uint32_t dev, uint32_t sm, uint32_t wp,
+			 uint64_t *gridId64)
+{
+	MockWarp w;
+
+	MOCK_CALL(readGridId);
+	VERIFY_ARG(gridId64);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*gridId64 = w.grid + 1;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readBlockIdx)(uint32_t dev, uint32_t sm, uint32_t wp,
+			   CuDim3 *blockIdx)
+{
+	MockWarp w;
+
+	MOCK_CALL(readBlockIdx);
+	VERIFY_ARG(blockIdx);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	mockLinearToDim(w.block, &curcm->gridDim, blockIdx);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readThreadIdx)(uint32_t dev, uint32_t sm, uint32_t wp,
+			    uint32_t ln, CuDim3 *threadIdx)
+{
+	MockWarp w;
+
+	MOCK_CALL(readThreadIdx);
+	VERIFY_ARG(threadIdx);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	mockLinearToDim(mockThreadInBlock(&w, ln), &curcm->blockDim, threadIdx);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readPC)(uint32_t dev, uint32_t sm, uint32_t wp, uint32_t ln,
+		     uint64_t *pc)
+{
+	MockWarp w;
+
+	MOCK_CALL(readPC);
+	VERIFY_ARG(pc);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*pc = mockLanePC(&w, ln) - mockFunctionEntry(curcm, w.dev, w.grid);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readVirtualPC)(uint32_t dev, uint32_t sm, uint32_t wp,
+			    uint32_t ln, uint64_t *pc)
+{
+	MockWarp w;
+
+	MOCK_CALL(readVirtualPC);
+	VERIFY_ARG(pc);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*pc = mockLanePC(&w, ln);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readLaneException)(uint32_t dev, uint32_t sm, uint32_t wp,
+				uint32_t ln, CUDBGException_t *exception)
+{
+	MockWarp w;
+
+	MOCK_CALL(readLaneException);
+	VERIFY_ARG(exception);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*exception = mockLaneException(&w, ln);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readLaneStatus)(uint32_t dev, uint32_t sm, uint32_t wp,
+			     uint32_t ln, bool *error)
+{
+	MockWarp w;
+
+	MOCK_CALL(readLaneStatus);
+	VERIFY_ARG(error);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*error = mockLaneException(&w, ln) != CUDBG_EXCEPTION_NONE;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readErrorPC)(uint32_t dev, uint32_t sm, uint32_t wp,
+			  uint64_t *errorPC, bool *errorPCValid)
+{
+	MockWarp w;
+
+	MOCK_CALL(readErrorPC);
+	VERIFY_ARG(errorPC);
+	VERIFY_ARG(errorPCValid);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*errorPCValid = mockWarpHasException(&w);
+	*errorPC = *errorPCValid ? mockLanePC(&w, 0) : 0;
+
+	return CUDBG_SUCCESS;
+}
+
+/* The illegal accesses dereference a null pointer */
+DEF_API_CALL(memcheckReadErrorAddress)(uint32_t dev, uint32_t sm, uint32_t wp,
+				       uint32_t ln, uint64_t *address,
+				       ptxStorageKind *storage)
+{
+	MockWarp w;
+
+	MOCK_CALL(memcheckReadErrorAddress);
+	VERIFY_ARG(address);
+	VERIFY_ARG(storage);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*address = 0;
+	*storage = mockLaneException(&w, ln) ==
+		   CUDBG_EXCEPTION_LANE_ILLEGAL_ADDRESS ?
+		   ptxGlobalStorage : ptxUNSPECIFIEDStorage;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readWarpState)(uint32_t dev, uint32_t sm, uint32_t wp,
+			    CUDBGWarpState *state)
+{
+	MockWarp w;
+	uint32_t ln;
+
+	MOCK_CALL(readWarpState);
+	VERIFY_ARG(state);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	memset(state, 0, sizeof(*state));
+	state->gridId = w.grid + 1;
+	mockLinearToDim(w.block, &curcm->gridDim, &state->blockIdx);
+	state->validLanes = w.validLanes;
+	state->activeLanes = mockActiveLanes(&w);
+	state->errorPCValid = mockWarpHasException(&w);
+	state->errorPC = state->errorPCValid ? mockLanePC(&w, 0) : 0;
+
+	for (ln = 0; ln < curcm->numLanes; ++ln) {
+		if (!getBit(w.validLanes, ln))
+			continue;
+
+		state->lane[ln].virtualPC = mockLanePC(&w, ln);
+		mockLinearToDim(mockThreadInBlock(&w, ln), &curcm->blockDim,
+				&state->lane[ln].threadIdx);
+		state->lane[ln].exception = mockLaneException(&w, ln);
+	}
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readDeviceExceptionState)(uint32_t dev, uint64_t *exceptionSMMask)
+{
+	MockWarp w;
+	uint32_t sm, wp;
+
+	MOCK_CALL(readDeviceExceptionState);
+	VERIFY_ARG(exceptionSMMask);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*exceptionSMMask = 0;
+	if (!curcm->exceptionStride)
+		return CUDBG_SUCCESS;
+
+	for (sm = 0; sm < curcm->numSMs && sm < 64; ++sm)
+		for (wp = 0; wp < curcm->numWarps; ++wp)
+			if (mockGetWarp(dev, sm, wp, &w) &&
+			    mockWarpHasException(&w)) {
+				*exceptionSMMask |= 1ULL << sm;
+				break;
+			}
+
+	return CUDBG_SUCCESS;
+}
+
+/* Kernels of the simulated device make no calls */
+
+DEF_API_CALL(readCallDepth)(uint32_t dev, uint32_t sm, uint32_t wp,
+			    uint32_t ln, uint32_t *depth)
+{
+	MockWarp w;
+
+	MOCK_CALL(readCallDepth);
+	VERIFY_ARG(depth);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*depth = 0;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readSyscallCallDepth)(uint32_t dev, uint32_t sm, uint32_t wp,
+				   uint32_t ln, uint32_t *depth)
+{
+	MockWarp w;
+
+	MOCK_CALL(readSyscallCallDepth);
+	VERIFY_ARG(depth);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*depth = 0;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readVirtualReturnAddress)(uint32_t dev, uint32_t sm, uint32_t wp,
+				       uint32_t ln, uint32_t level,
+				       uint64_t *ra)
+{
+	MOCK_CALL(readVirtualReturnAddress);
+	VERIFY_ARG(ra);
+
+	return CUDBG_ERROR_INVALID_CALL_LEVEL;
+}
+
+/* Registers */
+
+DEF_API_CALL(readRegister)(uint32_t dev, uint32_t sm, uint32_t wp,
+			   uint32_t ln, uint32_t regno, uint32_t *val)
+{
+	MockWarp w;
+
+	MOCK_CALL(readRegister);
+	VERIFY_ARG(val);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (regno >= curcm->numRegs)
+		return CUDBG_ERROR_INVALID_ARGS;
+
+	*val = mockReadRegister(&w, sm, wp, ln, regno);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readRegisterRange)(uint32_t dev, uint32_t sm, uint32_t wp,
+				uint32_t ln, uint32_t index,
+				uint32_t registers_size, uint32_t *registers)
+{
+	MockWarp w;
+	uint32_t i;
+
+	MOCK_CALL(readRegisterRange);
+	VERIFY_ARG(registers);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (index > curcm->numRegs || registers_size > curcm->numRegs - index)
+		return CUDBG_ERROR_INVALID_ARGS;
+
+	for (i = 0; i < registers_size; ++i)
+		registers[i] = mockReadRegister(&w, sm, wp, ln, index + i);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(writeRegister)(uint32_t dev, uint32_t sm, uint32_t wp,
+			    uint32_t ln, uint32_t regno, uint32_t val)
+{
+	MockWarp w;
+
+	MOCK_CALL(writeRegister);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (regno >= curcm->numRegs)
+		return CUDBG_ERROR_INVALID_ARGS;
+
+	return mockAddWrite(MOCK_SEG_REGISTER, dev, sm, wp, ln, regno, val);
+}
+
+DEF_API_CALL(readPredicates)(uint32_t dev, uint32_t sm, uint32_t wp,
+			     uint32_t ln, uint32_t predicates_size,
+			     uint32_t *predicates)
+{
+	MockWarp w;
+
+	MOCK_CALL(readPredicates);
+	VERIFY_ARG(predicates);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (predicates_size > curcm->numPredicates)
+		return CUDBG_ERROR_INVALID_ARGS;
+
+	memset(predicates, 0, predicates_size * sizeof(uint32_t));
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readCCRegister)(uint32_t dev, uint32_t sm, uint32_t wp,
+			     uint32_t ln, uint32_t *val)
+{
+	MockWarp w;
+
+	MOCK_CALL(readCCRegister);
+	VERIFY_ARG(val);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+
+	*val = 0;
+
+	return CUDBG_SUCCESS;
+}
+
+/* Memory */
+
+DEF_API_CALL(readCodeMemory)(uint32_t dev, uint64_t addr, void *buf,
+			     uint32_t sz)
+{
+	MOCK_CALL(readCodeMemory);
+	VERIFY_ARG(buf);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+	if (addr < MOCK_CODE_BASE ||
+	    !mockInSegment(addr - MOCK_CODE_BASE, sz,
+			   mockFunctionEntry(curcm, curcm->numDevices, 0) -
+			   MOCK_CODE_BASE))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	memset(buf, 0, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readConstMemory)(uint32_t dev, uint64_t addr, void *buf,
+			      uint32_t sz)
+{
+	MOCK_CALL(readConstMemory);
+	VERIFY_ARG(buf);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+	if (!mockInSegment(addr, sz, curcm->constSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	mockReadMemory(MOCK_SEG_GLOBAL, 0, 0, 0, 0, 0, addr, buf, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(readParamMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+			      uint64_t addr, void *buf, uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(readParamMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+	if (!mockInSegment(addr, sz, curcm->paramSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	mockReadMemory(MOCK_SEG_PARAM, dev, w.grid, 0, 0,
+		       (uint64_t)w.grid << 24, addr, buf, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(writeParamMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+			       uint64_t addr, const void *buf, uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(writeParamMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+	if (!mockInSegment(addr, sz, curcm->paramSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	return mockWriteMemory(MOCK_SEG_PARAM, dev, w.grid, 0, 0, addr, buf,
+			       sz);
+}
+
+DEF_API_CALL(readSharedMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+			       uint64_t addr, void *buf, uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(readSharedMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+	if (!mockInSegment(addr, sz, curcm->sharedSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	/* Shared memory belongs to the block, not to the warp */
+	wp -= w.warp;
+	mockReadMemory(MOCK_SEG_SHARED, dev, sm, wp, 0,
+		       w.block << 16, addr, buf, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(writeSharedMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+				uint64_t addr, const void *buf, uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(writeSharedMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+	if (!mockInSegment(addr, sz, curcm->sharedSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	wp -= w.warp;
+	return mockWriteMemory(MOCK_SEG_SHARED, dev, sm, wp, 0, addr, buf, sz);
+}
+
+DEF_API_CALL(readLocalMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+			      uint32_t ln, uint64_t addr, void *buf,
+			      uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(readLocalMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (!mockInSegment(addr, sz, curcm->localSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	mockReadMemory(MOCK_SEG_LOCAL, dev, sm, wp, ln,
+		       mockGlobalThread(&w, ln) << 16, addr, buf, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(writeLocalMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+			       uint32_t ln, uint64_t addr, const void *buf,
+			       uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(writeLocalMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (!mockInSegment(addr, sz, curcm->localSize))
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	return mockWriteMemory(MOCK_SEG_LOCAL, dev, sm, wp, ln, addr, buf, sz);
+}
+
+/* Global memory starts at MOCK_GLOBAL_BASE and has no upper bound */
+
+DEF_API_CALL(readGlobalMemory)(uint64_t addr, void *buf, uint32_t sz)
+{
+	MOCK_CALL(readGlobalMemory);
+	VERIFY_ARG(buf);
+
+	if (addr < MOCK_GLOBAL_BASE)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	mockReadMemory(MOCK_SEG_GLOBAL, 0, 0, 0, 0, 0, addr, buf, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(writeGlobalMemory)(uint64_t addr, const void *buf, uint32_t sz)
+{
+	MOCK_CALL(writeGlobalMemory);
+	VERIFY_ARG(buf);
+
+	if (addr < MOCK_GLOBAL_BASE)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	return mockWriteMemory(MOCK_SEG_GLOBAL, 0, 0, 0, 0, addr, buf, sz);
+}
+
+DEF_API_CALL(readGenericMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+				uint32_t ln, uint64_t addr, void *buf,
+				uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(readGenericMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (addr < MOCK_GLOBAL_BASE)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	mockReadMemory(MOCK_SEG_GLOBAL, 0, 0, 0, 0, 0, addr, buf, sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(writeGenericMemory)(uint32_t dev, uint32_t sm, uint32_t wp,
+				 uint32_t ln, uint64_t addr, const void *buf,
+				 uint32_t sz)
+{
+	MockWarp w;
+
+	MOCK_CALL(writeGenericMemory);
+	VERIFY_ARG(buf);
+
+	if (!mockGetLane(dev, sm, wp, ln, &w))
+		return CUDBG_ERROR_INVALID_LANE;
+	if (addr < MOCK_GLOBAL_BASE)
+		return CUDBG_ERROR_INVALID_MEMORY_ACCESS;
+
+	return mockWriteMemory(MOCK_SEG_GLOBAL, 0, 0, 0, 0, addr, buf, sz);
+}
+
+/* Grid properties */
+
+DEF_API_CALL(getBlockDim)(uint32_t dev, uint32_t sm, uint32_t wp,
+			  CuDim3 *blockDim)
+{
+	MockWarp w;
+
+	MOCK_CALL(getBlockDim);
+	VERIFY_ARG(blockDim);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*blockDim = curcm->blockDim;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getGridDim)(uint32_t dev, uint32_t sm, uint32_t wp,
+			 CuDim3 *gridDim)
+{
+	MockWarp w;
+
+	MOCK_CALL(getGridDim);
+	VERIFY_ARG(gridDim);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*gridDim = curcm->gridDim;
+
+	return CUDBG_SUCCESS;
+}
+
+/* The image is relocated at build time: both kinds are the same */
+DEF_API_CALL(getElfImage32)(uint32_t dev, uint32_t sm, uint32_t wp,
+			    bool relocated, void **elfImage, uint32_t *size)
+{
+	MockWarp w;
+
+	MOCK_CALL(getElfImage32);
+	VERIFY_ARG(elfImage);
+	VERIFY_ARG(size);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*elfImage = curcm->elfImage[dev];
+	*size = (uint32_t)curcm->elfImageSize;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getElfImage)(uint32_t dev, uint32_t sm, uint32_t wp,
+			  bool relocated, void **elfImage, uint64_t *size)
+{
+	MockWarp w;
+
+	MOCK_CALL(getElfImage);
+	VERIFY_ARG(elfImage);
+	VERIFY_ARG(size);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*elfImage = curcm->elfImage[dev];
+	*size = curcm->elfImageSize;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getElfImageByHandle)(uint32_t dev, uint64_t handle,
+				  CUDBGElfImageType type, void *elfImage,
+				  uint64_t size)
+{
+	MOCK_CALL(getElfImageByHandle);
+	VERIFY_ARG(elfImage);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+	if (handle != MOCK_MODULE_ID + dev || size < curcm->elfImageSize)
+		return CUDBG_ERROR_INVALID_ARGS;
+
+	memcpy(elfImage, curcm->elfImage[dev], curcm->elfImageSize);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getTID)(uint32_t dev, uint32_t sm, uint32_t wp, uint32_t *tid)
+{
+	MockWarp w;
+
+	MOCK_CALL(getTID);
+	VERIFY_ARG(tid);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	*tid = MOCK_TID;
+
+	return CUDBG_SUCCESS;
+}
+
+/* With nested launches, the first grid launched the others */
+static CUDBGKernelOrigin mockGridOrigin(uint32_t grid, uint64_t *parentGridId)
+{
+	if (curcm->firstGrid && grid > 0) {
+		*parentGridId = 1;
+		return CUDBG_KNL_ORIGIN_GPU;
+	}
+
+	*parentGridId = 0;
+	return CUDBG_KNL_ORIGIN_CPU;
+}
+
+DEF_API_CALL(getGridInfo)(uint32_t dev, uint64_t gridId64,
+			  CUDBGGridInfo *info)
+{
+	MOCK_CALL(getGridInfo);
+	VERIFY_ARG(info);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+	if (gridId64 < 1 || gridId64 > curcm->numGrids)
+		return CUDBG_ERROR_INVALID_GRID;
+
+	memset(info, 0, sizeof(*info));
+	info->dev = dev;
+	info->gridId64 = gridId64;
+	info->tid = MOCK_TID;
+	info->context = MOCK_CONTEXT_ID + dev;
+	info->module = MOCK_MODULE_ID + dev;
+	info->function = mockFunctionEntry(curcm, dev, gridId64 - 1);
+	info->functionEntry = info->function;
+	info->gridDim = curcm->gridDim;
+	info->blockDim = curcm->blockDim;
+	info->type = CUDBG_KNL_TYPE_APPLICATION;
+	info->origin = mockGridOrigin(gridId64 - 1, &info->parentGridId);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getGridStatus)(uint32_t dev, uint64_t gridId64,
+			    CUDBGGridStatus *status)
+{
+	MOCK_CALL(getGridStatus);
+	VERIFY_ARG(status);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	if (gridId64 < 1 || gridId64 > curcm->numGrids)
+		*status = CUDBG_GRID_STATUS_INVALID;
+	else if (gridId64 - 1 < curcm->firstGrid)
+		*status = CUDBG_GRID_STATUS_TERMINATED;
+	else
+		*status = CUDBG_GRID_STATUS_ACTIVE;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getGridAttributes)(uint32_t dev, uint32_t sm, uint32_t wp,
+				CUDBGAttributeValuePair *pairs,
+				uint32_t numPairs)
+{
+	MockWarp w;
+	uint32_t pairId;
+
+	MOCK_CALL(getGridAttributes);
+	VERIFY_ARG(pairs);
+
+	if (!mockGetWarp(dev, sm, wp, &w))
+		return CUDBG_ERROR_INVALID_WARP;
+
+	for (pairId = 0; pairId < numPairs; ++pairId) {
+		switch (pairs[pairId].attribute) {
+		case CUDBG_ATTR_GRID_LAUNCH_BLOCKING:
+			pairs[pairId].value = 0;
+			break;
+		case CUDBG_ATTR_GRID_TID:
+			pairs[pairId].value = MOCK_TID;
+			break;
+		default:
+			return CUDBG_ERROR_INVALID_ATTRIBUTE;
+		}
+	}
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getGridAttribute)(uint32_t dev, uint32_t sm, uint32_t wp,
+			       CUDBGAttribute attr, uint64_t *value)
+{
+	CUDBGAttributeValuePair pair;
+	CUDBGResult res;
+
+	VERIFY_ARG(value);
+
+	pair.attribute = attr;
+
+	res = API_CALL(getGridAttributes)(dev, sm, wp, &pair, 1);
+	if (res != CUDBG_SUCCESS)
+		return res;
+
+	*value = pair.value;
+
+	return CUDBG_SUCCESS;
+}
+
+/* Code */
+
+DEF_API_CALL(disassemble)(uint32_t dev, uint64_t addr, uint32_t *instSize,
+			  char *buf, uint32_t sz)
+{
+	MOCK_CALL(disassemble);
+	VERIFY_ARG(instSize);
+	VERIFY_ARG(buf);
+
+	if (dev >= curcm->numDevices)
+		return CUDBG_ERROR_INVALID_DEVICE;
+
+	*instSize = MOCK_INSN_SIZE;
+	strncpy(buf, "NOP ;", sz);
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getAdjustedCodeAddress)(uint32_t dev, uint64_t address,
+				     uint64_t *adjustedAddress,
+				     CUDBGAdjAddrAction adjAction)
+{
+	MOCK_CALL(getAdjustedCodeAddress);
+	VERIFY_ARG(adjustedAddress);
+
+	*adjustedAddress = address;
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(isDeviceCodeAddress)(uintptr_t addr, bool *isDeviceAddress)
+{
+	MOCK_CALL(isDeviceCodeAddress);
+	VERIFY_ARG(isDeviceAddress);
+
+	*isDeviceAddress = addr >= MOCK_CODE_BASE &&
+			   addr < mockFunctionEntry(curcm, curcm->numDevices,
+						    0);
+
+	return CUDBG_SUCCESS;
+}
+
+/* The only symbols are the functions of the grids, on the first device */
+DEF_API_CALL(lookupDeviceCodeSymbol)(char *symName, bool *symFound,
+				     uintptr_t *symAddr)
+{
+	size_t len = strlen(MOCK_FUNCTION_PREFIX);
+	uint64_t grid;
+
+	MOCK_CALL(lookupDeviceCodeSymbol);
+	VERIFY_ARG(symName);
+	VERIFY_ARG(symFound);
+	VERIFY_ARG(symAddr);
+
+	*symFound = false;
+	*symAddr = 0x0;
+
+	if (strncmp(symName, MOCK_FUNCTION_PREFIX, len) == 0 &&
+	    !mockParseUInt(symName + len, &grid) && grid < curcm->numGrids) {
+		*symFound = true;
+		*symAddr = mockFunctionEntry(curcm, 0, grid);
+	}
+
+	return CUDBG_SUCCESS;
+}
+
+DEF_API_CALL(getManagedMemoryRegionInfo)(uint64_t startAddress,
+					 CUDBGMemoryInfo *memoryInfo,
+					 uint32_t memoryInfo_size,
+					 uint32_t *numEntries)
+{
+	MOCK_CALL(getManagedMemoryRegionInfo);
+	VERIFY_ARG(memoryInfo);
+	VERIFY_ARG(numEntries);
+
+	*numEntries = 0;
+
+	return CUDBG_SUCCESS;
+}
+
+/* Events: on every device, the context is created, its module is loaded,
+ * then every grid is launched.  With nested launches, the first grid then
+ * finishes. */
+
+DEF_API_CALL(getNextEvent)(CUDBGEventQueueType type, CUDBGEvent *event)
+{
+	uint32_t dev, step, grid, steps;
+
+	MOCK_CALL(getNextEvent);
+	VERIFY_ARG(event);
+
+	steps = curcm->numGrids + 2 + curcm->firstGrid;
+	dev = curcm->nextEvent / steps;
+	step = curcm->nextEvent % steps;
+
+	if (type == CUDBG_EVENT_QUEUE_TYPE_ASYNC || dev >= curcm->numDevices)
+		return CUDBG_ERROR_NO_EVENT_AVAILABLE;
+
+	memset(event, 0, sizeof(*event));
+
+	if (step == 0) {
+		event->kind = CUDBG_EVENT_CTX_CREATE;
+		event->cases.contextCreate.dev = dev;
+		event->cases.contextCreate.tid = MOCK_TID;
+		event->cases.contextCreate.context = MOCK_CONTEXT_ID + dev;
+	} else if (step == 1) {
+		event->kind = CUDBG_EVENT_ELF_IMAGE_LOADED;
+		event->cases.elfImageLoaded.dev = dev;
+		event->cases.elfImageLoaded.context = MOCK_CONTEXT_ID + dev;
+		event->cases.elfImageLoaded.module = MOCK_MODULE_ID + dev;
+		event->cases.elfImageLoaded.size = curcm->elfImageSize;
+		event->cases.elfImageLoaded.handle = MOCK_MODULE_ID + dev;
+	} else if (step == curcm->numGrids + 2) {
+		event->kind = CUDBG_EVENT_KERNEL_FINISHED;
+		event->cases.kernelFinished.dev = dev;
+		event->cases.kernelFinished.tid = MOCK_TID;
+		event->cases.kernelFinished.context = MOCK_CONTEXT_ID + dev;
+		event->cases.kernelFinished.module = MOCK_MODULE_ID + dev;
+		event->cases.kernelFinished.function =
+			mockFunctionEntry(curcm, dev, 0);
+		event->cases.kernelFinished.functionEntry =
+			event->cases.kernelFinished.function;
+		event->cases.kernelFinished.gridId = 1;
+	} else {
+		grid = step - 2;
+		event->kind = CUDBG_EVENT_KERNEL_READY;
+		event->cases.kernelReady.dev = dev;
+		event->cases.kernelReady.tid = MOCK_TID;
+		event->cases.kernelReady.gridId = grid + 1;
+		event->cases.kernelReady.context = MOCK_CONTEXT_ID + dev;
+		event->cases.kernelReady.module = MOCK_MODULE_ID + dev;
+		event->cases.kernelReady.function =
+			mockFunctionEntry(curcm, dev, grid);
+		event->cases.kernelReady.functionEntry =
+			event->cases.kernelReady.function;
+		event->cases.kernelReady.gridDim = curcm->gridDim;
+		event->cases.kernelReady.blockDim = curcm->blockDim;
+		event->cases.kernelReady.type = CUDBG_KNL_TYPE_APPLICATION;
+		event->cases.kernelReady.origin =
+			mockGridOrigin(grid,
+				       &event->cases.kernelReady.parentGridId);
+	}
+
+	++curcm->nextEvent;
+
+	return CUDBG_SUCCESS;
+}
+
+static const struct CUDBGAPI_st cudbgMockApi = {
+    /* Initialization */
+    API_CALL(doNothing),
+    API_CALL(doNothing),
+
+    /* Device Execution Control */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* Breakpoints */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* Device State Inspection */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(readThreadIdx),
+    API_CALL(readBrokenWarps),
+    API_CALL(readValidWarps),
+    API_CALL(readValidLanes),
+    API_CALL(readActiveLanes),
+    API_CALL(readCodeMemory),
+    API_CALL(readConstMemory),
+    API_CALL(notSupported),
+    API_CALL(readParamMemory),
+    API_CALL(readSharedMemory),
+    API_CALL(readLocalMemory),
+    API_CALL(readRegister),
+    API_CALL(readPC),
+    API_CALL(readVirtualPC),
+    API_CALL(readLaneStatus),
+
+    /* Device State Alteration */
+    API_CALL(notSupported),
+    API_CALL(writeParamMemory),
+    API_CALL(writeSharedMemory),
+    API_CALL(writeLocalMemory),
+    API_CALL(writeRegister),
+
+    /* Grid Properties */
+    API_CALL(notSupported),
+    API_CALL(getBlockDim),
+    API_CALL(getTID),
+    API_CALL(getElfImage32),
+
+    /* Device Properties */
+    API_CALL(getDeviceType),
+    API_CALL(getSmType),
+    API_CALL(getNumDevices),
+    API_CALL(getNumSMs),
+    API_CALL(getNumWarps),
+    API_CALL(getNumLanes),
+    API_CALL(getNumRegisters),
+
+    /* DWARF-related routines */
+    API_CALL(notSupported),
+    API_CALL(disassemble),
+    API_CALL(notSupported),
+    API_CALL(lookupDeviceCodeSymbol),
+
+    /* Events */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* 3.1 Extensions */
+    API_CALL(getGridAttribute),
+    API_CALL(getGridAttributes),
+    API_CALL(notSupported),
+    API_CALL(readLaneException),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* 3.1 - ABI */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* 3.2 Extensions */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* 4.0 Extensions */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(readBlockIdx),
+    API_CALL(getGridDim),
+    API_CALL(readCallDepth),
+    API_CALL(notSupported),
+    API_CALL(readVirtualReturnAddress),
+    API_CALL(getElfImage),
+
+    /* 4.1 Extensions */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(readSyscallCallDepth),
+
+    /* 4.2 Extensions */
+    API_CALL(notSupported),
+
+    /* 5.0 Extensions */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(memcheckReadErrorAddress),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+
+    /* 5.5 Extensions */
+    API_CALL(notSupported),
+    API_CALL(notSupported),
+    API_CALL(getGridInfo),
+    API_CALL(readGridId),
+    API_CALL(getGridStatus),
+    API_CALL(notSupported),
+    API_CALL(getDevicePCIBusInfo),
+    API_CALL(readDeviceExceptionState),
+
+   /* 6.0 Extensions */
+    API_CALL(getAdjustedCodeAddress),
+    API_CALL(readErrorPC),
+    API_CALL(getNextEvent),
+    API_CALL(getElfImageByHandle),
+    API_CALL(notSupported),
+    API_CALL(readWarpState),
+    API_CALL(readRegisterRange),
+    API_CALL(readGenericMemory),
+    API_CALL(writeGenericMemory),
+    API_CALL(readGlobalMemory),
+    API_CALL(writeGlobalMemory),
+    API_CALL(getManagedMemoryRegionInfo),
+    API_CALL(isDeviceCodeAddress),
+    API_CALL(notSupported),
+
+   /* 6.5 Extensions */
+    API_CALL(readPredicates),
+    API_CALL(notSupported),
+    API_CALL(getNumPredicates),
+    API_CALL(readCCRegister),
+    API_CALL(notSupported),
+
+    API_CALL(getDeviceName),
+};
+
+CudaMock *cuMockOpen(const char *config)
+{
+	CudaMock *cm;
+	uint32_t call, dev;
+
+	cm = calloc(1, sizeof(*cm));
+	VERIFY(cm != NULL, NULL, "Could not allocate memory");
+
+	cm->numDevices = 1;
+	cm->numSMs = 16;
+	cm->numWarps = 64;
+	cm->numLanes = 32;
+	cm->numRegs = 64;
+	cm->numPredicates = 7;
+	strcpy(cm->smType, "sm_35");
+	cm->numGrids = 1;
+	cm->gridDim.x = cm->gridDim.y = cm->gridDim.z = 1;
+	cm->blockDim.x = 256;
+	cm->blockDim.y = cm->blockDim.z = 1;
+	cm->numPCs = 1;
+	cm->paramSize = 256;
+	cm->sharedSize = 48 * 1024;
+	cm->localSize = 16 * 1024;
+	cm->constSize = 64 * 1024;
+
+	for (call = 0; call < MOCK_CALL_MAX; ++call)
+		cm->stats[call].name = mockCallNames[call];
+
+	if (mockConfigure(cm, config)) {
+		free(cm);
+		return NULL;
+	}
+
+	for (dev = 0; dev < cm->numDevices; ++dev)
+		if (mockBuildElfImage(cm, dev)) {
+			cuMockFree(cm);
+			return NULL;
+		}
+
+	return cm;
+}
+
+void cuMockFree(CudaMock *cm)
+{
+	MockWrite *write, *tmp;
+	uint32_t dev;
+
+	if (cm == NULL)
+		return;
+
+	HASH_ITER(hh, cm->writes, write, tmp) {
+		HASH_DEL(cm->writes, write);
+		free(write);
+	}
+
+	if (curcm == cm)
+		curcm = NULL;
+
+	for (dev = 0; dev < cm->numDevices; ++dev)
+		free(cm->elfImage[dev]);
+	free(cm);
+}
+
+CUDBGAPI cuMockGetApi(CudaMock *cm)
+{
+	curcm = cm;
+
+	return &cudbgMockApi;
+}
+
+size_t cuMockGetCallStats(CudaMock *cm, const CudaMockCallStats **stats)
+{
+	*stats = cm->stats;
+
+	return MOCK_CALL_MAX;
+}
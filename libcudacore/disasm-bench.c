@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2014-2015 NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Disassembly benchmark for CUDA core files.
+ *
+ * Disassembles COUNT consecutive instructions starting at the PC of the
+ * first valid lane of the core file, and reports the number of nvdisasm
+ * processes started and the wall time spent.
+ *
+ * Build:
+ *   cc -I. -I../include disasm-bench.c libcudacore.a -o disasm-bench
+ * Usage:
+ *   disasm-bench CORE [COUNT]
+ */
+
+#include "libcudacore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define DEFAULT_COUNT	200
+
+static int findFirstPC(CUDBGAPI api, uint32_t *dev, uint64_t *pc)
+{
+	uint32_t numDevices, numSMs, sm, wp, ln;
+	uint32_t validLanesMask;
+	uint64_t validWarpsMask;
+
+	if (api->getNumDevices(&numDevices) != CUDBG_SUCCESS)
+		return -1;
+
+	for (*dev = 0; *dev < numDevices; ++*dev) {
+		if (api->getNumSMs(*dev, &numSMs) != CUDBG_SUCCESS)
+			continue;
+
+		for (sm = 0; sm < numSMs; ++sm) {
+			if (api->readValidWarps(*dev, sm, &validWarpsMask) != CUDBG_SUCCESS)
+				continue;
+
+			for (wp = 0; wp < 64; ++wp) {
+				if (!((validWarpsMask >> wp) & 1))
+					continue;
+				if (api->readValidLanes(*dev, sm, wp, &validLanesMask) != CUDBG_SUCCESS)
+					continue;
+
+				for (ln = 0; ln < 32; ++ln)
+					if (((validLanesMask >> ln) & 1) &&
+					    api->readVirtualPC(*dev, sm, wp, ln, pc) == CUDBG_SUCCESS)
+						return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	CudaCore *cc;
+	CUDBGAPI api;
+	CudaCoreDisasmStats stats;
+	struct timeval start, end;
+	uint32_t dev, instSize;
+	uint64_t pc;
+	unsigned count, i;
+	char buf[256];
+	double ms;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s CORE [COUNT]\n", argv[0]);
+		return 2;
+	}
+
+	count = argc > 2 ? (unsigned)atoi(argv[2]) : DEFAULT_COUNT;
+
+	cc = cuCoreOpenByName(argv[1]);
+	if (cc == NULL) {
+		fprintf(stderr, "%s: %s\n", argv[1], cuCoreErrorMsg());
+		return 1;
+	}
+
+	api = cuCoreGetApi(cc);
+
+	if (findFirstPC(api, &dev, &pc) != 0) {
+		fprintf(stderr, "%s: no valid lane found\n", argv[1]);
+		cuCoreFree(cc);
+		return 1;
+	}
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < count; ++i, pc += instSize) {
+		if (api->disassemble(dev, pc, &instSize, buf, sizeof(buf)) != CUDBG_SUCCESS)
+			break;
+	}
+
+	gettimeofday(&end, NULL);
+
+	ms = (end.tv_sec - start.tv_sec) * 1e3 +
+	     (end.tv_usec - start.tv_usec) / 1e3;
+
+	cuCoreGetDisasmStats(cc, &stats);
+
+	printf("instructions: %u of %u\n", i, count);
+	printf("spawns:       %llu\n", (unsigned long long)stats.spawns);
+	printf("cache hits:   %llu\n", (unsigned long long)stats.cacheHits);
+	printf("wall time:    %.3f ms (%.3f ms per instruction)\n",
+	       ms, i ? ms / i : 0.0);
+
+	cuCoreFree(cc);
+
+	return 0;
+}
@@ -108,6 +108,83 @@ void cuCoreFree(CudaCore *cc);
  */
 CUDBGAPI cuCoreGetApi(CudaCore *cc);
 
+/**
+ * \brief Disassembly statistics of a core file.
+ */
+typedef struct {
+	uint64_t requests;	/**< Instructions requested */
+	uint64_t cacheHits;	/**< Requests answered from the cache */
+	uint64_t spawns;	/**< Disassembler processes started */
+	uint64_t instructions;	/**< Instructions parsed from their output */
+} CudaCoreDisasmStats;
+
+/**
+ * \brief Get disassembly statistics.
+ * \param cc CudaCore object returned by a previous call to one of
+ *           cuCoreOpen*() functions.
+ * \param stats Statistics to fill in.
+ *
+ * Instructions are disassembled one function at a time and cached for the
+ * lifetime of the CudaCore object. This function reports how many requests
+ * were served, and how many disassembler processes they required.
+ */
+void cuCoreGetDisasmStats(CudaCore *cc, CudaCoreDisasmStats *stats);
+
+typedef struct CudaMock_st CudaMock;
+
+/**
+ * \brief Create one or more simulated devices.
+ * \param config Comma-separated list of \c name=value parameters:
+ *        \c devices, \c sms, \c warps (per SM), \c lanes (per warp),
+ *        \c regs, \c smtype, \c grids (per device), \c grid and
+ *        \c block (as \c XxYxZ), \c threads (per grid, split over the
+ *        devices, instead of \c grid), \c nested (the first grid
+ *        launches the others from the device, then finishes), \c pcs
+ *        (distinct lane PCs), \c exceptions (warps with an exception),
+ *        \c shared and \c local (memory sizes in bytes) and \c latency
+ *        (delay of every API call in microseconds).
+ * \return CudaMock object which should be used by subsequent calls
+ *         to cuMock*() functions. On error NULL is returned, and
+ *         cuCoreErrorMsg() describes the error.
+ * \sa cuMockGetApi(), cuMockFree()
+ *
+ * The simulated device computes its state from the parameters, so that
+ * the debugger can be exercised on large grids without a GPU.  Unless
+ * \c devices and \c sms are given, there are enough of them for every
+ * block of \c threads to be resident, up to the limits of the debugger
+ * API.
+ */
+CudaMock *cuMockOpen(const char *config);
+
+/**
+ * \brief Free the simulated device.
+ * \param cm CudaMock object returned by cuMockOpen().
+ */
+void cuMockFree(CudaMock *cm);
+
+/**
+ * \brief Get CUDA debugger API of the simulated device.
+ * \param cm CudaMock object returned by cuMockOpen().
+ * \return CUDBGAPI structure pointer, valid until cuMockFree() is called.
+ */
+CUDBGAPI cuMockGetApi(CudaMock *cm);
+
+/**
+ * \brief Number of calls of an API entry point of the simulated device.
+ */
+typedef struct {
+	const char *name;	/**< API entry point */
+	uint64_t calls;		/**< Number of calls */
+} CudaMockCallStats;
+
+/**
+ * \brief Get API call statistics of the simulated device.
+ * \param cm CudaMock object returned by cuMockOpen().
+ * \param stats Set to the statistics, valid until cuMockFree() is called.
+ * \return Number of entries of \p stats.
+ */
+size_t cuMockGetCallStats(CudaMock *cm, const CudaMockCallStats **stats);
+
 #ifdef __cplusplus
 }
 #endif